@@ -164,8 +164,6 @@ static void alarm_play_cycle(void)
         } else if (tone > 9) {
             tone = 1;
         }
-        audio_i2s_write_silence(50);
-        audio_i2s_reset();
         if (force_tone) {
             alarm_tone_play(tone, s_alarm_volume, 0);
         } else {
@@ -188,8 +186,6 @@ static void alarm_playback_task(void *arg)
             alarm_sound_stop();
             alarm_tone_stop();
             audio_stop();
-            audio_i2s_write_silence(50);
-            audio_i2s_reset();
             if (s_repeat_done >= s_repeat_total) {
                 alarm_playback_deinit(true);
                 return;
@@ -198,8 +194,6 @@ static void alarm_playback_task(void *arg)
             alarm_sound_stop();
             alarm_tone_stop();
             audio_stop();
-            audio_i2s_write_silence(50);
-            audio_i2s_reset();
             s_repeat_done = 0;
         }
     }
@@ -250,8 +244,6 @@ static void alarm_playback_deinit(bool from_task)
     alarm_sound_stop();
     alarm_tone_stop();
     audio_stop();
-    audio_i2s_write_silence(50);
-    audio_i2s_reset();
     alarm_sound_deinit();
 
     if (s_repeat_timer) {
@@ -140,10 +140,17 @@ void app_main(void)
     led_indicator_init();
     audio_init();
     alarm_playback_init();
-    audio_eq_set_steps(s_cfg.eq_low, s_cfg.eq_high);
+    for (uint8_t band = 0; band < audio_eq_get_band_count(); ++band) {
+        uint8_t *step = config_eq_step(&s_cfg, band, audio_eq_get_band_count());
+        if (step) {
+            audio_eq_set_band_step(band, *step);
+        }
+    }
     audio_set_volume(app_volume_steps_to_byte(s_cfg.volume));
+    audio_set_loudness(s_cfg.loudness_enabled);
     storage_sd_init();
     audio_player_set_volume(app_volume_steps_to_byte(s_cfg.volume));
+    audio_player_set_crossfade_ms(s_cfg.crossfade_ms);
     bt_avrc_notify_volume(app_volume_steps_to_byte(s_cfg.volume));
     wifi_init(&s_cfg);
     ui_input_init(ui_input_handle_encoder, ui_input_handle_adc_key);
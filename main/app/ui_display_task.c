@@ -76,6 +76,16 @@ static void show_player_status(void)
         return;
     }
 
+    uint32_t found = 0;
+    if (audio_player_get_scan_progress(&found)) {
+        // Library scan still running: show what it has found and check back.
+        char text[5];
+        snprintf(text, sizeof(text), "S%3u", (unsigned)(found > 999 ? 999 : found));
+        display_ui_show_text(text, 800);
+        schedule_player_status(esp_timer_get_time());
+        return;
+    }
+
     uint16_t count = audio_player_get_track_count();
     if (count == 0) {
         display_ui_show_text("NOFL", 1200);
@@ -184,12 +194,12 @@ static void start_bt_overlay(void)
     display_ui_show_text("BLUE", TRACK_NUMBER_MS);
 }
 
-static bool music_is_playing(app_ui_mode_t mode)
+static bool music_is_playing(app_ui_mode_t mode, const audio_player_status_t *player)
 {
     if (mode == APP_UI_MODE_BLUETOOTH) {
         return bt_sink_is_streaming();
     }
-    return (audio_player_get_state() == PLAYER_STATE_PLAYING);
+    return (player->state == PLAYER_STATE_PLAYING);
 }
 
 static void render_clock_or_placeholder(void)
@@ -295,10 +305,12 @@ static void display_task(void *arg)
                 s_post_mode_pending = false;
             }
         }
-        bool music_playing = music_is_playing(mode);
+        // One lock-free snapshot per pass keeps track, count and time consistent.
+        audio_player_status_t player;
+        audio_player_get_status(&player);
+        bool music_playing = music_is_playing(mode, &player);
         bool bt_streaming = (mode == APP_UI_MODE_BLUETOOTH) ? bt_sink_is_streaming() : false;
-        bool audio_playing = (mode == APP_UI_MODE_PLAYER) ? (audio_player_get_state() == PLAYER_STATE_PLAYING)
-                                                          : false;
+        bool audio_playing = (mode == APP_UI_MODE_PLAYER) ? (player.state == PLAYER_STATE_PLAYING) : false;
 
         if (mode == APP_UI_MODE_BLUETOOTH) {
             int64_t now_us = esp_timer_get_time();
@@ -342,9 +354,9 @@ static void display_task(void *arg)
         }
 
         if (s_overlays_enabled && audio_playing) {
-            uint16_t track = audio_player_get_track_index();
+            uint16_t track = player.track_index;
             if (track != 0 && track != last_track) {
-                start_track_overlay(track, audio_player_get_track_count());
+                start_track_overlay(track, player.track_count);
             }
             last_track = track;
         } else {
@@ -355,8 +367,7 @@ static void display_task(void *arg)
             int64_t now_us = esp_timer_get_time();
             if (now_us >= s_next_overlay_us) {
                 if (audio_playing) {
-                    start_track_overlay(audio_player_get_track_index(),
-                                        audio_player_get_track_count());
+                    start_track_overlay(player.track_index, player.track_count);
                 } else if (bt_streaming) {
                     start_bt_overlay();
                 }
@@ -375,7 +386,8 @@ static void display_task(void *arg)
                 uint32_t elapsed_ms = 0;
                 uint32_t total_ms = 0;
                 if (audio_playing) {
-                    audio_player_get_time_ms(&elapsed_ms, &total_ms);
+                    elapsed_ms = player.elapsed_ms;
+                    total_ms = player.total_ms;
                 }
                 uint32_t remaining_ms = 0;
                 if (total_ms > elapsed_ms) {
@@ -41,6 +41,8 @@ typedef enum {
     MENU_SET_BRIGHTNESS,
     MENU_SET_WEB,
     MENU_SET_POWER_SAVE,
+    MENU_SET_LOUDNESS,
+    MENU_SET_CROSSFADE,
     MENU_SET_COUNT
 } menu_set_item_t;
 
@@ -160,8 +162,6 @@ static void menu_alarm_tone_preview_enter(void)
 
     alarm_sound_stop();
     audio_stop();
-    audio_i2s_write_silence(50);
-    audio_i2s_reset();
     s_alarm_tone_preview_pending = true;
     s_alarm_tone_preview_change_us = menu_now_us();
 }
@@ -170,8 +170,6 @@ static void menu_alarm_tone_preview_exit(void)
 {
     alarm_sound_stop();
     audio_stop();
-    audio_i2s_write_silence(50);
-    audio_i2s_reset();
 
     if (s_alarm_tone_resume_player) {
         audio_player_play();
@@ -337,6 +335,16 @@ static void menu_render_item(void)
         case MENU_SET_POWER_SAVE:
             memcpy(text, s_cfg && s_cfg->power_save_enabled ? "POn " : "POFF", 4);
             break;
+        case MENU_SET_LOUDNESS:
+            memcpy(text, s_cfg && s_cfg->loudness_enabled ? "LdOn" : "LdOF", 4);
+            break;
+        case MENU_SET_CROSSFADE:
+            if (s_cfg && s_cfg->crossfade_ms > 0) {
+                snprintf(text, sizeof(text), "CF%2u", (unsigned)(s_cfg->crossfade_ms / 1000U));
+            } else {
+                memcpy(text, "CFOF", 4);
+            }
+            break;
         default:
             memcpy(text, "SEt ", 4);
             break;
@@ -416,10 +424,15 @@ static void menu_render_eq(void)
     if (!s_cfg) {
         return;
     }
-    uint8_t value = (s_eq_select == 0) ? s_cfg->eq_low : s_cfg->eq_high;
+    uint8_t *step = config_eq_step(s_cfg, s_eq_select, audio_eq_get_band_count());
+    if (!step) {
+        return;
+    }
+    uint8_t value = *step;
+    const char *label = audio_eq_get_band_label(s_eq_select);
     char text[4];
-    text[0] = (s_eq_select == 0) ? 'L' : 'H';
-    text[1] = (s_eq_select == 0) ? 'o' : 'i';
+    text[0] = label[0];
+    text[1] = label[1];
     text[2] = (char)('0' + (value / 10));
     text[3] = (char)('0' + (value % 10));
     display_set_text(text, false);
@@ -698,7 +711,7 @@ ui_menu_action_t ui_menu_handle_encoder(encoder_event_t event, app_ui_mode_t *ou
 
     if (event == ENC_EVENT_BTN_SHORT) {
         if (s_menu_state == MENU_STATE_EQ) {
-            s_eq_select = (uint8_t)(s_eq_select ^ 1U);
+            s_eq_select = (uint8_t)((s_eq_select + 1U) % audio_eq_get_band_count());
             return UI_MENU_ACTION_HANDLED;
         }
         if (s_menu_state == MENU_STATE_BRIGHTNESS) {
@@ -778,6 +791,19 @@ ui_menu_action_t ui_menu_handle_encoder(encoder_event_t event, app_ui_mode_t *ou
                     menu_request_cfg_update();
                     power_manager_set_autonomous(s_cfg->power_save_enabled);
                     break;
+                case MENU_SET_LOUDNESS:
+                    s_cfg->loudness_enabled = !s_cfg->loudness_enabled;
+                    menu_request_cfg_update();
+                    audio_set_loudness(s_cfg->loudness_enabled);
+                    break;
+                case MENU_SET_CROSSFADE:
+                    // Off, 2, 4 ... 10 s, then off again.
+                    s_cfg->crossfade_ms = (s_cfg->crossfade_ms >= APP_CROSSFADE_MAX_MS)
+                                              ? 0
+                                              : (uint16_t)(s_cfg->crossfade_ms + APP_CROSSFADE_STEP_MS);
+                    menu_request_cfg_update();
+                    audio_player_set_crossfade_ms(s_cfg->crossfade_ms);
+                    break;
                 default:
                     break;
             }
@@ -840,16 +866,18 @@ ui_menu_action_t ui_menu_handle_encoder(encoder_event_t event, app_ui_mode_t *ou
             s_cfg->display_brightness = *s_display_brightness;
             menu_brightness_touch();
         } else if (s_menu_state == MENU_STATE_EQ) {
-            uint8_t *target = (s_eq_select == 0) ? &s_cfg->eq_low : &s_cfg->eq_high;
-            int value = (int)(*target) + delta;
-            if (value < 0) {
-                value = 0;
-            } else if (value > 30) {
-                value = 30;
+            uint8_t *target = config_eq_step(s_cfg, s_eq_select, audio_eq_get_band_count());
+            if (target) {
+                int value = (int)(*target) + delta;
+                if (value < 0) {
+                    value = 0;
+                } else if (value > APP_EQ_STEP_MAX) {
+                    value = APP_EQ_STEP_MAX;
+                }
+                *target = (uint8_t)value;
+                audio_eq_set_band_step(s_eq_select, *target);
+                menu_eq_touch();
             }
-            *target = (uint8_t)value;
-            audio_eq_set_steps(s_cfg->eq_low, s_cfg->eq_high);
-            menu_eq_touch();
         } else if (s_menu_state == MENU_STATE_ALARM_TIME) {
             if (s_alarm_time_select == 0) {
                 int hour = (int)(s_alarm_time_editing ? s_alarm_time_hour : s_cfg->alarm_hour);
@@ -911,8 +939,6 @@ ui_menu_action_t ui_menu_handle_encoder(encoder_event_t event, app_ui_mode_t *ou
                 menu_request_cfg_update();
                 alarm_sound_stop();
                 audio_stop();
-                audio_i2s_write_silence(50);
-                audio_i2s_reset();
                 s_alarm_tone_preview_pending = true;
                 s_alarm_tone_preview_change_us = menu_now_us();
             }
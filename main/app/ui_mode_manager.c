@@ -552,8 +552,6 @@ static void stop_player_and_flush(void)
         vTaskDelay(pdMS_TO_TICKS(10));
     }
     audio_player_shutdown();
-    audio_i2s_write_silence(120);
-    audio_i2s_reset();
 }
 
 #if UI_MODE_HEAP_LOG
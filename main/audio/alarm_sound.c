@@ -1,7 +1,7 @@
 #include "alarm_sound.h"
 
 #include "app_control.h"
-#include "audio_owner.h"
+#include "audio_mixer.h"
 #include "audio_pcm5102.h"
 #include "helix_mp3_wrapper.h"
 #include "storage_sd_spi.h"
@@ -47,7 +47,6 @@ static QueueHandle_t s_cmd_queue = NULL;
 static TaskHandle_t s_task = NULL;
 static volatile bool s_stop_requested = false;
 static volatile bool s_playing = false;
-static uint8_t s_alarm_vol_percent = 100;
 
 static bool alarm_is_mp3_file(const char *name)
 {
@@ -157,45 +156,18 @@ static bool alarm_sound_get_path_by_index(uint8_t index, char *out, size_t out_l
     return found;
 }
 
-static void alarm_flush_silence(void)
-{
-    static const uint8_t zeros[1024] = {0};
-    size_t written = 0;
-    for (int i = 0; i < 12; ++i) {
-        if (s_stop_requested) {
-            break;
-        }
-        audio_i2s_write(zeros, sizeof(zeros), &written, 20);
-    }
-}
-
-static size_t alarm_mp3_write_cb(const uint8_t *data, size_t len, void *user)
+static size_t alarm_mp3_write_cb(uint8_t *data, size_t len, void *user)
 {
     (void)user;
     if (s_stop_requested) {
         return 0;
     }
     size_t written = 0;
-    const uint8_t *out = data;
-    size_t out_len = len;
-    if (s_alarm_vol_percent < 100 && len >= sizeof(int16_t)) {
-        static int16_t s_mp3_buf[1152 * 2];
-        size_t samples = len / sizeof(int16_t);
-        if (samples > (sizeof(s_mp3_buf) / sizeof(s_mp3_buf[0]))) {
-            samples = sizeof(s_mp3_buf) / sizeof(s_mp3_buf[0]);
-        }
-        const int16_t *in = (const int16_t *)data;
-        for (size_t i = 0; i < samples; ++i) {
-            s_mp3_buf[i] = (int16_t)(((int32_t)in[i] * s_alarm_vol_percent) / 100);
-        }
-        out = (const uint8_t *)s_mp3_buf;
-        out_len = samples * sizeof(int16_t);
-    }
+    size_t out_len = len & ~(sizeof(int16_t) - 1U);
     int64_t start_us = esp_timer_get_time();
-    if (audio_i2s_write(out, out_len, &written, ALARM_I2S_TIMEOUT_MS) != ESP_OK) {
+    if (audio_mixer_write(AUDIO_SOURCE_ALARM, data, out_len, &written, ALARM_I2S_TIMEOUT_MS) != ESP_OK) {
         int64_t dur_us = esp_timer_get_time() - start_us;
-        ESP_LOGW(TAG, "i2s write failed (owner=%s, len=%u, wrote=%u, dt=%lldus)",
-                 audio_owner_name(audio_owner_get()),
+        ESP_LOGW(TAG, "mixer write failed (len=%u, wrote=%u, dt=%lldus)",
                  (unsigned)out_len, (unsigned)written, (long long)dur_us);
         return 0;
     }
@@ -205,6 +177,14 @@ static size_t alarm_mp3_write_cb(const uint8_t *data, size_t len, void *user)
     return written;
 }
 
+static uint32_t alarm_mp3_format_cb(uint32_t sample_rate, void *user)
+{
+    (void)sample_rate;
+    (void)user;
+    // Never reclock under whatever else is playing; resample to the output.
+    return audio_i2s_get_sample_rate();
+}
+
 static void alarm_mp3_progress_cb(size_t bytes_read,
                                   size_t total_bytes,
                                   uint32_t elapsed_ms,
@@ -228,12 +208,12 @@ static void alarm_mp3_progress_cb(size_t bytes_read,
     }
 }
 
-static int alarm_volume_percent(uint8_t steps)
+static int32_t alarm_volume_gain(uint8_t steps)
 {
     if (steps > APP_VOLUME_MAX) {
         steps = APP_VOLUME_MAX;
     }
-    return (int)((steps * 100U + (APP_VOLUME_MAX / 2U)) / APP_VOLUME_MAX);
+    return (int32_t)((steps * (uint32_t)AUDIO_MIXER_UNITY + (APP_VOLUME_MAX / 2U)) / APP_VOLUME_MAX);
 }
 
 static void alarm_play_index(uint8_t index, uint8_t volume_steps, uint32_t preview_ms)
@@ -248,9 +228,7 @@ static void alarm_play_index(uint8_t index, uint8_t volume_steps, uint32_t previ
     }
 
     uint32_t played_ms = 0;
-    int vol_percent = alarm_volume_percent(volume_steps);
-    s_alarm_vol_percent = (uint8_t)vol_percent;
-    audio_i2s_set_sample_rate(44100);
+    audio_mixer_set_gain(AUDIO_SOURCE_ALARM, alarm_volume_gain(volume_steps));
     s_stop_requested = false;
 
     while (!s_stop_requested && (preview_ms == 0 || played_ms < preview_ms)) {
@@ -260,9 +238,10 @@ static void alarm_play_index(uint8_t index, uint8_t volume_steps, uint32_t previ
             .last_elapsed_ms = 0,
             .last_est_total_ms = 0
         };
+        // Volume is the alarm source's mixer gain.
         bool ok = helix_mp3_decode_file(path,
-                                        vol_percent,
                                         alarm_mp3_write_cb,
+                                        alarm_mp3_format_cb,
                                         NULL,
                                         alarm_mp3_progress_cb,
                                         &ctx,
@@ -288,10 +267,6 @@ static void alarm_play_index(uint8_t index, uint8_t volume_steps, uint32_t previ
         }
         played_ms += span_ms;
     }
-
-    if (!s_stop_requested) {
-        alarm_flush_silence();
-    }
 }
 
 static uint32_t alarm_builtin_duration_ms(uint8_t tone)
@@ -413,10 +388,8 @@ void alarm_sound_stop(void)
 {
     s_stop_requested = true;
     audio_stop();
-    alarm_flush_silence();
-    audio_i2s_write_silence(50);
-    audio_i2s_reset();
-    audio_owner_release(AUDIO_OWNER_ALARM);
+    audio_mixer_flush(AUDIO_SOURCE_ALARM);
+    audio_mixer_close(AUDIO_SOURCE_ALARM);
     if (!s_cmd_queue) {
         return;
     }
@@ -441,7 +414,7 @@ bool alarm_sound_play_index(uint8_t index, uint8_t volume_steps, uint32_t previe
     if (!alarm_sound_ensure_init()) {
         return false;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_ALARM, true)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_ALARM)) {
         return false;
     }
     alarm_cmd_t cmd = {
@@ -461,7 +434,7 @@ bool alarm_sound_play_builtin(uint8_t tone, uint8_t volume_steps, uint32_t durat
     if (!alarm_sound_ensure_init()) {
         return false;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_ALARM, true)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_ALARM)) {
         return false;
     }
     alarm_cmd_t cmd = {
@@ -1,7 +1,7 @@
 #include "alarm_tone.h"
 
 #include "app_control.h"
-#include "audio_owner.h"
+#include "audio_mixer.h"
 #include "audio_pcm5102.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
@@ -131,7 +131,7 @@ bool alarm_tone_play(uint8_t tone, uint8_t volume_steps, uint32_t duration_ms)
     if (!alarm_tone_ensure_init()) {
         return false;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_ALARM, true)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_ALARM)) {
         return false;
     }
     alarm_tone_cmd_t cmd = {
@@ -149,9 +149,8 @@ void alarm_tone_stop(void)
 {
     s_stop_requested = true;
     audio_stop();
-    audio_i2s_write_silence(50);
-    audio_i2s_reset();
-    audio_owner_release(AUDIO_OWNER_ALARM);
+    audio_mixer_flush(AUDIO_SOURCE_ALARM);
+    audio_mixer_close(AUDIO_SOURCE_ALARM);
     if (!s_cmd_queue) {
         return;
     }
@@ -1,152 +1,144 @@
 #include "audio_eq.h"
 
+#include "audio_eq_tables.h"
+
 #include <math.h>
+#include <string.h>
+
+// 1 runs the bands in Q2.29 fixed point, 0 in float (reference).
+#ifndef AUDIO_EQ_FIXED
+#define AUDIO_EQ_FIXED 1
+#endif
+
+#define AUDIO_EQ_RAMP_STEPS 32      // sub-blocks, 2048 frames, ~46 ms at 44.1 kHz
 
-#define AUDIO_EQ_LOW_HZ 150.0f
-#define AUDIO_EQ_HIGH_HZ 5000.0f
-#define AUDIO_EQ_MAX_STEP 30
-#define AUDIO_EQ_CENTER_STEP 15
-#define AUDIO_EQ_RANGE_DB 12.0f
+#if AUDIO_EQ_FIXED
+typedef int32_t eq_sample_t;
+#else
+typedef float eq_sample_t;
+#endif
 
+// One direct-form-I stage per band and channel. In fixed point each stage
+// keeps the bits it drops when requantizing and adds them to the next sample
+// (first-order error feedback), so truncation noise is shaped away from DC
+// and cannot sustain limit cycles.
 typedef struct {
-    float b0;
-    float b1;
-    float b2;
-    float a1;
-    float a2;
-    float z1[2];
-    float z2[2];
-} biquad_t;
-
-static uint32_t s_sample_rate = 44100;
-static uint8_t s_low_step = AUDIO_EQ_CENTER_STEP;
-static uint8_t s_high_step = AUDIO_EQ_CENTER_STEP;
-static bool s_ready = false;
+    eq_sample_t x1, x2;
+    eq_sample_t y1, y2;
+    int32_t e;
+} eq_stage_t;
+
+// Requests from the UI/audio tasks; audio_eq_begin() applies them on the
+// output task, which alone owns the coefficients and filter state below.
+static uint8_t s_req_step[AUDIO_EQ_BANDS];
+static uint32_t s_req_rate = 44100;
+static uint32_t s_req_gen = 1;
+
+static uint32_t s_applied_gen;
+static uint8_t s_rate_idx = 0xFF;
+static int32_t s_cur[AUDIO_EQ_BANDS][5];
+static int32_t s_delta[AUDIO_EQ_BANDS][5];
+static const int32_t *s_target[AUDIO_EQ_BANDS];
+static uint8_t s_ramp_left;
+static uint8_t s_active;            // bit per band that has to run
 static bool s_flat = true;
-static biquad_t s_low;
-static biquad_t s_high;
+static eq_stage_t s_stage[2][AUDIO_EQ_BANDS];
 
-static float step_to_db(uint8_t step)
+static uint8_t eq_rate_index(uint32_t sample_rate)
 {
-    if (step > AUDIO_EQ_MAX_STEP) {
-        step = AUDIO_EQ_MAX_STEP;
+    // Other rates use the nearest table; band centres shift by the ratio.
+    uint8_t best = 0;
+    uint32_t best_diff = UINT32_MAX;
+    for (uint8_t i = 0; i < AUDIO_EQ_RATE_COUNT; ++i) {
+        uint32_t r = audio_eq_rates[i];
+        uint32_t diff = (r > sample_rate) ? (r - sample_rate) : (sample_rate - r);
+        if (diff < best_diff) {
+            best_diff = diff;
+            best = i;
+        }
     }
-    float delta = (float)((int)step - AUDIO_EQ_CENTER_STEP);
-    return delta * (AUDIO_EQ_RANGE_DB / (float)AUDIO_EQ_MAX_STEP);
+    return best;
 }
 
-static void biquad_reset(biquad_t *bq)
+static bool eq_band_is_identity(uint8_t band)
 {
-    bq->z1[0] = 0.0f;
-    bq->z1[1] = 0.0f;
-    bq->z2[0] = 0.0f;
-    bq->z2[1] = 0.0f;
+    const int32_t *c = s_cur[band];
+    return c[0] == (1 << AUDIO_EQ_COEF_BITS) && c[1] == 0 && c[2] == 0 && c[3] == 0 && c[4] == 0;
 }
 
-static void biquad_set_identity(biquad_t *bq)
+// A band at identity is skipped unless it is about to leave it: it then runs
+// the identity coefficients first, which leaves its history current.
+static void eq_update_active(void)
 {
-    bq->b0 = 1.0f;
-    bq->b1 = 0.0f;
-    bq->b2 = 0.0f;
-    bq->a1 = 0.0f;
-    bq->a2 = 0.0f;
-    biquad_reset(bq);
-}
-
-static void biquad_design_low_shelf(biquad_t *bq, float fs, float freq, float gain_db)
-{
-    if (gain_db == 0.0f) {
-        biquad_set_identity(bq);
-        return;
+    s_active = 0;
+    for (uint8_t b = 0; b < AUDIO_EQ_BANDS; ++b) {
+        bool moving = s_ramp_left > 0 && memcmp(s_cur[b], s_target[b], sizeof(s_cur[b])) != 0;
+        if (moving || !eq_band_is_identity(b)) {
+            s_active |= (uint8_t)(1U << b);
+        }
     }
-
-    float A = powf(10.0f, gain_db / 40.0f);
-    float w0 = 2.0f * 3.1415926535f * freq / fs;
-    if (w0 > 3.1415926535f * 0.99f) {
-        w0 = 3.1415926535f * 0.99f;
-    }
-    float cosw0 = cosf(w0);
-    float sinw0 = sinf(w0);
-    float sqrtA = sqrtf(A);
-    float alpha = sinw0 / 2.0f * sqrtf(2.0f);
-
-    float b0 = A * ((A + 1.0f) - (A - 1.0f) * cosw0 + 2.0f * sqrtA * alpha);
-    float b1 = 2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosw0);
-    float b2 = A * ((A + 1.0f) - (A - 1.0f) * cosw0 - 2.0f * sqrtA * alpha);
-    float a0 = (A + 1.0f) + (A - 1.0f) * cosw0 + 2.0f * sqrtA * alpha;
-    float a1 = -2.0f * ((A - 1.0f) + (A + 1.0f) * cosw0);
-    float a2 = (A + 1.0f) + (A - 1.0f) * cosw0 - 2.0f * sqrtA * alpha;
-
-    bq->b0 = b0 / a0;
-    bq->b1 = b1 / a0;
-    bq->b2 = b2 / a0;
-    bq->a1 = a1 / a0;
-    bq->a2 = a2 / a0;
-    biquad_reset(bq);
+    s_flat = (s_active == 0);
 }
 
-static void biquad_design_high_shelf(biquad_t *bq, float fs, float freq, float gain_db)
+// Picks up pending requests. A step change ramps every band from its current
+// coefficients to the new table entry without touching the filter state; a
+// line between two stable biquads stays inside the (a1, a2) stability
+// triangle, so every intermediate filter is stable too. A rate change jumps
+// straight to the new table since the output restarts anyway.
+static void eq_apply_requests(void)
 {
-    if (gain_db == 0.0f) {
-        biquad_set_identity(bq);
+    uint32_t gen = __atomic_load_n(&s_req_gen, __ATOMIC_ACQUIRE);
+    if (gen == s_applied_gen) {
         return;
     }
+    s_applied_gen = gen;
+    uint8_t rate_idx = eq_rate_index(__atomic_load_n(&s_req_rate, __ATOMIC_RELAXED));
+    bool jump = (rate_idx != s_rate_idx);
+    s_rate_idx = rate_idx;
 
-    float A = powf(10.0f, gain_db / 40.0f);
-    float w0 = 2.0f * 3.1415926535f * freq / fs;
-    if (w0 > 3.1415926535f * 0.99f) {
-        w0 = 3.1415926535f * 0.99f;
-    }
-    float cosw0 = cosf(w0);
-    float sinw0 = sinf(w0);
-    float sqrtA = sqrtf(A);
-    float alpha = sinw0 / 2.0f * sqrtf(2.0f);
-
-    float b0 = A * ((A + 1.0f) + (A - 1.0f) * cosw0 + 2.0f * sqrtA * alpha);
-    float b1 = -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosw0);
-    float b2 = A * ((A + 1.0f) + (A - 1.0f) * cosw0 - 2.0f * sqrtA * alpha);
-    float a0 = (A + 1.0f) - (A - 1.0f) * cosw0 + 2.0f * sqrtA * alpha;
-    float a1 = 2.0f * ((A - 1.0f) - (A + 1.0f) * cosw0);
-    float a2 = (A + 1.0f) - (A - 1.0f) * cosw0 - 2.0f * sqrtA * alpha;
-
-    bq->b0 = b0 / a0;
-    bq->b1 = b1 / a0;
-    bq->b2 = b2 / a0;
-    bq->a1 = a1 / a0;
-    bq->a2 = a2 / a0;
-    biquad_reset(bq);
+    for (uint8_t b = 0; b < AUDIO_EQ_BANDS; ++b) {
+        uint8_t step = __atomic_load_n(&s_req_step[b], __ATOMIC_RELAXED);
+        s_target[b] = audio_eq_coefs[rate_idx][b][step];
+        for (int k = 0; k < 5; ++k) {
+            if (jump) {
+                s_cur[b][k] = s_target[b][k];
+                s_delta[b][k] = 0;
+            } else {
+                s_delta[b][k] = (s_target[b][k] - s_cur[b][k]) / AUDIO_EQ_RAMP_STEPS;
+            }
+        }
+    }
+    if (jump) {
+        memset(s_stage, 0, sizeof(s_stage));
+        s_ramp_left = 0;
+    } else {
+        s_ramp_left = AUDIO_EQ_RAMP_STEPS;
+    }
+    eq_update_active();
 }
 
-static void audio_eq_update(void)
+static void eq_ramp_step(void)
 {
-    if (s_sample_rate == 0) {
+    if (s_ramp_left == 0) {
         return;
     }
-    float low_db = step_to_db(s_low_step);
-    float high_db = step_to_db(s_high_step);
-    s_flat = (low_db == 0.0f && high_db == 0.0f);
-
-    float low_hz = AUDIO_EQ_LOW_HZ;
-    float high_hz = AUDIO_EQ_HIGH_HZ;
-    float nyq = 0.5f * (float)s_sample_rate;
-    if (low_hz > nyq * 0.45f) {
-        low_hz = nyq * 0.45f;
+    --s_ramp_left;
+    for (uint8_t b = 0; b < AUDIO_EQ_BANDS; ++b) {
+        for (int k = 0; k < 5; ++k) {
+            s_cur[b][k] = s_ramp_left ? (s_cur[b][k] + s_delta[b][k]) : s_target[b][k];
+        }
     }
-    if (high_hz > nyq * 0.9f) {
-        high_hz = nyq * 0.9f;
+    if (s_ramp_left == 0) {
+        eq_update_active();
     }
-
-    biquad_design_low_shelf(&s_low, (float)s_sample_rate, low_hz, low_db);
-    biquad_design_high_shelf(&s_high, (float)s_sample_rate, high_hz, high_db);
 }
 
 void audio_eq_init(uint32_t sample_rate)
 {
-    if (sample_rate > 0) {
-        s_sample_rate = sample_rate;
+    for (uint8_t b = 0; b < AUDIO_EQ_BANDS; ++b) {
+        s_req_step[b] = AUDIO_EQ_CENTER_STEP;
     }
-    s_ready = true;
-    audio_eq_update();
+    audio_eq_set_sample_rate(sample_rate);
 }
 
 void audio_eq_set_sample_rate(uint32_t sample_rate)
@@ -154,77 +146,122 @@ void audio_eq_set_sample_rate(uint32_t sample_rate)
     if (sample_rate == 0) {
         return;
     }
-    s_sample_rate = sample_rate;
-    if (s_ready) {
-        audio_eq_update();
-    }
+    __atomic_store_n(&s_req_rate, sample_rate, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_req_gen, 1, __ATOMIC_RELEASE);
 }
 
-void audio_eq_set_steps(uint8_t low_step, uint8_t high_step)
+void audio_eq_set_band_step(uint8_t band, uint8_t step)
 {
-    if (low_step > AUDIO_EQ_MAX_STEP) {
-        low_step = AUDIO_EQ_MAX_STEP;
-    }
-    if (high_step > AUDIO_EQ_MAX_STEP) {
-        high_step = AUDIO_EQ_MAX_STEP;
+    if (band >= AUDIO_EQ_BANDS) {
+        return;
     }
-    s_low_step = low_step;
-    s_high_step = high_step;
-    if (s_ready) {
-        audio_eq_update();
+    if (step >= AUDIO_EQ_STEPS) {
+        step = AUDIO_EQ_STEPS - 1;
     }
+    __atomic_store_n(&s_req_step[band], step, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_req_gen, 1, __ATOMIC_RELEASE);
 }
 
-bool audio_eq_is_flat(void)
+uint8_t audio_eq_get_band_count(void)
 {
-    return s_flat;
+    return AUDIO_EQ_BANDS;
 }
 
-static float biquad_process(biquad_t *bq, float x, int ch)
+const char *audio_eq_get_band_label(uint8_t band)
 {
-    float y = bq->b0 * x + bq->z1[ch];
-    bq->z1[ch] = bq->b1 * x - bq->a1 * y + bq->z2[ch];
-    bq->z2[ch] = bq->b2 * x - bq->a2 * y;
-    return y;
+    return (band < AUDIO_EQ_BANDS) ? audio_eq_bands[band].label : "";
 }
 
-void audio_eq_process(int16_t *samples, size_t frames, int channels)
+#if AUDIO_EQ_FIXED
+// One band over one channel's sub-block; coefficients and state sit in
+// locals so the loop body is only multiply-accumulates.
+static void eq_stage_run(eq_stage_t *st, const int32_t *coefs, int32_t *buf, size_t n)
 {
-    if (!samples || frames == 0 || channels <= 0) {
-        return;
+    const int32_t b0 = coefs[0], b1 = coefs[1], b2 = coefs[2], a1 = coefs[3], a2 = coefs[4];
+    const int64_t mask = ((int64_t)1 << AUDIO_EQ_COEF_BITS) - 1;
+    int32_t x1 = st->x1, x2 = st->x2;
+    int32_t y1 = st->y1, y2 = st->y2;
+    int32_t e = st->e;
+
+    for (size_t i = 0; i < n; ++i) {
+        int32_t x = buf[i];
+        int64_t acc = (int64_t)e + (int64_t)b0 * x + (int64_t)b1 * x1 + (int64_t)b2 * x2
+                      - (int64_t)a1 * y1 - (int64_t)a2 * y2;
+        int32_t y = (int32_t)(acc >> AUDIO_EQ_COEF_BITS);
+        e = (int32_t)(acc & mask);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        buf[i] = y;
     }
-    if (s_flat) {
-        return;
+
+    st->x1 = x1;
+    st->x2 = x2;
+    st->y1 = y1;
+    st->y2 = y2;
+    st->e = e;
+}
+#else
+static void eq_stage_run(eq_stage_t *st, const int32_t *coefs, float *buf, size_t n)
+{
+    const float scale = 1.0f / (float)(1 << AUDIO_EQ_COEF_BITS);
+    const float b0 = coefs[0] * scale, b1 = coefs[1] * scale, b2 = coefs[2] * scale;
+    const float a1 = coefs[3] * scale, a2 = coefs[4] * scale;
+    float x1 = st->x1, x2 = st->x2;
+    float y1 = st->y1, y2 = st->y2;
+
+    for (size_t i = 0; i < n; ++i) {
+        float x = buf[i];
+        float y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        buf[i] = y;
     }
-    if (channels < 2) {
-        for (size_t i = 0; i < frames; ++i) {
-            float x = (float)samples[i] * (1.0f / 32768.0f);
-            x = biquad_process(&s_low, x, 0);
-            x = biquad_process(&s_high, x, 0);
-            int32_t y = (int32_t)lrintf(x * 32768.0f);
-            if (y > 32767) {
-                y = 32767;
-            } else if (y < -32768) {
-                y = -32768;
-            }
-            samples[i] = (int16_t)y;
-        }
+
+    st->x1 = x1;
+    st->x2 = x2;
+    st->y1 = y1;
+    st->y2 = y2;
+}
+#endif
+
+bool audio_eq_begin(void)
+{
+    eq_apply_requests();
+    return !s_flat;
+}
+
+void audio_eq_run(int channel, int32_t *samples, size_t frames)
+{
+    if (channel < 0 || channel > 1 || frames > AUDIO_EQ_BLOCK_FRAMES) {
         return;
     }
-
+    eq_stage_t *stages = s_stage[channel];
+#if AUDIO_EQ_FIXED
+    int32_t *buf = samples;
+#else
+    float buf[AUDIO_EQ_BLOCK_FRAMES];
     for (size_t i = 0; i < frames; ++i) {
-        size_t base = i * (size_t)channels;
-        for (int ch = 0; ch < 2; ++ch) {
-            float x = (float)samples[base + (size_t)ch] * (1.0f / 32768.0f);
-            x = biquad_process(&s_low, x, ch);
-            x = biquad_process(&s_high, x, ch);
-            int32_t y = (int32_t)lrintf(x * 32768.0f);
-            if (y > 32767) {
-                y = 32767;
-            } else if (y < -32768) {
-                y = -32768;
-            }
-            samples[base + (size_t)ch] = (int16_t)y;
+        buf[i] = (float)samples[i];
+    }
+#endif
+    for (uint8_t b = 0; b < AUDIO_EQ_BANDS; ++b) {
+        if (s_active & (1U << b)) {
+            eq_stage_run(&stages[b], s_cur[b], buf, frames);
         }
     }
+#if !AUDIO_EQ_FIXED
+    for (size_t i = 0; i < frames; ++i) {
+        samples[i] = (int32_t)lrintf(buf[i]);
+    }
+#endif
+}
+
+bool audio_eq_next_block(void)
+{
+    eq_ramp_step();
+    return !s_flat;
 }
@@ -8,11 +8,24 @@
 extern "C" {
 #endif
 
+// Samples handed to audio_eq_run() carry this many bits below the int16 LSB.
+#define AUDIO_EQ_FRAC_BITS 11
+#define AUDIO_EQ_BLOCK_FRAMES 64
+
 void audio_eq_init(uint32_t sample_rate);
 void audio_eq_set_sample_rate(uint32_t sample_rate);
-void audio_eq_set_steps(uint8_t low_step, uint8_t high_step);
-bool audio_eq_is_flat(void);
-void audio_eq_process(int16_t *samples, size_t frames, int channels);
+// Steps are 0..30 (+/-6 dB, 15 flat); band 0 is the low shelf, the last band
+// the high shelf. Changes glide over ~46 ms instead of restarting the filters.
+void audio_eq_set_band_step(uint8_t band, uint8_t step);
+uint8_t audio_eq_get_band_count(void);
+const char *audio_eq_get_band_label(uint8_t band);
+// Output-stage interface, called from the output task only. begin() applies
+// pending changes and returns false when every band is flat; then run() each
+// channel of a sub-block of at most AUDIO_EQ_BLOCK_FRAMES frames in place and
+// call next_block(), which returns false once the EQ has gone flat.
+bool audio_eq_begin(void);
+void audio_eq_run(int channel, int32_t *samples, size_t frames);
+bool audio_eq_next_block(void);
 
 #ifdef __cplusplus
 }
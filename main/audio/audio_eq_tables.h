@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Band count of the EQ plan; main/CMakeLists.txt passes the same value to
+// gen_eq_tables.py, which generates the tables below.
+#ifndef AUDIO_EQ_BANDS
+#define AUDIO_EQ_BANDS 5
+#endif
+
+#define AUDIO_EQ_STEPS 31           // 0..30, +/-6 dB, 15 is flat
+#define AUDIO_EQ_CENTER_STEP 15
+#define AUDIO_EQ_RATE_COUNT 9
+#define AUDIO_EQ_COEF_BITS 29       // Q2.29
+
+typedef struct {
+    char label[3];                  // two characters for the 4-digit display
+    uint16_t freq_hz;
+} audio_eq_band_info_t;
+
+extern const uint32_t audio_eq_rates[AUDIO_EQ_RATE_COUNT];
+extern const audio_eq_band_info_t audio_eq_bands[AUDIO_EQ_BANDS];
+// b0, b1, b2, a1, a2 per rate, band and step.
+extern const int32_t audio_eq_coefs[AUDIO_EQ_RATE_COUNT][AUDIO_EQ_BANDS][AUDIO_EQ_STEPS][5];
@@ -0,0 +1,304 @@
+#include "audio_limiter.h"
+
+#include "freertos/FreeRTOS.h"
+#include <math.h>
+#include <string.h>
+
+#define LIMITER_GAIN_BITS 20
+#define LIMITER_UNITY (1 << LIMITER_GAIN_BITS)
+#define LIMITER_RING_MASK (AUDIO_LIMITER_MAX_LOOKAHEAD - 1)
+#define LIMITER_FULL_SCALE (32768.0f * (float)(1 << AUDIO_EQ_FRAC_BITS))
+
+// Requests from any task; the output task takes them at its next block.
+static portMUX_TYPE s_req_mux = portMUX_INITIALIZER_UNLOCKED;
+static audio_limiter_config_t s_req_cfg = AUDIO_LIMITER_CONFIG_DEFAULT();
+static uint32_t s_req_rate = 44100;
+static uint32_t s_req_gen = 1;
+
+// Output task only.
+static uint32_t s_applied_gen;
+static uint32_t s_rate;
+static bool s_comp;
+static uint32_t s_window;           // look-ahead frames; the output lags by window - 1
+static int32_t s_ceiling;
+static uint32_t s_release_coef;     // Q31 per frame
+static uint32_t s_box_inv;          // floor(2^32 / window), UINT32_MAX for window 1
+static float s_comp_thresh_db;
+static float s_comp_slope;          // 1 - 1/ratio
+static float s_comp_makeup_db;
+static int32_t s_comp_attack_coef;  // Q31 per sub-block
+static int32_t s_comp_release_coef;
+
+static uint32_t s_pos;              // frames processed, wraps
+static int32_t s_delay[2][AUDIO_LIMITER_MAX_LOOKAHEAD];
+static int32_t s_box[AUDIO_LIMITER_MAX_LOOKAHEAD];
+static uint32_t s_box_idx;
+static uint32_t s_box_sum;
+static int32_t s_release_gain;
+// Monotonic deque of frame peaks over the look-ahead window: values fall from
+// head to tail, so the head is the window maximum.
+static int32_t s_dq_peak[AUDIO_LIMITER_MAX_LOOKAHEAD];
+static uint32_t s_dq_pos[AUDIO_LIMITER_MAX_LOOKAHEAD];
+static uint32_t s_dq_head;
+static uint32_t s_dq_tail;
+static int32_t s_last_peak;
+static int32_t s_last_gain;
+static int32_t s_comp_env;
+static int32_t s_comp_gain;
+
+static uint32_t limiter_coef_q31(float frames)
+{
+    if (frames < 1.0f) {
+        return 0x7FFFFFFFU;
+    }
+    return (uint32_t)((1.0f - expf(-1.0f / frames)) * 2147483647.0f);
+}
+
+static void limiter_reset(void)
+{
+    s_pos = 0;
+    memset(s_delay, 0, sizeof(s_delay));
+    for (uint32_t i = 0; i < s_window; ++i) {
+        s_box[i] = LIMITER_UNITY;
+    }
+    s_box_idx = 0;
+    s_box_sum = s_window * (uint32_t)LIMITER_UNITY;
+    s_release_gain = LIMITER_UNITY;
+    s_dq_head = 0;
+    s_dq_tail = 0;
+    s_last_peak = 0;
+    s_last_gain = LIMITER_UNITY;
+    s_comp_env = 0;
+    s_comp_gain = LIMITER_UNITY;
+}
+
+// Recomputes the derived coefficients; the float math runs only here, on a
+// change. A rate change restarts the output anyway, so the state is reset
+// along with it, as is any change of the window length.
+static void limiter_apply_requests(void)
+{
+    uint32_t gen = __atomic_load_n(&s_req_gen, __ATOMIC_ACQUIRE);
+    if (gen == s_applied_gen) {
+        return;
+    }
+    s_applied_gen = gen;
+    audio_limiter_config_t cfg;
+    portENTER_CRITICAL(&s_req_mux);
+    cfg = s_req_cfg;
+    uint32_t rate = s_req_rate;
+    portEXIT_CRITICAL(&s_req_mux);
+
+    float fs = (float)rate;
+    uint32_t window = (uint32_t)((float)cfg.attack_us * fs / 1000000.0f + 0.5f);
+    if (window < 1) {
+        window = 1;
+    } else if (window > AUDIO_LIMITER_MAX_LOOKAHEAD) {
+        window = AUDIO_LIMITER_MAX_LOOKAHEAD;
+    }
+    bool restart = (rate != s_rate) || (window != s_window);
+    s_rate = rate;
+    s_window = window;
+    // 2^32 does not fit for a one-frame window; UINT32_MAX is one LSB of
+    // gain low, which can only undershoot.
+    s_box_inv = (window == 1) ? UINT32_MAX : (uint32_t)(((uint64_t)1 << 32) / window);
+    s_ceiling = (int32_t)(LIMITER_FULL_SCALE * powf(10.0f, (float)cfg.ceiling_db / 20.0f));
+    s_release_coef = limiter_coef_q31((float)cfg.release_ms * fs / 1000.0f);
+    s_last_peak = -1;               // gain cache depends on the ceiling
+
+    float ratio = (cfg.comp_ratio_x10 < 10) ? 1.0f : (float)cfg.comp_ratio_x10 / 10.0f;
+    s_comp_thresh_db = (float)cfg.comp_threshold_db;
+    s_comp_slope = 1.0f - 1.0f / ratio;
+    s_comp_makeup_db = (float)cfg.comp_makeup_db;
+    float blocks_per_ms = fs / 1000.0f / (float)AUDIO_LIMITER_BLOCK_FRAMES;
+    s_comp_attack_coef = (int32_t)limiter_coef_q31((float)cfg.comp_attack_ms * blocks_per_ms);
+    s_comp_release_coef = (int32_t)limiter_coef_q31((float)cfg.comp_release_ms * blocks_per_ms);
+    if (cfg.comp_enabled && !s_comp) {
+        s_comp_env = 0;
+        s_comp_gain = LIMITER_UNITY;
+    }
+    s_comp = cfg.comp_enabled;
+    if (restart) {
+        limiter_reset();
+    }
+}
+
+void audio_limiter_init(uint32_t sample_rate)
+{
+    audio_limiter_config_t cfg = AUDIO_LIMITER_CONFIG_DEFAULT();
+    audio_limiter_set_config(&cfg);
+    audio_limiter_set_sample_rate(sample_rate);
+}
+
+void audio_limiter_set_sample_rate(uint32_t sample_rate)
+{
+    if (sample_rate == 0) {
+        return;
+    }
+    portENTER_CRITICAL(&s_req_mux);
+    s_req_rate = sample_rate;
+    portEXIT_CRITICAL(&s_req_mux);
+    __atomic_add_fetch(&s_req_gen, 1, __ATOMIC_RELEASE);
+}
+
+void audio_limiter_set_config(const audio_limiter_config_t *cfg)
+{
+    if (!cfg) {
+        return;
+    }
+    portENTER_CRITICAL(&s_req_mux);
+    s_req_cfg = *cfg;
+    if (s_req_cfg.ceiling_db > 0) {
+        s_req_cfg.ceiling_db = 0;
+    }
+    portEXIT_CRITICAL(&s_req_mux);
+    __atomic_add_fetch(&s_req_gen, 1, __ATOMIC_RELEASE);
+}
+
+void audio_limiter_get_config(audio_limiter_config_t *cfg)
+{
+    if (!cfg) {
+        return;
+    }
+    portENTER_CRITICAL(&s_req_mux);
+    *cfg = s_req_cfg;
+    portEXIT_CRITICAL(&s_req_mux);
+}
+
+size_t audio_limiter_latency_frames(void)
+{
+    limiter_apply_requests();
+    return s_window - 1;
+}
+
+// Compressor gain for this sub-block from the smoothed block peak: a hard
+// knee above the threshold, makeup after. Once per sub-block, so float is
+// cheap here; the per-frame path only ramps and multiplies.
+static int32_t limiter_comp_target(int32_t block_peak)
+{
+    int32_t diff = block_peak - s_comp_env;
+    int32_t coef = (diff > 0) ? s_comp_attack_coef : s_comp_release_coef;
+    s_comp_env += (int32_t)(((int64_t)diff * coef) >> 31);
+
+    float gain_db = s_comp_makeup_db;
+    if (s_comp_env > 0) {
+        float level_db = 20.0f * log10f((float)s_comp_env / LIMITER_FULL_SCALE);
+        if (level_db > s_comp_thresh_db) {
+            gain_db -= (level_db - s_comp_thresh_db) * s_comp_slope;
+        }
+    }
+    return (int32_t)((float)LIMITER_UNITY * powf(10.0f, gain_db / 20.0f));
+}
+
+static void limiter_compress(int32_t *left, int32_t *right, size_t frames)
+{
+    int32_t peak = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        int32_t l = left[i] < 0 ? -left[i] : left[i];
+        int32_t r = right[i] < 0 ? -right[i] : right[i];
+        int32_t p = l > r ? l : r;
+        if (p > peak) {
+            peak = p;
+        }
+    }
+    // Ramp to the new gain over the sub-block; the limiter behind catches the
+    // attack this is too slow for.
+    int32_t target = limiter_comp_target(peak);
+    int32_t g = s_comp_gain;
+    int32_t step = (target - g) / (int32_t)frames;
+    for (size_t i = 0; i < frames; ++i) {
+        g += step;
+        left[i] = (int32_t)(((int64_t)left[i] * g) >> LIMITER_GAIN_BITS);
+        right[i] = (int32_t)(((int64_t)right[i] * g) >> LIMITER_GAIN_BITS);
+    }
+    s_comp_gain = g;
+}
+
+// Gain that brings `peak` down to the ceiling. The window maximum changes
+// far less often than once per frame, so the division is cached.
+static inline int32_t limiter_gain_for(int32_t peak)
+{
+    if (peak != s_last_peak) {
+        s_last_peak = peak;
+        s_last_gain = (peak <= s_ceiling)
+                      ? LIMITER_UNITY
+                      : (int32_t)(((int64_t)s_ceiling << LIMITER_GAIN_BITS) / peak);
+    }
+    return s_last_gain;
+}
+
+// Per frame: the window maximum of the stereo peak gives the gain the
+// loudest frame still ahead needs; that gain is taken at once and released
+// through a one-pole, then averaged over the window. Every value in the
+// average covering a peak's output frame has already seen that peak, so the
+// average is at most the gain the peak needs and the delayed sample cannot
+// overshoot, while the average turns the attack into a smooth ramp.
+void audio_limiter_process(int32_t *left, int32_t *right, size_t frames)
+{
+    limiter_apply_requests();
+    if (frames == 0 || frames > AUDIO_LIMITER_BLOCK_FRAMES) {
+        return;
+    }
+    if (s_comp) {
+        limiter_compress(left, right, frames);
+    }
+
+    const uint32_t window = s_window;
+    const uint32_t unity_sum = window * (uint32_t)LIMITER_UNITY;
+    uint32_t pos = s_pos;
+    uint32_t head = s_dq_head, tail = s_dq_tail;
+    uint32_t box_idx = s_box_idx, box_sum = s_box_sum;
+    int32_t rel = s_release_gain;
+
+    for (size_t i = 0; i < frames; ++i, ++pos) {
+        int32_t l = left[i], r = right[i];
+        int32_t al = l < 0 ? -l : l;
+        int32_t ar = r < 0 ? -r : r;
+        int32_t peak = al > ar ? al : ar;
+
+        if (head != tail && pos - s_dq_pos[head & LIMITER_RING_MASK] >= window) {
+            ++head;
+        }
+        while (tail != head && s_dq_peak[(tail - 1) & LIMITER_RING_MASK] <= peak) {
+            --tail;
+        }
+        s_dq_peak[tail & LIMITER_RING_MASK] = peak;
+        s_dq_pos[tail & LIMITER_RING_MASK] = pos;
+        ++tail;
+
+        int32_t need = limiter_gain_for(s_dq_peak[head & LIMITER_RING_MASK]);
+        if (need < rel) {
+            rel = need;
+        } else if (rel < LIMITER_UNITY) {
+            rel += (int32_t)(((int64_t)(need - rel) * s_release_coef) >> 31) + 1;
+            if (rel > need) {
+                rel = need;
+            }
+        }
+        box_sum += (uint32_t)rel - (uint32_t)s_box[box_idx];
+        s_box[box_idx] = rel;
+        if (++box_idx == window) {
+            box_idx = 0;
+        }
+
+        uint32_t w = pos & LIMITER_RING_MASK;
+        uint32_t rd = (pos - (window - 1)) & LIMITER_RING_MASK;
+        s_delay[0][w] = l;
+        s_delay[1][w] = r;
+        l = s_delay[0][rd];
+        r = s_delay[1][rd];
+        if (box_sum != unity_sum) {
+            int32_t g = (int32_t)(((uint64_t)box_sum * s_box_inv) >> 32);
+            l = (int32_t)(((int64_t)l * g) >> LIMITER_GAIN_BITS);
+            r = (int32_t)(((int64_t)r * g) >> LIMITER_GAIN_BITS);
+        }
+        left[i] = l;
+        right[i] = r;
+    }
+
+    s_pos = pos;
+    s_dq_head = head;
+    s_dq_tail = tail;
+    s_box_idx = box_idx;
+    s_box_sum = box_sum;
+    s_release_gain = rel;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "audio_eq.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Output dynamics after the EQ: an optional single-band loudness compressor
+// followed by a look-ahead peak limiter. Samples are in the EQ's format,
+// AUDIO_EQ_FRAC_BITS below the int16 LSB.
+#define AUDIO_LIMITER_BLOCK_FRAMES AUDIO_EQ_BLOCK_FRAMES
+#define AUDIO_LIMITER_MAX_LOOKAHEAD 128     // frames, power of two
+
+typedef struct {
+    int8_t ceiling_db;              // limiter output peak, dBFS
+    uint16_t attack_us;             // limiter look-ahead and attack, capped at 128 frames
+    uint16_t release_ms;            // time constants, like the compressor's below
+    bool comp_enabled;
+    int8_t comp_threshold_db;       // dBFS
+    uint8_t comp_ratio_x10;         // 30 = 3:1
+    uint16_t comp_attack_ms;
+    uint16_t comp_release_ms;
+    int8_t comp_makeup_db;
+} audio_limiter_config_t;
+
+#define AUDIO_LIMITER_CONFIG_DEFAULT() {    \
+    .ceiling_db = -1,                       \
+    .attack_us = 1500,                      \
+    .release_ms = 80,                       \
+    .comp_enabled = false,                  \
+    .comp_threshold_db = -24,               \
+    .comp_ratio_x10 = 30,                   \
+    .comp_attack_ms = 10,                   \
+    .comp_release_ms = 250,                 \
+    .comp_makeup_db = 6,                    \
+}
+
+void audio_limiter_init(uint32_t sample_rate);
+void audio_limiter_set_sample_rate(uint32_t sample_rate);
+// Takes effect on the next output block; any task.
+void audio_limiter_set_config(const audio_limiter_config_t *cfg);
+void audio_limiter_get_config(audio_limiter_config_t *cfg);
+// Frames the look-ahead delays the output by.
+size_t audio_limiter_latency_frames(void);
+// Output task only: one sub-block of at most AUDIO_LIMITER_BLOCK_FRAMES
+// frames, left and right in separate buffers, processed in place. The
+// output never exceeds the ceiling.
+void audio_limiter_process(int32_t *left, int32_t *right, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,435 @@
+#include "audio_mixer.h"
+
+#include "audio_pcm5102.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+#define AUDIO_MIXER_BLOCK_FRAMES 256
+#define AUDIO_MIXER_RING_FRAMES 512     // per source, power of two
+#define AUDIO_MIXER_HOLD_FRAMES 768     // I2S queue above which a short source is waited for
+#define AUDIO_MIXER_DUCK_TONE 8231      // -12 dB
+#define AUDIO_MIXER_I2S_TIMEOUT_MS 1000
+#define AUDIO_MIXER_TASK_STACK 3072
+#define AUDIO_MIXER_TASK_PRIORITY 10
+
+typedef struct {
+    int16_t ring[AUDIO_MIXER_RING_FRAMES * 2];
+    uint64_t head;          // frames written; producer side
+    uint64_t tail;          // frames consumed or flushed; mixer side
+    uint64_t pulled;        // frames mixed or dropped by a flush
+    uint64_t out_end;       // I2S written count after this source's last block
+    uint64_t played;        // last value reported, kept monotonic
+    uint32_t underruns;
+    int32_t gain;           // Q15, set by the owner
+    int32_t cur_gain;       // Q15, as applied last block (gain x ducking)
+    volatile bool open;
+    SemaphoreHandle_t space;
+} mixer_source_t;
+
+static const char *TAG = "audio_mixer";
+static mixer_source_t s_src[AUDIO_SOURCE_COUNT];
+static portMUX_TYPE s_mix_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_mixer_task = NULL;
+static int16_t s_mix_in[AUDIO_MIXER_BLOCK_FRAMES * 2];
+static int16_t s_mix_out[AUDIO_MIXER_BLOCK_FRAMES * 2];
+static int32_t s_mix_acc[AUDIO_MIXER_BLOCK_FRAMES * 2];     // AUDIO_OUTPUT_FRAC_BITS below int16
+
+static bool mixer_is_music(audio_source_t src)
+{
+    return src == AUDIO_SOURCE_BT || src == AUDIO_SOURCE_PLAYER;
+}
+
+static uint64_t mixer_available(const mixer_source_t *s)
+{
+    portENTER_CRITICAL(&s_mix_mux);
+    uint64_t avail = s->head - s->tail;
+    portEXIT_CRITICAL(&s_mix_mux);
+    return avail;
+}
+
+// Gain applied to music while an alarm or tone is sounding.
+static int32_t mixer_duck_gain(void)
+{
+    const mixer_source_t *alarm = &s_src[AUDIO_SOURCE_ALARM];
+    const mixer_source_t *tone = &s_src[AUDIO_SOURCE_TONE];
+    if (alarm->open || mixer_available(alarm) > 0) {
+        return 0;
+    }
+    if (tone->open || mixer_available(tone) > 0) {
+        return AUDIO_MIXER_DUCK_TONE;
+    }
+    return AUDIO_MIXER_UNITY;
+}
+
+// Copies `frames` frames of `s` from `tail` into s_mix_in. Outside the lock:
+// until the tail moves the writer cannot reach them, and a flush that moves
+// it meanwhile is caught by mixer_commit().
+static void mixer_fetch(const mixer_source_t *s, uint64_t tail, uint32_t frames)
+{
+    uint32_t pos = (uint32_t)(tail & (AUDIO_MIXER_RING_FRAMES - 1U));
+    uint32_t first = AUDIO_MIXER_RING_FRAMES - pos;
+    if (first > frames) {
+        first = frames;
+    }
+    memcpy(s_mix_in, &s->ring[pos * 2], first * 2 * sizeof(int16_t));
+    memcpy(&s_mix_in[first * 2], s->ring, (frames - first) * 2 * sizeof(int16_t));
+}
+
+// Takes the fetched frames off the ring unless a flush dropped them after
+// the fetch; only taken frames are mixed and counted as pulled.
+static bool mixer_commit(mixer_source_t *s, uint64_t tail, uint32_t frames, uint32_t block)
+{
+    portENTER_CRITICAL(&s_mix_mux);
+    bool taken = s->tail == tail;
+    if (taken) {
+        s->tail += frames;
+        s->pulled += frames;
+        if (frames < block && s->open) {
+            s->underruns++;
+        }
+    }
+    portEXIT_CRITICAL(&s_mix_mux);
+    return taken;
+}
+
+// Adds `frames` fetched frames to the accumulator, ramping from the gain of
+// the previous block to `target` so ducking and volume changes don't zipper.
+// This is the only gain stage: sources write unscaled PCM.
+static void mixer_accumulate(mixer_source_t *s, uint32_t frames, int32_t target)
+{
+    const int shift = 15 - AUDIO_OUTPUT_FRAC_BITS;
+    int32_t from = s->cur_gain;
+    if (from == target) {
+        for (uint32_t i = 0; i < frames * 2; ++i) {
+            s_mix_acc[i] += ((int32_t)s_mix_in[i] * target) >> shift;
+        }
+    } else {
+        // Gain in Q30 stepped per frame, so the ramp costs one add.
+        int32_t g = from * 32768;
+        int32_t step = ((target - from) * 32768) / (int32_t)frames;
+        for (uint32_t i = 0; i < frames; ++i) {
+            int32_t gi = g >> 15;
+            s_mix_acc[i * 2] += ((int32_t)s_mix_in[i * 2] * gi) >> shift;
+            s_mix_acc[i * 2 + 1] += ((int32_t)s_mix_in[i * 2 + 1] * gi) >> shift;
+            g += step;
+        }
+    }
+    s->cur_gain = target;
+}
+
+static void mixer_output(uint32_t frames)
+{
+    audio_output_render(s_mix_acc, s_mix_out, frames);
+    size_t bytes_written = 0;
+    esp_err_t err = audio_i2s_write(s_mix_out, frames * 2 * sizeof(int16_t), &bytes_written,
+                                    AUDIO_MIXER_I2S_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "i2s write err=%s", esp_err_to_name(err));
+    }
+}
+
+static void mixer_task(void *arg)
+{
+    (void)arg;
+    uint64_t avail[AUDIO_SOURCE_COUNT];
+    uint64_t tails[AUDIO_SOURCE_COUNT];
+    bool tail_held = false;     // the output stage still delays audio
+
+    while (1) {
+        uint32_t frames = 0;
+        bool waiting = false;   // an open source has a partial block queued
+        portENTER_CRITICAL(&s_mix_mux);
+        for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+            tails[i] = s_src[i].tail;
+            avail[i] = s_src[i].head - tails[i];
+        }
+        portEXIT_CRITICAL(&s_mix_mux);
+        for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+            uint32_t n = (avail[i] < AUDIO_MIXER_BLOCK_FRAMES) ? (uint32_t)avail[i] : AUDIO_MIXER_BLOCK_FRAMES;
+            if (n > frames) {
+                frames = n;
+            }
+            if (n > 0 && n < AUDIO_MIXER_BLOCK_FRAMES && s_src[i].open) {
+                waiting = true;
+            }
+        }
+        if (frames == 0) {
+            if (tail_held) {
+                // Silence through the output stage pushes out what its
+                // look-ahead still holds of the last block.
+                tail_held = false;
+                uint32_t latency = (uint32_t)audio_output_latency_frames();
+                if (latency > 0) {
+                    memset(s_mix_acc, 0, latency * 2 * sizeof(int32_t));
+                    mixer_output(latency);
+                }
+                continue;
+            }
+            // Nothing queued: the DMA clears itself to silence meanwhile.
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (waiting && audio_i2s_get_written_frames() - audio_i2s_get_played_frames() > AUDIO_MIXER_HOLD_FRAMES) {
+            ulTaskNotifyTake(pdTRUE, 1);
+            continue;
+        }
+
+        int32_t duck = mixer_duck_gain();
+        memset(s_mix_acc, 0, frames * 2 * sizeof(int32_t));
+        uint32_t mixed = 0;
+        for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+            mixer_source_t *s = &s_src[i];
+            int32_t target = mixer_is_music((audio_source_t)i) ? (s->gain * duck) >> 15 : s->gain;
+            if (avail[i] == 0) {
+                s->cur_gain = target;
+                continue;
+            }
+            uint32_t take = (avail[i] < frames) ? (uint32_t)avail[i] : frames;
+            mixer_fetch(s, tails[i], take);
+            if (!mixer_commit(s, tails[i], take, frames)) {
+                avail[i] = 0;       // flushed meanwhile: none of it plays
+                continue;
+            }
+            mixer_accumulate(s, take, target);
+            xSemaphoreGive(s->space);
+            if (take > mixed) {
+                mixed = take;
+            }
+        }
+        if (mixed == 0) {
+            continue;
+        }
+        // A source flushed after sizing the block does not pad it with silence.
+        mixer_output(mixed);
+        tail_held = true;
+        uint64_t out_end = audio_i2s_get_written_frames();
+        portENTER_CRITICAL(&s_mix_mux);
+        for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+            if (avail[i] > 0) {
+                s_src[i].out_end = out_end;
+            }
+        }
+        portEXIT_CRITICAL(&s_mix_mux);
+    }
+}
+
+esp_err_t audio_mixer_init(void)
+{
+    if (s_mixer_task) {
+        return ESP_OK;
+    }
+    for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+        s_src[i].gain = AUDIO_MIXER_UNITY;
+        s_src[i].cur_gain = AUDIO_MIXER_UNITY;
+        if (!s_src[i].space) {
+            s_src[i].space = xSemaphoreCreateBinary();
+            if (!s_src[i].space) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+    if (xTaskCreate(mixer_task, "audio_mixer", AUDIO_MIXER_TASK_STACK, NULL, AUDIO_MIXER_TASK_PRIORITY,
+                    &s_mixer_task) != pdPASS) {
+        s_mixer_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool audio_mixer_open(audio_source_t src)
+{
+    if (src >= AUDIO_SOURCE_COUNT || !s_mixer_task) {
+        return false;
+    }
+    mixer_source_t *s = &s_src[src];
+    portENTER_CRITICAL(&s_mix_mux);
+    if (!s->open) {
+        s->open = true;
+        s->underruns = 0;
+    }
+    portEXIT_CRITICAL(&s_mix_mux);
+    return true;
+}
+
+void audio_mixer_close(audio_source_t src)
+{
+    if (src >= AUDIO_SOURCE_COUNT || !s_mixer_task) {
+        return;
+    }
+    mixer_source_t *s = &s_src[src];
+    portENTER_CRITICAL(&s_mix_mux);
+    bool was_open = s->open;
+    s->open = false;
+    uint32_t underruns = s->underruns;
+    portEXIT_CRITICAL(&s_mix_mux);
+    if (!was_open) {
+        return;
+    }
+    xSemaphoreGive(s->space);
+    xTaskNotifyGive(s_mixer_task);
+    if (underruns > 0) {
+        ESP_LOGI(TAG, "%s closed, %u short blocks", audio_mixer_source_name(src), (unsigned)underruns);
+    }
+}
+
+void audio_mixer_flush(audio_source_t src)
+{
+    if (src >= AUDIO_SOURCE_COUNT || !s_mixer_task) {
+        return;
+    }
+    mixer_source_t *s = &s_src[src];
+    portENTER_CRITICAL(&s_mix_mux);
+    s->pulled += s->head - s->tail;
+    s->tail = s->head;
+    portEXIT_CRITICAL(&s_mix_mux);
+    xSemaphoreGive(s->space);
+}
+
+bool audio_mixer_is_open(audio_source_t src)
+{
+    return src < AUDIO_SOURCE_COUNT && s_src[src].open;
+}
+
+uint32_t audio_mixer_claim_rate(audio_source_t src, uint32_t rate)
+{
+    uint32_t cur = audio_i2s_get_sample_rate();
+    if (src >= AUDIO_SOURCE_COUNT || rate == 0 || rate == cur) {
+        return cur;
+    }
+    for (int i = 0; i < AUDIO_SOURCE_COUNT; ++i) {
+        const mixer_source_t *other = &s_src[i];
+        if (i != (int)src && (other->open || mixer_available(other) > 0)) {
+            ESP_LOGI(TAG, "%s at %u Hz resampled, %s keeps the output at %u Hz", audio_mixer_source_name(src),
+                     (unsigned)rate, audio_mixer_source_name((audio_source_t)i), (unsigned)cur);
+            return cur;
+        }
+    }
+    if (audio_i2s_set_sample_rate(rate) != ESP_OK) {
+        ESP_LOGW(TAG, "i2s rate %u failed, resampling", (unsigned)rate);
+        return audio_i2s_get_sample_rate();
+    }
+    return rate;
+}
+
+void audio_mixer_set_gain(audio_source_t src, int32_t gain_q15)
+{
+    if (src >= AUDIO_SOURCE_COUNT) {
+        return;
+    }
+    if (gain_q15 < 0) {
+        gain_q15 = 0;
+    } else if (gain_q15 > AUDIO_MIXER_UNITY) {
+        gain_q15 = AUDIO_MIXER_UNITY;
+    }
+    __atomic_store_n(&s_src[src].gain, gain_q15, __ATOMIC_RELAXED);
+}
+
+esp_err_t audio_mixer_write(audio_source_t src, const void *data, size_t len, size_t *bytes_written,
+                            uint32_t timeout_ms)
+{
+    if (bytes_written) {
+        *bytes_written = 0;
+    }
+    if (src >= AUDIO_SOURCE_COUNT || !s_mixer_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mixer_source_t *s = &s_src[src];
+    const int16_t *in = (const int16_t *)data;
+    size_t frames = len / (sizeof(int16_t) * 2);
+    size_t done = 0;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    esp_err_t err = ESP_OK;
+
+    while (done < frames) {
+        if (!s->open) {
+            err = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        portENTER_CRITICAL(&s_mix_mux);
+        uint64_t head = s->head;
+        uint32_t space = AUDIO_MIXER_RING_FRAMES - (uint32_t)(head - s->tail);
+        portEXIT_CRITICAL(&s_mix_mux);
+        if (space == 0) {
+            TickType_t waited = xTaskGetTickCount() - start;
+            if (waited >= timeout || xSemaphoreTake(s->space, timeout - waited) != pdTRUE) {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            continue;
+        }
+        uint32_t n = (frames - done < space) ? (uint32_t)(frames - done) : space;
+        uint32_t pos = (uint32_t)(head & (AUDIO_MIXER_RING_FRAMES - 1U));
+        uint32_t first = AUDIO_MIXER_RING_FRAMES - pos;
+        if (first > n) {
+            first = n;
+        }
+        // Only the mixer reads, and only up to head, so the copy needs no lock.
+        memcpy(&s->ring[pos * 2], &in[done * 2], first * 2 * sizeof(int16_t));
+        memcpy(s->ring, &in[(done + first) * 2], (n - first) * 2 * sizeof(int16_t));
+        portENTER_CRITICAL(&s_mix_mux);
+        s->head += n;
+        portEXIT_CRITICAL(&s_mix_mux);
+        done += n;
+        xTaskNotifyGive(s_mixer_task);
+    }
+    if (bytes_written) {
+        *bytes_written = done * sizeof(int16_t) * 2;
+    }
+    return err;
+}
+
+uint64_t audio_mixer_get_written_frames(audio_source_t src)
+{
+    if (src >= AUDIO_SOURCE_COUNT) {
+        return 0;
+    }
+    portENTER_CRITICAL(&s_mix_mux);
+    uint64_t written = s_src[src].head;
+    portEXIT_CRITICAL(&s_mix_mux);
+    return written;
+}
+
+uint64_t audio_mixer_get_played_frames(audio_source_t src)
+{
+    if (src >= AUDIO_SOURCE_COUNT) {
+        return 0;
+    }
+    // This source's last block ends at out_end in the I2S stream; whatever of
+    // it the DMA has not sent yet is still ahead of the speaker.
+    uint64_t i2s_played = audio_i2s_get_played_frames();
+    mixer_source_t *s = &s_src[src];
+    portENTER_CRITICAL(&s_mix_mux);
+    uint64_t pending = (s->out_end > i2s_played) ? s->out_end - i2s_played : 0;
+    uint64_t played = (s->pulled > pending) ? s->pulled - pending : 0;
+    if (played > s->played) {
+        s->played = played;
+    }
+    played = s->played;
+    portEXIT_CRITICAL(&s_mix_mux);
+    return played;
+}
+
+uint32_t audio_mixer_get_underruns(audio_source_t src)
+{
+    return (src < AUDIO_SOURCE_COUNT) ? s_src[src].underruns : 0;
+}
+
+const char *audio_mixer_source_name(audio_source_t src)
+{
+    switch (src) {
+        case AUDIO_SOURCE_BT:
+            return "bt";
+        case AUDIO_SOURCE_PLAYER:
+            return "player";
+        case AUDIO_SOURCE_ALARM:
+            return "alarm";
+        case AUDIO_SOURCE_TONE:
+            return "tone";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_MIXER_UNITY 32768     // Q15 gain 1.0
+
+// Producers of the I2S output. Each has its own ring; the mixer task pulls
+// fixed blocks from all of them, so one source starting or stopping never
+// touches the others' audio.
+typedef enum {
+    AUDIO_SOURCE_BT = 0,
+    AUDIO_SOURCE_PLAYER,
+    AUDIO_SOURCE_ALARM,
+    AUDIO_SOURCE_TONE,
+    AUDIO_SOURCE_COUNT
+} audio_source_t;
+
+// Started by audio_init(); the mixer task is the only caller of the output
+// stage and the I2S write.
+esp_err_t audio_mixer_init(void);
+
+// Opening an open source is a no-op, so a stream can span tracks. Closing
+// lets the queued audio play out; flush drops it. While the alarm is open
+// BT and player are ducked to silence, while a tone is open to -12 dB.
+bool audio_mixer_open(audio_source_t src);
+void audio_mixer_close(audio_source_t src);
+void audio_mixer_flush(audio_source_t src);
+bool audio_mixer_is_open(audio_source_t src);
+// Output rate for a stream of `rate` Hz starting on `src`. Reclocking stops
+// the I2S channel and drops what it has queued, so the output only follows
+// `rate` while no other source is open or still playing out; otherwise the
+// current rate is returned and the caller resamples to it.
+uint32_t audio_mixer_claim_rate(audio_source_t src, uint32_t rate);
+// Volume of `src`, Q15 0..AUDIO_MIXER_UNITY; ramped over one block.
+void audio_mixer_set_gain(audio_source_t src, int32_t gain_q15);
+
+// Queues interleaved stereo int16 for `src`, blocking up to `timeout_ms` for
+// ring space. One writer per source. Returns ESP_ERR_INVALID_STATE once the
+// source is closed.
+esp_err_t audio_mixer_write(audio_source_t src, const void *data, size_t len, size_t *bytes_written,
+                            uint32_t timeout_ms);
+
+// Per-source counterparts of audio_i2s_get_written/played_frames(): frames
+// accepted by audio_mixer_write() and frames of this source the DAC has
+// played, to within one DMA buffer.
+uint64_t audio_mixer_get_written_frames(audio_source_t src);
+uint64_t audio_mixer_get_played_frames(audio_source_t src);
+// Blocks that had to go out with this source short of data since open.
+uint32_t audio_mixer_get_underruns(audio_source_t src);
+const char *audio_mixer_source_name(audio_source_t src);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,65 @@
+#include "audio_pcm5102.h"
+
+#include "audio_eq.h"
+#include "audio_limiter.h"
+#include <stdbool.h>
+
+// Output stage of audio_pcm5102.c, kept apart from the I2S driver so the
+// host tools can run it.
+
+#define AUDIO_CLIP_KNEE 29205       // -1 dBFS; above it the curve bends toward full scale
+
+// Linear up to the knee, then knee + r*d/(r+d): slope 1 at the knee and
+// approaching full scale asymptotically, so peaks round off instead of
+// folding into hard-clip harmonics. With the limiter's ceiling at or below
+// the knee this only catches its rounding.
+static inline int16_t audio_soft_clip(int32_t v)
+{
+    const int32_t r = INT16_MAX - AUDIO_CLIP_KNEE;
+    if (v > AUDIO_CLIP_KNEE) {
+        int32_t d = v - AUDIO_CLIP_KNEE;
+        return (int16_t)(AUDIO_CLIP_KNEE + (int32_t)(((int64_t)r * d) / (r + d)));
+    }
+    if (v < -AUDIO_CLIP_KNEE) {
+        int32_t d = -AUDIO_CLIP_KNEE - v;
+        return (int16_t)(-AUDIO_CLIP_KNEE - (int32_t)(((int64_t)r * d) / (r + d)));
+    }
+    return (int16_t)v;
+}
+
+void audio_output_render(const int32_t *mix, int16_t *out, size_t frames)
+{
+    const int32_t half = 1 << (AUDIO_OUTPUT_FRAC_BITS - 1);
+    bool eq = audio_eq_begin();
+    int32_t buf[2][AUDIO_EQ_BLOCK_FRAMES];
+
+    for (size_t off = 0; off < frames; off += AUDIO_EQ_BLOCK_FRAMES) {
+        size_t n = frames - off;
+        if (n > AUDIO_EQ_BLOCK_FRAMES) {
+            n = AUDIO_EQ_BLOCK_FRAMES;
+        }
+        // The EQ runs band by band and the limiter looks ahead over the
+        // sub-block, so each channel is made contiguous; it stays in cache.
+        const int32_t *in = &mix[off * 2];
+        for (size_t i = 0; i < n; ++i) {
+            buf[0][i] = in[i * 2];
+            buf[1][i] = in[i * 2 + 1];
+        }
+        if (eq) {
+            audio_eq_run(0, buf[0], n);
+            audio_eq_run(1, buf[1], n);
+            eq = audio_eq_next_block();
+        }
+        audio_limiter_process(buf[0], buf[1], n);
+        int16_t *dst = &out[off * 2];
+        for (size_t i = 0; i < n; ++i) {
+            dst[i * 2] = audio_soft_clip((buf[0][i] + half) >> AUDIO_OUTPUT_FRAC_BITS);
+            dst[i * 2 + 1] = audio_soft_clip((buf[1][i] + half) >> AUDIO_OUTPUT_FRAC_BITS);
+        }
+    }
+}
+
+size_t audio_output_latency_frames(void)
+{
+    return audio_limiter_latency_frames();
+}
@@ -1,10 +1,13 @@
 #include "audio_pcm5102.h"
 
 #include "board_pins.h"
-#include "audio_owner.h"
 #include "audio_eq.h"
+#include "audio_limiter.h"
+#include "audio_mixer.h"
 #include "audio_tones.h"
+#include "pcm_convert.h"
 #include "driver/i2s_std.h"
+#include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_random.h"
@@ -21,11 +24,11 @@
 #define AUDIO_QUEUE_DEPTH 8
 #define AUDIO_CHUNK_FRAMES 256
 #define AUDIO_I2S_TIMEOUT_MS 5000
-#define AUDIO_EQ_CHUNK_FRAMES 256
 #define AUDIO_KS_MAX_DELAY 512
 #define AUDIO_SINE_LUT_SIZE 1024
 #define AUDIO_SINE_LUT_MASK (AUDIO_SINE_LUT_SIZE - 1U)
 #define AUDIO_CHORD_LPF_ALPHA_Q15 13631
+#define AUDIO_FRAME_BYTES (sizeof(int16_t) * 2)
 
 static const char *TAG = "audio_pcm5102";
 
@@ -61,12 +64,45 @@ static volatile bool s_stop_requested = false;
 static uint8_t s_volume = 200;
 static i2s_chan_handle_t s_tx_chan = NULL;
 static volatile bool s_i2s_enabled = false;
+static uint32_t s_sample_rate = AUDIO_SAMPLE_RATE;
 static SemaphoreHandle_t s_i2s_mutex = NULL;
-static int16_t s_eq_buf[AUDIO_EQ_CHUNK_FRAMES * 2];
+static portMUX_TYPE s_pos_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t s_frames_written = 0;   // accepted into the DMA queue
+static uint64_t s_frames_played = 0;    // sent by the DMA, never ahead of written
 static int16_t s_ks_buf[AUDIO_KS_MAX_DELAY];
 static int16_t s_sine_lut[AUDIO_SINE_LUT_SIZE];
 static bool s_sine_ready = false;
 
+// Counts whole DMA buffers as they finish. Capping at the written count keeps
+// the silence sent during underruns and idle out of the total, to within one
+// buffer.
+static bool IRAM_ATTR audio_i2s_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    (void)handle;
+    (void)user_ctx;
+    uint64_t frames = event->size / AUDIO_FRAME_BYTES;
+    portENTER_CRITICAL_ISR(&s_pos_mux);
+    uint64_t played = s_frames_played + frames;
+    s_frames_played = (played < s_frames_written) ? played : s_frames_written;
+    portEXIT_CRITICAL_ISR(&s_pos_mux);
+    return false;
+}
+
+static void audio_pos_add_written(size_t bytes)
+{
+    portENTER_CRITICAL(&s_pos_mux);
+    s_frames_written += bytes / AUDIO_FRAME_BYTES;
+    portEXIT_CRITICAL(&s_pos_mux);
+}
+
+// The channel was stopped and its queue dropped: nothing is pending any more.
+static void audio_pos_flush(void)
+{
+    portENTER_CRITICAL(&s_pos_mux);
+    s_frames_played = s_frames_written;
+    portEXIT_CRITICAL(&s_pos_mux);
+}
+
 static void audio_sine_init(void)
 {
     if (s_sine_ready) {
@@ -86,15 +122,18 @@ static void audio_sine_init(void)
     s_sine_ready = true;
 }
 
-static void audio_write_silence(uint32_t duration_ms)
+// The synths render at whatever rate the output runs, so tones keep their
+// pitch over music or BT at 48 kHz.
+static void audio_write_silence(audio_source_t src, uint32_t duration_ms)
 {
+    uint32_t rate = s_sample_rate;
     if (duration_ms == 0) {
         return;
     }
 
     int16_t frame[AUDIO_CHUNK_FRAMES * 2] = {0};
     size_t bytes_written = 0;
-    uint32_t total_frames = (AUDIO_SAMPLE_RATE * duration_ms) / 1000;
+    uint32_t total_frames = (rate * duration_ms) / 1000;
 
     for (uint32_t offset = 0; offset < total_frames; ) {
         if (s_stop_requested) {
@@ -104,26 +143,29 @@ static void audio_write_silence(uint32_t duration_ms)
         if (frames > AUDIO_CHUNK_FRAMES) {
             frames = AUDIO_CHUNK_FRAMES;
         }
-        audio_i2s_write(frame, frames * sizeof(int16_t) * 2, &bytes_written, AUDIO_I2S_TIMEOUT_MS);
+        if (audio_mixer_write(src, frame, frames * AUDIO_FRAME_BYTES, &bytes_written, AUDIO_I2S_TIMEOUT_MS) != ESP_OK) {
+            break;
+        }
         offset += frames;
     }
 }
 
-static void audio_write_tone(uint16_t freq_hz, uint32_t duration_ms, uint8_t volume)
+static void audio_write_tone(audio_source_t src, uint16_t freq_hz, uint32_t duration_ms, uint8_t volume)
 {
+    uint32_t rate = s_sample_rate;
     if (freq_hz == 0 || duration_ms == 0) {
-        audio_write_silence(duration_ms);
+        audio_write_silence(src, duration_ms);
         return;
     }
 
-    uint32_t samples_per_cycle = AUDIO_SAMPLE_RATE / freq_hz;
+    uint32_t samples_per_cycle = rate / freq_hz;
     if (samples_per_cycle < 2) {
         return;
     }
 
     int16_t amplitude = (int16_t)((AUDIO_AMPLITUDE * volume) / 255U);
     uint32_t half_cycle = samples_per_cycle / 2;
-    uint32_t total_frames = (AUDIO_SAMPLE_RATE * duration_ms) / 1000;
+    uint32_t total_frames = (rate * duration_ms) / 1000;
     int16_t frame[AUDIO_CHUNK_FRAMES * 2];
     size_t bytes_written = 0;
 
@@ -143,21 +185,25 @@ static void audio_write_tone(uint16_t freq_hz, uint32_t duration_ms, uint8_t vol
             frame[i * 2 + 1] = sample;
         }
 
-        audio_i2s_write(frame, frames * sizeof(int16_t) * 2, &bytes_written, AUDIO_I2S_TIMEOUT_MS);
+        if (audio_mixer_write(src, frame, frames * AUDIO_FRAME_BYTES, &bytes_written, AUDIO_I2S_TIMEOUT_MS) != ESP_OK) {
+            break;
+        }
         offset += frames;
     }
 }
 
-static void audio_write_karplus(uint16_t freq_hz, uint32_t duration_ms, uint8_t volume, uint16_t damping_q15)
+static void audio_write_karplus(audio_source_t src, uint16_t freq_hz, uint32_t duration_ms, uint8_t volume,
+                                uint16_t damping_q15)
 {
+    uint32_t rate = s_sample_rate;
     if (freq_hz == 0 || duration_ms == 0) {
-        audio_write_silence(duration_ms);
+        audio_write_silence(src, duration_ms);
         return;
     }
 
-    uint32_t delay = AUDIO_SAMPLE_RATE / freq_hz;
+    uint32_t delay = rate / freq_hz;
     if (delay < 2 || delay > AUDIO_KS_MAX_DELAY) {
-        audio_write_tone(freq_hz, duration_ms, volume);
+        audio_write_tone(src, freq_hz, duration_ms, volume);
         return;
     }
 
@@ -178,12 +224,12 @@ static void audio_write_karplus(uint16_t freq_hz, uint32_t duration_ms, uint8_t
         s_ks_buf[i] = (int16_t)((rnd * amp) / 32768);
     }
 
-    uint32_t total_frames = (AUDIO_SAMPLE_RATE * duration_ms) / 1000;
+    uint32_t total_frames = (rate * duration_ms) / 1000;
     if (total_frames == 0) {
         total_frames = 1;
     }
-    uint32_t attack_frames = (AUDIO_SAMPLE_RATE * 2U) / 1000U;
-    uint32_t release_frames = (AUDIO_SAMPLE_RATE * 18U) / 1000U;
+    uint32_t attack_frames = (rate * 2U) / 1000U;
+    uint32_t release_frames = (rate * 18U) / 1000U;
     if (release_frames > (total_frames / 2U)) {
         release_frames = total_frames / 2U;
     }
@@ -231,17 +277,19 @@ static void audio_write_karplus(uint16_t freq_hz, uint32_t duration_ms, uint8_t
             frame[i * 2 + 1] = (int16_t)sample;
         }
 
-        audio_i2s_write(frame, frames * sizeof(int16_t) * 2, &bytes_written, AUDIO_I2S_TIMEOUT_MS);
+        if (audio_mixer_write(src, frame, frames * AUDIO_FRAME_BYTES, &bytes_written, AUDIO_I2S_TIMEOUT_MS) != ESP_OK) {
+            break;
+        }
         offset += frames;
     }
 }
 
-static uint32_t audio_calc_phase_inc(float freq_hz)
+static uint32_t audio_calc_phase_inc(float freq_hz, uint32_t rate)
 {
     if (freq_hz <= 0.0f) {
         return 0;
     }
-    float inc = (freq_hz * (float)AUDIO_SINE_LUT_SIZE * 65536.0f) / (float)AUDIO_SAMPLE_RATE;
+    float inc = (freq_hz * (float)AUDIO_SINE_LUT_SIZE * 65536.0f) / (float)rate;
     if (inc < 1.0f) {
         return 0;
     }
@@ -251,23 +299,24 @@ static uint32_t audio_calc_phase_inc(float freq_hz)
     return (uint32_t)(inc + 0.5f);
 }
 
-static void audio_write_chord(const audio_cmd_t *cmd)
+static void audio_write_chord(audio_source_t src, const audio_cmd_t *cmd)
 {
+    uint32_t rate = s_sample_rate;
     if (!cmd || cmd->duration_ms == 0) {
-        audio_write_silence(cmd ? cmd->duration_ms : 0);
+        audio_write_silence(src, cmd ? cmd->duration_ms : 0);
         return;
     }
 
     audio_sine_init();
 
-    uint32_t total_frames = (AUDIO_SAMPLE_RATE * cmd->duration_ms) / 1000U;
+    uint32_t total_frames = (rate * cmd->duration_ms) / 1000U;
     if (total_frames == 0) {
         total_frames = 1;
     }
 
-    uint32_t attack_frames = (AUDIO_SAMPLE_RATE * cmd->chord_attack_ms) / 1000U;
-    uint32_t decay_frames = (AUDIO_SAMPLE_RATE * cmd->chord_decay_ms) / 1000U;
-    uint32_t release_frames = (AUDIO_SAMPLE_RATE * cmd->chord_release_ms) / 1000U;
+    uint32_t attack_frames = (rate * cmd->chord_attack_ms) / 1000U;
+    uint32_t decay_frames = (rate * cmd->chord_decay_ms) / 1000U;
+    uint32_t release_frames = (rate * cmd->chord_release_ms) / 1000U;
 
     uint32_t total_env = attack_frames + decay_frames + release_frames;
     if (total_env > total_frames) {
@@ -313,7 +362,7 @@ static void audio_write_chord(const audio_cmd_t *cmd)
         float cents = (float)cmd->chord_detune_cents[i];
         float detune = powf(2.0f, cents / 1200.0f);
         float freq = (float)cmd->chord_freq_hz[i] * detune;
-        phase_inc[i] = audio_calc_phase_inc(freq);
+        phase_inc[i] = audio_calc_phase_inc(freq, rate);
     }
 
     int16_t frame[AUDIO_CHUNK_FRAMES * 2];
@@ -381,7 +430,9 @@ static void audio_write_chord(const audio_cmd_t *cmd)
             frame[i * 2 + 1] = (int16_t)sample;
         }
 
-        audio_i2s_write(frame, frames * sizeof(int16_t) * 2, &bytes_written, AUDIO_I2S_TIMEOUT_MS);
+        if (audio_mixer_write(src, frame, frames * AUDIO_FRAME_BYTES, &bytes_written, AUDIO_I2S_TIMEOUT_MS) != ESP_OK) {
+            break;
+        }
         offset += frames;
     }
 }
@@ -393,32 +444,23 @@ static void audio_task(void *arg)
 
     while (xQueueReceive(s_cmd_queue, &cmd, portMAX_DELAY)) {
         s_stop_requested = false;
-        if (!s_audio_ready) {
-            continue;
-        }
-        audio_owner_t owner = audio_owner_get();
-        if (owner != AUDIO_OWNER_TONE && owner != AUDIO_OWNER_ALARM) {
+        if (!s_audio_ready || !audio_mixer_is_open(AUDIO_SOURCE_TONE)) {
             continue;
         }
 
         if (cmd.wave == AUDIO_WAVE_SILENCE || cmd.volume == 0) {
-            audio_write_silence(cmd.duration_ms);
+            audio_write_silence(AUDIO_SOURCE_TONE, cmd.duration_ms);
         } else if (cmd.wave == AUDIO_WAVE_KARPLUS) {
-            audio_write_karplus(cmd.freq_hz, cmd.duration_ms, cmd.volume, cmd.damping_q15);
+            audio_write_karplus(AUDIO_SOURCE_TONE, cmd.freq_hz, cmd.duration_ms, cmd.volume, cmd.damping_q15);
         } else if (cmd.wave == AUDIO_WAVE_CHORD) {
-            audio_write_chord(&cmd);
+            audio_write_chord(AUDIO_SOURCE_TONE, &cmd);
         } else {
-            audio_write_tone(cmd.freq_hz, cmd.duration_ms, cmd.volume);
+            audio_write_tone(AUDIO_SOURCE_TONE, cmd.freq_hz, cmd.duration_ms, cmd.volume);
         }
 
         if (uxQueueMessagesWaiting(s_cmd_queue) == 0) {
-            audio_write_silence(30);
-            audio_i2s_reset();
-            if (owner == AUDIO_OWNER_ALARM) {
-                audio_owner_release(AUDIO_OWNER_ALARM);
-            } else {
-                audio_owner_release(AUDIO_OWNER_TONE);
-            }
+            // The tail plays out from the ring; music comes back up after it.
+            audio_mixer_close(AUDIO_SOURCE_TONE);
         }
     }
 }
@@ -464,6 +506,14 @@ esp_err_t audio_init(void)
         return err;
     }
 
+    i2s_event_callbacks_t cbs = {
+        .on_sent = audio_i2s_on_sent,
+    };
+    err = i2s_channel_register_event_callback(s_tx_chan, &cbs, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "i2s sent callback failed: %s", esp_err_to_name(err));
+    }
+
     if (!s_i2s_mutex) {
         s_i2s_mutex = xSemaphoreCreateMutex();
     }
@@ -478,8 +528,15 @@ esp_err_t audio_init(void)
     s_i2s_enabled = true;
 
     audio_eq_init(AUDIO_SAMPLE_RATE);
+    audio_limiter_init(AUDIO_SAMPLE_RATE);
     audio_sine_init();
 
+    err = audio_mixer_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mixer start failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
     s_cmd_queue = xQueueCreate(AUDIO_QUEUE_DEPTH, sizeof(audio_cmd_t));
     if (!s_cmd_queue) {
         ESP_LOGE(TAG, "queue create failed");
@@ -507,6 +564,7 @@ esp_err_t audio_init(void)
 void audio_set_volume(uint8_t volume)
 {
     s_volume = volume;
+    audio_mixer_set_gain(AUDIO_SOURCE_BT, pcm_gain_from_volume(volume));
 }
 
 uint8_t audio_get_volume(void)
@@ -514,6 +572,14 @@ uint8_t audio_get_volume(void)
     return s_volume;
 }
 
+void audio_set_loudness(bool enabled)
+{
+    audio_limiter_config_t cfg;
+    audio_limiter_get_config(&cfg);
+    cfg.comp_enabled = enabled;
+    audio_limiter_set_config(&cfg);
+}
+
 esp_err_t audio_i2s_set_sample_rate(uint32_t sample_rate)
 {
     if (!s_tx_chan || sample_rate == 0) {
@@ -532,6 +598,7 @@ esp_err_t audio_i2s_set_sample_rate(uint32_t sample_rate)
         return err;
     }
     s_i2s_enabled = false;
+    audio_pos_flush();
     err = i2s_channel_reconfig_std_clock(s_tx_chan, &clk_cfg);
     if (err != ESP_OK) {
         if (s_i2s_mutex) {
@@ -547,14 +614,37 @@ esp_err_t audio_i2s_set_sample_rate(uint32_t sample_rate)
         return err;
     }
     s_i2s_enabled = (err == ESP_OK);
+    s_sample_rate = sample_rate;
     if (s_i2s_mutex) {
         xSemaphoreGive(s_i2s_mutex);
     }
     audio_eq_set_sample_rate(sample_rate);
+    audio_limiter_set_sample_rate(sample_rate);
     return ESP_OK;
 }
 
-esp_err_t audio_i2s_write(const void *data, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+uint32_t audio_i2s_get_sample_rate(void)
+{
+    return s_sample_rate;
+}
+
+uint64_t audio_i2s_get_played_frames(void)
+{
+    portENTER_CRITICAL(&s_pos_mux);
+    uint64_t played = s_frames_played;
+    portEXIT_CRITICAL(&s_pos_mux);
+    return played;
+}
+
+uint64_t audio_i2s_get_written_frames(void)
+{
+    portENTER_CRITICAL(&s_pos_mux);
+    uint64_t written = s_frames_written;
+    portEXIT_CRITICAL(&s_pos_mux);
+    return written;
+}
+
+esp_err_t audio_i2s_write(const int16_t *samples, size_t len, size_t *bytes_written, uint32_t timeout_ms)
 {
     if (!s_tx_chan) {
         return ESP_ERR_INVALID_STATE;
@@ -572,68 +662,17 @@ esp_err_t audio_i2s_write(const void *data, size_t len, size_t *bytes_written, u
         }
         s_i2s_enabled = true;
     }
-    if (!data || len == 0) {
-        if (bytes_written) {
-            *bytes_written = 0;
-        }
-        if (s_i2s_mutex) {
-            xSemaphoreGive(s_i2s_mutex);
-        }
-        return ESP_OK;
-    }
-
-    if (audio_eq_is_flat()) {
-        esp_err_t err = i2s_channel_write(s_tx_chan, data, len, bytes_written, timeout_ms);
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "i2s write err=%s", esp_err_to_name(err));
-        }
-        if (s_i2s_mutex) {
-            xSemaphoreGive(s_i2s_mutex);
-        }
-        return err;
-    }
-
-    const uint8_t *src = (const uint8_t *)data;
-    size_t total_written = 0;
+    size_t bw = 0;
     esp_err_t err = ESP_OK;
-
-    while (len > 0) {
-        size_t frames = len / (sizeof(int16_t) * 2);
-        if (frames == 0) {
-            size_t bw = 0;
-        err = i2s_channel_write(s_tx_chan, src, len, &bw, timeout_ms);
+    if (samples && len > 0) {
+        err = i2s_channel_write(s_tx_chan, samples, len, &bw, timeout_ms);
         if (err != ESP_OK) {
             ESP_LOGW(TAG, "i2s write err=%s", esp_err_to_name(err));
         }
-        total_written += bw;
-        break;
-        }
-
-        if (frames > AUDIO_EQ_CHUNK_FRAMES) {
-            frames = AUDIO_EQ_CHUNK_FRAMES;
-        }
-        size_t chunk_bytes = frames * sizeof(int16_t) * 2;
-        memcpy(s_eq_buf, src, chunk_bytes);
-        audio_eq_process(s_eq_buf, frames, 2);
-
-        size_t bw = 0;
-        err = i2s_channel_write(s_tx_chan, s_eq_buf, chunk_bytes, &bw, timeout_ms);
-        if (err != ESP_OK) {
-            ESP_LOGW(TAG, "i2s write err=%s", esp_err_to_name(err));
-        }
-        total_written += bw;
-        if (err != ESP_OK || bw == 0) {
-            break;
-        }
-        if (bw < chunk_bytes) {
-            break;
-        }
-        src += chunk_bytes;
-        len -= chunk_bytes;
+        audio_pos_add_written(bw);
     }
-
     if (bytes_written) {
-        *bytes_written = total_written;
+        *bytes_written = bw;
     }
     if (s_i2s_mutex) {
         xSemaphoreGive(s_i2s_mutex);
@@ -641,52 +680,12 @@ esp_err_t audio_i2s_write(const void *data, size_t len, size_t *bytes_written, u
     return err;
 }
 
-esp_err_t audio_i2s_reset(void)
-{
-    if (!s_tx_chan) {
-        return ESP_ERR_INVALID_STATE;
-    }
-    if (s_i2s_mutex) {
-        xSemaphoreTake(s_i2s_mutex, portMAX_DELAY);
-    }
-    esp_err_t err = i2s_channel_disable(s_tx_chan);
-    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
-        if (s_i2s_mutex) {
-            xSemaphoreGive(s_i2s_mutex);
-        }
-        return err;
-    }
-    err = i2s_channel_enable(s_tx_chan);
-    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
-        if (s_i2s_mutex) {
-            xSemaphoreGive(s_i2s_mutex);
-        }
-        return err;
-    }
-    s_i2s_enabled = (err == ESP_OK);
-    if (s_i2s_mutex) {
-        xSemaphoreGive(s_i2s_mutex);
-    }
-    return ESP_OK;
-}
-
-void audio_i2s_write_silence(uint32_t duration_ms)
-{
-    if (!s_tx_chan || duration_ms == 0) {
-        return;
-    }
-    bool prev_stop = s_stop_requested;
-    s_stop_requested = false;
-    audio_write_silence(duration_ms);
-    s_stop_requested = prev_stop;
-}
-
 static void audio_play_tone_volume(uint16_t freq_hz, uint32_t duration_ms, uint8_t volume)
 {
     if (!s_audio_ready || !s_cmd_queue) {
         return;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_TONE, false)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_TONE)) {
         return;
     }
     audio_cmd_t cmd = {
@@ -826,9 +825,9 @@ void audio_play_tone_sequence_blocking(const audio_tone_step_t *seq, size_t coun
             break;
         }
         if (seq[i].freq_hz == 0) {
-            audio_write_silence(seq[i].duration_ms);
+            audio_write_silence(AUDIO_SOURCE_ALARM, seq[i].duration_ms);
         } else {
-            audio_write_tone(seq[i].freq_hz, seq[i].duration_ms, volume);
+            audio_write_tone(AUDIO_SOURCE_ALARM, seq[i].freq_hz, seq[i].duration_ms, volume);
         }
     }
 }
@@ -845,9 +844,11 @@ void audio_play_alarm_tone_volume(uint8_t tone, uint8_t volume)
     if (!s_audio_ready || !s_cmd_queue) {
         return;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_ALARM, true)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_ALARM)) {
         return;
     }
+    // Synthesized alarms carry their volume; an MP3 alarm may have left a gain.
+    audio_mixer_set_gain(AUDIO_SOURCE_ALARM, AUDIO_MIXER_UNITY);
     s_stop_requested = true;
     xQueueReset(s_cmd_queue);
     (void)tone;
@@ -859,7 +860,7 @@ void audio_play_system_tone(uint8_t tone)
     if (!s_audio_ready || !s_cmd_queue) {
         return;
     }
-    if (!audio_owner_acquire(AUDIO_OWNER_TONE, true)) {
+    if (!audio_mixer_open(AUDIO_SOURCE_TONE)) {
         return;
     }
     audio_tones_play_system(tone, s_volume);
@@ -872,7 +873,7 @@ void audio_stop(void)
     }
     s_stop_requested = true;
     xQueueReset(s_cmd_queue);
-    audio_queue_silence(30);
-    audio_owner_release(AUDIO_OWNER_TONE);
+    audio_mixer_flush(AUDIO_SOURCE_TONE);
+    audio_mixer_close(AUDIO_SOURCE_TONE);
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "audio_eq.h"
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -11,10 +13,29 @@ extern "C" {
 esp_err_t audio_init(void);
 void audio_set_volume(uint8_t volume);
 uint8_t audio_get_volume(void);
+// Switches the output compressor; the peak limiter always runs.
+void audio_set_loudness(bool enabled);
 esp_err_t audio_i2s_set_sample_rate(uint32_t sample_rate);
-esp_err_t audio_i2s_write(const void *data, size_t len, size_t *bytes_written, uint32_t timeout_ms);
-esp_err_t audio_i2s_reset(void);
-void audio_i2s_write_silence(uint32_t duration_ms);
+uint32_t audio_i2s_get_sample_rate(void);
+// Frames the DMA has sent to the DAC since boot, from the I2S sent events.
+// Underrun and idle silence is not counted (to within one 384-frame DMA
+// buffer), so this only moves while written audio is actually audible.
+uint64_t audio_i2s_get_played_frames(void);
+// Frames accepted by audio_i2s_write() since boot. Minus the played
+// count, this is what is still queued ahead of the speaker.
+uint64_t audio_i2s_get_written_frames(void);
+// Fraction bits below the int16 LSB in the mixer's accumulator.
+#define AUDIO_OUTPUT_FRAC_BITS AUDIO_EQ_FRAC_BITS
+// Output stage for one mixed block: EQ, limiter and soft clipping in a single
+// pass from the interleaved stereo accumulator (gains already applied, may
+// exceed int16 range) to `out`. Output task only.
+void audio_output_render(const int32_t *mix, int16_t *out, size_t frames);
+// Frames the output stage holds back; rendering that many frames of silence
+// pushes the tail of the last block out.
+size_t audio_output_latency_frames(void);
+// Writes rendered interleaved stereo int16 to the DMA queue. Only the mixer
+// task calls this; everything else plays through audio_mixer_write().
+esp_err_t audio_i2s_write(const int16_t *samples, size_t len, size_t *bytes_written, uint32_t timeout_ms);
 void audio_play_tone(uint16_t freq_hz, uint32_t duration_ms);
 typedef struct {
     uint16_t freq_hz;
@@ -37,6 +58,7 @@ typedef struct {
 void audio_play_tone_sequence(const audio_tone_step_t *seq, size_t count, uint8_t volume);
 void audio_play_pluck_sequence(const audio_pluck_step_t *seq, size_t count, uint8_t volume);
 void audio_play_chord_sequence(const audio_chord_step_t *seq, size_t count, uint8_t volume);
+// Renders on the caller's task into the alarm source.
 void audio_play_tone_sequence_blocking(const audio_tone_step_t *seq, size_t count, uint8_t volume);
 void audio_play_alarm(void);
 void audio_play_alarm_tone(uint8_t tone);
@@ -1,29 +1,43 @@
 #include "audio_player.h"
 
-#include "audio_owner.h"
+#include "audio_mixer.h"
 #include "audio_pcm5102.h"
+#include "audio_prefetch.h"
+#include "audio_resampler.h"
 #include "helix_mp3_wrapper.h"
+#include "pcm_convert.h"
+#include "track_catalog.h"
+#include "track_playlist.h"
+#include "track_shuffle.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
-#include <ctype.h>
-#include <dirent.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define PLAYER_MAX_TRACKS 64
-#define PLAYER_MAX_PATH 160
+#define PLAYER_MAX_PATH TRACK_CATALOG_MAX_PATH
 #define PLAYER_QUEUE_DEPTH 8
-#define PLAYER_READ_BYTES 1024
+#define PLAYER_WAV_BLOCK_FRAMES 256    // at most 2 KB in, 1 KB out on the player stack
 #define PLAYER_I2S_TIMEOUT_MS 100
 #define PLAYER_MP3_I2S_TIMEOUT_MS 5000
 #define PLAYER_DECODE_CORE 1
+#define PLAYER_PREOPEN_LEAD_MS 3000
+#define PLAYER_XFADE_MAX_MS 10000
+#define PLAYER_XFADE_CHUNK 576          // frames pulled from the incoming track at a time
+#define PLAYER_XFADE_MAX_LOAD 700       // per mille of real time both decoders may take on core 1
+#define PLAYER_XFADE_MIN_QUEUE 384      // frames queued ahead of the DAC; below one DMA buffer the fade is starving
+#define PLAYER_NOTIFY_CMD (1U << 0)
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
 
 static const char *TAG = "audio_player";
 
@@ -31,16 +45,12 @@ typedef struct {
     uint32_t sample_rate;
     uint16_t channels;
     uint16_t bits_per_sample;
+    uint16_t block_align;
+    pcm_format_t format;
     uint32_t data_offset;
     uint32_t data_size;
 } wav_info_t;
 
-typedef enum {
-    PLAYER_FMT_UNKNOWN = 0,
-    PLAYER_FMT_WAV,
-    PLAYER_FMT_MP3
-} player_format_t;
-
 typedef enum {
     CMD_PLAY,
     CMD_PAUSE,
@@ -48,15 +58,38 @@ typedef enum {
     CMD_NEXT,
     CMD_PREV,
     CMD_RESCAN,
+    CMD_CATALOG,
     CMD_SET_REPEAT,
+    CMD_SET_SEED,
     CMD_SHUTDOWN
 } audio_player_cmd_type_t;
 
 typedef struct {
     audio_player_cmd_type_t type;
     audio_repeat_mode_t repeat_mode;
+    uint32_t shuffle_seed;
+    bool scan_done;
 } audio_player_cmd_t;
 
+// Next track resolved and opened ahead of time for gapless transitions.
+typedef struct {
+    helix_mp3_source_t *src;
+    uint16_t order_index;
+    uint16_t track_idx;
+    char path[PLAYER_MAX_PATH];
+} player_next_t;
+
+// Overlap of the ending track with the pre-opened next one.
+typedef struct {
+    bool tried;             // started or refused for the current track
+    bool active;
+    bool handed_over;       // the next track has started; the current one stops
+    uint32_t pos;           // frames mixed so far
+    uint32_t len;
+    uint64_t start_frame;   // player frames written where the next track began
+    uint32_t queue_low;     // fewest frames queued ahead of the DAC during the fade
+} player_xfade_t;
+
 typedef enum {
     REQ_NONE,
     REQ_STOP,
@@ -69,16 +102,39 @@ static TaskHandle_t s_player_task = NULL;
 static SemaphoreHandle_t s_api_mutex = NULL;
 static char s_folder[PLAYER_MAX_PATH] = "/sdcard/music";
 static char s_current_path[PLAYER_MAX_PATH];
+static uint16_t s_current_track = UINT16_MAX;  // catalog index s_current_path was resolved for
+static bool s_playlist = false;     // s_folder names an M3U playlist
 static uint16_t s_track_count = 0;
-static uint16_t s_order[PLAYER_MAX_TRACKS];
+static track_shuffle_t s_shuffle;      // play order in shuffle mode; no per-track state
 static uint16_t s_order_index = 0;
 static audio_repeat_mode_t s_repeat_mode = PLAYER_REPEAT_ALL;
 static audio_player_state_t s_state = PLAYER_STATE_STOPPED;
 static audio_request_t s_request = REQ_NONE;
-static uint8_t s_volume = 200;
 static volatile uint32_t s_elapsed_ms = 0;
 static volatile uint32_t s_total_ms = 0;
+static uint64_t s_track_start_frame = 0;    // player frames written when the track began
+static uint32_t s_decoded_ms = 0;           // decoder position, ahead of s_elapsed_ms by the output queue
+static uint16_t s_crossfade_ms = 0;
+static helix_mp3_source_t *s_cur_src = NULL;
+static player_xfade_t s_xfade;
+static int16_t s_xfade_buf[PLAYER_XFADE_CHUNK * 2];
 static volatile bool s_shutdown_requested = false;
+static player_next_t s_next;
+static bool s_next_attempted = false;
+static bool s_play_pending = false;     // play pressed before the scanner found a track
+
+// Seqlock snapshot for readers on other tasks. Only the player task writes
+// it (API calls do while no task runs); the write sits in a critical section
+// so a reader on the same core never spins on a half-written copy.
+static audio_player_status_t s_status = {
+    .state = PLAYER_STATE_STOPPED,
+    .repeat_mode = PLAYER_REPEAT_ALL
+};
+static uint32_t s_status_seq = 0;
+static portMUX_TYPE s_status_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t s_cmd_pending = 0;      // set after a command is queued; polled per frame
+static int64_t s_play_request_us = 0;   // audio_player_play() time, until the first sample is queued
 
 static void player_lock(void)
 {
@@ -99,83 +155,129 @@ static bool player_has_tracks(void)
     return s_track_count > 0;
 }
 
-static player_format_t player_detect_format(const char *name)
+// Commands go straight to the queue: it is created once and never deleted,
+// so posting needs no lock. The flag lets the decode loop skip the queue
+// while nothing is pending; the notification wakes a paused or idle task.
+static bool player_post(const audio_player_cmd_t *cmd)
 {
-    size_t len = strlen(name);
-    if (len < 4) {
-        return PLAYER_FMT_UNKNOWN;
+    QueueHandle_t queue = __atomic_load_n(&s_cmd_queue, __ATOMIC_ACQUIRE);
+    if (!queue || xQueueSend(queue, cmd, 0) != pdTRUE) {
+        return false;
     }
-    const char *ext = name + len - 4;
-    if ((tolower((unsigned char)ext[0]) == '.') &&
-        (tolower((unsigned char)ext[1]) == 'w') &&
-        (tolower((unsigned char)ext[2]) == 'a') &&
-        (tolower((unsigned char)ext[3]) == 'v')) {
-        return PLAYER_FMT_WAV;
+    __atomic_store_n(&s_cmd_pending, 1, __ATOMIC_RELEASE);
+    TaskHandle_t task = __atomic_load_n(&s_player_task, __ATOMIC_ACQUIRE);
+    if (task) {
+        xTaskNotify(task, PLAYER_NOTIFY_CMD, eSetBits);
     }
-    if ((tolower((unsigned char)ext[0]) == '.') &&
-        (tolower((unsigned char)ext[1]) == 'm') &&
-        (tolower((unsigned char)ext[2]) == 'p') &&
-        (tolower((unsigned char)ext[3]) == '3')) {
-        return PLAYER_FMT_MP3;
+    return true;
+}
+
+static uint16_t player_order_track(uint16_t order_index)
+{
+    if (s_repeat_mode != PLAYER_REPEAT_SHUFFLE) {
+        return order_index;
     }
-    return PLAYER_FMT_UNKNOWN;
+    return (uint16_t)track_shuffle_at(&s_shuffle, order_index);
 }
 
-static void player_build_order(void)
+// Re-keys the order for the current track count and repeat mode, keeping
+// `track` at the play position.
+static void player_build_order(uint16_t track)
 {
-    for (uint16_t i = 0; i < s_track_count; ++i) {
-        s_order[i] = i;
+    track_shuffle_init(&s_shuffle, s_track_count, s_shuffle.seed);
+    if (track >= s_track_count) {
+        track = 0;
+    }
+    if (s_repeat_mode == PLAYER_REPEAT_SHUFFLE) {
+        s_order_index = (uint16_t)track_shuffle_pos(&s_shuffle, track);
+    } else {
+        s_order_index = track;
     }
+}
 
-    if (s_repeat_mode != PLAYER_REPEAT_SHUFFLE || s_track_count < 2) {
-        s_order_index = (s_order_index < s_track_count) ? s_order_index : 0;
-        return;
+static void player_publish(void)
+{
+    audio_player_status_t st = {
+        .state = s_state,
+        .repeat_mode = s_repeat_mode,
+        .track_index = player_has_tracks() ? (uint16_t)(player_order_track(s_order_index) + 1) : 0,
+        .track_count = s_track_count,
+        .elapsed_ms = s_elapsed_ms,
+        .total_ms = s_total_ms,
+        .shuffle_seed = s_shuffle.seed
+    };
+    portENTER_CRITICAL(&s_status_mux);
+    uint32_t seq = s_status_seq;
+    __atomic_store_n(&s_status_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s_status = st;
+    __atomic_store_n(&s_status_seq, seq + 2, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&s_status_mux);
+}
+
+// Elapsed time from what the DAC has actually played of this track: it trails
+// the decoder by the DMA queue and holds still while output stalls.
+static void player_update_elapsed(void)
+{
+    uint64_t played = audio_mixer_get_played_frames(AUDIO_SOURCE_PLAYER);
+    uint64_t frames = (played > s_track_start_frame) ? played - s_track_start_frame : 0;
+    uint32_t ms = (uint32_t)((frames * 1000ULL) / audio_i2s_get_sample_rate());
+    if (s_total_ms > 0 && ms > s_total_ms) {
+        ms = s_total_ms;
     }
+    s_elapsed_ms = ms;
+}
+
+static void player_set_repeat(audio_repeat_mode_t mode)
+{
+    uint16_t track = player_order_track(s_order_index);
+    s_repeat_mode = mode;
+    player_build_order(track);
+}
 
-    for (uint16_t i = s_track_count - 1; i > 0; --i) {
-        uint32_t j = esp_random() % (i + 1);
-        uint16_t tmp = s_order[i];
-        s_order[i] = s_order[j];
-        s_order[j] = tmp;
+static void player_set_seed(uint32_t seed)
+{
+    track_shuffle_init(&s_shuffle, s_track_count, seed);
+    if (s_repeat_mode == PLAYER_REPEAT_SHUFFLE) {
+        s_order_index = 0;
     }
-    s_order_index = 0;
 }
 
-static const char *player_current_path(void)
+// Crossing either end in shuffle mode moves to the neighbouring pass; the
+// seed step is invertible, so prev walks back into the previous order.
+static void player_wrap_order(bool forward)
 {
-    if (!player_has_tracks()) {
-        return NULL;
+    if (s_repeat_mode == PLAYER_REPEAT_SHUFFLE) {
+        uint32_t seed = forward ? track_shuffle_next_seed(s_shuffle.seed)
+                                : track_shuffle_prev_seed(s_shuffle.seed);
+        track_shuffle_init(&s_shuffle, s_track_count, seed);
     }
-    uint16_t track_idx = s_order[s_order_index];
+    s_order_index = forward ? 0 : (uint16_t)(s_track_count - 1);
+}
+
+static bool player_track_path(uint16_t track_idx, char *out, size_t out_len)
+{
     if (track_idx >= s_track_count) {
-        return NULL;
+        return false;
+    }
+    if (s_playlist) {
+        return track_playlist_path(track_idx, out, out_len);
     }
-    DIR *dir = opendir(s_folder);
-    if (!dir) {
-        ESP_LOGW(TAG, "folder open failed: %s", s_folder);
+    return track_catalog_path(track_idx, out, out_len);
+}
+
+static const char *player_current_path(void)
+{
+    if (!player_has_tracks()) {
         return NULL;
     }
-    struct dirent *entry;
-    uint16_t idx = 0;
-    const char *result = NULL;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-        if (player_detect_format(entry->d_name) == PLAYER_FMT_UNKNOWN) {
-            continue;
-        }
-        if (idx == track_idx) {
-            int written = snprintf(s_current_path, sizeof(s_current_path), "%s/%s", s_folder, entry->d_name);
-            if (written > 0 && written < (int)sizeof(s_current_path)) {
-                result = s_current_path;
-            }
-            break;
-        }
-        idx++;
+    uint16_t track = player_order_track(s_order_index);
+    if (!player_track_path(track, s_current_path, sizeof(s_current_path))) {
+        s_current_track = UINT16_MAX;
+        return NULL;
     }
-    closedir(dir);
-    return result;
+    s_current_track = track;
+    return s_current_path;
 }
 
 static bool player_step_next(bool manual)
@@ -194,14 +296,79 @@ static bool player_step_next(bool manual)
     }
 
     if (manual || s_repeat_mode == PLAYER_REPEAT_ALL || s_repeat_mode == PLAYER_REPEAT_SHUFFLE) {
-        player_build_order();
-        s_order_index = 0;
+        player_wrap_order(true);
         return true;
     }
 
     return false;
 }
 
+// Order slot that player_step_next(false) will move to, without side effects.
+// A shuffle wrap switches to the next pass, so it is not pre-opened.
+static bool player_peek_next(uint16_t *order_index)
+{
+    if (!player_has_tracks()) {
+        return false;
+    }
+    if (s_repeat_mode == PLAYER_REPEAT_ONE) {
+        *order_index = s_order_index;
+        return true;
+    }
+    if (s_order_index + 1 < s_track_count) {
+        *order_index = s_order_index + 1;
+        return true;
+    }
+    if (s_repeat_mode == PLAYER_REPEAT_ALL) {
+        *order_index = 0;
+        return true;
+    }
+    return false;
+}
+
+static void player_drop_next(void)
+{
+    if (s_next.src) {
+        helix_mp3_close(s_next.src);
+        s_next.src = NULL;
+    }
+}
+
+static void player_preopen_next(void)
+{
+    uint16_t order_index;
+    if (!player_peek_next(&order_index)) {
+        return;
+    }
+    uint16_t track_idx = player_order_track(order_index);
+    if (!player_track_path(track_idx, s_next.path, sizeof(s_next.path)) ||
+        track_catalog_detect_format(s_next.path) != TRACK_FMT_MP3) {
+        return;
+    }
+    s_next.src = helix_mp3_open(s_next.path, 0.0f);
+    s_next.order_index = order_index;
+    s_next.track_idx = track_idx;
+    if (s_next.src) {
+        ESP_LOGD(TAG, "pre-opened %s", s_next.path);
+    }
+}
+
+// Hands over the pre-opened source if it is the track about to play.
+static helix_mp3_source_t *player_take_next(void)
+{
+    helix_mp3_source_t *src = s_next.src;
+    if (!src) {
+        return NULL;
+    }
+    s_next.src = NULL;
+    if (s_next.order_index != s_order_index || s_next.track_idx != player_order_track(s_order_index)) {
+        helix_mp3_close(src);
+        return NULL;
+    }
+    memcpy(s_current_path, s_next.path, sizeof(s_current_path));
+    s_current_track = s_next.track_idx;
+    return src;
+}
+
 static bool player_step_prev(bool manual)
 {
     if (!player_has_tracks()) {
@@ -218,40 +385,55 @@ static bool player_step_prev(bool manual)
     }
 
     if (manual || s_repeat_mode == PLAYER_REPEAT_ALL || s_repeat_mode == PLAYER_REPEAT_SHUFFLE) {
-        player_build_order();
-        if (s_track_count > 0) {
-            s_order_index = s_track_count - 1;
-        }
+        player_wrap_order(false);
         return true;
     }
 
     return false;
 }
 
-static esp_err_t player_scan_folder(void)
+// Picks up the catalog's track count. While a shuffled library is still
+// being scanned the order is left alone so it is not reshuffled per batch.
+// A finished scan may have swapped in a catalog where tracks moved even at
+// the same count, so the current track is looked up again by its path.
+static void player_sync_catalog(bool done)
 {
-    s_track_count = 0;
-
-    DIR *dir = opendir(s_folder);
-    if (!dir) {
-        ESP_LOGW(TAG, "folder open failed: %s", s_folder);
-        return ESP_FAIL;
+    uint32_t count = s_playlist ? track_playlist_count() : track_catalog_count();
+    uint16_t n = (uint16_t)((count > UINT16_MAX) ? UINT16_MAX : count);
+    uint16_t track = player_has_tracks() ? player_order_track(s_order_index) : 0;
+    bool moved = false;
+    uint32_t found;
+    if (done && !s_playlist && player_has_tracks() && s_current_track == track &&
+        track_catalog_find(s_current_path, &found) && found < n && found != track) {
+        ESP_LOGI(TAG, "current track moved %u -> %u", (unsigned)track, (unsigned)found);
+        track = (uint16_t)found;
+        s_current_track = track;
+        moved = true;
     }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && s_track_count < PLAYER_MAX_TRACKS) {
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-        if (player_detect_format(entry->d_name) == PLAYER_FMT_UNKNOWN) {
-            continue;
-        }
-        s_track_count++;
+    if (moved || (n != s_track_count &&
+                  (done || s_track_count == 0 || s_repeat_mode != PLAYER_REPEAT_SHUFFLE))) {
+        player_drop_next();
+        s_track_count = n;
+        player_build_order(track);
+    }
+    if (s_play_pending && player_has_tracks()) {
+        s_play_pending = false;
+        s_state = PLAYER_STATE_PLAYING;
     }
-    closedir(dir);
+    if (done) {
+        s_play_pending = false;
+    }
+}
 
-    player_build_order();
-    return ESP_OK;
+static void player_catalog_cb(uint32_t count, bool done, void *user)
+{
+    (void)count;
+    (void)user;
+    audio_player_cmd_t cmd = {
+        .type = CMD_CATALOG,
+        .scan_done = done
+    };
+    player_post(&cmd);
 }
 
 static bool wav_read_header(FILE *fp, wav_info_t *out)
@@ -271,6 +453,8 @@ static bool wav_read_header(FILE *fp, wav_info_t *out)
     uint32_t sample_rate = 0;
     uint16_t channels = 0;
     uint16_t bits = 0;
+    uint16_t block_align = 0;
+    uint16_t audio_format = 0;
 
     while (!got_fmt || !got_data) {
         uint8_t chunk[8];
@@ -284,7 +468,7 @@ static bool wav_read_header(FILE *fp, wav_info_t *out)
                               ((uint32_t)chunk[7] << 24);
 
         if (memcmp(chunk, "fmt ", 4) == 0) {
-            uint8_t fmt[16] = {0};
+            uint8_t fmt[40] = {0};
             size_t to_read = chunk_size < sizeof(fmt) ? chunk_size : sizeof(fmt);
             if (fread(fmt, 1, to_read, fp) != to_read) {
                 return false;
@@ -293,15 +477,20 @@ static bool wav_read_header(FILE *fp, wav_info_t *out)
                 fseek(fp, (long)(chunk_size - to_read), SEEK_CUR);
             }
 
-            uint16_t audio_format = (uint16_t)fmt[0] | ((uint16_t)fmt[1] << 8);
+            audio_format = (uint16_t)fmt[0] | ((uint16_t)fmt[1] << 8);
             channels = (uint16_t)fmt[2] | ((uint16_t)fmt[3] << 8);
             sample_rate = (uint32_t)fmt[4] |
                           ((uint32_t)fmt[5] << 8) |
                           ((uint32_t)fmt[6] << 16) |
                           ((uint32_t)fmt[7] << 24);
+            block_align = (uint16_t)fmt[12] | ((uint16_t)fmt[13] << 8);
             bits = (uint16_t)fmt[14] | ((uint16_t)fmt[15] << 8);
+            // WAVE_FORMAT_EXTENSIBLE: the real format leads the subformat GUID.
+            if (audio_format == WAV_FORMAT_EXTENSIBLE && to_read >= 26) {
+                audio_format = (uint16_t)fmt[24] | ((uint16_t)fmt[25] << 8);
+            }
 
-            if (audio_format != 1) {
+            if (audio_format != WAV_FORMAT_PCM && audio_format != WAV_FORMAT_FLOAT) {
                 ESP_LOGW(TAG, "unsupported format: %u", (unsigned)audio_format);
                 return false;
             }
@@ -324,14 +513,31 @@ static bool wav_read_header(FILE *fp, wav_info_t *out)
         return false;
     }
 
-    if (bits != 16 || (channels != 1 && channels != 2)) {
-        ESP_LOGW(TAG, "unsupported wav: %u bit, %u ch", (unsigned)bits, (unsigned)channels);
+    pcm_format_t format = PCM_FMT_S16;
+    bool supported = channels == 1 || channels == 2;
+    if (audio_format == WAV_FORMAT_FLOAT) {
+        format = PCM_FMT_F32;
+        supported = supported && bits == 32;
+    } else if (bits == 8) {
+        format = PCM_FMT_U8;
+    } else if (bits == 24) {
+        format = PCM_FMT_S24;
+    } else if (bits == 32) {
+        format = PCM_FMT_S32;
+    } else {
+        supported = supported && bits == 16;
+    }
+    if (!supported || block_align != channels * pcm_sample_bytes(format)) {
+        ESP_LOGW(TAG, "unsupported wav: fmt %u, %u bit, %u ch", (unsigned)audio_format, (unsigned)bits,
+                 (unsigned)channels);
         return false;
     }
 
     out->sample_rate = sample_rate;
     out->channels = channels;
     out->bits_per_sample = bits;
+    out->block_align = block_align;
+    out->format = format;
     out->data_offset = data_offset;
     out->data_size = data_size;
 
@@ -346,11 +552,11 @@ static void player_handle_cmd(const audio_player_cmd_t *cmd)
             if (s_state == PLAYER_STATE_PAUSED) {
                 s_state = PLAYER_STATE_PLAYING;
             } else if (s_state == PLAYER_STATE_STOPPED) {
-                if (!player_has_tracks()) {
-                    player_scan_folder();
-                }
                 if (player_has_tracks()) {
                     s_state = PLAYER_STATE_PLAYING;
+                } else {
+                    // Starts as soon as the scanner reports the first track.
+                    s_play_pending = true;
                 }
             }
             break;
@@ -360,6 +566,7 @@ static void player_handle_cmd(const audio_player_cmd_t *cmd)
             }
             break;
         case CMD_STOP:
+            s_play_pending = false;
             s_state = PLAYER_STATE_STOPPED;
             s_request = REQ_STOP;
             break;
@@ -372,11 +579,23 @@ static void player_handle_cmd(const audio_player_cmd_t *cmd)
             s_state = PLAYER_STATE_PLAYING;
             break;
         case CMD_RESCAN:
-            player_scan_folder();
+            if (s_playlist) {
+                track_playlist_open(s_folder);
+                player_sync_catalog(true);
+            } else {
+                track_catalog_rescan();
+            }
+            break;
+        case CMD_CATALOG:
+            player_sync_catalog(cmd->scan_done);
             break;
         case CMD_SET_REPEAT:
-            s_repeat_mode = cmd->repeat_mode;
-            player_build_order();
+            player_drop_next();
+            player_set_repeat(cmd->repeat_mode);
+            break;
+        case CMD_SET_SEED:
+            player_drop_next();
+            player_set_seed(cmd->shuffle_seed);
             break;
         case CMD_SHUTDOWN:
             s_state = PLAYER_STATE_STOPPED;
@@ -386,116 +605,272 @@ static void player_handle_cmd(const audio_player_cmd_t *cmd)
         default:
             break;
     }
+    player_publish();
 }
 
 static void player_drain_cmds(void)
 {
+    if (!__atomic_load_n(&s_cmd_pending, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    // Cleared before draining: a command queued meanwhile sets it again.
+    __atomic_store_n(&s_cmd_pending, 0, __ATOMIC_RELEASE);
     audio_player_cmd_t cmd;
     while (xQueueReceive(s_cmd_queue, &cmd, 0)) {
         player_handle_cmd(&cmd);
     }
 }
 
-static void player_stream_file(FILE *fp, const wav_info_t *info)
+// Blocks without a timeout until a command arrives, then handles it.
+static void player_wait_cmds(void)
+{
+    if (!__atomic_load_n(&s_cmd_pending, __ATOMIC_ACQUIRE)) {
+        xTaskNotifyWait(0, UINT32_MAX, NULL, portMAX_DELAY);
+    }
+    player_drain_cmds();
+}
+
+static void player_note_first_sample(void)
+{
+    if (!__atomic_load_n(&s_play_request_us, __ATOMIC_RELAXED)) {
+        return;
+    }
+    int64_t t0 = __atomic_exchange_n(&s_play_request_us, 0, __ATOMIC_RELAXED);
+    if (t0 != 0) {
+        // Audible one DMA queue later (at most 8 x 384 frames).
+        ESP_LOGI(TAG, "play -> first sample queued in %u us", (unsigned)(esp_timer_get_time() - t0));
+    }
+}
+
+// False when the file cannot be played at the output rate.
+static bool player_stream_file(FILE *fp, const wav_info_t *info)
 {
     size_t bytes_written = 0;
     uint32_t remaining = info->data_size;
-    uint32_t in_frame_bytes = info->channels * 2;
+    uint32_t in_frame_bytes = info->block_align;
     uint32_t total_frames = info->data_size / in_frame_bytes;
-    uint32_t processed_frames = 0;
     s_total_ms = (uint32_t)(((uint64_t)total_frames * 1000ULL) / info->sample_rate);
     s_elapsed_ms = 0;
 
-    uint8_t raw[PLAYER_READ_BYTES];
-    int16_t out[(PLAYER_READ_BYTES / 2) * 2];
-
-    audio_i2s_set_sample_rate(info->sample_rate);
+    // Whole frames per block, so no sample straddles two reads; the prefetch
+    // ring underneath keeps the card reads themselves block-aligned.
+    uint32_t raw[PLAYER_WAV_BLOCK_FRAMES * 2];
+    int16_t out[PLAYER_WAV_BLOCK_FRAMES * 2];
+    size_t block_bytes = PLAYER_WAV_BLOCK_FRAMES * in_frame_bytes;
+
+    // While another source holds the output clock the file is resampled,
+    // into `raw` once a block has been converted out of it. Without a
+    // resampler the track is skipped: the clock belongs to the mixer.
+    audio_resampler_t *rs = NULL;
+    uint32_t out_rate = audio_mixer_claim_rate(AUDIO_SOURCE_PLAYER, info->sample_rate);
+    if (out_rate != info->sample_rate) {
+        rs = malloc(sizeof(*rs));
+        if (!rs || !audio_resampler_init(rs, info->sample_rate, out_rate)) {
+            ESP_LOGW(TAG, "no resampler for %u -> %u Hz, skipping", (unsigned)info->sample_rate,
+                     (unsigned)out_rate);
+            free(rs);
+            return false;
+        }
+    }
+    audio_prefetch_t *pf = audio_prefetch_open(fp, info->sample_rate * in_frame_bytes, AUDIO_PREFETCH_LEAD_MS_DEFAULT,
+                                               NULL, 0);
 
-    while (remaining > 0) {
+    while (remaining >= in_frame_bytes) {
         player_drain_cmds();
         if (s_request != REQ_NONE || s_state == PLAYER_STATE_STOPPED) {
             break;
         }
         if (s_state == PLAYER_STATE_PAUSED) {
-            vTaskDelay(pdMS_TO_TICKS(20));
+            player_wait_cmds();
             continue;
         }
 
-        size_t to_read = remaining > sizeof(raw) ? sizeof(raw) : remaining;
-        size_t read = fread(raw, 1, to_read, fp);
+        size_t to_read = remaining > block_bytes ? block_bytes : remaining;
+        size_t read = pf ? audio_prefetch_read(pf, raw, to_read) : fread(raw, 1, to_read, fp);
         if (read == 0) {
             break;
         }
         remaining -= (uint32_t)read;
         size_t frames = read / in_frame_bytes;
-        processed_frames += (uint32_t)frames;
-        s_elapsed_ms = (uint32_t)(((uint64_t)processed_frames * 1000ULL) / info->sample_rate);
-
-        int16_t *in_samples = (int16_t *)raw;
-        for (size_t i = 0; i < frames; ++i) {
-            int16_t left;
-            int16_t right;
-            if (info->channels == 2) {
-                left = in_samples[i * 2];
-                right = in_samples[i * 2 + 1];
-            } else {
-                left = in_samples[i];
-                right = in_samples[i];
-            }
+        player_update_elapsed();
+        player_publish();
 
-            left = (int16_t)(((int32_t)left * s_volume) / 255);
-            right = (int16_t)(((int32_t)right * s_volume) / 255);
-            out[i * 2] = left;
-            out[i * 2 + 1] = right;
-        }
+        pcm_convert_block(info->format, (uint8_t)info->channels, raw, out, frames, PCM_GAIN_UNITY);
 
         if (s_request != REQ_NONE || s_state == PLAYER_STATE_STOPPED) {
             break;
         }
-        audio_i2s_write(out, frames * sizeof(int16_t) * 2, &bytes_written, PLAYER_I2S_TIMEOUT_MS);
+        if (rs) {
+            int16_t *rs_out = (int16_t *)raw;
+            audio_resampler_push(rs, out, frames, 2);
+            size_t got;
+            while ((got = audio_resampler_pull(rs, rs_out, PLAYER_WAV_BLOCK_FRAMES * 2)) > 0) {
+                audio_mixer_write(AUDIO_SOURCE_PLAYER, rs_out, got * sizeof(int16_t) * 2, &bytes_written,
+                                  PLAYER_I2S_TIMEOUT_MS);
+            }
+        } else {
+            audio_mixer_write(AUDIO_SOURCE_PLAYER, out, frames * sizeof(int16_t) * 2, &bytes_written,
+                              PLAYER_I2S_TIMEOUT_MS);
+        }
+        player_note_first_sample();
+    }
+    audio_prefetch_close(pf, NULL);
+    free(rs);
+    return true;
+}
+
+static uint32_t player_queued_frames(void)
+{
+    return (uint32_t)(audio_mixer_get_written_frames(AUDIO_SOURCE_PLAYER) -
+                      audio_mixer_get_played_frames(AUDIO_SOURCE_PLAYER));
+}
+
+// Starts mixing in the pre-opened track if it is the one that plays next,
+// runs at the output rate, and both decoders fit on the core together.
+// Otherwise the tracks join with a gapless cut.
+static void player_xfade_begin(uint32_t xfade_ms)
+{
+    s_xfade.tried = true;
+    uint16_t order_index;
+    if (!player_peek_next(&order_index) || order_index != s_next.order_index ||
+        player_order_track(order_index) != s_next.track_idx) {
+        return;
+    }
+    uint32_t rate = helix_mp3_source_sample_rate(s_next.src);
+    uint32_t out_rate = audio_i2s_get_sample_rate();
+    uint32_t load = helix_mp3_source_load(s_cur_src) + helix_mp3_source_load(s_next.src);
+    uint32_t remaining_ms = (s_total_ms > s_decoded_ms) ? s_total_ms - s_decoded_ms : 0;
+    if (xfade_ms > remaining_ms) {
+        xfade_ms = remaining_ms;
+    }
+    if (rate != out_rate || load > PLAYER_XFADE_MAX_LOAD) {
+        ESP_LOGI(TAG, "crossfade skipped: %u Hz into %u Hz, decode load %u per mille; gapless cut",
+                 (unsigned)rate, (unsigned)out_rate, (unsigned)load);
+        return;
+    }
+    s_xfade.len = (uint32_t)(((uint64_t)xfade_ms * out_rate) / 1000U);
+    if (s_xfade.len == 0) {
+        return;
+    }
+    s_xfade.active = true;
+    s_xfade.pos = 0;
+    s_xfade.start_frame = audio_mixer_get_written_frames(AUDIO_SOURCE_PLAYER);
+    s_xfade.queue_low = player_queued_frames();
+    ESP_LOGI(TAG, "crossfade %u ms into %s, decode load %u per mille", (unsigned)xfade_ms, s_next.path,
+             (unsigned)load);
+}
+
+// The next track takes over; what is left of the current one is dropped.
+static void player_xfade_end(const char *why)
+{
+    s_xfade.active = false;
+    s_xfade.handed_over = true;
+    ESP_LOGI(TAG, "crossfade %s after %u/%u frames: decode load %u+%u per mille, output queue low %u frames", why,
+             (unsigned)s_xfade.pos, (unsigned)s_xfade.len, (unsigned)helix_mp3_source_load(s_cur_src),
+             (unsigned)helix_mp3_source_load(s_next.src), (unsigned)s_xfade.queue_low);
+}
+
+static int32_t player_xfade_gain(uint32_t pos, bool incoming)
+{
+    float x = (float)pos * ((float)M_PI_2 / (float)s_xfade.len);
+    return (int32_t)((incoming ? sinf(x) : cosf(x)) * 32767.0f + 0.5f);
+}
+
+// Mixes the incoming track into `pcm` (stereo) with an equal-power curve:
+// cos/sin are evaluated at chunk ends and interpolated linearly in between.
+static void player_xfade_mix(int16_t *pcm, size_t frames)
+{
+    while (frames > 0) {
+        size_t n = (frames < PLAYER_XFADE_CHUNK) ? frames : PLAYER_XFADE_CHUNK;
+        if (s_xfade.pos < s_xfade.len && n > s_xfade.len - s_xfade.pos) {
+            n = s_xfade.len - s_xfade.pos;
+        }
+        size_t got = helix_mp3_source_read(s_next.src, s_xfade_buf, n, NULL);
+        memset(s_xfade_buf + got * 2, 0, (n - got) * 2 * sizeof(int16_t));
+        if (s_xfade.pos >= s_xfade.len) {
+            memcpy(pcm, s_xfade_buf, n * 2 * sizeof(int16_t));
+        } else {
+            int32_t out0 = player_xfade_gain(s_xfade.pos, false);
+            int32_t in0 = player_xfade_gain(s_xfade.pos, true);
+            int32_t out_step = ((player_xfade_gain(s_xfade.pos + (uint32_t)n, false) - out0) * 65536) / (int32_t)n;
+            int32_t in_step = ((player_xfade_gain(s_xfade.pos + (uint32_t)n, true) - in0) * 65536) / (int32_t)n;
+            int32_t g_out = out0 * 65536;
+            int32_t g_in = in0 * 65536;
+            for (size_t i = 0; i < n * 2; i += 2) {
+                int32_t go = g_out >> 16;
+                int32_t gi = g_in >> 16;
+                for (size_t c = 0; c < 2; ++c) {
+                    int32_t v = ((int32_t)pcm[i + c] * go + (int32_t)s_xfade_buf[i + c] * gi) >> 15;
+                    pcm[i + c] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+                }
+                g_out += out_step;
+                g_in += in_step;
+            }
+        }
+        s_xfade.pos += (uint32_t)n;
+        pcm += n * 2;
+        frames -= n;
     }
 }
 
-static size_t mp3_i2s_write_cb(const uint8_t *data, size_t len, void *user)
+static size_t mp3_i2s_write_cb(uint8_t *data, size_t len, void *user)
 {
     (void)user;
 
     player_drain_cmds();
     while (s_state == PLAYER_STATE_PAUSED && s_request == REQ_NONE) {
-        player_drain_cmds();
-        vTaskDelay(pdMS_TO_TICKS(20));
+        player_wait_cmds();
     }
 
-    if (s_request != REQ_NONE || s_state == PLAYER_STATE_STOPPED) {
+    if (s_request != REQ_NONE || s_state == PLAYER_STATE_STOPPED || s_xfade.handed_over) {
         return 0;
     }
 
+    // Gain runs in place on the decoder's slot; the only copy left is the one
+    // into the mixer's ring.
     size_t bytes_written = 0;
-    const uint8_t *out = data;
-    size_t out_len = len;
-    if (s_volume < 255 && len >= sizeof(int16_t)) {
-        static int16_t s_mp3_buf[1152 * 2];
-        size_t samples = len / sizeof(int16_t);
-        if (samples > (sizeof(s_mp3_buf) / sizeof(s_mp3_buf[0]))) {
-            samples = sizeof(s_mp3_buf) / sizeof(s_mp3_buf[0]);
+    int16_t *pcm = (int16_t *)data;
+    size_t samples = len / sizeof(int16_t);
+    uint32_t xfade_ms = __atomic_load_n(&s_crossfade_ms, __ATOMIC_RELAXED);
+    if (!s_xfade.tried && xfade_ms > 0 && s_next.src && s_total_ms > 0 &&
+        s_decoded_ms + xfade_ms >= s_total_ms) {
+        player_xfade_begin(xfade_ms);
+    }
+    if (s_xfade.active) {
+        uint32_t queued = player_queued_frames();
+        if (queued < s_xfade.queue_low) {
+            s_xfade.queue_low = queued;
+        }
+        if (queued < PLAYER_XFADE_MIN_QUEUE) {
+            // Two decoders cannot keep up: cut over instead of underrunning.
+            player_xfade_end("cut short");
+            return 0;
         }
-        const int16_t *in = (const int16_t *)data;
-        for (size_t i = 0; i < samples; ++i) {
-            s_mp3_buf[i] = (int16_t)(((int32_t)in[i] * s_volume) / 255);
+        player_xfade_mix(pcm, samples / 2);
+        if (s_xfade.pos >= s_xfade.len) {
+            player_xfade_end("done");
         }
-        out = (const uint8_t *)s_mp3_buf;
-        out_len = samples * sizeof(int16_t);
     }
-    esp_err_t err = audio_i2s_write(out, out_len, &bytes_written, PLAYER_MP3_I2S_TIMEOUT_MS);
+    esp_err_t err = audio_mixer_write(AUDIO_SOURCE_PLAYER, pcm, samples * sizeof(int16_t), &bytes_written,
+                                      PLAYER_MP3_I2S_TIMEOUT_MS);
     if (err != ESP_OK || bytes_written == 0) {
         ESP_LOGW(TAG, "i2s write failed err=%s bytes=%u/%u",
                  esp_err_to_name(err),
                  (unsigned)bytes_written,
                  (unsigned)len);
     }
+    player_note_first_sample();
     return bytes_written;
 }
 
+static uint32_t mp3_format_cb(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    // Native rate when the output is free to follow it, else the decoder
+    // resamples to whatever the output runs at.
+    return audio_mixer_claim_rate(AUDIO_SOURCE_PLAYER, sample_rate);
+}
+
 static void mp3_progress_cb(size_t bytes_read, size_t total_bytes, uint32_t elapsed_ms, uint32_t est_total_ms, void *user)
 {
     (void)bytes_read;
@@ -505,76 +880,151 @@ static void mp3_progress_cb(size_t bytes_read, size_t total_bytes, uint32_t elap
         s_total_ms = est_total_ms;
     }
     if (elapsed_ms > 0) {
-        s_elapsed_ms = elapsed_ms;
+        s_decoded_ms = elapsed_ms;
+        player_update_elapsed();
+        player_publish();
+        // Resolve and open the next track while this one still has audio
+        // queued, so the transition needs no directory scan or header reads.
+        uint32_t lead_ms = __atomic_load_n(&s_crossfade_ms, __ATOMIC_RELAXED) + 1000U;
+        if (lead_ms < PLAYER_PREOPEN_LEAD_MS) {
+            lead_ms = PLAYER_PREOPEN_LEAD_MS;
+        }
+        if (!s_next_attempted && s_request == REQ_NONE && est_total_ms > 0 &&
+            elapsed_ms + lead_ms >= est_total_ms) {
+            s_next_attempted = true;
+            player_preopen_next();
+        }
     }
 }
 
 static void player_task(void *arg)
 {
     (void)arg;
-    audio_player_cmd_t cmd;
+    bool continuing = false;    // previous track ran to its end
+    uint16_t failures = 0;      // tracks in a row that could not be played
+    // Posters may run before xTaskCreate has stored the handle.
+    __atomic_store_n(&s_player_task, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
 
     while (1) {
+        player_publish();
         if (s_shutdown_requested) {
             break;
         }
         if (s_state != PLAYER_STATE_PLAYING) {
-            if (xQueueReceive(s_cmd_queue, &cmd, portMAX_DELAY)) {
-                player_handle_cmd(&cmd);
-                if (s_shutdown_requested) {
-                    break;
-                }
+            player_drop_next();
+            audio_mixer_close(AUDIO_SOURCE_PLAYER);
+            continuing = false;
+            player_wait_cmds();
+            if (s_shutdown_requested) {
+                break;
             }
             continue;
         }
 
-        const char *path = player_current_path();
+        helix_mp3_source_t *pre = player_take_next();
+        bool crossfaded = pre && s_xfade.handed_over;
+        uint64_t xfade_start = s_xfade.start_frame;
+        memset(&s_xfade, 0, sizeof(s_xfade));
+        s_next_attempted = false;
+        const char *path = pre ? s_current_path : player_current_path();
         if (!path) {
+            // A missing or changed playlist entry: skip it without touching
+            // the card, until every entry has been tried.
+            if (s_playlist && ++failures < s_track_count && player_step_next(true)) {
+                continue;
+            }
             s_state = PLAYER_STATE_STOPPED;
+            continuing = false;
+            failures = 0;
             continue;
         }
 
-        player_format_t fmt = player_detect_format(path);
-        if (!audio_owner_acquire(AUDIO_OWNER_PLAYER, false)) {
+        track_format_t fmt = track_catalog_detect_format(path);
+        bool failed = false;
+        bool refused = false;   // playable, just not at the current output rate
+        // Whatever is still queued from the previous track plays out first;
+        // after a crossfade this track began where the fade did.
+        s_track_start_frame = crossfaded ? xfade_start : audio_mixer_get_written_frames(AUDIO_SOURCE_PLAYER);
+        if (!audio_mixer_open(AUDIO_SOURCE_PLAYER)) {
+            helix_mp3_close(pre);
             s_state = PLAYER_STATE_STOPPED;
             s_request = REQ_STOP;
+            continuing = false;
             continue;
         }
 
-        if (fmt == PLAYER_FMT_MP3) {
-            audio_stop();
-            audio_i2s_set_sample_rate(44100);
-            int volume_percent = (int)((s_volume * 100U + 127U) / 255U);
+        if (fmt == TRACK_FMT_MP3) {
             s_elapsed_ms = 0;
             s_total_ms = 0;
-            bool ok = helix_mp3_decode_file(path, volume_percent, mp3_i2s_write_cb, NULL, mp3_progress_cb, NULL, 0.0f);
-            if (!ok && s_request == REQ_NONE) {
+            s_decoded_ms = 0;
+            player_publish();
+            helix_mp3_source_t *src = pre ? pre : helix_mp3_open(path, 0.0f);
+            s_cur_src = src;
+            bool ok = src && helix_mp3_decode_source(src, mp3_i2s_write_cb, mp3_format_cb, NULL,
+                                                     mp3_progress_cb, NULL);
+            s_cur_src = NULL;     // decode_source() has closed it
+            if (s_xfade.active) {
+                // The track ended before its estimated length; the next one
+                // carries on from where the fade got to.
+                player_xfade_end("ended early");
+            }
+            if (!ok && s_request == REQ_NONE && !s_xfade.handed_over) {
                 s_request = REQ_NEXT;
+                failed = true;
             }
-        } else if (fmt == PLAYER_FMT_WAV) {
+        } else if (fmt == TRACK_FMT_WAV) {
             FILE *fp = fopen(path, "rb");
             if (!fp) {
                 ESP_LOGW(TAG, "file open failed: %s", path);
                 s_request = REQ_NEXT;
+                failed = true;
             } else {
                 wav_info_t info = {0};
-                if (wav_read_header(fp, &info)) {
-                    audio_stop();
-                    player_stream_file(fp, &info);
-                } else {
+                if (!wav_read_header(fp, &info)) {
                     ESP_LOGW(TAG, "wav parse failed: %s", path);
                     s_request = REQ_NEXT;
+                    failed = true;
+                } else if (!player_stream_file(fp, &info)) {
+                    s_request = REQ_NEXT;
+                    failed = true;
+                    refused = true;
                 }
                 fclose(fp);
             }
         } else {
             ESP_LOGW(TAG, "unsupported format: %s", path);
             s_request = REQ_NEXT;
+            failed = true;
         }
 
         audio_request_t req = s_request;
         s_request = REQ_NONE;
-        audio_owner_release(AUDIO_OWNER_PLAYER);
+        if (failed) {
+            if (s_playlist && !refused) {
+                track_playlist_mark_missing(player_order_track(s_order_index));
+            }
+            if (++failures >= s_track_count) {
+                ESP_LOGW(TAG, "no playable tracks");
+                req = REQ_STOP;
+                failures = 0;
+            }
+        } else {
+            failures = 0;
+        }
+        if (req == REQ_NONE && s_total_ms > 0 && !s_playlist) {
+            // Played through: the catalog keeps the exact length for the UI.
+            track_catalog_set_duration(player_order_track(s_order_index), s_total_ms);
+        }
+        continuing = (req == REQ_NONE && s_state == PLAYER_STATE_PLAYING);
+        if (!continuing) {
+            player_drop_next();
+            // Between consecutive tracks the ring still holds the previous
+            // track's tail and plays on; a skip or stop drops it.
+            if (req != REQ_NONE) {
+                audio_mixer_flush(AUDIO_SOURCE_PLAYER);
+            }
+            audio_mixer_close(AUDIO_SOURCE_PLAYER);
+        }
 
         if (req == REQ_STOP) {
             s_state = PLAYER_STATE_STOPPED;
@@ -619,6 +1069,9 @@ static void player_task(void *arg)
         }
     }
 
+    player_drop_next();
+    audio_mixer_flush(AUDIO_SOURCE_PLAYER);
+    audio_mixer_close(AUDIO_SOURCE_PLAYER);
     s_player_task = NULL;
     vTaskDelete(NULL);
 }
@@ -638,7 +1091,8 @@ esp_err_t audio_player_init(const char *folder)
     }
 
     if (!s_cmd_queue) {
-        s_cmd_queue = xQueueCreate(PLAYER_QUEUE_DEPTH, sizeof(audio_player_cmd_t));
+        __atomic_store_n(&s_cmd_queue, xQueueCreate(PLAYER_QUEUE_DEPTH, sizeof(audio_player_cmd_t)),
+                         __ATOMIC_RELEASE);
     }
     if (!s_cmd_queue) {
         player_unlock();
@@ -646,6 +1100,7 @@ esp_err_t audio_player_init(const char *folder)
     }
 
     if (!s_player_task) {
+        helix_mp3_arena_init();
         BaseType_t created = xTaskCreatePinnedToCore(player_task,
                                                      "audio_player",
                                                      8192,
@@ -654,6 +1109,7 @@ esp_err_t audio_player_init(const char *folder)
                                                      &s_player_task,
                                                      PLAYER_DECODE_CORE);
         if (created != pdPASS) {
+            helix_mp3_arena_deinit();
             s_player_task = NULL;
             player_unlock();
             return ESP_ERR_NO_MEM;
@@ -661,7 +1117,22 @@ esp_err_t audio_player_init(const char *folder)
     }
 
     s_shutdown_requested = false;
-    player_scan_folder();
+    player_set_seed(esp_random());
+    // Opens the last catalog at once; the scan runs in the background. The
+    // task picks up the track count, so it stays the only writer. A playlist
+    // is indexed right here in one pass.
+    s_playlist = track_playlist_is_playlist(s_folder);
+    if (s_playlist) {
+        track_catalog_set_listener(NULL, NULL);
+        track_catalog_close();
+        track_playlist_open(s_folder);
+        player_catalog_cb(0, true, NULL);
+    } else {
+        track_playlist_close();
+        track_catalog_set_listener(player_catalog_cb, NULL);
+        track_catalog_open(s_folder);
+        player_catalog_cb(0, false, NULL);
+    }
     player_unlock();
     return ESP_OK;
 }
@@ -675,6 +1146,7 @@ void audio_player_shutdown(void)
         s_request = REQ_NONE;
         s_elapsed_ms = 0;
         s_total_ms = 0;
+        player_publish();
         player_unlock();
         return;
     }
@@ -686,9 +1158,9 @@ void audio_player_shutdown(void)
         audio_player_cmd_t cmd = {
             .type = CMD_SHUTDOWN
         };
-        if (xQueueSend(s_cmd_queue, &cmd, 0) != pdTRUE) {
+        if (!player_post(&cmd)) {
             xQueueReset(s_cmd_queue);
-            xQueueSend(s_cmd_queue, &cmd, 0);
+            player_post(&cmd);
         }
     }
     player_unlock();
@@ -703,185 +1175,209 @@ void audio_player_shutdown(void)
         return;
     }
 
+    helix_mp3_arena_deinit();
+
     player_lock();
     if (s_cmd_queue) {
         xQueueReset(s_cmd_queue);
     }
+    track_catalog_set_listener(NULL, NULL);
+    track_catalog_close();
+    track_playlist_close();
+    s_play_pending = false;
     s_track_count = 0;
     s_order_index = 0;
+    s_current_track = UINT16_MAX;
     s_state = PLAYER_STATE_STOPPED;
     s_request = REQ_NONE;
     s_elapsed_ms = 0;
     s_total_ms = 0;
     s_shutdown_requested = false;
+    player_publish();
     player_unlock();
 }
 
 bool audio_player_is_ready(void)
 {
-    player_lock();
-    bool ready = (s_cmd_queue != NULL && s_player_task != NULL);
-    player_unlock();
-    return ready;
+    return __atomic_load_n(&s_cmd_queue, __ATOMIC_ACQUIRE) != NULL &&
+           __atomic_load_n(&s_player_task, __ATOMIC_ACQUIRE) != NULL;
 }
 
 void audio_player_rescan(void)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        player_unlock();
-        return;
-    }
     audio_player_cmd_t cmd = {
         .type = CMD_RESCAN
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
-    player_unlock();
+    player_post(&cmd);
 }
 
 void audio_player_set_volume(uint8_t volume)
 {
-    player_lock();
-    s_volume = volume;
-    player_unlock();
+    audio_mixer_set_gain(AUDIO_SOURCE_PLAYER, pcm_gain_from_volume(volume));
 }
 
-void audio_player_set_repeat_mode(audio_repeat_mode_t mode)
+void audio_player_set_crossfade_ms(uint16_t ms)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        s_repeat_mode = mode;
-        player_build_order();
-        player_unlock();
-        return;
+    if (ms > PLAYER_XFADE_MAX_MS) {
+        ms = PLAYER_XFADE_MAX_MS;
     }
+    __atomic_store_n(&s_crossfade_ms, ms, __ATOMIC_RELAXED);
+}
+
+uint16_t audio_player_get_crossfade_ms(void)
+{
+    return __atomic_load_n(&s_crossfade_ms, __ATOMIC_RELAXED);
+}
+
+void audio_player_set_repeat_mode(audio_repeat_mode_t mode)
+{
     audio_player_cmd_t cmd = {
         .type = CMD_SET_REPEAT,
         .repeat_mode = mode
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
+    if (player_post(&cmd)) {
+        return;
+    }
+    player_lock();
+    if (!s_cmd_queue) {
+        player_set_repeat(mode);
+        player_publish();
+    }
     player_unlock();
 }
 
-audio_repeat_mode_t audio_player_get_repeat_mode(void)
+void audio_player_set_shuffle_seed(uint32_t seed)
 {
+    audio_player_cmd_t cmd = {
+        .type = CMD_SET_SEED,
+        .shuffle_seed = seed
+    };
+    if (player_post(&cmd)) {
+        return;
+    }
     player_lock();
-    audio_repeat_mode_t mode = s_repeat_mode;
+    if (!s_cmd_queue) {
+        player_set_seed(seed);
+        player_publish();
+    }
     player_unlock();
-    return mode;
+}
+
+void audio_player_get_status(audio_player_status_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&s_status_seq, __ATOMIC_ACQUIRE);
+        *out = s_status;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1U) || seq != __atomic_load_n(&s_status_seq, __ATOMIC_RELAXED));
+}
+
+uint32_t audio_player_get_shuffle_seed(void)
+{
+    audio_player_status_t st;
+    audio_player_get_status(&st);
+    return st.shuffle_seed;
+}
+
+audio_repeat_mode_t audio_player_get_repeat_mode(void)
+{
+    audio_player_status_t st;
+    audio_player_get_status(&st);
+    return st.repeat_mode;
 }
 
 audio_player_state_t audio_player_get_state(void)
 {
-    player_lock();
-    audio_player_state_t state = s_state;
-    player_unlock();
-    return state;
+    audio_player_status_t st;
+    audio_player_get_status(&st);
+    return st.state;
 }
 
 uint16_t audio_player_get_track_index(void)
 {
-    player_lock();
-    if (!player_has_tracks()) {
-        player_unlock();
-        return 0;
-    }
-    uint16_t index = (uint16_t)(s_order[s_order_index] + 1);
-    player_unlock();
-    return index;
+    audio_player_status_t st;
+    audio_player_get_status(&st);
+    return st.track_index;
 }
 
 uint16_t audio_player_get_track_count(void)
 {
-    player_lock();
-    uint16_t count = s_track_count;
-    player_unlock();
-    return count;
+    audio_player_status_t st;
+    audio_player_get_status(&st);
+    return st.track_count;
+}
+
+bool audio_player_get_scan_progress(uint32_t *tracks_found)
+{
+    track_catalog_progress_t progress;
+    track_catalog_get_progress(&progress);
+    if (tracks_found) {
+        *tracks_found = progress.tracks;
+    }
+    return progress.scanning;
 }
 
 void audio_player_get_time_ms(uint32_t *elapsed_ms, uint32_t *total_ms)
 {
-    player_lock();
+    audio_player_status_t st;
+    audio_player_get_status(&st);
     if (elapsed_ms) {
-        *elapsed_ms = s_elapsed_ms;
+        *elapsed_ms = st.elapsed_ms;
     }
     if (total_ms) {
-        *total_ms = s_total_ms;
+        *total_ms = st.total_ms;
     }
-    player_unlock();
 }
 
 void audio_player_play(void)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        player_unlock();
-        return;
-    }
     audio_player_cmd_t cmd = {
         .type = CMD_PLAY
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
-    player_unlock();
+    __atomic_store_n(&s_play_request_us, esp_timer_get_time(), __ATOMIC_RELAXED);
+    player_post(&cmd);
 }
 
 void audio_player_pause(void)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        player_unlock();
-        return;
-    }
     audio_player_cmd_t cmd = {
         .type = CMD_PAUSE
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
-    player_unlock();
+    player_post(&cmd);
 }
 
 void audio_player_stop(void)
 {
+    audio_player_cmd_t cmd = {
+        .type = CMD_STOP
+    };
+    if (player_post(&cmd)) {
+        return;
+    }
     player_lock();
     if (!s_cmd_queue) {
         s_state = PLAYER_STATE_STOPPED;
         s_request = REQ_NONE;
         s_elapsed_ms = 0;
         s_total_ms = 0;
-        player_unlock();
-        return;
+        player_publish();
     }
-    audio_player_cmd_t cmd = {
-        .type = CMD_STOP
-    };
-    xQueueSend(s_cmd_queue, &cmd, 0);
     player_unlock();
 }
 
 void audio_player_next(void)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        player_unlock();
-        return;
-    }
     audio_player_cmd_t cmd = {
         .type = CMD_NEXT
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
-    player_unlock();
+    player_post(&cmd);
 }
 
 void audio_player_prev(void)
 {
-    player_lock();
-    if (!s_cmd_queue) {
-        player_unlock();
-        return;
-    }
     audio_player_cmd_t cmd = {
         .type = CMD_PREV
     };
-    xQueueSend(s_cmd_queue, &cmd, 0);
-    player_unlock();
+    player_post(&cmd);
 }
-
@@ -20,16 +20,41 @@ typedef enum {
     PLAYER_STATE_PAUSED
 } audio_player_state_t;
 
+// Consistent copy of the player state; reading it takes no lock.
+typedef struct {
+    audio_player_state_t state;
+    audio_repeat_mode_t repeat_mode;
+    uint16_t track_index;       // 1-based, 0 without tracks
+    uint16_t track_count;
+    uint32_t elapsed_ms;
+    uint32_t total_ms;
+    uint32_t shuffle_seed;
+} audio_player_status_t;
+
 esp_err_t audio_player_init(const char *folder);
 void audio_player_shutdown(void);
 bool audio_player_is_ready(void);
 void audio_player_rescan(void);
 void audio_player_set_volume(uint8_t volume);
+// Overlap of consecutive MP3 tracks, 0 (gapless, the default) to 10000 ms.
+// Falls back to a gapless cut when the tracks' rates differ or decoding both
+// would not leave the core enough headroom.
+void audio_player_set_crossfade_ms(uint16_t ms);
+uint16_t audio_player_get_crossfade_ms(void);
 void audio_player_set_repeat_mode(audio_repeat_mode_t mode);
 audio_repeat_mode_t audio_player_get_repeat_mode(void);
+// Shuffle order is derived from this seed and the track count, so a saved
+// seed replays the same order from its first track. The seed advances when
+// the order wraps; set it after audio_player_init(), which picks a random one.
+void audio_player_set_shuffle_seed(uint32_t seed);
+uint32_t audio_player_get_shuffle_seed(void);
+// The single getters below each read one snapshot; use this for several fields.
+void audio_player_get_status(audio_player_status_t *out);
 audio_player_state_t audio_player_get_state(void);
 uint16_t audio_player_get_track_index(void);
 uint16_t audio_player_get_track_count(void);
+// True while the library scan runs; tracks_found counts what it has seen so far.
+bool audio_player_get_scan_progress(uint32_t *tracks_found);
 void audio_player_get_time_ms(uint32_t *elapsed_ms, uint32_t *total_ms);
 
 void audio_player_play(void);
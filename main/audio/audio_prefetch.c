@@ -0,0 +1,245 @@
+#include "audio_prefetch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define PREFETCH_MIN_BLOCKS 3
+#define PREFETCH_MAX_BLOCKS_INTERNAL 8
+#define PREFETCH_MAX_BLOCKS_PSRAM 64
+#define PREFETCH_TASK_STACK 3072
+#define PREFETCH_TASK_PRIORITY 10
+#define PREFETCH_TASK_CORE 0     // decode runs on core 1
+
+struct audio_prefetch {
+    FILE *f;
+    uint8_t *ring;
+    bool owns_ring;
+    uint32_t blocks;
+    uint16_t block_len[PREFETCH_MAX_BLOCKS_PSRAM];
+    bool block_eof[PREFETCH_MAX_BLOCKS_PSRAM];
+    uint32_t wr_block;      // reader task only
+    uint32_t rd_block;      // consumer only
+    uint32_t rd_off;
+    bool rd_holding;        // consumer owns rd_block
+    bool eof;
+    long pos;
+    volatile bool stop;
+    SemaphoreHandle_t free_sem;
+    SemaphoreHandle_t filled_sem;
+    SemaphoreHandle_t done_sem;
+    audio_prefetch_stats_t stats;
+};
+
+static const char *TAG = "audio_prefetch";
+
+static void prefetch_task(void *arg)
+{
+    audio_prefetch_t *pf = (audio_prefetch_t *)arg;
+    long file_pos = pf->pos;
+
+    while (!pf->stop) {
+        xSemaphoreTake(pf->free_sem, portMAX_DELAY);
+        if (pf->stop) {
+            break;
+        }
+        // Keep every read after the first on a block boundary so FATFS can
+        // transfer whole sectors straight into the ring.
+        size_t want = AUDIO_PREFETCH_BLOCK_BYTES - (size_t)(file_pos % AUDIO_PREFETCH_BLOCK_BYTES);
+        uint8_t *blk = pf->ring + (size_t)pf->wr_block * AUDIO_PREFETCH_BLOCK_BYTES;
+        int64_t t0 = esp_timer_get_time();
+        size_t n = fread(blk, 1, want, pf->f);
+        uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+        if (dt > pf->stats.max_read_us) {
+            pf->stats.max_read_us = dt;
+        }
+        bool eof = (n < want);
+        if (eof && ferror(pf->f)) {
+            ESP_LOGW(TAG, "read error at %ld", file_pos);
+        }
+        file_pos += (long)n;
+        pf->stats.reads++;
+        pf->block_len[pf->wr_block] = (uint16_t)n;
+        pf->block_eof[pf->wr_block] = eof;
+        pf->wr_block = (pf->wr_block + 1) % pf->blocks;
+        xSemaphoreGive(pf->filled_sem);
+        if (eof) {
+            break;
+        }
+    }
+
+    xSemaphoreGive(pf->done_sem);
+    vTaskDelete(NULL);
+}
+
+static uint8_t *prefetch_alloc_ring(uint32_t want_blocks, uint32_t *out_blocks)
+{
+    uint32_t n = want_blocks;
+    if (n > PREFETCH_MAX_BLOCKS_PSRAM) {
+        n = PREFETCH_MAX_BLOCKS_PSRAM;
+    }
+    uint8_t *ring = heap_caps_malloc((size_t)n * AUDIO_PREFETCH_BLOCK_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) {
+        // Internal RAM is scarce; cap the ring and keep it DMA-capable so the
+        // SD driver does not bounce through its own buffer.
+        if (n > PREFETCH_MAX_BLOCKS_INTERNAL) {
+            n = PREFETCH_MAX_BLOCKS_INTERNAL;
+        }
+        while (!ring && n >= PREFETCH_MIN_BLOCKS) {
+            ring = heap_caps_malloc((size_t)n * AUDIO_PREFETCH_BLOCK_BYTES, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+            if (!ring) {
+                n--;
+            }
+        }
+    }
+    *out_blocks = ring ? n : 0;
+    return ring;
+}
+
+audio_prefetch_t *audio_prefetch_open(FILE *f, uint32_t bytes_per_sec, uint32_t lead_ms,
+                                      uint8_t *ring, size_t ring_bytes)
+{
+    if (!f) {
+        return NULL;
+    }
+    if (lead_ms == 0) {
+        lead_ms = AUDIO_PREFETCH_LEAD_MS_DEFAULT;
+    }
+    audio_prefetch_t *pf = calloc(1, sizeof(*pf));
+    if (!pf) {
+        return NULL;
+    }
+    uint64_t lead_bytes = ((uint64_t)bytes_per_sec * lead_ms) / 1000ULL;
+    uint32_t want = (uint32_t)((lead_bytes + AUDIO_PREFETCH_BLOCK_BYTES - 1) / AUDIO_PREFETCH_BLOCK_BYTES);
+    if (want < PREFETCH_MIN_BLOCKS) {
+        want = PREFETCH_MIN_BLOCKS;
+    }
+    uint32_t given = (uint32_t)(ring_bytes / AUDIO_PREFETCH_BLOCK_BYTES);
+    if (ring && given >= PREFETCH_MIN_BLOCKS) {
+        if (given > PREFETCH_MAX_BLOCKS_PSRAM) {
+            given = PREFETCH_MAX_BLOCKS_PSRAM;
+        }
+        pf->ring = ring;
+        pf->blocks = (want < given) ? want : given;
+    } else {
+        pf->ring = prefetch_alloc_ring(want, &pf->blocks);
+        pf->owns_ring = true;
+    }
+    pf->free_sem = xSemaphoreCreateCounting(pf->blocks ? pf->blocks : 1, pf->blocks);
+    pf->filled_sem = xSemaphoreCreateCounting(pf->blocks ? pf->blocks : 1, 0);
+    pf->done_sem = xSemaphoreCreateBinary();
+    if (!pf->ring || !pf->free_sem || !pf->filled_sem || !pf->done_sem) {
+        ESP_LOGE(TAG, "alloc failed (%u blocks)", (unsigned)want);
+        goto fail;
+    }
+
+    pf->f = f;
+    pf->pos = ftell(f);
+    pf->stats.blocks = pf->blocks;
+    // The ring already batches reads; stdio buffering would only add a copy.
+    setvbuf(f, NULL, _IONBF, 0);
+
+    if (xTaskCreatePinnedToCore(prefetch_task, "sd_prefetch", PREFETCH_TASK_STACK, pf,
+                                PREFETCH_TASK_PRIORITY, NULL, PREFETCH_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "task create failed");
+        goto fail;
+    }
+    ESP_LOGD(TAG, "ring %u x %u bytes, lead %u ms", (unsigned)pf->blocks,
+             (unsigned)AUDIO_PREFETCH_BLOCK_BYTES, (unsigned)lead_ms);
+    return pf;
+
+fail:
+    if (pf->done_sem) {
+        vSemaphoreDelete(pf->done_sem);
+    }
+    if (pf->filled_sem) {
+        vSemaphoreDelete(pf->filled_sem);
+    }
+    if (pf->free_sem) {
+        vSemaphoreDelete(pf->free_sem);
+    }
+    if (pf->owns_ring) {
+        heap_caps_free(pf->ring);
+    }
+    free(pf);
+    return NULL;
+}
+
+size_t audio_prefetch_read(audio_prefetch_t *pf, void *dst, size_t len)
+{
+    if (!pf || !dst) {
+        return 0;
+    }
+    uint8_t *out = (uint8_t *)dst;
+    size_t done = 0;
+    while (done < len && !pf->eof) {
+        if (!pf->rd_holding) {
+            if (xSemaphoreTake(pf->filled_sem, 0) != pdTRUE) {
+                // Reader fell behind: the decoder is about to starve.
+                pf->stats.stalls++;
+                int64_t t0 = esp_timer_get_time();
+                xSemaphoreTake(pf->filled_sem, portMAX_DELAY);
+                pf->stats.stall_ms += (uint32_t)((esp_timer_get_time() - t0) / 1000);
+            }
+            pf->rd_holding = true;
+            pf->rd_off = 0;
+        }
+        uint32_t blen = pf->block_len[pf->rd_block];
+        size_t n = blen - pf->rd_off;
+        if (n > len - done) {
+            n = len - done;
+        }
+        memcpy(out + done, pf->ring + (size_t)pf->rd_block * AUDIO_PREFETCH_BLOCK_BYTES + pf->rd_off, n);
+        done += n;
+        pf->rd_off += (uint32_t)n;
+        pf->pos += (long)n;
+        if (pf->rd_off >= blen) {
+            if (pf->block_eof[pf->rd_block]) {
+                pf->eof = true;
+            }
+            pf->rd_holding = false;
+            pf->rd_block = (pf->rd_block + 1) % pf->blocks;
+            xSemaphoreGive(pf->free_sem);
+        }
+    }
+    return done;
+}
+
+long audio_prefetch_tell(const audio_prefetch_t *pf)
+{
+    return pf ? pf->pos : -1;
+}
+
+void audio_prefetch_close(audio_prefetch_t *pf, audio_prefetch_stats_t *stats)
+{
+    if (!pf) {
+        return;
+    }
+    pf->stop = true;
+    xSemaphoreGive(pf->free_sem);
+    xSemaphoreTake(pf->done_sem, portMAX_DELAY);
+
+    if (pf->stats.stalls > 0) {
+        ESP_LOGI(TAG, "stalls=%u (%u ms) reads=%u max_read=%uus ring=%u",
+                 (unsigned)pf->stats.stalls, (unsigned)pf->stats.stall_ms, (unsigned)pf->stats.reads,
+                 (unsigned)pf->stats.max_read_us, (unsigned)pf->stats.blocks);
+    } else {
+        ESP_LOGD(TAG, "reads=%u max_read=%uus ring=%u", (unsigned)pf->stats.reads,
+                 (unsigned)pf->stats.max_read_us, (unsigned)pf->stats.blocks);
+    }
+    if (stats) {
+        *stats = pf->stats;
+    }
+    vSemaphoreDelete(pf->done_sem);
+    vSemaphoreDelete(pf->filled_sem);
+    vSemaphoreDelete(pf->free_sem);
+    if (pf->owns_ring) {
+        heap_caps_free(pf->ring);
+    }
+    free(pf);
+}
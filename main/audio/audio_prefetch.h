@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_PREFETCH_BLOCK_BYTES 4096     // 8 SD sectors per read
+#define AUDIO_PREFETCH_LEAD_MS_DEFAULT 750
+
+typedef struct {
+    uint32_t reads;         // blocks filled by the reader task
+    uint32_t stalls;        // consumer found the ring empty before EOF
+    uint32_t stall_ms;      // total time the consumer spent waiting
+    uint32_t max_read_us;   // slowest single SD read
+    uint32_t blocks;        // ring size in blocks
+} audio_prefetch_stats_t;
+
+typedef struct audio_prefetch audio_prefetch_t;
+
+// Starts a reader task that streams `f` from its current position into a
+// ring sized for `lead_ms` of audio at `bytes_per_sec`. The ring owns the
+// FILE until audio_prefetch_close(); the caller still fcloses it afterwards.
+// A caller-owned `ring` (whole blocks, may be NULL) is used instead of a heap
+// allocation, capped at `lead_ms` worth of blocks.
+audio_prefetch_t *audio_prefetch_open(FILE *f, uint32_t bytes_per_sec, uint32_t lead_ms,
+                                      uint8_t *ring, size_t ring_bytes);
+// Blocking read; returns fewer than `len` bytes only at EOF or on error.
+size_t audio_prefetch_read(audio_prefetch_t *pf, void *dst, size_t len);
+// File offset of the next byte audio_prefetch_read() will return.
+long audio_prefetch_tell(const audio_prefetch_t *pf);
+void audio_prefetch_close(audio_prefetch_t *pf, audio_prefetch_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+#include "audio_resampler.h"
+
+#include "audio_resampler_tables.h"
+#include <string.h>
+
+#define RS_TAPS AUDIO_RESAMPLER_TAPS
+#define RS_COEF_SHIFT 14
+
+// Filter for the largest tabulated cutoff ratio not above out/in: exact for
+// the MP3 rates, and never a wider passband than the pair allows otherwise.
+static const int16_t *audio_resampler_table(uint32_t in_rate, uint32_t out_rate)
+{
+    const int16_t *coef = NULL;
+    for (int i = 0; i < AUDIO_RESAMPLER_TABLE_COUNT; ++i) {
+        uint64_t num = audio_resampler_ratios[i][0];
+        uint64_t den = audio_resampler_ratios[i][1];
+        if (num * in_rate > den * out_rate) {
+            break;
+        }
+        coef = audio_resampler_coefs[i];
+    }
+    return coef;
+}
+
+bool audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate, uint32_t out_rate)
+{
+    if (!rs || in_rate == 0 || out_rate == 0) {
+        return false;
+    }
+    rs->coef = audio_resampler_table(in_rate, out_rate);
+    if (!rs->coef) {
+        return false;
+    }
+    rs->in_rate = in_rate;
+    rs->out_rate = out_rate;
+    rs->step_int = in_rate / out_rate;
+    rs->step_frac = (uint32_t)((((uint64_t)(in_rate % out_rate)) << 32) / out_rate);
+    audio_resampler_reset(rs);
+    return true;
+}
+
+void audio_resampler_reset(audio_resampler_t *rs)
+{
+    if (!rs) {
+        return;
+    }
+    // Prime with half a filter of silence so the first output is centred.
+    rs->frac = 0;
+    rs->pos = 0;
+    rs->fill = RS_TAPS / 2 - 1;
+    memset(rs->buf, 0, sizeof(rs->buf));
+}
+
+size_t audio_resampler_push(audio_resampler_t *rs, const int16_t *in, size_t frames, int channels)
+{
+    if (!rs || !in || frames == 0 || channels <= 0) {
+        return 0;
+    }
+    if (rs->pos > 0) {
+        uint32_t keep = (rs->fill > rs->pos) ? rs->fill - rs->pos : 0;
+        memmove(rs->buf, rs->buf + rs->pos * 2, (size_t)keep * 2 * sizeof(int16_t));
+        rs->pos = (rs->pos > rs->fill) ? rs->pos - rs->fill : 0;
+        rs->fill = keep;
+    }
+    size_t cap = (sizeof(rs->buf) / (2 * sizeof(int16_t))) - rs->fill;
+    if (frames > cap) {
+        frames = cap;
+    }
+    int16_t *dst = rs->buf + rs->fill * 2;
+    if (channels == 1) {
+        for (size_t i = 0; i < frames; ++i) {
+            dst[i * 2] = in[i];
+            dst[i * 2 + 1] = in[i];
+        }
+    } else {
+        for (size_t i = 0; i < frames; ++i) {
+            dst[i * 2] = in[i * (size_t)channels];
+            dst[i * 2 + 1] = in[i * (size_t)channels + 1];
+        }
+    }
+    rs->fill += (uint32_t)frames;
+    return frames;
+}
+
+static inline int16_t rs_sat16(int32_t v)
+{
+    v = (v + (1 << (RS_COEF_SHIFT - 1))) >> RS_COEF_SHIFT;
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return (int16_t)v;
+}
+
+size_t audio_resampler_pull(audio_resampler_t *rs, int16_t *out, size_t max_frames)
+{
+    if (!rs || !out) {
+        return 0;
+    }
+    size_t produced = 0;
+    while (produced < max_frames && rs->pos + RS_TAPS <= rs->fill) {
+        uint32_t phase = rs->frac >> (32 - AUDIO_RESAMPLER_PHASE_BITS);
+        int32_t w = (int32_t)((rs->frac >> (32 - AUDIO_RESAMPLER_PHASE_BITS - 15)) & 0x7FFF);
+        const int16_t *c0 = &rs->coef[phase * RS_TAPS];
+        const int16_t *c1 = c0 + RS_TAPS;
+        const int16_t *x = &rs->buf[rs->pos * 2];
+        int32_t acc_l = 0;
+        int32_t acc_r = 0;
+        for (int k = 0; k < RS_TAPS; ++k) {
+            int32_t c = c0[k] + ((((int32_t)c1[k] - (int32_t)c0[k]) * w) >> 15);
+            acc_l += c * x[k * 2];
+            acc_r += c * x[k * 2 + 1];
+        }
+        out[produced * 2] = rs_sat16(acc_l);
+        out[produced * 2 + 1] = rs_sat16(acc_r);
+        produced++;
+
+        uint32_t prev = rs->frac;
+        rs->frac += rs->step_frac;
+        rs->pos += rs->step_int + ((rs->frac < prev) ? 1U : 0U);
+    }
+    return produced;
+}
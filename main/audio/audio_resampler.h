@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_RESAMPLER_TAPS 16
+#define AUDIO_RESAMPLER_PHASE_BITS 6
+#define AUDIO_RESAMPLER_PHASES (1 << AUDIO_RESAMPLER_PHASE_BITS)
+#define AUDIO_RESAMPLER_MAX_IN_FRAMES 1152
+
+// Fixed-point polyphase FIR resampler, interleaved stereo int16 output.
+// Coefficients (Q14, linearly interpolated between phases) are const tables
+// generated at build time by gen_resampler_tables.py, one per cutoff ratio;
+// audio_resampler_init() only picks one. The input history is carried across
+// push() calls so frame boundaries are seamless.
+typedef struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t step_int;
+    uint32_t step_frac;
+    uint32_t frac;
+    uint32_t pos;
+    uint32_t fill;
+    const int16_t *coef;    // (AUDIO_RESAMPLER_PHASES + 1) rows of taps
+    int16_t buf[(AUDIO_RESAMPLER_TAPS + AUDIO_RESAMPLER_MAX_IN_FRAMES) * 2];
+} audio_resampler_t;
+
+// False when out/in is below the lowest tabulated ratio (1/6).
+bool audio_resampler_init(audio_resampler_t *rs, uint32_t in_rate, uint32_t out_rate);
+void audio_resampler_reset(audio_resampler_t *rs);
+// Append input frames (mono or stereo); returns frames accepted.
+size_t audio_resampler_push(audio_resampler_t *rs, const int16_t *in, size_t frames, int channels);
+// Produce up to max_frames stereo output frames from buffered input.
+size_t audio_resampler_pull(audio_resampler_t *rs, int16_t *out, size_t max_frames);
+
+#ifdef __cplusplus
+}
+#endif
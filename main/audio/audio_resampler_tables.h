@@ -0,0 +1,15 @@
+#pragma once
+
+#include "audio_resampler.h"
+#include <stdint.h>
+
+// Generated by gen_resampler_tables.py from main/CMakeLists.txt: one filter
+// per out/in cutoff ratio between the MP3 sample rates, ascending, the last
+// (1/1) serving every upsampling pair.
+#define AUDIO_RESAMPLER_TABLE_COUNT 18
+
+// Numerator, denominator.
+extern const uint16_t audio_resampler_ratios[AUDIO_RESAMPLER_TABLE_COUNT][2];
+// Q14, (AUDIO_RESAMPLER_PHASES + 1) rows of AUDIO_RESAMPLER_TAPS.
+extern const int16_t audio_resampler_coefs[AUDIO_RESAMPLER_TABLE_COUNT]
+                                          [(AUDIO_RESAMPLER_PHASES + 1) * AUDIO_RESAMPLER_TAPS];
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Generate the EQ coefficient tables for audio_eq.c.
+
+For every band of the selected plan, every step (0..30, +/-6 dB, 15 flat)
+and every output rate the player or A2DP can run at, designs the RBJ
+shelf/peaking biquad in double precision and stores b0, b1, b2, a1, a2
+(a0 normalized away) as Q2.29. The firmware only indexes and interpolates
+these, so step changes need no transcendental math at runtime.
+
+Usage: gen_eq_tables.py --bands <2..5> <output.c>
+"""
+
+import argparse
+import math
+import sys
+
+STEPS = 31
+CENTER = 15
+RANGE_DB = 12.0
+COEF_BITS = 29
+RATES = [8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000]
+
+LOW_SHELF, PEAK, HIGH_SHELF = 0, 1, 2
+
+# (type, centre Hz, Q for peaks, label). The outer shelves keep the 150 Hz /
+# 5 kHz corners of the original two-band EQ, so saved low/high steps sound
+# the same whatever the plan.
+PLANS = {
+    2: [(LOW_SHELF, 150, 0, "Lo"), (HIGH_SHELF, 5000, 0, "Hi")],
+    3: [(LOW_SHELF, 150, 0, "Lo"), (PEAK, 1000, 0.7, "b2"), (HIGH_SHELF, 5000, 0, "Hi")],
+    4: [(LOW_SHELF, 150, 0, "Lo"), (PEAK, 500, 0.9, "b2"), (PEAK, 1800, 0.9, "b3"),
+        (HIGH_SHELF, 5000, 0, "Hi")],
+    5: [(LOW_SHELF, 150, 0, "Lo"), (PEAK, 400, 1.0, "b2"), (PEAK, 1000, 1.0, "b3"),
+        (PEAK, 2500, 1.0, "b4"), (HIGH_SHELF, 5000, 0, "Hi")],
+}
+
+
+def design(kind, freq, q, gain_db, fs):
+    if gain_db == 0.0:
+        return (1.0, 0.0, 0.0, 0.0, 0.0)
+    nyq = 0.5 * fs
+    freq = min(freq, nyq * (0.45 if kind == LOW_SHELF else 0.9))
+    a = 10.0 ** (gain_db / 40.0)
+    w0 = 2.0 * math.pi * freq / fs
+    cw = math.cos(w0)
+    sw = math.sin(w0)
+    if kind == PEAK:
+        alpha = sw / (2.0 * q)
+        b0 = 1.0 + alpha * a
+        b1 = -2.0 * cw
+        b2 = 1.0 - alpha * a
+        a0 = 1.0 + alpha / a
+        a1 = -2.0 * cw
+        a2 = 1.0 - alpha / a
+    else:
+        alpha = sw / 2.0 * math.sqrt(2.0)
+        sa = 2.0 * math.sqrt(a) * alpha
+        if kind == LOW_SHELF:
+            b0 = a * ((a + 1) - (a - 1) * cw + sa)
+            b1 = 2 * a * ((a - 1) - (a + 1) * cw)
+            b2 = a * ((a + 1) - (a - 1) * cw - sa)
+            a0 = (a + 1) + (a - 1) * cw + sa
+            a1 = -2 * ((a - 1) + (a + 1) * cw)
+            a2 = (a + 1) + (a - 1) * cw - sa
+        else:
+            b0 = a * ((a + 1) + (a - 1) * cw + sa)
+            b1 = -2 * a * ((a - 1) + (a + 1) * cw)
+            b2 = a * ((a + 1) + (a - 1) * cw - sa)
+            a0 = (a + 1) - (a - 1) * cw + sa
+            a1 = 2 * ((a - 1) - (a + 1) * cw)
+            a2 = (a + 1) - (a - 1) * cw - sa
+    return (b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0)
+
+
+def to_q(c):
+    v = int(round(c * (1 << COEF_BITS)))
+    if not -(1 << 31) <= v < (1 << 31):
+        sys.exit("coefficient %f out of Q2.29 range" % c)
+    return v
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--bands", type=int, default=5)
+    ap.add_argument("output")
+    args = ap.parse_args()
+    if args.bands not in PLANS:
+        sys.exit("--bands must be 2..5")
+    plan = PLANS[args.bands]
+
+    out = []
+    out.append("// Generated by gen_eq_tables.py --bands %d. Do not edit." % args.bands)
+    out.append('#include "audio_eq_tables.h"')
+    out.append("")
+    out.append("#if AUDIO_EQ_BANDS != %d" % args.bands)
+    out.append('#error "AUDIO_EQ_BANDS does not match the generated tables"')
+    out.append("#endif")
+    out.append("")
+    out.append("const uint32_t audio_eq_rates[AUDIO_EQ_RATE_COUNT] = {%s};" % ", ".join(str(r) for r in RATES))
+    out.append("")
+    out.append("const audio_eq_band_info_t audio_eq_bands[AUDIO_EQ_BANDS] = {")
+    for kind, freq, q, label in plan:
+        out.append('    {"%s", %d},' % (label, freq))
+    out.append("};")
+    out.append("")
+    out.append("const int32_t audio_eq_coefs[AUDIO_EQ_RATE_COUNT][AUDIO_EQ_BANDS][AUDIO_EQ_STEPS][5] = {")
+    for fs in RATES:
+        out.append("    { // %d Hz" % fs)
+        for kind, freq, q, label in plan:
+            out.append("        { // %s" % label)
+            for step in range(STEPS):
+                gain_db = (step - CENTER) * (RANGE_DB / (STEPS - 1))
+                coefs = [to_q(c) for c in design(kind, freq, q, gain_db, fs)]
+                out.append("            {%s}," % ", ".join(str(c) for c in coefs))
+            out.append("        },")
+        out.append("    },")
+    out.append("};")
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Generate the polyphase FIR tables for audio_resampler.c.
+
+The filter only depends on the cutoff, which is the input Nyquist when
+upsampling and the output Nyquist when downsampling. One table is made for
+upsampling and one for every out/in ratio below 1 between the MP3 sample
+rates, which are also the rates the output can run at. Each is a Kaiser
+windowed sinc (16 taps, 64 phases + 1 for interpolation) designed in double
+precision, normalized to unity DC gain per phase and stored as Q14, so the
+firmware never designs a filter at runtime.
+
+Usage: gen_resampler_tables.py <output.c>
+"""
+
+import math
+import sys
+from fractions import Fraction
+
+TAPS = 16
+PHASE_BITS = 6
+PHASES = 1 << PHASE_BITS
+COEF_SHIFT = 14
+KAISER_BETA = 7.0
+PASSBAND = 0.90
+RATES = [8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000]
+
+
+def bessel_i0(x):
+    total = 1.0
+    term = 1.0
+    half = x * 0.5
+    for k in range(1, 24):
+        term *= half / k
+        total += term * term
+    return total
+
+
+def design(ratio):
+    fc = 0.5 * PASSBAND
+    if ratio < 1:
+        fc *= ratio.numerator / ratio.denominator
+    half = TAPS / 2.0
+    i0_beta = bessel_i0(KAISER_BETA)
+    coefs = []
+    for p in range(PHASES + 1):
+        f = p / PHASES
+        row = []
+        for k in range(TAPS):
+            x = half - 1.0 - k + f
+            sinc = 1.0 if abs(x) < 1e-9 else math.sin(2.0 * math.pi * fc * x) / (2.0 * math.pi * fc * x)
+            r = x / half
+            win = 0.0 if abs(r) >= 1.0 else bessel_i0(KAISER_BETA * math.sqrt(1.0 - r * r)) / i0_beta
+            row.append(2.0 * fc * sinc * win)
+        total = sum(row)
+        for v in row:
+            q = round(v / total * (1 << COEF_SHIFT))
+            if not -32768 <= q <= 32767:
+                sys.exit("coefficient %f out of Q14 range" % (v / total))
+            coefs.append(q)
+    return coefs
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    ratios = sorted({Fraction(o, i) for i in RATES for o in RATES if o < i})
+    ratios.append(Fraction(1))
+
+    out = []
+    out.append("// Generated by gen_resampler_tables.py. Do not edit.")
+    out.append('#include "audio_resampler_tables.h"')
+    out.append("")
+    out.append("#if AUDIO_RESAMPLER_TAPS != %d || AUDIO_RESAMPLER_PHASE_BITS != %d" % (TAPS, PHASE_BITS))
+    out.append('#error "resampler geometry does not match the generated tables"')
+    out.append("#endif")
+    out.append("")
+    out.append("const uint16_t audio_resampler_ratios[AUDIO_RESAMPLER_TABLE_COUNT][2] = {")
+    for r in ratios:
+        out.append("    {%d, %d}," % (r.numerator, r.denominator))
+    out.append("};")
+    out.append("")
+    out.append("const int16_t audio_resampler_coefs[AUDIO_RESAMPLER_TABLE_COUNT]"
+               "[(AUDIO_RESAMPLER_PHASES + 1) * AUDIO_RESAMPLER_TAPS] = {")
+    for r in ratios:
+        coefs = design(r)
+        out.append("    { // %s" % ("upsampling" if r == 1 else "out/in = %d/%d" % (r.numerator, r.denominator)))
+        for p in range(PHASES + 1):
+            row = coefs[p * TAPS:(p + 1) * TAPS]
+            out.append("        %s," % ", ".join(str(c) for c in row))
+        out.append("    },")
+    out.append("};")
+
+    with open(sys.argv[1], "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
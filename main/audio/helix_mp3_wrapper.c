@@ -3,97 +3,612 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#if HELIX_MP3_PROFILE
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+#endif
 
+#include "audio_prefetch.h"
+#include "audio_resampler.h"
+#include "helix_memory.h"
+#include "helix_shim.h"
+#include "mp3_frame_index.h"
+#include "mp3_vbr_info.h"
 #include "mp3dec.h"
 
+#define HELIX_SEEK_PREROLL_FRAMES 4
+#define HELIX_OUTPUT_RATE 44100
+#define HELIX_OUT_CHUNK_FRAMES 576
+#define HELIX_PREFETCH_DEFAULT_BPS 40000   // 320 kbps, the MPEG-1 L3 ceiling
+#define HELIX_INBUF_SIZE 4096
+#define HELIX_DECODER_DELAY 529   // MP3 decoder delay, samples (LAME convention)
+#define HELIX_CTX_POOL 2          // playing + pre-opened track
+#define HELIX_RING_BLOCKS_INTERNAL 3   // the prefetch minimum: ~300 ms at 320 kbps
+#define HELIX_RING_BLOCKS_PSRAM 32
+
+typedef struct {
+    mp3_write_cb_t writer;
+    mp3_format_cb_t format_cb;
+    void *user;
+    uint32_t in_rate;
+    uint32_t out_rate;
+    audio_resampler_t *rs;  // allocated on first use, kept for the context's lifetime
+    short pcm[1152 * 2];    // Helix decodes straight into this slot
+    short outbuf[HELIX_OUT_CHUNK_FRAMES * 2];
+} helix_output_t;
+
+// Everything a decode needs besides the FILE: decoder state, input buffer,
+// output slot and prefetch ring. Pool entries live in the arena for as long
+// as player mode runs and are reset between tracks; when the pool is empty or
+// absent a context is built on the heap and freed after the track.
+typedef struct {
+    HMP3Decoder dec;
+    unsigned char *inbuf;
+    helix_output_t *out;
+    uint8_t *ring;
+    size_t ring_bytes;
+    bool in_use;
+} helix_ctx_t;
+
 static const char *TAG = "helix_mp3";
+static helix_mp3_stats_t s_last_stats;
+static helix_ctx_t s_ctx_pool[HELIX_CTX_POOL];
+static int s_ctx_count = 0;
+static portMUX_TYPE s_ctx_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_arena_tracks = 0;
+static bool s_arena_release_pending = false;    // deinit while a context was in use
+static size_t s_arena_largest_before = 0;
+
+static void helix_stats_finish(helix_mp3_stats_t *st, uint64_t samples_total, int rate, uint64_t decode_us)
+{
+    st->decode_us = (decode_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)decode_us;
+    st->audio_ms = (rate > 0) ? (uint32_t)((samples_total * 1000ULL) / (uint32_t)rate) : 0;
+    st->frames_per_sec = (decode_us > 0) ? (uint32_t)(((uint64_t)st->frames * 1000000ULL) / decode_us) : 0;
+    st->heap_peak = (uint32_t)helix_shim_heap_peak();
+#if HELIX_MP3_PROFILE
+    uint64_t cycles[HELIX_STAGE_COUNT];
+    helix_shim_profile_get(cycles);
+    for (int i = 0; i < HELIX_STAGE_COUNT; ++i) {
+        uint64_t ns = (cycles[i] * 1000ULL) / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        st->stage_ns_per_frame[i] = st->frames ? (uint32_t)(ns / st->frames) : 0;
+    }
+    ESP_LOGI(TAG, "frames=%u audio=%ums decode=%uus fps=%u heap_peak=%u stalls=%u crc=%08x",
+             (unsigned)st->frames, (unsigned)st->audio_ms, (unsigned)st->decode_us,
+             (unsigned)st->frames_per_sec, (unsigned)st->heap_peak, (unsigned)st->read_stalls,
+             (unsigned)st->pcm_crc32);
+    ESP_LOGI(TAG, "ns/frame huffman=%u dequant=%u imdct=%u polyphase=%u",
+             (unsigned)st->stage_ns_per_frame[HELIX_STAGE_HUFFMAN],
+             (unsigned)st->stage_ns_per_frame[HELIX_STAGE_DEQUANT],
+             (unsigned)st->stage_ns_per_frame[HELIX_STAGE_IMDCT],
+             (unsigned)st->stage_ns_per_frame[HELIX_STAGE_SUBBAND]);
+#else
+    ESP_LOGD(TAG, "frames=%u audio=%ums decode=%uus fps=%u heap_peak=%u stalls=%u",
+             (unsigned)st->frames, (unsigned)st->audio_ms, (unsigned)st->decode_us,
+             (unsigned)st->frames_per_sec, (unsigned)st->heap_peak, (unsigned)st->read_stalls);
+#endif
+    s_last_stats = *st;
+}
 
-static size_t convert_and_write(const short *pcm, int samples, int nChans, int sampleRate, int volume_percent, mp3_write_cb_t writer, void *user)
+void helix_mp3_get_last_stats(helix_mp3_stats_t *out)
 {
-    const int target_rate = 44100;
-    (void)volume_percent;
-    if (sampleRate == target_rate && nChans == 2) {
-        return writer((const uint8_t *)pcm, (size_t)samples * sizeof(short), user);
+    if (out) {
+        *out = s_last_stats;
     }
-    float ratio = (float)sampleRate / (float)target_rate;
-    int out_frames = samples / nChans;
-    if (ratio != 1.0f) {
-        out_frames = (int)((float)out_frames / ratio);
+}
+
+static size_t helix_ctx_bytes(size_t ring_bytes)
+{
+    size_t a = HELIX_ARENA_ALIGN;
+    size_t in = ((size_t)HELIX_INBUF_SIZE + MAINBUF_SIZE + a - 1) & ~(a - 1);
+    size_t out = (sizeof(helix_output_t) + a - 1) & ~(a - 1);
+    return (size_t)MP3DecoderBytes((int)a) + in + out + ring_bytes;
+}
+
+esp_err_t helix_mp3_arena_init(void)
+{
+    if (s_ctx_count > 0) {
+        // Back before the last context of the old session was released.
+        portENTER_CRITICAL(&s_ctx_lock);
+        s_arena_release_pending = false;
+        portEXIT_CRITICAL(&s_ctx_lock);
+        return ESP_OK;
     }
-    static short outbuf[1152 * 2]; // max mp3 frame stereo
-    if (out_frames > 1152) {
-        out_frames = 1152;
+    s_arena_largest_before = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_arena_tracks = 0;
+    int n = 0;
+    size_t ring_bytes = (size_t)HELIX_RING_BLOCKS_PSRAM * AUDIO_PREFETCH_BLOCK_BYTES;
+    for (int want = HELIX_CTX_POOL; want > 0 && n == 0; --want) {
+        if (helix_shim_arena_create(helix_ctx_bytes(ring_bytes) * want, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)) {
+            n = want;
+        }
     }
-    if (sampleRate == target_rate && nChans == 1) {
-        for (int o = 0; o < out_frames; ++o) {
-            int16_t s = pcm[o];
-            outbuf[o * 2] = s;
-            outbuf[o * 2 + 1] = s;
+    if (n == 0) {
+        // Internal RAM: short rings so both contexts fit and a pre-opened
+        // track never builds one on the heap at each track change.
+        ring_bytes = (size_t)HELIX_RING_BLOCKS_INTERNAL * AUDIO_PREFETCH_BLOCK_BYTES;
+        for (int want = HELIX_CTX_POOL; want > 0 && n == 0; --want) {
+            if (helix_shim_arena_create(helix_ctx_bytes(ring_bytes) * want, MALLOC_CAP_DMA | MALLOC_CAP_8BIT)) {
+                n = want;
+            }
         }
-    } else {
-        for (int o = 0; o < out_frames; ++o) {
-            int src_idx = ratio == 1.0f ? o : (int)(o * ratio);
-            int32_t l = (nChans == 1) ? pcm[src_idx] : pcm[src_idx * 2];
-            int32_t r = (nChans == 1) ? pcm[src_idx] : pcm[src_idx * 2 + 1];
-            if (l > 32767) {
-                l = 32767;
-            } else if (l < -32768) {
-                l = -32768;
+    }
+    if (n == 0) {
+        ESP_LOGW(TAG, "arena alloc failed, decoding from heap");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < n; ++i) {
+        helix_ctx_t *ctx = &s_ctx_pool[i];
+        ctx->dec = MP3InitDecoder();
+        ctx->inbuf = helix_malloc(HELIX_INBUF_SIZE + MAINBUF_SIZE);
+        ctx->out = helix_malloc(sizeof(helix_output_t));
+        ctx->ring = helix_malloc((int)ring_bytes);
+        ctx->ring_bytes = ring_bytes;
+        ctx->in_use = false;
+        if (!ctx->dec || !ctx->inbuf || !ctx->out || !ctx->ring) {
+            ESP_LOGE(TAG, "arena layout mismatch");
+            helix_shim_arena_destroy();
+            memset(s_ctx_pool, 0, sizeof(s_ctx_pool));
+            return ESP_FAIL;
+        }
+        ctx->out->rs = NULL;
+    }
+    helix_shim_arena_seal();
+    s_ctx_count = n;
+    ESP_LOGI(TAG, "arena %u ctx, %u bytes, largest_int_before=%u", (unsigned)n,
+             (unsigned)helix_shim_arena_used(), (unsigned)s_arena_largest_before);
+    return ESP_OK;
+}
+
+// Pool entries are idle and no longer handed out.
+static void helix_arena_destroy(void)
+{
+    for (int i = 0; i < HELIX_CTX_POOL; ++i) {
+        if (s_ctx_pool[i].out) {
+            helix_free(s_ctx_pool[i].out->rs);
+        }
+    }
+    memset(s_ctx_pool, 0, sizeof(s_ctx_pool));
+    helix_shim_arena_destroy();
+    size_t after = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_LOGI(TAG, "arena released after %u tracks, largest_int before=%u after=%u",
+             (unsigned)s_arena_tracks, (unsigned)s_arena_largest_before, (unsigned)after);
+}
+
+void helix_mp3_arena_deinit(void)
+{
+    if (s_ctx_count == 0) {
+        return;
+    }
+    bool busy = false;
+    portENTER_CRITICAL(&s_ctx_lock);
+    for (int i = 0; i < s_ctx_count; ++i) {
+        busy |= s_ctx_pool[i].in_use;
+    }
+    // Either way no new track gets a pool context from here on.
+    s_arena_release_pending = busy;
+    if (!busy) {
+        s_ctx_count = 0;
+    }
+    portEXIT_CRITICAL(&s_ctx_lock);
+    if (busy) {
+        ESP_LOGI(TAG, "arena busy, releasing it with the last context");
+        return;
+    }
+    helix_arena_destroy();
+}
+
+static helix_ctx_t *helix_ctx_acquire(void)
+{
+    helix_ctx_t *ctx = NULL;
+    portENTER_CRITICAL(&s_ctx_lock);
+    for (int i = 0; i < s_ctx_count && !s_arena_release_pending; ++i) {
+        if (!s_ctx_pool[i].in_use) {
+            ctx = &s_ctx_pool[i];
+            ctx->in_use = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_ctx_lock);
+    if (ctx) {
+        MP3ResetDecoder(ctx->dec);
+        s_arena_tracks++;
+        return ctx;
+    }
+
+    ctx = helix_malloc(sizeof(helix_ctx_t));
+    if (!ctx) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->dec = MP3InitDecoder();
+    ctx->inbuf = helix_malloc(HELIX_INBUF_SIZE + MAINBUF_SIZE);
+    ctx->out = helix_malloc(sizeof(helix_output_t));
+    ctx->in_use = true;
+    if (!ctx->dec || !ctx->inbuf || !ctx->out) {
+        ESP_LOGE(TAG, "decoder alloc failed");
+        MP3FreeDecoder(ctx->dec);
+        helix_free(ctx->inbuf);
+        helix_free(ctx->out);
+        helix_free(ctx);
+        return NULL;
+    }
+    ctx->out->rs = NULL;
+    return ctx;
+}
+
+static void helix_ctx_release(helix_ctx_t *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    if (ctx >= s_ctx_pool && ctx < s_ctx_pool + HELIX_CTX_POOL) {
+        bool last = false;
+        portENTER_CRITICAL(&s_ctx_lock);
+        ctx->in_use = false;
+        if (s_arena_release_pending) {
+            last = true;
+            for (int i = 0; i < s_ctx_count; ++i) {
+                last &= !s_ctx_pool[i].in_use;
             }
-            if (r > 32767) {
-                r = 32767;
-            } else if (r < -32768) {
-                r = -32768;
+            if (last) {
+                s_arena_release_pending = false;
+                s_ctx_count = 0;
             }
-            outbuf[o * 2] = (short)l;
-            outbuf[o * 2 + 1] = (short)r;
         }
+        portEXIT_CRITICAL(&s_ctx_lock);
+        if (last) {
+            helix_arena_destroy();
+        }
+        return;
     }
-    size_t bytes = out_frames * 2 * sizeof(short);
-    return writer((const uint8_t *)outbuf, bytes, user);
+    MP3FreeDecoder(ctx->dec);
+    helix_free(ctx->inbuf);
+    helix_free(ctx->out->rs);
+    helix_free(ctx->out);
+    helix_free(ctx);
 }
 
-bool helix_mp3_decode_file(const char *path,
-                           int volume_percent,
-                           mp3_write_cb_t writer,
-                           void *user,
-                           mp3_progress_cb_t progress_cb,
-                           void *progress_user,
-                           float start_ratio)
+// Reads go through the prefetch ring when it could be set up, else straight to the file.
+static size_t helix_read(FILE *f, audio_prefetch_t *pf, unsigned char *dst, size_t len)
 {
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        ESP_LOGE(TAG, "cannot open %s", path);
+    return pf ? audio_prefetch_read(pf, dst, len) : fread(dst, 1, len, f);
+}
+
+static long helix_tell(FILE *f, const audio_prefetch_t *pf)
+{
+    return pf ? audio_prefetch_tell(pf) : ftell(f);
+}
+
+static bool helix_output_set_rate(helix_output_t *out, int rate)
+{
+    out->in_rate = (uint32_t)rate;
+    out->out_rate = out->format_cb ? out->format_cb((uint32_t)rate, out->user) : 0;
+    if (out->out_rate == 0) {
+        out->out_rate = HELIX_OUTPUT_RATE;
+    }
+    if (out->out_rate == out->in_rate) {
+        return true;
+    }
+    if (!out->rs) {
+        out->rs = helix_malloc(sizeof(audio_resampler_t));
+        if (!out->rs) {
+            ESP_LOGE(TAG, "resampler alloc failed");
+            return false;
+        }
+        memset(out->rs, 0, sizeof(*out->rs));
+    }
+    ESP_LOGD(TAG, "resampling %u -> %u Hz", (unsigned)out->in_rate, (unsigned)out->out_rate);
+    return audio_resampler_init(out->rs, out->in_rate, out->out_rate);
+}
+
+static bool convert_and_write(helix_output_t *out, short *pcm, int samples, int nChans, int sampleRate)
+{
+    if ((uint32_t)sampleRate != out->in_rate && !helix_output_set_rate(out, sampleRate)) {
         return false;
     }
+    size_t frames = (size_t)(samples / nChans);
 
-    long total_bytes = 0;
-    fseek(f, 0, SEEK_END);
-    total_bytes = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    if (out->out_rate == out->in_rate) {
+        if (nChans == 2) {
+            // Native stereo: hand the decode slot itself to the sink.
+            return out->writer((uint8_t *)pcm, (size_t)samples * sizeof(short), out->user) != 0;
+        }
+        for (size_t done = 0; done < frames; ) {
+            size_t n = frames - done;
+            if (n > HELIX_OUT_CHUNK_FRAMES) {
+                n = HELIX_OUT_CHUNK_FRAMES;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                short s = pcm[done + i];
+                out->outbuf[i * 2] = s;
+                out->outbuf[i * 2 + 1] = s;
+            }
+            if (out->writer((uint8_t *)out->outbuf, n * 2 * sizeof(short), out->user) == 0) {
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
 
-    HMP3Decoder dec = MP3InitDecoder();
-    if (!dec) {
-        fclose(f);
-        ESP_LOGE(TAG, "MP3InitDecoder failed");
-        return false;
+    // Band-limited conversion; a frame can expand to several output chunks.
+    audio_resampler_push(out->rs, pcm, frames, nChans);
+    size_t got;
+    while ((got = audio_resampler_pull(out->rs, out->outbuf, HELIX_OUT_CHUNK_FRAMES)) > 0) {
+        if (out->writer((uint8_t *)out->outbuf, got * 2 * sizeof(short), out->user) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Push/pull decoder over one context: callers feed bytes from any source and
+// pull frames; sync search, underflow and resync live here and nowhere else.
+struct helix_mp3_stream {
+    helix_ctx_t *ctx;
+    int rd;                 // read offset into ctx->inbuf
+    int left;               // buffered bytes starting at rd
+    uint64_t in_pos;        // stream offset just past the buffered bytes
+    uint64_t sample_pos;    // timeline position of the next frame
+    bool flushed;
+    bool resync;            // landed at an arbitrary byte, sync words are suspect
+    uint32_t errors;
+    mp3_frame_cb_t frame_cb;
+    void *frame_user;
+};
+
+helix_mp3_stream_t *helix_mp3_stream_create(void)
+{
+    helix_mp3_stream_t *s = helix_malloc(sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    memset(s, 0, sizeof(*s));
+    s->ctx = helix_ctx_acquire();
+    if (!s->ctx) {
+        helix_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void helix_mp3_stream_destroy(helix_mp3_stream_t *s)
+{
+    if (!s) {
+        return;
     }
+    helix_ctx_release(s->ctx);
+    helix_free(s);
+}
+
+void helix_mp3_stream_set_frame_cb(helix_mp3_stream_t *s, mp3_frame_cb_t cb, void *user)
+{
+    s->frame_cb = cb;
+    s->frame_user = user;
+}
 
-    const int INBUF_SIZE = 4096;
-    unsigned char *inbuf = malloc(INBUF_SIZE + MAINBUF_SIZE);
-    if (!inbuf) {
-        MP3FreeDecoder(dec);
-        fclose(f);
+uint8_t *helix_mp3_stream_feed_buf(helix_mp3_stream_t *s, size_t *space)
+{
+    unsigned char *inbuf = s->ctx->inbuf;
+    if (s->rd > 0) {
+        memmove(inbuf, inbuf + s->rd, (size_t)s->left);
+        s->rd = 0;
+    }
+    *space = (size_t)(HELIX_INBUF_SIZE + MAINBUF_SIZE - s->left);
+    return inbuf + s->left;
+}
+
+void helix_mp3_stream_commit(helix_mp3_stream_t *s, size_t len)
+{
+    size_t space = (size_t)(HELIX_INBUF_SIZE + MAINBUF_SIZE - s->rd - s->left);
+    if (len > space) {
+        len = space;
+    }
+    s->left += (int)len;
+    s->in_pos += len;
+}
+
+size_t helix_mp3_stream_feed(helix_mp3_stream_t *s, const uint8_t *data, size_t len)
+{
+    size_t space;
+    uint8_t *dst = helix_mp3_stream_feed_buf(s, &space);
+    if (len > space) {
+        len = space;
+    }
+    memcpy(dst, data, len);
+    helix_mp3_stream_commit(s, len);
+    return len;
+}
+
+void helix_mp3_stream_skip(helix_mp3_stream_t *s, size_t len)
+{
+    if (len > (size_t)s->left) {
+        len = (size_t)s->left;
+    }
+    s->rd += (int)len;
+    s->left -= (int)len;
+}
+
+void helix_mp3_stream_flush(helix_mp3_stream_t *s)
+{
+    s->flushed = true;
+}
+
+void helix_mp3_stream_seek(helix_mp3_stream_t *s, uint64_t stream_pos, uint64_t sample_pos)
+{
+    // Buffered bytes and the bit reservoir belong to the old position; the
+    // first frames after a jump come back as MP3_STREAM_GAP until it refills.
+    MP3ResetDecoder(s->ctx->dec);
+    s->rd = 0;
+    s->left = 0;
+    s->in_pos = stream_pos;
+    s->sample_pos = sample_pos;
+    s->flushed = false;
+    s->resync = true;
+}
+
+void helix_mp3_stream_reset(helix_mp3_stream_t *s)
+{
+    helix_mp3_stream_seek(s, 0, 0);
+    s->errors = 0;
+}
+
+// A sync word at `p` is trusted once the next frame header follows where this
+// one says it ends, with the same rate and channel count.
+static bool helix_sync_confirmed(const unsigned char *p, int left, bool flushed)
+{
+    mp3_frame_header_t hdr;
+    mp3_frame_header_t next;
+    if (left < 4 || !mp3_frame_header_parse(p, &hdr)) {
         return false;
     }
+    if ((int)hdr.frame_bytes + 4 > left) {
+        return flushed;
+    }
+    return mp3_frame_header_parse(p + hdr.frame_bytes, &next) && next.sample_rate == hdr.sample_rate &&
+           next.channels == hdr.channels;
+}
 
-    short pcm[1152 * 2];
-    int bytesLeft = 0;
-    unsigned char *readPtr = inbuf;
-    bool ok = true;
+mp3_stream_status_t helix_mp3_stream_pull(helix_mp3_stream_t *s, short **pcm, mp3_frame_meta_t *meta)
+{
+    helix_ctx_t *ctx = s->ctx;
+    short *slot = ctx->out->pcm;
+    while (1) {
+        // Only decode once a worst-case frame is buffered, unless no more input is coming.
+        if (s->left < MAINBUF_SIZE && !s->flushed) {
+            return MP3_STREAM_NEED_DATA;
+        }
+        if (s->left <= 0) {
+            return MP3_STREAM_END;
+        }
+
+        unsigned char *ptr = ctx->inbuf + s->rd;
+        int offset = MP3FindSyncWord(ptr, s->left);
+        if (offset < 0) {
+            // Keep the last byte: a sync word may straddle the next feed.
+            helix_mp3_stream_skip(s, s->flushed ? (size_t)s->left : (size_t)s->left - 1);
+            continue;
+        }
+        ptr += offset;
+        s->rd += offset;
+        s->left -= offset;
+        if (s->resync && !helix_sync_confirmed(ptr, s->left, s->flushed)) {
+            // 0xFFE inside main data: Helix would decode it and walk off the frame grid.
+            helix_mp3_stream_skip(s, 1);
+            continue;
+        }
+
+        mp3_frame_meta_t m = {0};
+        m.stream_pos = s->in_pos - (uint64_t)s->left;
+        m.sample_pos = s->sample_pos;
+        int left = s->left;
+        int err = MP3Decode(ctx->dec, &ptr, &left, slot, 0);
+        s->rd = (int)(ptr - ctx->inbuf);
+        s->left = left;
+        if (err == ERR_MP3_INDATA_UNDERFLOW) {
+            s->left = 0;
+            continue;
+        }
+        if (err && err != ERR_MP3_MAINDATA_UNDERFLOW) {
+            s->resync = true;
+            if (s->errors++ < 5) {
+                ESP_LOGW(TAG, "MP3Decode err=%d bytesLeft=%d", err, s->left);
+            }
+            helix_mp3_stream_skip(s, 1);
+            continue;
+        }
+
+        s->resync = false;
+        MP3FrameInfo info;
+        MP3GetLastFrameInfo(ctx->dec, &info);
+        if (info.nChans <= 0 || info.outputSamps <= 0) {
+            continue;
+        }
+        m.sample_rate = (uint32_t)info.samprate;
+        m.bitrate = (uint32_t)info.bitrate;
+        m.channels = (uint8_t)info.nChans;
+        m.samples = (uint16_t)(info.outputSamps / info.nChans);
+        s->sample_pos += m.samples;
+        if (s->frame_cb) {
+            s->frame_cb(&m, s->frame_user);
+        }
+        if (meta) {
+            *meta = m;
+        }
+        if (err) {
+            // Bit reservoir underflow: the frame still occupies its slot on the timeline.
+            return MP3_STREAM_GAP;
+        }
+        if (pcm) {
+            *pcm = slot;
+        }
+        return MP3_STREAM_FRAME;
+    }
+}
+
+// Everything up to the first decoded frame: file, headers, seek position,
+// prefetch ring and stream. Kept separate so the next track can be opened
+// while the current one is still playing.
+struct helix_mp3_source {
+    FILE *f;
+    audio_prefetch_t *pf;
+    helix_mp3_stream_t *stream;
+    long total_bytes;
+    uint32_t audio_bytes;
+    uint32_t est_total_ms;
+    bool total_ms_set;
+    bool have_index;
+    bool use_seek;
+    float ratio;
+    bool seek_base_set;
+    uint32_t seek_base_ms;
+    uint32_t skip_samples;
+    uint64_t samples_start;
+    uint64_t trim_end;      // timeline sample where LAME padding starts, 0 = none
+    uint32_t lead_samples;  // timeline samples before the first audible one (LAME delay)
+    uint64_t samples_pos;   // timeline position after the last decoded frame
+    int rate;               // of the last decoded frame, the first header's before that
+    uint64_t decode_us;     // time spent in the decoder so far
+    short *pend;            // decoded by helix_mp3_source_read() but not handed out
+    uint32_t pend_frames;
+    uint8_t pend_chans;
+    bool pulled;            // helix_mp3_source_read() has taken frames
+    char path[];
+};
+
+helix_mp3_source_t *helix_mp3_open(const char *path, float start_ratio)
+{
+    size_t path_len = strlen(path);
+    helix_mp3_source_t *src = helix_malloc((int)(sizeof(*src) + path_len + 1));
+    if (!src) {
+        return NULL;
+    }
+    memset(src, 0, sizeof(*src));
+    memcpy(src->path, path, path_len + 1);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "cannot open %s", path);
+        helix_free(src);
+        return NULL;
+    }
+    src->f = f;
+
+    fseek(f, 0, SEEK_END);
+    src->total_bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    src->stream = helix_mp3_stream_create();
+    if (!src->stream) {
+        helix_mp3_close(src);
+        return NULL;
+    }
+    long total_bytes = src->total_bytes;
 
     // Skip ID3v2 tag if present.
     unsigned char id3[10] = {0};
@@ -105,11 +620,44 @@ bool helix_mp3_decode_file(const char *path,
         fseek(f, 0, SEEK_SET);
     }
 
-    size_t bytes_read_total = (size_t)ftell(f);
-    uint64_t samples_total = 0;
-    int last_rate = 44100;
-    uint32_t est_total_ms = 0;
-    bool total_ms_set = false;
+    long stream_start = ftell(f);
+    helix_mp3_stream_seek(src->stream, (uint64_t)stream_start, 0);
+
+    // Probe the first frame for a Xing/Info/VBRI tag; it carries no audio.
+    mp3_vbr_info_t vbr;
+    mp3_frame_header_t first;
+    bool have_vbr = false;
+    uint32_t first_rate = 0;
+    long first_frame_pos = stream_start;
+    size_t space;
+    unsigned char *probe = helix_mp3_stream_feed_buf(src->stream, &space);
+    int got = (int)fread(probe, 1, HELIX_INBUF_SIZE, f);
+    helix_mp3_stream_commit(src->stream, (size_t)got);
+    int sync = MP3FindSyncWord(probe, got);
+    if (sync >= 0) {
+        first_frame_pos = stream_start + sync;
+        if (got - sync >= 4 && mp3_frame_header_parse(probe + sync, &first)) {
+            first_rate = first.sample_rate;
+        }
+        have_vbr = mp3_vbr_info_parse(probe + sync, (size_t)(got - sync), &vbr);
+        if (have_vbr && vbr.tag_frame_bytes <= got - sync) {
+            helix_mp3_stream_skip(src->stream, (size_t)(sync + vbr.tag_frame_bytes));
+        }
+    }
+
+    uint32_t audio_bytes = (total_bytes > first_frame_pos) ? (uint32_t)(total_bytes - first_frame_pos) : 0;
+    if (have_vbr && vbr.stream_bytes > 0 && vbr.stream_bytes <= audio_bytes) {
+        audio_bytes = vbr.stream_bytes;
+    }
+    src->audio_bytes = audio_bytes;
+    // A frame index from an earlier full play gives exact duration and seek points.
+    mp3_frame_index_t index;
+    src->have_index = mp3_frame_index_open(path, &index);
+    src->est_total_ms = src->have_index ? mp3_frame_index_duration_ms(&index) : 0;
+    if (src->est_total_ms == 0 && have_vbr) {
+        src->est_total_ms = mp3_vbr_info_duration_ms(&vbr);
+    }
+    src->total_ms_set = (src->est_total_ms > 0);
     float ratio = start_ratio;
     if (ratio < 0.0f) {
         ratio = 0.0f;
@@ -117,109 +665,333 @@ bool helix_mp3_decode_file(const char *path,
     if (ratio > 1.0f) {
         ratio = 1.0f;
     }
-    if (ratio > 0.0f) {
-        long seek_pos = (long)((double)total_bytes * ratio);
+    src->ratio = ratio;
+
+    // LAME delay/padding are counted on the raw decoder timeline, which the
+    // sample counter follows from the first frame or an index entry. Index
+    // totals and elapsed times count audible samples, which start `lead`
+    // samples into that timeline.
+    bool trim = have_vbr && vbr.has_lame && vbr.frames > 0;
+    uint32_t lead = trim ? (uint32_t)vbr.enc_delay + HELIX_DECODER_DELAY : 0;
+    src->use_seek = ratio > 0.0f;
+    if (src->use_seek) {
+        long seek_pos;
+        mp3_index_entry_t entry;
+        bool have_index = src->have_index;
+        uint32_t target = have_index ? (uint32_t)((double)index.total_samples * ratio) + lead : 0;
+        uint32_t preroll = have_index ? (uint32_t)index.samples_per_frame * HELIX_SEEK_PREROLL_FRAMES : 0;
+        if (have_index && mp3_frame_index_lookup(&index, (target > preroll) ? target - preroll : 0, &entry)) {
+            // Start a few frames early to refill the bit reservoir, then drop
+            // decoded samples up to the exact target.
+            seek_pos = (long)entry.byte_offset;
+            src->samples_start = entry.sample_pos;
+            src->skip_samples = (target > entry.sample_pos) ? target - entry.sample_pos : 0;
+        } else {
+            if (have_vbr && vbr.has_toc) {
+                seek_pos = first_frame_pos + (long)mp3_vbr_info_seek_offset(&vbr, ratio, audio_bytes);
+            } else {
+                seek_pos = first_frame_pos + (long)((double)audio_bytes * ratio);
+            }
+            trim = false;
+        }
         if (seek_pos < 0) {
             seek_pos = 0;
         }
         if (seek_pos > total_bytes) {
             seek_pos = total_bytes;
         }
+        if (src->total_ms_set && !have_index) {
+            src->seek_base_ms = (uint32_t)((float)src->est_total_ms * ratio);
+            src->seek_base_set = true;
+        }
         fseek(f, seek_pos, SEEK_SET);
-        bytes_read_total = (size_t)seek_pos;
+        helix_mp3_stream_seek(src->stream, (uint64_t)seek_pos, src->samples_start);
+    } else if (trim) {
+        src->skip_samples = lead;
+    }
+    if (trim) {
+        src->trim_end = (uint64_t)vbr.frames * vbr.samples_per_frame + HELIX_DECODER_DELAY;
+        src->trim_end = (src->trim_end > vbr.enc_padding) ? src->trim_end - vbr.enc_padding : 0;
+        src->lead_samples = lead;
     }
+    src->samples_pos = src->samples_start;
+    src->rate = first_rate ? (int)first_rate : HELIX_OUTPUT_RATE;
 
-    uint32_t seek_base_ms = 0;
-    bool seek_base_set = false;
-    bool use_seek = ratio > 0.0f;
+    uint32_t stream_bps = HELIX_PREFETCH_DEFAULT_BPS;
+    if (src->est_total_ms > 0 && audio_bytes > 0) {
+        stream_bps = (uint32_t)(((uint64_t)audio_bytes * 1000ULL) / src->est_total_ms);
+    }
+    // From here on the reader task owns the file position.
+    helix_ctx_t *ctx = src->stream->ctx;
+    src->pf = audio_prefetch_open(f, stream_bps, AUDIO_PREFETCH_LEAD_MS_DEFAULT, ctx->ring, ctx->ring_bytes);
+    if (!src->pf) {
+        ESP_LOGW(TAG, "prefetch unavailable, reading synchronously");
+    }
+    return src;
+}
+
+void helix_mp3_close(helix_mp3_source_t *src)
+{
+    if (!src) {
+        return;
+    }
+    // The prefetch ring may live in the stream's context; stop it first.
+    audio_prefetch_close(src->pf, NULL);
+    helix_mp3_stream_destroy(src->stream);
+    if (src->f) {
+        fclose(src->f);
+    }
+    helix_free(src);
+}
 
-    int err_logged = 0;
+uint32_t helix_mp3_source_duration_ms(const helix_mp3_source_t *src)
+{
+    return src ? src->est_total_ms : 0;
+}
+
+// Audible samples up to the end of the last decoded frame, on the same
+// timeline as the LAME tag's duration.
+static uint64_t helix_source_audible_pos(const helix_mp3_source_t *src)
+{
+    uint64_t pos = src->samples_pos;
+    if (src->trim_end > 0 && pos > src->trim_end) {
+        pos = src->trim_end;
+    }
+    return (pos > src->lead_samples) ? pos - src->lead_samples : 0;
+}
+
+static void helix_index_frame_cb(const mp3_frame_meta_t *meta, void *user)
+{
+    mp3_frame_index_builder_add((mp3_frame_index_builder_t *)user, (uint32_t)meta->stream_pos,
+                                (uint32_t)meta->sample_pos);
+}
+
+typedef struct {
+    short *raw;             // the whole decoded frame
+    uint32_t raw_frames;
+    short *pcm;             // first sample kept after trimming
+    uint32_t frames;        // kept frames; 0 when trimming drops the whole frame
+    int chans;
+    int rate;
+} helix_frame_t;
+
+// Next decoded frame of `src`, reading input as needed, with seek preroll,
+// encoder delay and LAME padding cut away. False at the end of the stream.
+static bool helix_source_next(helix_mp3_source_t *src, helix_frame_t *fr,
+                              mp3_progress_cb_t progress_cb, void *progress_user)
+{
+    helix_mp3_stream_t *stream = src->stream;
     while (1) {
-        if (bytesLeft < MAINBUF_SIZE) {
-            memmove(inbuf, readPtr, bytesLeft);
-            int n = fread(inbuf + bytesLeft, 1, INBUF_SIZE, f);
-            bytesLeft += n;
-            readPtr = inbuf;
-            if (bytesLeft == 0) {
-                break;
+        short *pcm = NULL;
+        mp3_frame_meta_t meta;
+        int64_t t0 = esp_timer_get_time();
+        mp3_stream_status_t st = helix_mp3_stream_pull(stream, &pcm, &meta);
+        src->decode_us += (uint64_t)(esp_timer_get_time() - t0);
+        if (st == MP3_STREAM_END) {
+            return false;
+        }
+        if (st == MP3_STREAM_NEED_DATA) {
+            size_t space;
+            uint8_t *dst = helix_mp3_stream_feed_buf(stream, &space);
+            size_t n = helix_read(src->f, src->pf, dst, space);
+            helix_mp3_stream_commit(stream, n);
+            if (n < space) {
+                helix_mp3_stream_flush(stream);
             }
+            if (progress_cb && src->total_bytes > 0) {
+                progress_cb((size_t)helix_tell(src->f, src->pf), (size_t)src->total_bytes, 0, src->est_total_ms,
+                            progress_user);
+            }
+            continue;
         }
 
-        int offset = MP3FindSyncWord(readPtr, bytesLeft);
-        if (offset < 0) {
-            bytesLeft = 0;
+        uint32_t frame_samples = meta.samples;
+        src->samples_pos = meta.sample_pos + frame_samples;
+        if (st == MP3_STREAM_GAP) {
+            src->skip_samples = (src->skip_samples > frame_samples) ? src->skip_samples - frame_samples : 0;
             continue;
         }
-        readPtr += offset;
-        bytesLeft -= offset;
 
-        int err = MP3Decode(dec, &readPtr, &bytesLeft, pcm, 0);
-        if (err) {
-            if (err == ERR_MP3_INDATA_UNDERFLOW) {
-                bytesLeft = 0;
-                continue;
-            }
-            if (err == ERR_MP3_MAINDATA_UNDERFLOW) {
-                continue;
-            }
-            if (err_logged < 5) {
-                ESP_LOGW(TAG, "MP3Decode err=%d bytesLeft=%d", err, bytesLeft);
-                err_logged++;
+        src->rate = (int)meta.sample_rate;
+        if (!src->total_ms_set && src->audio_bytes > 0 && meta.bitrate > 0) {
+            // Tagless stream: assume CBR and estimate from the first frame's bitrate.
+            src->est_total_ms = (uint32_t)(((uint64_t)src->audio_bytes * 8ULL * 1000ULL) / meta.bitrate);
+            src->total_ms_set = true;
+            if (src->use_seek) {
+                src->seek_base_ms = (uint32_t)((float)src->est_total_ms * src->ratio);
+                src->seek_base_set = true;
             }
-            if (bytesLeft > 0) {
-                readPtr++;
-                bytesLeft--;
-            }
-            continue;
         }
+        // Drop the seek preroll / encoder delay at the head and LAME padding
+        // at the tail so consecutive tracks join sample-exactly.
+        uint32_t first = (src->skip_samples < frame_samples) ? src->skip_samples : frame_samples;
+        src->skip_samples -= first;
+        uint32_t last = frame_samples;
+        if (src->trim_end > 0 && src->samples_pos > src->trim_end) {
+            uint64_t excess = src->samples_pos - src->trim_end;
+            last = (excess >= frame_samples) ? 0 : frame_samples - (uint32_t)excess;
+        }
+        fr->raw = pcm;
+        fr->raw_frames = frame_samples;
+        fr->chans = meta.channels;
+        fr->rate = src->rate;
+        fr->pcm = pcm + (size_t)first * (size_t)meta.channels;
+        fr->frames = (last > first) ? last - first : 0;
+        return true;
+    }
+}
 
-        MP3FrameInfo info;
-        MP3GetLastFrameInfo(dec, &info);
-        int samples = info.outputSamps;
-        int chans = info.nChans;
-        int rate = info.samprate;
-        if (samples <= 0 || chans <= 0) {
+size_t helix_mp3_source_read(helix_mp3_source_t *src, int16_t *out, size_t frames, uint32_t *sample_rate)
+{
+    size_t done = 0;
+    src->pulled = true;
+    while (1) {
+        if (src->pend_frames == 0) {
+            helix_frame_t fr;
+            if (!helix_source_next(src, &fr, NULL, NULL)) {
+                break;
+            }
+            src->pend = fr.pcm;
+            src->pend_frames = fr.frames;
+            src->pend_chans = (uint8_t)fr.chans;
             continue;
         }
-
-        last_rate = rate;
-        uint64_t frame_samples = (uint64_t)(samples / chans);
-        samples_total += frame_samples;
-        if (!total_ms_set && total_bytes > 0 && info.bitrate > 0) {
-            est_total_ms = (uint32_t)(((uint64_t)total_bytes * 8ULL * 1000ULL) / (uint32_t)info.bitrate);
-            total_ms_set = true;
-            if (use_seek) {
-                seek_base_ms = (uint32_t)((float)est_total_ms * ratio);
-                seek_base_set = true;
+        if (done == frames) {
+            break;
+        }
+        size_t n = frames - done;
+        if (n > src->pend_frames) {
+            n = src->pend_frames;
+        }
+        if (src->pend_chans == 2) {
+            memcpy(out + done * 2, src->pend, n * 2 * sizeof(int16_t));
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                out[(done + i) * 2] = src->pend[i];
+                out[(done + i) * 2 + 1] = src->pend[i];
             }
         }
-        if (convert_and_write(pcm, samples, chans, rate, volume_percent, writer, user) == 0) {
+        src->pend += n * src->pend_chans;
+        src->pend_frames -= (uint32_t)n;
+        done += n;
+    }
+    if (sample_rate) {
+        *sample_rate = (uint32_t)src->rate;
+    }
+    return done;
+}
+
+uint32_t helix_mp3_source_sample_rate(const helix_mp3_source_t *src)
+{
+    return src ? (uint32_t)src->rate : 0;
+}
+
+uint32_t helix_mp3_source_load(const helix_mp3_source_t *src)
+{
+    if (!src || src->rate <= 0 || src->samples_pos <= src->samples_start) {
+        return 0;
+    }
+    uint64_t audio_us = ((src->samples_pos - src->samples_start) * 1000000ULL) / (uint32_t)src->rate;
+    return audio_us ? (uint32_t)((src->decode_us * 1000ULL) / audio_us) : 0;
+}
+
+bool helix_mp3_decode_source(helix_mp3_source_t *src,
+                             mp3_write_cb_t writer,
+                             mp3_format_cb_t format_cb,
+                             void *user,
+                             mp3_progress_cb_t progress_cb,
+                             void *progress_user)
+{
+    if (!src) {
+        return false;
+    }
+    helix_mp3_stream_t *stream = src->stream;
+    helix_output_t *out = stream->ctx->out;
+    out->writer = writer;
+    out->format_cb = format_cb;
+    out->user = user;
+    out->in_rate = 0;
+    out->out_rate = 0;
+
+    helix_mp3_stats_t stats = {0};
+    helix_shim_reset_stats();
+
+    uint64_t samples_start = src->samples_pos;
+    uint64_t decode_us_start = src->decode_us;
+    bool ok = true;
+
+    mp3_frame_index_builder_t builder;
+    bool build_index = !src->have_index && !src->use_seek && !src->pulled;
+    if (build_index) {
+        mp3_frame_index_builder_init(&builder);
+        helix_mp3_stream_set_frame_cb(stream, helix_index_frame_cb, &builder);
+    }
+    uint16_t spf = 0;
+    // A crossfade may have left part of a decoded frame behind; it plays first.
+    if (src->pend_frames > 0) {
+        ok = convert_and_write(out, src->pend, (int)(src->pend_frames * src->pend_chans), src->pend_chans,
+                               src->rate);
+        src->pend_frames = 0;
+    }
+    helix_frame_t fr;
+    while (ok && helix_source_next(src, &fr, progress_cb, progress_user)) {
+        stats.frames++;
+#if HELIX_MP3_PROFILE
+        stats.pcm_crc32 = esp_rom_crc32_le(stats.pcm_crc32, (const uint8_t *)fr.raw,
+                                           fr.raw_frames * (uint32_t)fr.chans * sizeof(short));
+#endif
+        spf = (uint16_t)fr.raw_frames;
+        if (fr.frames == 0) {
+            continue;
+        }
+        if (!convert_and_write(out, fr.pcm, (int)(fr.frames * (uint32_t)fr.chans), fr.chans, fr.rate)) {
             ok = false;
             break;
         }
         if (progress_cb) {
-            bytes_read_total = (size_t)ftell(f);
-            float elapsed_sec = (float)samples_total / (float)last_rate;
-            uint32_t elapsed_ms = (uint32_t)(elapsed_sec * 1000.0f);
-            if (use_seek && seek_base_set) {
-                elapsed_ms += seek_base_ms;
-            }
-            progress_cb(bytes_read_total, (size_t)total_bytes, elapsed_ms, est_total_ms, progress_user);
-        }
-        if (bytesLeft < MAINBUF_SIZE) {
-            memmove(inbuf, readPtr, bytesLeft);
-            int n = fread(inbuf + bytesLeft, 1, INBUF_SIZE, f);
-            bytesLeft += n;
-            readPtr = inbuf;
-            bytes_read_total = (size_t)ftell(f);
-            if (progress_cb && total_bytes > 0) {
-                progress_cb(bytes_read_total, (size_t)total_bytes, 0, est_total_ms, progress_user);
+            uint32_t elapsed_ms = (uint32_t)((helix_source_audible_pos(src) * 1000ULL) / (uint32_t)src->rate);
+            if (src->use_seek && src->seek_base_set) {
+                elapsed_ms += src->seek_base_ms;
             }
+            progress_cb((size_t)helix_tell(src->f, src->pf), (size_t)src->total_bytes, elapsed_ms, src->est_total_ms,
+                        progress_user);
         }
     }
 
-    free(inbuf);
-    MP3FreeDecoder(dec);
-    fclose(f);
+    if (src->pf) {
+        audio_prefetch_stats_t pf_stats;
+        audio_prefetch_close(src->pf, &pf_stats);
+        stats.read_stalls = pf_stats.stalls;
+        src->pf = NULL;
+    }
+    if (build_index) {
+        helix_mp3_stream_set_frame_cb(stream, NULL, NULL);
+        // Only a complete, uninterrupted pass yields a trustworthy index.
+        if (ok && spf > 0) {
+            mp3_frame_index_save(src->path, &builder, (uint32_t)src->rate, spf,
+                                 (uint32_t)helix_source_audible_pos(src));
+        }
+        mp3_frame_index_builder_free(&builder);
+    }
+    int rate = src->rate;
+    uint64_t samples_pos = src->samples_pos;
+    uint64_t decode_us = src->decode_us - decode_us_start;
+    helix_mp3_close(src);
+    helix_stats_finish(&stats, samples_pos - samples_start, rate, decode_us);
     return ok;
 }
+
+bool helix_mp3_decode_file(const char *path,
+                           mp3_write_cb_t writer,
+                           mp3_format_cb_t format_cb,
+                           void *user,
+                           mp3_progress_cb_t progress_cb,
+                           void *progress_user,
+                           float start_ratio)
+{
+    helix_mp3_source_t *src = helix_mp3_open(path, start_ratio);
+    if (!src) {
+        return false;
+    }
+    return helix_mp3_decode_source(src, writer, format_cb, user, progress_cb, progress_user);
+}
@@ -3,16 +3,117 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "esp_err.h"
 
-typedef size_t (*mp3_write_cb_t)(const uint8_t *data, size_t len, void *user);
+// PCM handed to the writer lives in the decoder's output slot and may be
+// modified in place (gain, EQ) before it is committed to the sink.
+typedef size_t (*mp3_write_cb_t)(uint8_t *data, size_t len, void *user);
+
+// Called (with the writer's user pointer) when the stream sample rate becomes
+// known or changes. Returns the rate the sink runs at; 0 means 44.1 kHz.
+// PCM is resampled only when the returned rate differs from the stream rate.
+typedef uint32_t (*mp3_format_cb_t)(uint32_t sample_rate, void *user);
 
 typedef void (*mp3_progress_cb_t)(size_t bytes_read, size_t total_bytes, uint32_t elapsed_ms, uint32_t est_total_ms, void *user);
 
-// Decode MP3 to PCM 44.1k/16bit/stereo, write via callback.
+// Decoder statistics for the last helix_mp3_decode_file() call.
+// Stage timings and the PCM checksum are only filled with HELIX_MP3_PROFILE=1.
+typedef struct {
+    uint32_t frames;
+    uint32_t audio_ms;
+    uint32_t decode_us;
+    uint32_t frames_per_sec;
+    uint32_t stage_ns_per_frame[4]; // huffman, dequant, imdct, polyphase
+    uint32_t heap_peak;
+    uint32_t pcm_crc32;
+    uint32_t read_stalls;           // decoder waited on the SD prefetch ring
+} helix_mp3_stats_t;
+
+// Decode MP3 to PCM 16bit/stereo, write via callback.
+// Output is 44.1 kHz unless format_cb accepts another rate.
 bool helix_mp3_decode_file(const char *path,
-                           int volume_percent,
                            mp3_write_cb_t writer,
+                           mp3_format_cb_t format_cb,
                            void *user,
                            mp3_progress_cb_t progress_cb,
                            void *progress_user,
                            float start_ratio);
+
+// Split form of helix_mp3_decode_file(): open parses headers, positions the
+// stream and starts SD prefetch, so the next track can be readied while the
+// current one plays. decode_source() always consumes (closes) the source.
+// LAME encoder delay and padding are trimmed when playing from the start.
+typedef struct helix_mp3_source helix_mp3_source_t;
+
+helix_mp3_source_t *helix_mp3_open(const char *path, float start_ratio);
+uint32_t helix_mp3_source_duration_ms(const helix_mp3_source_t *src);
+bool helix_mp3_decode_source(helix_mp3_source_t *src,
+                             mp3_write_cb_t writer,
+                             mp3_format_cb_t format_cb,
+                             void *user,
+                             mp3_progress_cb_t progress_cb,
+                             void *progress_user);
+void helix_mp3_close(helix_mp3_source_t *src);
+// Pulls up to `frames` trimmed frames as interleaved stereo at the source's
+// own rate (no resampling), for mixing into another track. frames == 0 only
+// decodes ahead so `sample_rate` is known. decode_source() later continues
+// where this stopped; a pulled source does not build a frame index.
+size_t helix_mp3_source_read(helix_mp3_source_t *src, int16_t *out, size_t frames, uint32_t *sample_rate);
+// Rate of the last decoded frame, or of the first frame header before any
+// is decoded. Decodes nothing, so unlike source_read() it leaves the frame
+// index to be built.
+uint32_t helix_mp3_source_sample_rate(const helix_mp3_source_t *src);
+// Decoder time per unit of decoded audio so far, in per mille.
+uint32_t helix_mp3_source_load(const helix_mp3_source_t *src);
+
+// Source-independent streaming decoder. Bytes are pushed in (feed, or
+// feed_buf + commit to read straight into the input buffer) and decoded
+// frames pulled out one at a time. The PCM pointer returned by pull stays
+// valid until the next pull and may be modified in place.
+typedef struct helix_mp3_stream helix_mp3_stream_t;
+
+typedef enum {
+    MP3_STREAM_NEED_DATA = 0,   // feed more bytes, or flush at end of input
+    MP3_STREAM_FRAME,           // *pcm holds meta->samples frames
+    MP3_STREAM_GAP,             // frame on the timeline without audio (bit reservoir refill)
+    MP3_STREAM_END,             // flushed and drained
+} mp3_stream_status_t;
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t bitrate;
+    uint16_t samples;           // per channel
+    uint8_t channels;
+    uint64_t sample_pos;        // timeline position of the frame's first sample
+    uint64_t stream_pos;        // byte offset of the frame's sync word
+} mp3_frame_meta_t;
+
+// Called from pull() for every frame that lands on the timeline, gaps included.
+typedef void (*mp3_frame_cb_t)(const mp3_frame_meta_t *meta, void *user);
+
+helix_mp3_stream_t *helix_mp3_stream_create(void);
+void helix_mp3_stream_destroy(helix_mp3_stream_t *s);
+void helix_mp3_stream_set_frame_cb(helix_mp3_stream_t *s, mp3_frame_cb_t cb, void *user);
+// Returns how many bytes were accepted; the rest must be fed again after a pull.
+size_t helix_mp3_stream_feed(helix_mp3_stream_t *s, const uint8_t *data, size_t len);
+uint8_t *helix_mp3_stream_feed_buf(helix_mp3_stream_t *s, size_t *space);
+void helix_mp3_stream_commit(helix_mp3_stream_t *s, size_t len);
+// Drops buffered input bytes that are not audio (tags, a Xing frame).
+void helix_mp3_stream_skip(helix_mp3_stream_t *s, size_t len);
+// No more input: pull() decodes what is buffered, then reports MP3_STREAM_END.
+void helix_mp3_stream_flush(helix_mp3_stream_t *s);
+mp3_stream_status_t helix_mp3_stream_pull(helix_mp3_stream_t *s, short **pcm, mp3_frame_meta_t *meta);
+// The caller repositioned its source: discard buffered input and decoder
+// history and continue the timeline at `sample_pos`.
+void helix_mp3_stream_seek(helix_mp3_stream_t *s, uint64_t stream_pos, uint64_t sample_pos);
+void helix_mp3_stream_reset(helix_mp3_stream_t *s);
+
+// Player-mode lifetime: one arena block holds decoder contexts (Helix state,
+// input buffer, output slot, prefetch ring) that are reset between tracks
+// instead of reallocated: two in PSRAM, one in internal RAM. Tracks that find
+// no free one allocate from the heap. Deinit while a track still decodes
+// frees the block when that track's context is released.
+esp_err_t helix_mp3_arena_init(void);
+void helix_mp3_arena_deinit(void);
+
+void helix_mp3_get_last_stats(helix_mp3_stats_t *out);
@@ -1,18 +1,160 @@
+#include "helix_shim.h"
+
 #include <stdlib.h>
+#include <string.h>
 #include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
 #include "helix_memory.h"
 
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static size_t s_heap_in_use = 0;
+static size_t s_heap_peak = 0;
+#if HELIX_MP3_PROFILE
+static uint64_t s_stage_cycles[HELIX_STAGE_COUNT];
+#endif
+static uint8_t *s_arena = NULL;
+static size_t s_arena_size = 0;
+static size_t s_arena_used = 0;
+static bool s_arena_open = false;
+
+static void *helix_arena_take(size_t size)
+{
+    size_t need = (size + HELIX_ARENA_ALIGN - 1) & ~(size_t)(HELIX_ARENA_ALIGN - 1);
+    void *p = NULL;
+    portENTER_CRITICAL(&s_stats_lock);
+    if (s_arena_open && s_arena_size - s_arena_used >= need) {
+        p = s_arena + s_arena_used;
+        s_arena_used += need;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return p;
+}
+
+static bool helix_arena_owns(const void *ptr)
+{
+    return s_arena && (const uint8_t *)ptr >= s_arena && (const uint8_t *)ptr < s_arena + s_arena_size;
+}
+
 // Helix allocators: use PSRAM if available, fallback to default heap.
 void *helix_malloc(int size)
 {
+    if (s_arena_open) {
+        void *a = helix_arena_take((size_t)size);
+        if (a) {
+            return a;
+        }
+    }
     void *p = heap_caps_malloc((size_t)size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!p) {
         p = heap_caps_malloc((size_t)size, MALLOC_CAP_DEFAULT);
     }
+    if (p) {
+        size_t block = heap_caps_get_allocated_size(p);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_heap_in_use += block;
+        if (s_heap_in_use > s_heap_peak) {
+            s_heap_peak = s_heap_in_use;
+        }
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
     return p;
 }
 
 void helix_free(void *ptr)
 {
+    if (!ptr || helix_arena_owns(ptr)) {
+        return;
+    }
+    size_t block = heap_caps_get_allocated_size(ptr);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_heap_in_use = (s_heap_in_use > block) ? (s_heap_in_use - block) : 0;
+    portEXIT_CRITICAL(&s_stats_lock);
     heap_caps_free(ptr);
 }
+
+void helix_shim_reset_stats(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_heap_peak = s_heap_in_use;
+#if HELIX_MP3_PROFILE
+    memset(s_stage_cycles, 0, sizeof(s_stage_cycles));
+#endif
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+size_t helix_shim_heap_in_use(void)
+{
+    return s_heap_in_use;
+}
+
+size_t helix_shim_heap_peak(void)
+{
+    return s_heap_peak;
+}
+
+bool helix_shim_arena_create(size_t bytes, uint32_t caps)
+{
+    if (s_arena) {
+        return false;
+    }
+    uint8_t *block = heap_caps_malloc(bytes, caps);
+    if (!block) {
+        return false;
+    }
+    size_t real = heap_caps_get_allocated_size(block);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_arena = block;
+    s_arena_size = bytes;
+    s_arena_used = 0;
+    s_arena_open = true;
+    s_heap_in_use += real;
+    if (s_heap_in_use > s_heap_peak) {
+        s_heap_peak = s_heap_in_use;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return true;
+}
+
+void helix_shim_arena_seal(void)
+{
+    s_arena_open = false;
+}
+
+void helix_shim_arena_destroy(void)
+{
+    if (!s_arena) {
+        return;
+    }
+    uint8_t *block = s_arena;
+    size_t real = heap_caps_get_allocated_size(block);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_arena = NULL;
+    s_arena_size = 0;
+    s_arena_used = 0;
+    s_arena_open = false;
+    s_heap_in_use = (s_heap_in_use > real) ? (s_heap_in_use - real) : 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+    heap_caps_free(block);
+}
+
+size_t helix_shim_arena_used(void)
+{
+    return s_arena_used;
+}
+
+#if HELIX_MP3_PROFILE
+void helix_shim_profile_add(helix_stage_t stage, uint32_t cycles)
+{
+    if (stage >= HELIX_STAGE_COUNT) {
+        return;
+    }
+    s_stage_cycles[stage] += cycles;
+}
+
+void helix_shim_profile_get(uint64_t cycles[HELIX_STAGE_COUNT])
+{
+    for (int i = 0; i < HELIX_STAGE_COUNT; ++i) {
+        cycles[i] = s_stage_cycles[i];
+    }
+}
+#endif
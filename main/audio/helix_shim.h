@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HELIX_MP3_PROFILE
+#define HELIX_MP3_PROFILE 0
+#endif
+
+#if HELIX_MP3_PROFILE
+#include "esp_cpu.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    HELIX_STAGE_HUFFMAN = 0,
+    HELIX_STAGE_DEQUANT,
+    HELIX_STAGE_IMDCT,
+    HELIX_STAGE_SUBBAND,
+    HELIX_STAGE_COUNT
+} helix_stage_t;
+
+// Heap accounting for everything allocated through helix_malloc().
+void helix_shim_reset_stats(void);
+size_t helix_shim_heap_in_use(void);
+size_t helix_shim_heap_peak(void);
+
+// Single-block arena for long-lived decoder state. While open, helix_malloc()
+// carves from it (falling back to the heap when full); helix_free() ignores
+// arena pointers and the block is released whole by arena_destroy().
+#define HELIX_ARENA_ALIGN 8
+bool helix_shim_arena_create(size_t bytes, uint32_t caps);
+void helix_shim_arena_seal(void);
+void helix_shim_arena_destroy(void);
+size_t helix_shim_arena_used(void);
+
+#if HELIX_MP3_PROFILE
+void helix_shim_profile_add(helix_stage_t stage, uint32_t cycles);
+void helix_shim_profile_get(uint64_t cycles[HELIX_STAGE_COUNT]);
+
+// Stage timing hooks used inside the vendored decoder (mp3dec.c).
+#define HELIX_PROFILE_VAR(t) uint32_t t = 0
+#define HELIX_PROFILE_BEGIN(t) ((t) = esp_cpu_get_cycle_count())
+#define HELIX_PROFILE_END(t, stage) helix_shim_profile_add((stage), esp_cpu_get_cycle_count() - (t))
+#else
+#define HELIX_PROFILE_VAR(t)
+#define HELIX_PROFILE_BEGIN(t) ((void)0)
+#define HELIX_PROFILE_END(t, stage) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
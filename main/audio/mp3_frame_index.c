@@ -0,0 +1,236 @@
+#include "mp3_frame_index.h"
+
+#include "storage_sd_spi.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MP3_INDEX_MAGIC 0x5849504DU // "MPIX"
+#define MP3_INDEX_VERSION 2     // 1 stored untrimmed totals
+#define MP3_INDEX_GROW 128
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t path_hash;
+    uint32_t file_size;
+    uint32_t file_mtime;
+    uint32_t sample_rate;
+    uint32_t total_samples;
+    uint16_t samples_per_frame;
+    uint16_t stride;
+    uint32_t count;
+} mp3_index_header_t;
+
+static const char *TAG = "mp3_index";
+
+static uint32_t mp3_index_hash(const char *s, uint32_t seed)
+{
+    uint32_t h = seed;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static bool mp3_index_key(const char *media_path, char *index_path, size_t len, mp3_index_header_t *key)
+{
+    struct stat st;
+    if (!media_path || stat(media_path, &st) != 0) {
+        return false;
+    }
+    memset(key, 0, sizeof(*key));
+    key->magic = MP3_INDEX_MAGIC;
+    key->version = MP3_INDEX_VERSION;
+    key->path_hash = mp3_index_hash(media_path, 5381U);
+    key->file_size = (uint32_t)st.st_size;
+    key->file_mtime = (uint32_t)st.st_mtime;
+    // 8.3 file name derived from the path.
+    uint32_t name_hash = mp3_index_hash(media_path, 2166136261U);
+    int written = snprintf(index_path, len, "%s/%08X.IDX", STORAGE_SD_CACHE_DIR, (unsigned)name_hash);
+    return written > 0 && (size_t)written < len;
+}
+
+bool mp3_frame_index_open(const char *media_path, mp3_frame_index_t *out)
+{
+    if (!out) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    mp3_index_header_t key;
+    if (!mp3_index_key(media_path, out->index_path, sizeof(out->index_path), &key)) {
+        return false;
+    }
+    FILE *f = fopen(out->index_path, "rb");
+    if (!f) {
+        return false;
+    }
+    mp3_index_header_t hdr;
+    bool ok = (fread(&hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+    fclose(f);
+    if (!ok ||
+        hdr.magic != key.magic ||
+        hdr.version != key.version ||
+        hdr.path_hash != key.path_hash ||
+        hdr.file_size != key.file_size ||
+        hdr.file_mtime != key.file_mtime ||
+        hdr.count == 0 || hdr.stride == 0 || hdr.samples_per_frame == 0 || hdr.sample_rate == 0) {
+        return false;
+    }
+    out->sample_rate = hdr.sample_rate;
+    out->total_samples = hdr.total_samples;
+    out->samples_per_frame = hdr.samples_per_frame;
+    out->stride = hdr.stride;
+    out->count = hdr.count;
+    out->valid = true;
+    return true;
+}
+
+bool mp3_frame_index_lookup(const mp3_frame_index_t *idx, uint32_t target_sample, mp3_index_entry_t *out)
+{
+    if (!idx || !idx->valid || !out) {
+        return false;
+    }
+    // Entries are evenly spaced in frames, so the slot is computed directly.
+    uint32_t span = (uint32_t)idx->stride * idx->samples_per_frame;
+    uint32_t k = target_sample / span;
+    if (k >= idx->count) {
+        k = idx->count - 1;
+    }
+    FILE *f = fopen(idx->index_path, "rb");
+    if (!f) {
+        return false;
+    }
+    bool found = false;
+    for (;;) {
+        long pos = (long)sizeof(mp3_index_header_t) + (long)k * (long)sizeof(mp3_index_entry_t);
+        if (fseek(f, pos, SEEK_SET) != 0 || fread(out, 1, sizeof(*out), f) != sizeof(*out)) {
+            break;
+        }
+        // Frames lost to stream errors shift positions; walk back if needed.
+        if (out->sample_pos <= target_sample || k == 0) {
+            found = true;
+            break;
+        }
+        k--;
+    }
+    fclose(f);
+    return found;
+}
+
+uint32_t mp3_frame_index_duration_ms(const mp3_frame_index_t *idx)
+{
+    if (!idx || !idx->valid || idx->sample_rate == 0) {
+        return 0;
+    }
+    return (uint32_t)(((uint64_t)idx->total_samples * 1000ULL) / idx->sample_rate);
+}
+
+void mp3_frame_index_builder_init(mp3_frame_index_builder_t *b)
+{
+    if (!b) {
+        return;
+    }
+    memset(b, 0, sizeof(*b));
+    b->stride = MP3_INDEX_DEFAULT_STRIDE;
+}
+
+static void mp3_index_builder_compact(mp3_frame_index_builder_t *b)
+{
+    // Keep every other entry and double the stride so long files still fit.
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < b->count; i += 2) {
+        b->entries[out++] = b->entries[i];
+    }
+    b->count = out;
+    b->stride = (uint16_t)(b->stride * 2U);
+}
+
+void mp3_frame_index_builder_add(mp3_frame_index_builder_t *b, uint32_t byte_offset, uint32_t sample_pos)
+{
+    if (!b || b->failed) {
+        return;
+    }
+    uint32_t frame = b->frames++;
+    if ((frame % b->stride) != 0) {
+        return;
+    }
+    if (b->count >= MP3_INDEX_MAX_ENTRIES) {
+        mp3_index_builder_compact(b);
+        if ((frame % b->stride) != 0) {
+            return;
+        }
+    }
+    if (b->count >= b->capacity) {
+        uint32_t cap = b->capacity + MP3_INDEX_GROW;
+        if (cap > MP3_INDEX_MAX_ENTRIES) {
+            cap = MP3_INDEX_MAX_ENTRIES;
+        }
+        mp3_index_entry_t *grown = realloc(b->entries, cap * sizeof(mp3_index_entry_t));
+        if (!grown) {
+            b->failed = true;
+            return;
+        }
+        b->entries = grown;
+        b->capacity = cap;
+    }
+    b->entries[b->count].byte_offset = byte_offset;
+    b->entries[b->count].sample_pos = sample_pos;
+    b->count++;
+}
+
+bool mp3_frame_index_save(const char *media_path,
+                          const mp3_frame_index_builder_t *b,
+                          uint32_t sample_rate,
+                          uint16_t samples_per_frame,
+                          uint32_t total_samples)
+{
+    if (!b || b->failed || b->count == 0 || sample_rate == 0 || samples_per_frame == 0) {
+        return false;
+    }
+    char index_path[40];
+    mp3_index_header_t hdr;
+    if (!mp3_index_key(media_path, index_path, sizeof(index_path), &hdr)) {
+        return false;
+    }
+    if (storage_sd_ensure_dir(STORAGE_SD_CACHE_DIR) != ESP_OK) {
+        return false;
+    }
+    hdr.sample_rate = sample_rate;
+    hdr.total_samples = total_samples;
+    hdr.samples_per_frame = samples_per_frame;
+    hdr.stride = b->stride;
+    hdr.count = b->count;
+
+    FILE *f = fopen(index_path, "wb");
+    if (!f) {
+        ESP_LOGW(TAG, "cannot create %s", index_path);
+        return false;
+    }
+    bool ok = (fwrite(&hdr, 1, sizeof(hdr), f) == sizeof(hdr));
+    if (ok) {
+        size_t bytes = (size_t)b->count * sizeof(mp3_index_entry_t);
+        ok = (fwrite(b->entries, 1, bytes, f) == bytes);
+    }
+    fclose(f);
+    if (!ok) {
+        remove(index_path);
+        return false;
+    }
+    ESP_LOGD(TAG, "saved %s: %u entries, stride %u", index_path, (unsigned)b->count, (unsigned)b->stride);
+    return true;
+}
+
+void mp3_frame_index_builder_free(mp3_frame_index_builder_t *b)
+{
+    if (!b) {
+        return;
+    }
+    free(b->entries);
+    b->entries = NULL;
+    b->count = 0;
+    b->capacity = 0;
+}
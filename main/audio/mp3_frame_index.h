@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MP3_INDEX_MAX_ENTRIES 1024
+#define MP3_INDEX_DEFAULT_STRIDE 32
+
+typedef struct {
+    uint32_t byte_offset;   // file offset of the frame sync word
+    uint32_t sample_pos;    // samples per channel before this frame
+} mp3_index_entry_t;
+
+// Sidecar index stored under STORAGE_SD_CACHE_DIR, keyed by file size + mtime.
+typedef struct {
+    bool valid;
+    char index_path[40];
+    uint32_t sample_rate;
+    uint32_t total_samples; // audible, LAME delay and padding removed
+    uint16_t samples_per_frame;
+    uint16_t stride;        // frames between entries
+    uint32_t count;
+} mp3_frame_index_t;
+
+typedef struct {
+    mp3_index_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t frames;
+    uint16_t stride;
+    bool failed;
+} mp3_frame_index_builder_t;
+
+bool mp3_frame_index_open(const char *media_path, mp3_frame_index_t *out);
+// `target_sample` is on the entries' timeline: decoder output from the first
+// audio frame, LAME delay included.
+bool mp3_frame_index_lookup(const mp3_frame_index_t *idx, uint32_t target_sample, mp3_index_entry_t *out);
+uint32_t mp3_frame_index_duration_ms(const mp3_frame_index_t *idx);
+
+void mp3_frame_index_builder_init(mp3_frame_index_builder_t *b);
+// Call once per frame consumed by the decoder, in stream order.
+void mp3_frame_index_builder_add(mp3_frame_index_builder_t *b, uint32_t byte_offset, uint32_t sample_pos);
+bool mp3_frame_index_save(const char *media_path,
+                          const mp3_frame_index_builder_t *b,
+                          uint32_t sample_rate,
+                          uint16_t samples_per_frame,
+                          uint32_t total_samples);
+void mp3_frame_index_builder_free(mp3_frame_index_builder_t *b);
+
+#ifdef __cplusplus
+}
+#endif
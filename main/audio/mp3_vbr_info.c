@@ -0,0 +1,238 @@
+#include "mp3_vbr_info.h"
+
+#include <string.h>
+
+#define MP3_VBRI_OFFSET 36
+#define MP3_VBRI_MAX_ENTRIES 4096
+
+static const uint16_t s_bitrate_kbps[2][15] = {
+    // MPEG1 layer III
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    // MPEG2/2.5 layer III
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+};
+
+static const uint32_t s_sample_rate_hz[3][3] = {
+    {44100, 48000, 32000}, // MPEG1
+    {22050, 24000, 16000}, // MPEG2
+    {11025, 12000, 8000},  // MPEG2.5
+};
+
+static uint32_t read_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint16_t read_be16(const uint8_t *p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+bool mp3_frame_header_parse(const uint8_t *hdr, mp3_frame_header_t *out)
+{
+    if (!hdr || !out) {
+        return false;
+    }
+    if (hdr[0] != 0xFF || (hdr[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    uint8_t version_bits = (hdr[1] >> 3) & 0x03; // 0=2.5, 2=2, 3=1
+    uint8_t layer_bits = (hdr[1] >> 1) & 0x03;   // 1=layer III
+    uint8_t bitrate_idx = (hdr[2] >> 4) & 0x0F;
+    uint8_t rate_idx = (hdr[2] >> 2) & 0x03;
+    uint8_t padding = (hdr[2] >> 1) & 0x01;
+    uint8_t mode = (hdr[3] >> 6) & 0x03;
+    if (version_bits == 1 || layer_bits != 1 || bitrate_idx == 0 || bitrate_idx == 15 || rate_idx == 3) {
+        return false;
+    }
+
+    bool mpeg1 = (version_bits == 3);
+    int ver = mpeg1 ? 0 : (version_bits == 2 ? 1 : 2);
+    out->sample_rate = s_sample_rate_hz[ver][rate_idx];
+    out->bitrate = (uint32_t)s_bitrate_kbps[mpeg1 ? 0 : 1][bitrate_idx] * 1000U;
+    out->samples_per_frame = mpeg1 ? 1152 : 576;
+    out->channels = (mode == 3) ? 1 : 2;
+    if (mpeg1) {
+        out->side_info_bytes = (out->channels == 1) ? 17 : 32;
+    } else {
+        out->side_info_bytes = (out->channels == 1) ? 9 : 17;
+    }
+    uint32_t slot_coef = mpeg1 ? 144U : 72U;
+    out->frame_bytes = (uint16_t)((slot_coef * out->bitrate) / out->sample_rate + padding);
+    return true;
+}
+
+static void mp3_vbr_parse_lame(const uint8_t *p, size_t avail, mp3_vbr_info_t *out)
+{
+    // LAME tag: 9 byte encoder string, delay/padding packed 12+12 bits at +21.
+    if (avail < 24) {
+        return;
+    }
+    if (memcmp(p, "LAME", 4) != 0 && memcmp(p, "Lavf", 4) != 0 && memcmp(p, "Lavc", 4) != 0) {
+        return;
+    }
+    out->enc_delay = (uint16_t)(((uint16_t)p[21] << 4) | (p[22] >> 4));
+    out->enc_padding = (uint16_t)(((uint16_t)(p[22] & 0x0F) << 8) | p[23]);
+    out->has_lame = true;
+}
+
+static bool mp3_vbr_parse_xing(const uint8_t *frame, size_t len, size_t pos, mp3_vbr_info_t *out)
+{
+    if (pos + 8 > len) {
+        return false;
+    }
+    const uint8_t *p = frame + pos;
+    if (memcmp(p, "Xing", 4) != 0 && memcmp(p, "Info", 4) != 0) {
+        return false;
+    }
+    uint32_t flags = read_be32(p + 4);
+    size_t off = pos + 8;
+    if (flags & 0x1) {
+        if (off + 4 > len) {
+            return false;
+        }
+        out->frames = read_be32(frame + off);
+        off += 4;
+    }
+    if (flags & 0x2) {
+        if (off + 4 > len) {
+            return false;
+        }
+        out->stream_bytes = read_be32(frame + off);
+        off += 4;
+    }
+    if (flags & 0x4) {
+        if (off + MP3_VBR_TOC_ENTRIES > len) {
+            return false;
+        }
+        memcpy(out->toc, frame + off, MP3_VBR_TOC_ENTRIES);
+        out->has_toc = true;
+        off += MP3_VBR_TOC_ENTRIES;
+    }
+    if (flags & 0x8) {
+        off += 4;
+    }
+    if (off < len) {
+        mp3_vbr_parse_lame(frame + off, len - off, out);
+    }
+    return true;
+}
+
+static bool mp3_vbr_parse_vbri(const uint8_t *frame, size_t len, mp3_vbr_info_t *out)
+{
+    if (MP3_VBRI_OFFSET + 26 > len) {
+        return false;
+    }
+    const uint8_t *p = frame + MP3_VBRI_OFFSET;
+    if (memcmp(p, "VBRI", 4) != 0) {
+        return false;
+    }
+    out->is_vbri = true;
+    out->enc_delay = read_be16(p + 6);
+    out->stream_bytes = read_be32(p + 10);
+    out->frames = read_be32(p + 14);
+    uint16_t entries = read_be16(p + 18);
+    uint16_t scale = read_be16(p + 20);
+    uint16_t entry_bytes = read_be16(p + 22);
+    uint16_t frames_per_entry = read_be16(p + 24);
+    const uint8_t *table = p + 26;
+
+    if (entries == 0 || entries > MP3_VBRI_MAX_ENTRIES || entry_bytes == 0 || entry_bytes > 4 ||
+        frames_per_entry == 0 || out->frames == 0 || out->stream_bytes == 0 ||
+        (size_t)(table - frame) + (size_t)entries * entry_bytes > len) {
+        return true;
+    }
+
+    // Fold the VBRI table into the same 100-entry byte TOC used for Xing.
+    uint32_t pos = 0;
+    uint32_t entry = 0;
+    for (int pct = 0; pct < MP3_VBR_TOC_ENTRIES; ++pct) {
+        uint32_t target_frame = (uint32_t)(((uint64_t)out->frames * (uint32_t)pct) / MP3_VBR_TOC_ENTRIES);
+        while (entry < entries && (entry + 1U) * frames_per_entry <= target_frame) {
+            uint32_t v = 0;
+            for (uint16_t b = 0; b < entry_bytes; ++b) {
+                v = (v << 8) | table[entry * entry_bytes + b];
+            }
+            pos += v * (scale ? scale : 1U);
+            entry++;
+        }
+        uint32_t entry_size = 0;
+        if (entry < entries) {
+            for (uint16_t b = 0; b < entry_bytes; ++b) {
+                entry_size = (entry_size << 8) | table[entry * entry_bytes + b];
+            }
+            entry_size *= (scale ? scale : 1U);
+        }
+        uint32_t in_entry = target_frame - entry * frames_per_entry;
+        uint32_t byte = pos + (uint32_t)(((uint64_t)entry_size * in_entry) / frames_per_entry);
+        uint32_t v = (uint32_t)(((uint64_t)byte * 256U) / out->stream_bytes);
+        out->toc[pct] = (uint8_t)(v > 255 ? 255 : v);
+    }
+    out->has_toc = true;
+    return true;
+}
+
+bool mp3_vbr_info_parse(const uint8_t *frame, size_t len, mp3_vbr_info_t *out)
+{
+    if (!frame || !out || len < 4) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    mp3_frame_header_t hdr;
+    if (!mp3_frame_header_parse(frame, &hdr)) {
+        return false;
+    }
+    if (len > hdr.frame_bytes) {
+        len = hdr.frame_bytes;
+    }
+
+    bool found = mp3_vbr_parse_xing(frame, len, 4U + hdr.side_info_bytes, out);
+    if (!found) {
+        found = mp3_vbr_parse_vbri(frame, len, out);
+    }
+    if (!found) {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    out->valid = true;
+    out->tag_frame_bytes = hdr.frame_bytes;
+    out->samples_per_frame = hdr.samples_per_frame;
+    out->sample_rate = hdr.sample_rate;
+    return true;
+}
+
+uint32_t mp3_vbr_info_duration_ms(const mp3_vbr_info_t *info)
+{
+    if (!info || !info->valid || info->frames == 0 || info->sample_rate == 0) {
+        return 0;
+    }
+    uint64_t samples = (uint64_t)info->frames * info->samples_per_frame;
+    uint32_t trimmed = info->has_lame ? (uint32_t)info->enc_delay + info->enc_padding : 0;
+    samples = (samples > trimmed) ? samples - trimmed : 0;
+    return (uint32_t)((samples * 1000ULL) / info->sample_rate);
+}
+
+uint32_t mp3_vbr_info_seek_offset(const mp3_vbr_info_t *info, float ratio, uint32_t stream_bytes)
+{
+    if (!info || stream_bytes == 0) {
+        return 0;
+    }
+    if (ratio <= 0.0f) {
+        return 0;
+    }
+    if (ratio >= 1.0f) {
+        return stream_bytes;
+    }
+    if (!info->has_toc) {
+        return (uint32_t)((float)stream_bytes * ratio);
+    }
+    float pct = ratio * 100.0f;
+    int a = (int)pct;
+    if (a > MP3_VBR_TOC_ENTRIES - 1) {
+        a = MP3_VBR_TOC_ENTRIES - 1;
+    }
+    float fa = (float)info->toc[a];
+    float fb = (a < MP3_VBR_TOC_ENTRIES - 1) ? (float)info->toc[a + 1] : 256.0f;
+    float fx = fa + (fb - fa) * (pct - (float)a);
+    return (uint32_t)((fx / 256.0f) * (float)stream_bytes);
+}
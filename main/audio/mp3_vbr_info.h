@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MP3_VBR_TOC_ENTRIES 100
+
+// Basic fields of an MPEG audio layer III frame header.
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t bitrate;
+    uint16_t samples_per_frame;
+    uint16_t frame_bytes;
+    uint8_t channels;
+    uint8_t side_info_bytes;
+} mp3_frame_header_t;
+
+// Xing/Info, VBRI and LAME data found in the first frame of a file.
+typedef struct {
+    bool valid;             // Xing/Info or VBRI tag present
+    bool is_vbri;
+    bool has_toc;
+    bool has_lame;
+    uint32_t frames;        // audio frames, tag frame excluded (0 = unknown)
+    uint32_t stream_bytes;  // bytes from the tag frame to the end of audio (0 = unknown)
+    uint16_t tag_frame_bytes;
+    uint16_t enc_delay;     // LAME encoder delay, samples
+    uint16_t enc_padding;   // LAME end padding, samples
+    uint16_t samples_per_frame;
+    uint32_t sample_rate;
+    uint8_t toc[MP3_VBR_TOC_ENTRIES];
+} mp3_vbr_info_t;
+
+bool mp3_frame_header_parse(const uint8_t *hdr, mp3_frame_header_t *out);
+
+// Parse a Xing/Info/VBRI tag from the frame at `frame` (must start with sync).
+// Returns false if the frame is a plain audio frame.
+bool mp3_vbr_info_parse(const uint8_t *frame, size_t len, mp3_vbr_info_t *out);
+
+// Exact stream duration from the tag frame count, minus LAME delay/padding (0 if unknown).
+uint32_t mp3_vbr_info_duration_ms(const mp3_vbr_info_t *info);
+
+// Byte offset of `ratio` (0..1) from the tag frame, using the TOC.
+uint32_t mp3_vbr_info_seek_offset(const mp3_vbr_info_t *info, float ratio, uint32_t stream_bytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,102 @@
+#include "pcm_convert.h"
+
+#include <string.h>
+
+// Each loader yields the sample as int16 with the gain applied; 24- and 32-bit
+// samples keep their full width through the multiply.
+static inline int16_t load_u8(const uint8_t *p, int32_t gain)
+{
+    return (int16_t)((((int32_t)p[0] - 128) * 256 * gain) >> 15);
+}
+
+static inline int16_t load_s16(const uint8_t *p, int32_t gain)
+{
+    return (int16_t)(((int32_t)*(const int16_t *)p * gain) >> 15);
+}
+
+static inline int16_t load_s24(const uint8_t *p, int32_t gain)
+{
+    int32_t v = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+    return (int16_t)(((int64_t)v * gain) >> 31);
+}
+
+static inline int16_t load_s32(const uint8_t *p, int32_t gain)
+{
+    int32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (int16_t)(((int64_t)v * gain) >> 31);
+}
+
+static inline int16_t load_f32(const uint8_t *p, float scale)
+{
+    float v;
+    memcpy(&v, p, sizeof(v));
+    v *= scale;
+    if (!(v > -32768.0f)) {     // also catches NaN
+        return INT16_MIN;
+    }
+    if (v >= 32767.0f) {
+        return INT16_MAX;
+    }
+    return (int16_t)v;
+}
+
+#define PCM_CONVERT_LOOP(load, size, gain)                              \
+    do {                                                                \
+        const uint8_t *p = (const uint8_t *)in;                         \
+        if (channels == 2) {                                            \
+            for (size_t i = 0; i < frames * 2; ++i, p += (size)) {      \
+                out[i] = load(p, gain);                                 \
+            }                                                           \
+        } else {                                                        \
+            for (size_t i = 0; i < frames; ++i, p += (size)) {          \
+                int16_t v = load(p, gain);                              \
+                out[i * 2] = v;                                         \
+                out[i * 2 + 1] = v;                                     \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+size_t pcm_sample_bytes(pcm_format_t fmt)
+{
+    switch (fmt) {
+        case PCM_FMT_U8:
+            return 1;
+        case PCM_FMT_S16:
+            return 2;
+        case PCM_FMT_S24:
+            return 3;
+        case PCM_FMT_S32:
+        case PCM_FMT_F32:
+            return 4;
+    }
+    return 0;
+}
+
+void pcm_convert_block(pcm_format_t fmt, uint8_t channels, const void *in, int16_t *out, size_t frames,
+                       int32_t gain)
+{
+    switch (fmt) {
+        case PCM_FMT_U8:
+            PCM_CONVERT_LOOP(load_u8, 1, gain);
+            break;
+        case PCM_FMT_S16:
+            if (gain == PCM_GAIN_UNITY && channels == 2) {
+                memcpy(out, in, frames * 2 * sizeof(int16_t));
+                break;
+            }
+            PCM_CONVERT_LOOP(load_s16, 2, gain);
+            break;
+        case PCM_FMT_S24:
+            PCM_CONVERT_LOOP(load_s24, 3, gain);
+            break;
+        case PCM_FMT_S32:
+            PCM_CONVERT_LOOP(load_s32, 4, gain);
+            break;
+        case PCM_FMT_F32: {
+            float scale = (float)gain * (32768.0f / PCM_GAIN_UNITY);
+            PCM_CONVERT_LOOP(load_f32, 4, scale);
+            break;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Unity gain in pcm_convert_block(); volume 0..255 maps onto 0..PCM_GAIN_UNITY.
+#define PCM_GAIN_UNITY 32768
+
+typedef enum {
+    PCM_FMT_U8 = 0,
+    PCM_FMT_S16,
+    PCM_FMT_S24,    // packed 3-byte samples
+    PCM_FMT_S32,    // also 24-in-32 WAVE_FORMAT_EXTENSIBLE, which is MSB-aligned
+    PCM_FMT_F32
+} pcm_format_t;
+
+static inline int32_t pcm_gain_from_volume(uint8_t volume)
+{
+    return ((int32_t)volume * PCM_GAIN_UNITY + 127) / 255;
+}
+
+// Bytes per sample of one channel.
+size_t pcm_sample_bytes(pcm_format_t fmt);
+
+// Converts `frames` little-endian mono or stereo frames to interleaved stereo
+// int16 with the Q15 `gain` applied, in one pass: one loop per format and
+// channel count, so nothing is decided per sample. `in` must be 4-byte aligned.
+void pcm_convert_block(pcm_format_t fmt, uint8_t channels, const void *in, int16_t *out, size_t frames,
+                       int32_t gain);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,980 @@
+#include "track_catalog.h"
+
+#include "track_sort.h"
+#include "storage_sd_spi.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TRACK_CATALOG_MAGIC 0x54414354U // "TCAT"
+#define TRACK_CATALOG_VERSION 3
+#define TRACK_CATALOG_FILE STORAGE_SD_CACHE_DIR "/TRACKS.CAT"
+#define TRACK_CATALOG_TMP STORAGE_SD_CACHE_DIR "/TRACKS.TMP"
+#define TRACK_CATALOG_BLOB_TMP STORAGE_SD_CACHE_DIR "/TRACKS.BLB"
+#define TRACK_CATALOG_SORT_RUNS STORAGE_SD_CACHE_DIR "/TRACKS.RUN"
+#define TRACK_CATALOG_COPY_BYTES 512
+#define TRACK_CATALOG_MAX_DEPTH 8
+#define TRACK_CATALOG_LOOKAHEAD 64      // old folder blocks tried before a folder counts as new
+#define TRACK_CATALOG_NOTIFY_EVERY 32
+#define SORT_TAG_FILE '\x01'            // files sort ahead of subfolders
+#define SORT_TAG_DIR '\x02'
+#define SCAN_TASK_STACK 4096
+#define SCAN_TASK_PRIORITY 2
+#define SCAN_TASK_CORE 0                // decode runs on core 1
+#define SCAN_STOP_TIMEOUT_MS 5000
+#define TRACK_CATALOG_PENDING 16        // durations kept for the catalog a scan is building
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t folder_hash;
+    uint32_t count;
+    uint32_t dirs;
+    uint32_t blob_offset;
+    uint32_t blob_bytes;
+} track_catalog_header_t;
+
+// The blob holds one block per folder in walk order: this header, the path
+// relative to the root ("" for the root itself), its track names, then its
+// subfolder names. Names are in natural order and the walk follows the
+// stored subfolder list, so the whole catalog reads in album order.
+typedef struct {
+    uint32_t path_hash;
+    uint32_t sig;           // hash of track and subfolder names in readdir order
+    uint32_t first;         // index of the folder's first track record
+    uint32_t count;
+    uint32_t names_bytes;
+    uint32_t subdirs_bytes;
+    uint16_t path_len;      // including the terminator
+    uint16_t reserved;
+} track_catalog_dir_t;
+
+// Records and blob a lookup reads from: the finished catalog, or the files a
+// first scan is still appending to.
+typedef struct {
+    FILE *rec;
+    FILE *blob;
+    uint32_t blob_base;
+    uint32_t blob_bytes;
+    uint32_t count;
+} catalog_view_t;
+
+// A track by folder and name, which survive a rescan when its index does not.
+typedef struct {
+    uint32_t path_hash;
+    uint32_t name_hash;
+    uint16_t path_len;
+} catalog_key_t;
+
+typedef struct {
+    catalog_key_t key;
+    uint32_t duration_ms;
+} catalog_duration_t;
+
+static const char *TAG = "track_catalog";
+static SemaphoreHandle_t s_lock = NULL;
+static char s_folder[TRACK_CATALOG_MAX_PATH];
+static FILE *s_file = NULL;
+static track_catalog_header_t s_hdr;
+static bool s_walk_fallback = false;    // no catalog could be written: flat folder walk
+static uint32_t s_walk_count = 0;
+static track_catalog_listener_t s_listener = NULL;
+static void *s_listener_user = NULL;
+
+static TaskHandle_t s_scan_task = NULL;
+static volatile bool s_scan_stop = false;
+static FILE *s_new_rec = NULL;
+static FILE *s_new_blob = NULL;
+static uint32_t s_new_count = 0;
+static uint32_t s_new_dirs = 0;
+static uint32_t s_new_blob_bytes = 0;
+static uint32_t s_old_cursor = 0;       // blob offset of the next old folder block
+static bool s_scan_changed = false;
+static track_catalog_progress_t s_progress;
+static char s_scan_path[TRACK_CATALOG_MAX_PATH];
+static uint8_t s_copy_buf[TRACK_CATALOG_COPY_BYTES];
+static track_sort_t s_sort;
+static catalog_duration_t s_pending[TRACK_CATALOG_PENDING];   // set while a scan ran
+static uint32_t s_pending_count = 0;
+
+static void catalog_lock(void)
+{
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+}
+
+static void catalog_unlock(void)
+{
+    if (s_lock) {
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static uint32_t catalog_hash(uint32_t h, const char *s)
+{
+    // The terminator is hashed too, so "ab"+"c" and "a"+"bc" differ.
+    do {
+        h ^= (uint8_t)*s;
+        h *= 16777619U;
+    } while (*s++);
+    return h;
+}
+
+track_format_t track_catalog_detect_format(const char *name)
+{
+    size_t len = strlen(name);
+    if (len < 4) {
+        return TRACK_FMT_UNKNOWN;
+    }
+    const char *ext = name + len - 4;
+    if ((tolower((unsigned char)ext[0]) == '.') &&
+        (tolower((unsigned char)ext[1]) == 'w') &&
+        (tolower((unsigned char)ext[2]) == 'a') &&
+        (tolower((unsigned char)ext[3]) == 'v')) {
+        return TRACK_FMT_WAV;
+    }
+    if ((tolower((unsigned char)ext[0]) == '.') &&
+        (tolower((unsigned char)ext[1]) == 'm') &&
+        (tolower((unsigned char)ext[2]) == 'p') &&
+        (tolower((unsigned char)ext[3]) == '3')) {
+        return TRACK_FMT_MP3;
+    }
+    return TRACK_FMT_UNKNOWN;
+}
+
+static uint32_t catalog_record_pos(uint32_t idx)
+{
+    return (uint32_t)(sizeof(track_catalog_header_t) + (size_t)idx * sizeof(track_catalog_entry_t));
+}
+
+static bool catalog_read_at(FILE *f, uint32_t pos, void *dst, size_t len)
+{
+    return fseek(f, (long)pos, SEEK_SET) == 0 && fread(dst, 1, len, f) == len;
+}
+
+static bool catalog_write_at(FILE *f, uint32_t pos, const void *src, size_t len)
+{
+    return fseek(f, (long)pos, SEEK_SET) == 0 && fwrite(src, 1, len, f) == len;
+}
+
+static bool catalog_append(FILE *f, const void *src, size_t len)
+{
+    // Lookups move the shared position, so every append seeks back to the end.
+    return fseek(f, 0, SEEK_END) == 0 && fwrite(src, 1, len, f) == len;
+}
+
+static bool catalog_view(catalog_view_t *v)
+{
+    if (s_file) {
+        v->rec = s_file;
+        v->blob = s_file;
+        v->blob_base = s_hdr.blob_offset;
+        v->blob_bytes = s_hdr.blob_bytes;
+        v->count = s_hdr.count;
+        return true;
+    }
+    if (s_new_rec) {
+        v->rec = s_new_rec;
+        v->blob = s_new_blob;
+        v->blob_base = 0;
+        v->blob_bytes = s_new_blob_bytes;
+        v->count = s_new_count;
+        return true;
+    }
+    return false;
+}
+
+static uint32_t catalog_hash_step(uint32_t h, uint8_t c)
+{
+    return (h ^ c) * 16777619U;
+}
+
+static bool catalog_key_at(const catalog_view_t *v, uint32_t idx, catalog_key_t *key)
+{
+    track_catalog_entry_t rec;
+    track_catalog_dir_t dir;
+    if (!catalog_read_at(v->rec, catalog_record_pos(idx), &rec, sizeof(rec)) ||
+        rec.dir_off >= v->blob_bytes || rec.name_off >= v->blob_bytes ||
+        !catalog_read_at(v->blob, v->blob_base + rec.dir_off, &dir, sizeof(dir)) ||
+        fseek(v->blob, (long)(v->blob_base + rec.name_off), SEEK_SET) != 0) {
+        return false;
+    }
+    key->path_hash = dir.path_hash;
+    key->path_len = dir.path_len;
+    key->name_hash = 2166136261U;
+    for (int i = 0; i < TRACK_CATALOG_MAX_PATH; ++i) {
+        int c = fgetc(v->blob);
+        if (c == EOF) {
+            return false;
+        }
+        key->name_hash = catalog_hash_step(key->name_hash, (uint8_t)c);
+        if (c == '\0') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Index of `key` in the view: one header read per folder, then the names of
+// the matching folder.
+static bool catalog_find_key(const catalog_view_t *v, const catalog_key_t *key, uint32_t *idx)
+{
+    track_catalog_dir_t dir;
+    uint8_t buf[64];
+    uint32_t off = 0;
+    while (off + sizeof(dir) <= v->blob_bytes && catalog_read_at(v->blob, v->blob_base + off, &dir, sizeof(dir))) {
+        uint32_t names = off + (uint32_t)sizeof(dir) + dir.path_len;
+        if (dir.path_hash == key->path_hash && dir.path_len == key->path_len &&
+            fseek(v->blob, (long)(v->blob_base + names), SEEK_SET) == 0) {
+            uint32_t h = 2166136261U;
+            uint32_t i = 0;
+            for (uint32_t left = dir.names_bytes; left > 0 && i < dir.count; ) {
+                size_t n = (left > sizeof(buf)) ? sizeof(buf) : left;
+                if (fread(buf, 1, n, v->blob) != n) {
+                    return false;
+                }
+                for (size_t j = 0; j < n && i < dir.count; ++j) {
+                    h = catalog_hash_step(h, buf[j]);
+                    if (buf[j] != '\0') {
+                        continue;
+                    }
+                    if (h == key->name_hash) {
+                        *idx = dir.first + i;
+                        return true;
+                    }
+                    h = 2166136261U;
+                    i++;
+                }
+                left -= (uint32_t)n;
+            }
+        }
+        off = names + dir.names_bytes + dir.subdirs_bytes;
+    }
+    return false;
+}
+
+static bool accept_file(const struct dirent *e, size_t path_len)
+{
+    return e->d_type != DT_DIR && e->d_name[0] != '.' &&
+           track_catalog_detect_format(e->d_name) != TRACK_FMT_UNKNOWN &&
+           path_len + 1 + strlen(e->d_name) < TRACK_CATALOG_MAX_PATH;
+}
+
+static bool accept_dir(const struct dirent *e, size_t path_len, int depth)
+{
+    return e->d_type == DT_DIR && e->d_name[0] != '.' && depth + 1 < TRACK_CATALOG_MAX_DEPTH &&
+           path_len + 1 + strlen(e->d_name) < TRACK_CATALOG_MAX_PATH;
+}
+
+// Catalog-less fallback: the idx-th track in the top folder, readdir order.
+static bool catalog_walk_path(uint32_t idx, char *out, size_t len)
+{
+    DIR *dir = opendir(s_folder);
+    if (!dir) {
+        ESP_LOGW(TAG, "folder open failed: %s", s_folder);
+        return false;
+    }
+    size_t folder_len = strlen(s_folder);
+    struct dirent *entry;
+    uint32_t n = 0;
+    bool found = false;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!accept_file(entry, folder_len)) {
+            continue;
+        }
+        if (n == idx) {
+            int written = snprintf(out, len, "%s/%s", s_folder, entry->d_name);
+            found = (written > 0 && written < (int)len);
+            break;
+        }
+        n++;
+    }
+    closedir(dir);
+    return found;
+}
+
+static uint32_t catalog_walk_count(void)
+{
+    DIR *dir = opendir(s_folder);
+    if (!dir) {
+        return 0;
+    }
+    size_t folder_len = strlen(s_folder);
+    struct dirent *entry;
+    uint32_t n = 0;
+    while ((entry = readdir(dir)) != NULL && n < TRACK_CATALOG_MAX_TRACKS) {
+        if (accept_file(entry, folder_len)) {
+            n++;
+        }
+    }
+    closedir(dir);
+    return n;
+}
+
+static void catalog_notify(bool done)
+{
+    if (s_listener) {
+        s_listener(track_catalog_count(), done, s_listener_user);
+    }
+}
+
+static bool scan_begin(void)
+{
+    if (storage_sd_ensure_dir(STORAGE_SD_CACHE_DIR) != ESP_OK) {
+        return false;
+    }
+    FILE *rec = fopen(TRACK_CATALOG_TMP, "w+b");
+    FILE *blob = fopen(TRACK_CATALOG_BLOB_TMP, "w+b");
+    // Records start after the header, which is written once the walk is done.
+    track_catalog_header_t blank = {0};
+    if (!rec || !blob || fwrite(&blank, sizeof(blank), 1, rec) != 1) {
+        if (rec) {
+            fclose(rec);
+        }
+        if (blob) {
+            fclose(blob);
+        }
+        remove(TRACK_CATALOG_TMP);
+        remove(TRACK_CATALOG_BLOB_TMP);
+        return false;
+    }
+    catalog_lock();
+    s_new_rec = rec;
+    s_new_blob = blob;
+    s_new_count = 0;
+    s_new_dirs = 0;
+    s_new_blob_bytes = 0;
+    s_old_cursor = 0;
+    s_scan_changed = false;
+    catalog_unlock();
+    return true;
+}
+
+static void scan_discard(void)
+{
+    catalog_lock();
+    if (s_new_rec) {
+        fclose(s_new_rec);
+        s_new_rec = NULL;
+    }
+    if (s_new_blob) {
+        fclose(s_new_blob);
+        s_new_blob = NULL;
+    }
+    s_new_count = 0;
+    s_new_blob_bytes = 0;
+    s_pending_count = 0;
+    catalog_unlock();
+    remove(TRACK_CATALOG_TMP);
+    remove(TRACK_CATALOG_BLOB_TMP);
+}
+
+static bool scan_copy(FILE *src, uint32_t src_pos, FILE *dst, uint32_t len)
+{
+    bool ok = true;
+    while (ok && len > 0) {
+        size_t n = (len > sizeof(s_copy_buf)) ? sizeof(s_copy_buf) : len;
+        catalog_lock();
+        ok = catalog_read_at(src, src_pos, s_copy_buf, n) && catalog_append(dst, s_copy_buf, n);
+        catalog_unlock();
+        src_pos += (uint32_t)n;
+        len -= (uint32_t)n;
+    }
+    return ok;
+}
+
+static void scan_track_added(void)
+{
+    s_progress.tracks = s_new_count;
+    // Without a previous catalog the player resolves tracks from the files
+    // being written, so it can start on the first one.
+    if (!s_file && (s_new_count == 1 || s_new_count % TRACK_CATALOG_NOTIFY_EVERY == 0)) {
+        catalog_notify(false);
+    }
+}
+
+// Matching block of the previous catalog. Walk order is stable across scans,
+// so the match is normally the very next block.
+static bool scan_find_old(uint32_t path_hash, const char *rel, track_catalog_dir_t *old, uint32_t *old_off)
+{
+    if (!s_file) {
+        return false;
+    }
+    uint32_t off = s_old_cursor;
+    bool found = false;
+    catalog_lock();
+    for (int i = 0; i < TRACK_CATALOG_LOOKAHEAD && off + sizeof(*old) <= s_hdr.blob_bytes; ++i) {
+        if (!catalog_read_at(s_file, s_hdr.blob_offset + off, old, sizeof(*old))) {
+            break;
+        }
+        uint32_t next = off + (uint32_t)sizeof(*old) + old->path_len + old->names_bytes + old->subdirs_bytes;
+        if (old->path_hash == path_hash && old->path_len == strlen(rel) + 1 && old->path_len <= sizeof(s_copy_buf) &&
+            fread(s_copy_buf, 1, old->path_len, s_file) == old->path_len &&
+            memcmp(s_copy_buf, rel, old->path_len) == 0) {
+            if (i > 0) {
+                s_scan_changed = true;  // folders before it were removed
+            }
+            *old_off = off;
+            s_old_cursor = next;
+            found = true;
+            break;
+        }
+        off = next;
+    }
+    catalog_unlock();
+    return found;
+}
+
+// Unchanged folder: block and records come from the previous catalog, so
+// none of its files are stat'ed again and played durations are kept.
+static bool scan_reuse_dir(const track_catalog_dir_t *old, uint32_t old_off, uint32_t *dir_off_out)
+{
+    track_catalog_dir_t hdr = *old;
+    hdr.first = s_new_count;
+    uint32_t dir_off = s_new_blob_bytes;
+    uint32_t tail = (uint32_t)old->path_len + old->names_bytes + old->subdirs_bytes;
+    *dir_off_out = dir_off;
+
+    catalog_lock();
+    bool ok = catalog_append(s_new_blob, &hdr, sizeof(hdr));
+    catalog_unlock();
+    ok = ok && scan_copy(s_file, s_hdr.blob_offset + old_off + (uint32_t)sizeof(hdr), s_new_blob, tail);
+
+    const size_t per_chunk = sizeof(s_copy_buf) / sizeof(track_catalog_entry_t);
+    track_catalog_entry_t *recs = (track_catalog_entry_t *)s_copy_buf;
+    for (uint32_t done = 0; ok && done < old->count; ) {
+        size_t n = old->count - done;
+        if (n > per_chunk) {
+            n = per_chunk;
+        }
+        catalog_lock();
+        ok = catalog_read_at(s_file, catalog_record_pos(old->first + done), recs, n * sizeof(*recs));
+        for (size_t i = 0; ok && i < n; ++i) {
+            recs[i].name_off = dir_off + (recs[i].name_off - old_off);
+            recs[i].dir_off = dir_off;
+        }
+        ok = ok && catalog_append(s_new_rec, recs, n * sizeof(*recs));
+        catalog_unlock();
+        done += (uint32_t)n;
+    }
+    if (ok) {
+        catalog_lock();
+        s_new_blob_bytes += (uint32_t)sizeof(hdr) + tail;
+        s_new_count += old->count;
+        catalog_unlock();
+        s_progress.tracks = s_new_count;
+        s_progress.dirs_reused++;
+    }
+    return ok;
+}
+
+static bool scan_emit_track(track_catalog_dir_t *hdr, uint32_t dir_off, const char *name, size_t path_len)
+{
+    if (s_new_count >= TRACK_CATALOG_MAX_TRACKS) {
+        return true;
+    }
+    track_catalog_entry_t rec = {0};
+    rec.dir_off = dir_off;
+    rec.format = (uint8_t)track_catalog_detect_format(name);
+    size_t name_len = strlen(name) + 1;
+    s_scan_path[path_len] = '/';
+    memcpy(s_scan_path + path_len + 1, name, name_len);
+    struct stat st;
+    if (stat(s_scan_path, &st) == 0) {
+        rec.size = (uint32_t)st.st_size;
+        rec.mtime = (uint32_t)st.st_mtime;
+    }
+    s_scan_path[path_len] = '\0';
+
+    catalog_lock();
+    rec.name_off = s_new_blob_bytes;
+    bool ok = catalog_append(s_new_blob, name, name_len) && catalog_append(s_new_rec, &rec, sizeof(rec));
+    if (ok) {
+        s_new_blob_bytes += (uint32_t)name_len;
+        s_new_count++;
+        hdr->count++;
+        hdr->names_bytes += (uint32_t)name_len;
+    }
+    catalog_unlock();
+    scan_track_added();
+    return ok;
+}
+
+static bool scan_emit_subdir(track_catalog_dir_t *hdr, const char *name)
+{
+    size_t name_len = strlen(name) + 1;
+    catalog_lock();
+    bool ok = catalog_append(s_new_blob, name, name_len);
+    if (ok) {
+        s_new_blob_bytes += (uint32_t)name_len;
+        hdr->subdirs_bytes += (uint32_t)name_len;
+    }
+    catalog_unlock();
+    return ok;
+}
+
+// Tracks then subfolders in natural order. Names go through an external sort
+// (TRACK_CATALOG_SORT_RAM bytes, spilling runs to the card for big folders);
+// if that fails the folder is written in readdir order instead.
+static bool scan_emit_names(DIR *dir, track_catalog_dir_t *hdr, uint32_t dir_off, size_t path_len, int depth)
+{
+    struct dirent *e;
+    char item[TRACK_CATALOG_MAX_PATH + 1];
+    bool sorted = track_sort_begin(&s_sort, TRACK_CATALOG_SORT_RAM, TRACK_CATALOG_SORT_RUNS);
+    rewinddir(dir);
+    while (sorted && !s_scan_stop && (e = readdir(dir)) != NULL) {
+        bool is_file = accept_file(e, path_len);
+        if (!is_file && !accept_dir(e, path_len, depth)) {
+            continue;
+        }
+        item[0] = is_file ? SORT_TAG_FILE : SORT_TAG_DIR;
+        strcpy(item + 1, e->d_name);
+        sorted = track_sort_add(&s_sort, item);
+    }
+    sorted = sorted && track_sort_finish(&s_sort);
+
+    bool ok = true;
+    if (sorted) {
+        const char *name;
+        while (ok && !s_scan_stop && (name = track_sort_next(&s_sort)) != NULL) {
+            ok = (name[0] == SORT_TAG_FILE) ? scan_emit_track(hdr, dir_off, name + 1, path_len)
+                                            : scan_emit_subdir(hdr, name + 1);
+        }
+        sorted = !s_sort.failed;
+    }
+    if (!sorted && s_sort.emitted == 0) {
+        ESP_LOGW(TAG, "sort failed, readdir order: %s", s_scan_path);
+        rewinddir(dir);
+        while (ok && !s_scan_stop && (e = readdir(dir)) != NULL) {
+            if (accept_file(e, path_len)) {
+                ok = scan_emit_track(hdr, dir_off, e->d_name, path_len);
+            }
+        }
+        rewinddir(dir);
+        while (ok && !s_scan_stop && (e = readdir(dir)) != NULL) {
+            if (accept_dir(e, path_len, depth)) {
+                ok = scan_emit_subdir(hdr, e->d_name);
+            }
+        }
+    } else if (!sorted) {
+        ok = false;
+    }
+    track_sort_end(&s_sort);
+    return ok && !s_scan_stop;
+}
+
+static bool scan_emit_dir(DIR *dir, const char *rel, uint32_t path_hash, uint32_t sig, size_t path_len, int depth,
+                          uint32_t *dir_off_out)
+{
+    track_catalog_dir_t hdr = {0};
+    hdr.path_hash = path_hash;
+    hdr.sig = sig;
+    hdr.first = s_new_count;
+    hdr.path_len = (uint16_t)(strlen(rel) + 1);
+    uint32_t dir_off = s_new_blob_bytes;
+    *dir_off_out = dir_off;
+
+    catalog_lock();
+    bool ok = catalog_append(s_new_blob, &hdr, sizeof(hdr)) && catalog_append(s_new_blob, rel, hdr.path_len);
+    if (ok) {
+        s_new_blob_bytes += (uint32_t)sizeof(hdr) + hdr.path_len;
+    }
+    catalog_unlock();
+
+    ok = ok && scan_emit_names(dir, &hdr, dir_off, path_len, depth);
+
+    // Counts and name bytes are only known now.
+    catalog_lock();
+    ok = ok && catalog_write_at(s_new_blob, dir_off, &hdr, sizeof(hdr));
+    catalog_unlock();
+    return ok;
+}
+
+static bool scan_dir(size_t path_len, int depth)
+{
+    DIR *dir = opendir(s_scan_path);
+    if (!dir) {
+        ESP_LOGW(TAG, "folder open failed: %s", s_scan_path);
+        return true;
+    }
+    size_t root_len = strlen(s_folder);
+    const char *rel = (path_len > root_len) ? s_scan_path + root_len + 1 : "";
+    uint32_t path_hash = catalog_hash(2166136261U, rel);
+
+    // Names only first: one sequential directory pass decides whether the
+    // folder changed since the last catalog.
+    uint32_t sig = 2166136261U;
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        if (accept_file(e, path_len) || accept_dir(e, path_len, depth)) {
+            sig = catalog_hash(sig, e->d_name);
+        }
+    }
+
+    track_catalog_dir_t old;
+    uint32_t old_off = 0;
+    uint32_t dir_off = 0;
+    bool ok;
+    if (scan_find_old(path_hash, rel, &old, &old_off) && old.sig == sig) {
+        ok = scan_reuse_dir(&old, old_off, &dir_off);
+    } else {
+        s_scan_changed = true;
+        ok = scan_emit_dir(dir, rel, path_hash, sig, path_len, depth, &dir_off);
+    }
+    closedir(dir);
+    s_new_dirs++;
+    s_progress.dirs = s_new_dirs;
+
+    // Subfolders in the order the block stores them.
+    track_catalog_dir_t hdr;
+    catalog_lock();
+    ok = ok && catalog_read_at(s_new_blob, dir_off, &hdr, sizeof(hdr));
+    catalog_unlock();
+    uint32_t off = dir_off + (uint32_t)sizeof(hdr) + hdr.path_len + hdr.names_bytes;
+    uint32_t end = off + (ok ? hdr.subdirs_bytes : 0);
+    while (ok && !s_scan_stop && off < end) {
+        size_t room = TRACK_CATALOG_MAX_PATH - path_len - 1;
+        size_t n = (end - off < room) ? end - off : room;
+        char *name = s_scan_path + path_len + 1;
+        catalog_lock();
+        ok = catalog_read_at(s_new_blob, off, name, n);
+        catalog_unlock();
+        size_t name_len = ok ? strnlen(name, n) : n;
+        if (name_len == n) {
+            ok = false;
+            break;
+        }
+        s_scan_path[path_len] = '/';
+        ok = scan_dir(path_len + 1 + name_len, depth + 1);
+        s_scan_path[path_len] = '\0';
+        off += (uint32_t)name_len + 1;
+    }
+    return ok && !s_scan_stop;
+}
+
+// Durations played while the scan ran went to the old catalog; folders it had
+// already copied by then carry the old value. Called with the lock held.
+static void scan_apply_durations(void)
+{
+    catalog_view_t v;
+    if (s_pending_count == 0 || !catalog_view(&v)) {
+        return;
+    }
+    for (uint32_t i = 0; i < s_pending_count; ++i) {
+        track_catalog_entry_t rec;
+        uint32_t idx;
+        if (catalog_find_key(&v, &s_pending[i].key, &idx) &&
+            catalog_read_at(v.rec, catalog_record_pos(idx), &rec, sizeof(rec))) {
+            rec.duration_ms = s_pending[i].duration_ms;
+            catalog_write_at(v.rec, catalog_record_pos(idx), &rec, sizeof(rec));
+        }
+    }
+    fflush(v.rec);
+}
+
+static bool scan_finish(void)
+{
+    track_catalog_header_t hdr = {0};
+    hdr.magic = TRACK_CATALOG_MAGIC;
+    hdr.version = TRACK_CATALOG_VERSION;
+    hdr.folder_hash = catalog_hash(2166136261U, s_folder);
+    hdr.count = s_new_count;
+    hdr.dirs = s_new_dirs;
+    hdr.blob_offset = catalog_record_pos(s_new_count);
+    hdr.blob_bytes = s_new_blob_bytes;
+    if (s_file && !s_scan_changed && hdr.count == s_hdr.count && hdr.dirs == s_hdr.dirs) {
+        // Nothing moved: keep the open catalog and the durations written to it meanwhile.
+        scan_discard();
+        return true;
+    }
+
+    catalog_lock();
+    bool ok = catalog_write_at(s_new_rec, 0, &hdr, sizeof(hdr));
+    catalog_unlock();
+    ok = ok && scan_copy(s_new_blob, 0, s_new_rec, s_new_blob_bytes);
+    if (!ok) {
+        scan_discard();
+        return false;
+    }
+
+    catalog_lock();
+    fclose(s_new_blob);
+    s_new_blob = NULL;
+    ok = fclose(s_new_rec) == 0;
+    s_new_rec = NULL;
+    if (ok) {
+        if (s_file) {
+            fclose(s_file);
+            s_file = NULL;
+        }
+        remove(TRACK_CATALOG_FILE);
+        ok = rename(TRACK_CATALOG_TMP, TRACK_CATALOG_FILE) == 0;
+        s_file = ok ? fopen(TRACK_CATALOG_FILE, "r+b") : NULL;
+        if (s_file) {
+            s_hdr = hdr;
+            scan_apply_durations();
+        }
+        s_walk_fallback = false;
+    }
+    s_new_count = 0;
+    s_new_blob_bytes = 0;
+    s_pending_count = 0;
+    catalog_unlock();
+    remove(TRACK_CATALOG_BLOB_TMP);
+    remove(TRACK_CATALOG_TMP);
+    return ok && s_file != NULL;
+}
+
+static void scan_task(void *arg)
+{
+    (void)arg;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = scan_begin();
+    if (ok) {
+        strcpy(s_scan_path, s_folder);
+        ok = scan_dir(strlen(s_folder), 0) && scan_finish();
+        if (!ok) {
+            scan_discard();
+        }
+    } else if (!s_file) {
+        uint32_t n = catalog_walk_count();
+        catalog_lock();
+        s_walk_fallback = true;
+        s_walk_count = n;
+        catalog_unlock();
+        ESP_LOGW(TAG, "no catalog, %u tracks resolved by folder walk", (unsigned)n);
+    }
+    if (ok) {
+        ESP_LOGI(TAG, "scan: %u tracks in %u folders (%u unchanged) in %u ms", (unsigned)track_catalog_count(),
+                 (unsigned)s_progress.dirs, (unsigned)s_progress.dirs_reused,
+                 (unsigned)((esp_timer_get_time() - t0) / 1000));
+    } else if (!s_scan_stop) {
+        ESP_LOGW(TAG, "scan failed");
+    }
+    s_progress.scanning = false;
+    if (!s_scan_stop) {
+        catalog_notify(true);
+    }
+    s_scan_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t track_catalog_open(const char *folder)
+{
+    if (!folder || strlen(folder) >= sizeof(s_folder)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    track_catalog_close();
+    strcpy(s_folder, folder);
+
+    // The last catalog serves lookups right away; the scan checks it behind.
+    FILE *f = fopen(TRACK_CATALOG_FILE, "r+b");
+    track_catalog_header_t hdr;
+    if (f && fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+        hdr.magic == TRACK_CATALOG_MAGIC &&
+        hdr.version == TRACK_CATALOG_VERSION &&
+        hdr.folder_hash == catalog_hash(2166136261U, folder)) {
+        catalog_lock();
+        s_file = f;
+        s_hdr = hdr;
+        catalog_unlock();
+        ESP_LOGI(TAG, "%u cached tracks", (unsigned)hdr.count);
+    } else if (f) {
+        fclose(f);
+    }
+    return track_catalog_rescan();
+}
+
+esp_err_t track_catalog_rescan(void)
+{
+    if (s_scan_task || s_folder[0] == '\0') {
+        return ESP_OK;
+    }
+    memset(&s_progress, 0, sizeof(s_progress));
+    s_progress.scanning = true;
+    s_scan_stop = false;
+    if (xTaskCreatePinnedToCore(scan_task, "lib_scan", SCAN_TASK_STACK, NULL, SCAN_TASK_PRIORITY,
+                                &s_scan_task, SCAN_TASK_CORE) != pdPASS) {
+        s_scan_task = NULL;
+        s_progress.scanning = false;
+        ESP_LOGE(TAG, "scan task create failed");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void track_catalog_close(void)
+{
+    if (s_scan_task) {
+        s_scan_stop = true;
+        int retries = SCAN_STOP_TIMEOUT_MS / 10;
+        while (s_scan_task && retries-- > 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        if (s_scan_task) {
+            ESP_LOGW(TAG, "scan did not stop");
+        }
+    }
+    catalog_lock();
+    if (s_file) {
+        fclose(s_file);
+        s_file = NULL;
+    }
+    memset(&s_hdr, 0, sizeof(s_hdr));
+    s_walk_fallback = false;
+    s_walk_count = 0;
+    catalog_unlock();
+}
+
+void track_catalog_set_listener(track_catalog_listener_t cb, void *user)
+{
+    s_listener = cb;
+    s_listener_user = user;
+}
+
+void track_catalog_get_progress(track_catalog_progress_t *out)
+{
+    if (out) {
+        *out = s_progress;
+    }
+}
+
+uint32_t track_catalog_count(void)
+{
+    catalog_lock();
+    catalog_view_t v;
+    uint32_t n = catalog_view(&v) ? v.count : (s_walk_fallback ? s_walk_count : 0);
+    catalog_unlock();
+    return n;
+}
+
+bool track_catalog_entry(uint32_t idx, track_catalog_entry_t *out)
+{
+    if (!out) {
+        return false;
+    }
+    catalog_lock();
+    catalog_view_t v;
+    bool ok = catalog_view(&v) && idx < v.count && catalog_read_at(v.rec, catalog_record_pos(idx), out, sizeof(*out));
+    catalog_unlock();
+    return ok;
+}
+
+static bool catalog_compose_path(const catalog_view_t *v, uint32_t idx, char *out, size_t len)
+{
+    track_catalog_entry_t rec;
+    track_catalog_dir_t dir;
+    if (!catalog_read_at(v->rec, catalog_record_pos(idx), &rec, sizeof(rec)) ||
+        rec.dir_off >= v->blob_bytes || rec.name_off >= v->blob_bytes ||
+        !catalog_read_at(v->blob, v->blob_base + rec.dir_off, &dir, sizeof(dir))) {
+        return false;
+    }
+    int n = snprintf(out, len, "%s/", s_folder);
+    if (n <= 0 || (size_t)n + dir.path_len >= len) {
+        return false;
+    }
+    if (dir.path_len > 1) {
+        // The folder path follows its block header directly.
+        if (fread(out + n, 1, dir.path_len, v->blob) != dir.path_len) {
+            return false;
+        }
+        n += dir.path_len - 1;
+        out[n++] = '/';
+    }
+    if (fseek(v->blob, (long)(v->blob_base + rec.name_off), SEEK_SET) != 0) {
+        return false;
+    }
+    size_t got = fread(out + n, 1, len - (size_t)n, v->blob);
+    return memchr(out + n, '\0', got) != NULL;
+}
+
+bool track_catalog_path(uint32_t idx, char *out, size_t len)
+{
+    if (!out || len == 0) {
+        return false;
+    }
+    int64_t t0 = esp_timer_get_time();
+    catalog_lock();
+    catalog_view_t v;
+    bool ok = false;
+    uint32_t count = 0;
+    if (catalog_view(&v)) {
+        count = v.count;
+        ok = idx < v.count && catalog_compose_path(&v, idx, out, len);
+    } else if (s_walk_fallback) {
+        count = s_walk_count;
+        ok = idx < s_walk_count && catalog_walk_path(idx, out, len);
+    }
+    catalog_unlock();
+    if (ok) {
+        ESP_LOGD(TAG, "track %u of %u resolved in %u us", (unsigned)idx, (unsigned)count,
+                 (unsigned)(esp_timer_get_time() - t0));
+    }
+    return ok;
+}
+
+void track_catalog_set_duration(uint32_t idx, uint32_t duration_ms)
+{
+    catalog_lock();
+    catalog_view_t v;
+    track_catalog_entry_t rec;
+    uint32_t pos = catalog_record_pos(idx);
+    if (catalog_view(&v) && idx < v.count && catalog_read_at(v.rec, pos, &rec, sizeof(rec)) &&
+        rec.duration_ms != duration_ms) {
+        rec.duration_ms = duration_ms;
+        if (!catalog_write_at(v.rec, pos, &rec, sizeof(rec))) {
+            ESP_LOGW(TAG, "duration update failed for %u", (unsigned)idx);
+        }
+        fflush(v.rec);
+        // A scan replacing this catalog may have copied the track already.
+        if (s_file && s_scan_task) {
+            catalog_duration_t *d = (s_pending_count < TRACK_CATALOG_PENDING) ? &s_pending[s_pending_count] : NULL;
+            if (d && catalog_key_at(&v, idx, &d->key)) {
+                d->duration_ms = duration_ms;
+                s_pending_count++;
+            }
+        }
+    }
+    catalog_unlock();
+}
+
+bool track_catalog_find(const char *path, uint32_t *idx)
+{
+    size_t folder_len = strlen(s_folder);
+    if (!path || !idx || strncmp(path, s_folder, folder_len) != 0 || path[folder_len] != '/') {
+        return false;
+    }
+    const char *rel = path + folder_len + 1;
+    const char *slash = strrchr(rel, '/');
+    size_t rel_len = slash ? (size_t)(slash - rel) : 0;
+    const char *name = slash ? slash + 1 : rel;
+    catalog_key_t key = {.path_hash = 2166136261U, .path_len = (uint16_t)(rel_len + 1)};
+    for (size_t i = 0; i < rel_len; ++i) {
+        key.path_hash = catalog_hash_step(key.path_hash, (uint8_t)rel[i]);
+    }
+    key.path_hash = catalog_hash_step(key.path_hash, 0);
+    key.name_hash = catalog_hash(2166136261U, name);
+
+    char found[TRACK_CATALOG_MAX_PATH];
+    catalog_lock();
+    catalog_view_t v;
+    // Hashes pick the candidate, the composed path confirms it.
+    bool ok = catalog_view(&v) && catalog_find_key(&v, &key, idx) && *idx < v.count &&
+              catalog_compose_path(&v, *idx, found, sizeof(found)) && strcmp(found, path) == 0;
+    catalog_unlock();
+    return ok;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACK_CATALOG_MAX_TRACKS 65535U
+#define TRACK_CATALOG_MAX_PATH 160
+// RAM for sorting one folder's names; bigger folders spill sorted runs to the card.
+#ifndef TRACK_CATALOG_SORT_RAM
+#define TRACK_CATALOG_SORT_RAM 8192
+#endif
+
+typedef enum {
+    TRACK_FMT_UNKNOWN = 0,
+    TRACK_FMT_WAV,
+    TRACK_FMT_MP3
+} track_format_t;
+
+// One fixed-size record per track; folder paths and names live in a blob
+// after the records, so index -> path costs the same at any library size.
+typedef struct {
+    uint32_t name_off;      // file name, into the blob
+    uint32_t dir_off;       // folder block, into the blob
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t duration_ms;   // 0 until the track has been played through
+    uint8_t format;         // track_format_t
+    uint8_t reserved[3];
+} track_catalog_entry_t;
+
+typedef struct {
+    bool scanning;
+    uint32_t dirs;          // folders visited so far
+    uint32_t dirs_reused;   // unchanged folders copied from the previous catalog
+    uint32_t tracks;        // tracks found so far
+} track_catalog_progress_t;
+
+// Called from the scanner task: as tracks appear while there is no previous
+// catalog to serve from, and once with done=true when a scan ends.
+typedef void (*track_catalog_listener_t)(uint32_t count, bool done, void *user);
+
+track_format_t track_catalog_detect_format(const char *name);
+
+// Serves lookups from the last catalog in STORAGE_SD_CACHE_DIR at once and
+// starts a low-priority scan of `folder` and its subfolders that replaces it
+// when anything changed. Tracks are ordered by folder, then name, comparing
+// numbers by value ("2 Intro" before "10 Outro"). Folders whose listing is unchanged are copied from
+// the old catalog without touching their files. If no catalog can be
+// written, lookups fall back to walking the top folder.
+esp_err_t track_catalog_open(const char *folder);
+// Starts another scan unless one is running.
+esp_err_t track_catalog_rescan(void);
+// Stops a running scan and closes the catalog.
+void track_catalog_close(void);
+void track_catalog_set_listener(track_catalog_listener_t cb, void *user);
+void track_catalog_get_progress(track_catalog_progress_t *out);
+uint32_t track_catalog_count(void);
+bool track_catalog_entry(uint32_t idx, track_catalog_entry_t *out);
+bool track_catalog_path(uint32_t idx, char *out, size_t len);
+// Keeps the length of a played-through track. One set while a scan runs is
+// carried over into the catalog that scan writes.
+void track_catalog_set_duration(uint32_t idx, uint32_t duration_ms);
+// Index of the track at `path` (as track_catalog_path() builds it); indices
+// shift when a rescan adds or removes tracks before it.
+bool track_catalog_find(const char *path, uint32_t *idx);
+
+#ifdef __cplusplus
+}
+#endif
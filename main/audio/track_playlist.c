@@ -0,0 +1,289 @@
+#include "track_playlist.h"
+
+#include "track_catalog.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define TRACK_PLAYLIST_ROOT "/sdcard"
+#define PLAYLIST_LINE_MAX 256
+#define PLAYLIST_FIRST_ALLOC 64
+#define PLAYLIST_MISSING 0x80000000U    // offset flag: the entry could not be played
+
+typedef struct {
+    uint32_t offset;    // start of the entry's line in the playlist file
+    uint32_t hash;      // of the resolved path, to catch a playlist edited since
+} playlist_entry_t;
+
+static const char *TAG = "track_playlist";
+static SemaphoreHandle_t s_lock = NULL;
+static char s_path[TRACK_CATALOG_MAX_PATH];
+static char s_dir[TRACK_CATALOG_MAX_PATH];
+static playlist_entry_t *s_entries = NULL;
+static uint32_t s_count = 0;
+
+static void playlist_lock(void)
+{
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    }
+}
+
+static void playlist_unlock(void)
+{
+    if (s_lock) {
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static uint32_t playlist_hash(const char *s)
+{
+    uint32_t h = 2166136261U;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+bool track_playlist_is_playlist(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (!dot || strchr(dot, '/')) {
+        return false;
+    }
+    return strcasecmp(dot, ".m3u") == 0 || strcasecmp(dot, ".m3u8") == 0;
+}
+
+// Collapses "//", "." and ".." in an absolute path, in place. Fails if ".."
+// would climb above the root.
+static bool playlist_normalize(char *path)
+{
+    char *w = path;
+    const char *r = path;
+    while (*r) {
+        while (*r == '/') {
+            r++;
+        }
+        if (!*r) {
+            break;
+        }
+        const char *seg = r;
+        while (*r && *r != '/') {
+            r++;
+        }
+        size_t n = (size_t)(r - seg);
+        if (n == 1 && seg[0] == '.') {
+            continue;
+        }
+        if (n == 2 && seg[0] == '.' && seg[1] == '.') {
+            if (w == path) {
+                return false;
+            }
+            while (w > path && *--w != '/') {
+            }
+            continue;
+        }
+        *w++ = '/';
+        memmove(w, seg, n);
+        w += n;
+    }
+    if (w == path) {
+        *w++ = '/';
+    }
+    *w = '\0';
+    return true;
+}
+
+// Turns one playlist line into a card path; false for comments, blank
+// lines, URLs and anything the player cannot play. `line` is modified.
+static bool playlist_entry_path(char *line, char *out, size_t len)
+{
+    size_t n = strlen(line);
+    while (n > 0 && isspace((unsigned char)line[n - 1])) {
+        line[--n] = '\0';
+    }
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (line[0] == '\0' || line[0] == '#' || strstr(line, "://")) {
+        return false;
+    }
+    for (char *p = line; *p; ++p) {
+        if (*p == '\\') {
+            *p = '/';
+        }
+    }
+    // Playlists written on Windows: "C:/Music/a.mp3" is taken from the card root.
+    if (isalpha((unsigned char)line[0]) && line[1] == ':' && line[2] == '/') {
+        line += 2;
+    }
+
+    int w;
+    if (line[0] != '/') {
+        w = snprintf(out, len, "%s/%s", s_dir, line);
+    } else if (strncmp(line, TRACK_PLAYLIST_ROOT "/", sizeof(TRACK_PLAYLIST_ROOT)) == 0) {
+        w = snprintf(out, len, "%s", line);
+    } else {
+        w = snprintf(out, len, "%s%s", TRACK_PLAYLIST_ROOT, line);
+    }
+    if (w < 0 || (size_t)w >= len || !playlist_normalize(out)) {
+        return false;
+    }
+    return strncmp(out, TRACK_PLAYLIST_ROOT "/", sizeof(TRACK_PLAYLIST_ROOT)) == 0 &&
+           track_catalog_detect_format(out) != TRACK_FMT_UNKNOWN;
+}
+
+// Reads one line into `buf`; returns the bytes it took in the file (0 at
+// EOF). A line that does not fit is consumed whole and comes back empty.
+static size_t playlist_read_line(FILE *f, char *buf, size_t size)
+{
+    if (!fgets(buf, (int)size, f)) {
+        return 0;
+    }
+    size_t used = strlen(buf);
+    if (used > 0 && buf[used - 1] != '\n' && !feof(f)) {
+        int c;
+        while ((c = fgetc(f)) != EOF) {
+            used++;
+            if (c == '\n') {
+                break;
+            }
+        }
+        buf[0] = '\0';
+    }
+    return used;
+}
+
+static bool playlist_add(uint32_t *cap, uint32_t offset, uint32_t hash)
+{
+    if (s_count == *cap) {
+        uint32_t grow = *cap ? *cap * 2 : PLAYLIST_FIRST_ALLOC;
+        if (grow > TRACK_PLAYLIST_MAX_ENTRIES) {
+            grow = TRACK_PLAYLIST_MAX_ENTRIES;
+        }
+        if (grow == *cap) {
+            return false;
+        }
+        playlist_entry_t *e = realloc(s_entries, grow * sizeof(*e));
+        if (!e) {
+            return false;
+        }
+        s_entries = e;
+        *cap = grow;
+    }
+    s_entries[s_count].offset = offset;
+    s_entries[s_count].hash = hash;
+    s_count++;
+    return true;
+}
+
+esp_err_t track_playlist_open(const char *path)
+{
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    track_playlist_close();
+    if (!path || strlen(path) >= sizeof(s_path) || path[0] != '/') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGW(TAG, "open failed: %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    playlist_lock();
+    strcpy(s_path, path);
+    strcpy(s_dir, path);
+    *strrchr(s_dir, '/') = '\0';
+
+    char line[PLAYLIST_LINE_MAX];
+    char resolved[TRACK_CATALOG_MAX_PATH];
+    uint32_t cap = 0;
+    uint32_t offset = 0;
+    uint32_t skipped = 0;
+    size_t used;
+    while ((used = playlist_read_line(f, line, sizeof(line))) > 0) {
+        char *entry = line;
+        if (offset == 0 && strncmp(entry, "\xEF\xBB\xBF", 3) == 0) {
+            entry += 3;     // UTF-8 BOM
+        }
+        if (playlist_entry_path(entry, resolved, sizeof(resolved))) {
+            if (!playlist_add(&cap, offset, playlist_hash(resolved))) {
+                ESP_LOGW(TAG, "index full at %u entries", (unsigned)s_count);
+                break;
+            }
+        } else if (entry[0] != '\0' && entry[0] != '#') {
+            skipped++;
+        }
+        offset += (uint32_t)used;
+    }
+    fclose(f);
+    ESP_LOGI(TAG, "%s: %u entries, %u skipped, %u bytes of index", path, (unsigned)s_count,
+             (unsigned)skipped, (unsigned)(cap * sizeof(playlist_entry_t)));
+    playlist_unlock();
+    return ESP_OK;
+}
+
+void track_playlist_close(void)
+{
+    playlist_lock();
+    free(s_entries);
+    s_entries = NULL;
+    s_count = 0;
+    s_path[0] = '\0';
+    playlist_unlock();
+}
+
+uint32_t track_playlist_count(void)
+{
+    playlist_lock();
+    uint32_t count = s_count;
+    playlist_unlock();
+    return count;
+}
+
+bool track_playlist_path(uint32_t idx, char *out, size_t len)
+{
+    playlist_lock();
+    if (idx >= s_count || (s_entries[idx].offset & PLAYLIST_MISSING)) {
+        playlist_unlock();
+        return false;
+    }
+    bool ok = false;
+    FILE *f = fopen(s_path, "rb");
+    if (f) {
+        char line[PLAYLIST_LINE_MAX];
+        char *entry = line;
+        if (fseek(f, (long)s_entries[idx].offset, SEEK_SET) == 0 && playlist_read_line(f, line, sizeof(line)) > 0) {
+            if (s_entries[idx].offset == 0 && strncmp(entry, "\xEF\xBB\xBF", 3) == 0) {
+                entry += 3;
+            }
+            ok = playlist_entry_path(entry, out, len) && playlist_hash(out) == s_entries[idx].hash;
+        }
+        fclose(f);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "entry %u unreadable; playlist changed?", (unsigned)idx);
+    }
+    playlist_unlock();
+    return ok;
+}
+
+void track_playlist_mark_missing(uint32_t idx)
+{
+    playlist_lock();
+    if (idx < s_count) {
+        s_entries[idx].offset |= PLAYLIST_MISSING;
+    }
+    playlist_unlock();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TRACK_PLAYLIST_MAX_ENTRIES
+#define TRACK_PLAYLIST_MAX_ENTRIES 1024
+#endif
+
+// True for names ending in .m3u or .m3u8.
+bool track_playlist_is_playlist(const char *path);
+
+// Indexes an M3U/M3U8 file in one streaming pass: each playable entry keeps
+// the byte offset of its line and a hash of its resolved path (8 bytes), so
+// entry -> path is one seek and one line read. Relative entries resolve
+// against the playlist's folder, absolute ones against the card root;
+// comments, URLs and unsupported formats are left out.
+esp_err_t track_playlist_open(const char *path);
+void track_playlist_close(void);
+uint32_t track_playlist_count(void);
+// False if the entry is out of range, known missing, or the playlist
+// changed since it was indexed.
+bool track_playlist_path(uint32_t idx, char *out, size_t len);
+// Remembers that an entry could not be played; later lookups skip the card.
+void track_playlist_mark_missing(uint32_t idx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+#include "track_shuffle.h"
+
+// Full-period LCG step and its inverse (multiplier inverse mod 2^32).
+#define SEED_MUL 1664525U
+#define SEED_MUL_INV 0xFEE058C5U
+#define SEED_INC 1013904223U
+
+static uint32_t mix32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t feistel_round(const track_shuffle_t *s, int round, uint32_t half)
+{
+    return mix32(half ^ s->keys[round]) & ((1U << s->half_bits) - 1U);
+}
+
+static uint32_t feistel_fwd(const track_shuffle_t *s, uint32_t x)
+{
+    uint32_t mask = (1U << s->half_bits) - 1U;
+    uint32_t l = x >> s->half_bits;
+    uint32_t r = x & mask;
+    for (int i = 0; i < TRACK_SHUFFLE_ROUNDS; ++i) {
+        uint32_t t = l ^ feistel_round(s, i, r);
+        l = r;
+        r = t;
+    }
+    return (l << s->half_bits) | r;
+}
+
+static uint32_t feistel_inv(const track_shuffle_t *s, uint32_t x)
+{
+    uint32_t mask = (1U << s->half_bits) - 1U;
+    uint32_t l = x >> s->half_bits;
+    uint32_t r = x & mask;
+    for (int i = TRACK_SHUFFLE_ROUNDS - 1; i >= 0; --i) {
+        uint32_t t = r ^ feistel_round(s, i, l);
+        r = l;
+        l = t;
+    }
+    return (l << s->half_bits) | r;
+}
+
+void track_shuffle_init(track_shuffle_t *s, uint32_t count, uint32_t seed)
+{
+    s->count = count;
+    s->seed = seed;
+    // Domain 2^(2*half_bits) is under 4 * count, so cycle walking takes
+    // fewer than four passes through the network on average.
+    uint8_t bits = 2;
+    while (bits < 32 && (1ULL << bits) < count) {
+        bits += 2;
+    }
+    s->half_bits = bits / 2;
+    uint32_t k = seed;
+    for (int i = 0; i < TRACK_SHUFFLE_ROUNDS; ++i) {
+        k += 0x9E3779B9U;
+        s->keys[i] = mix32(k);
+    }
+}
+
+uint32_t track_shuffle_at(const track_shuffle_t *s, uint32_t pos)
+{
+    if (s->count < 2 || pos >= s->count) {
+        return pos;
+    }
+    uint32_t x = pos;
+    do {
+        x = feistel_fwd(s, x);
+    } while (x >= s->count);
+    return x;
+}
+
+uint32_t track_shuffle_pos(const track_shuffle_t *s, uint32_t track)
+{
+    if (s->count < 2 || track >= s->count) {
+        return track;
+    }
+    uint32_t x = track;
+    do {
+        x = feistel_inv(s, x);
+    } while (x >= s->count);
+    return x;
+}
+
+uint32_t track_shuffle_next_seed(uint32_t seed)
+{
+    return seed * SEED_MUL + SEED_INC;
+}
+
+uint32_t track_shuffle_prev_seed(uint32_t seed)
+{
+    return (seed - SEED_INC) * SEED_MUL_INV;
+}
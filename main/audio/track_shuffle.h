@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Eight rounds: fewer leave small libraries (a dozen tracks) visibly biased.
+#define TRACK_SHUFFLE_ROUNDS 8
+
+// Seeded permutation of [0, count) evaluated on demand: a Feistel
+// network over the next even power of two, cycle-walked back into range.
+// Needs no per-track memory and maps both ways, so a shuffled position is
+// fully described by (seed, count, position).
+typedef struct {
+    uint32_t count;
+    uint32_t seed;
+    uint8_t half_bits;
+    uint32_t keys[TRACK_SHUFFLE_ROUNDS];
+} track_shuffle_t;
+
+void track_shuffle_init(track_shuffle_t *s, uint32_t count, uint32_t seed);
+// Track at shuffled position `pos`.
+uint32_t track_shuffle_at(const track_shuffle_t *s, uint32_t pos);
+// Shuffled position of `track`; inverse of track_shuffle_at().
+uint32_t track_shuffle_pos(const track_shuffle_t *s, uint32_t track);
+// Seed of the pass after / before `seed` (an invertible step, so going back
+// across a wrap needs no history).
+uint32_t track_shuffle_next_seed(uint32_t seed);
+uint32_t track_shuffle_prev_seed(uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,348 @@
+#include "track_sort.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACK_SORT_MIN_CHUNK 256    // a reader chunk must hold the longest item
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+int track_sort_natural_cmp(const char *a, const char *b)
+{
+    const char *a0 = a;
+    const char *b0 = b;
+    int zeros = 0;  // "T01" vs "T1": equal by value, decided last
+    while (*a && *b) {
+        if (is_digit(*a) && is_digit(*b)) {
+            const char *za = a;
+            const char *zb = b;
+            while (*a == '0') {
+                a++;
+            }
+            while (*b == '0') {
+                b++;
+            }
+            if (zeros == 0) {
+                zeros = (int)(a - za) - (int)(b - zb);
+            }
+            size_t la = 0;
+            size_t lb = 0;
+            while (is_digit(a[la])) {
+                la++;
+            }
+            while (is_digit(b[lb])) {
+                lb++;
+            }
+            if (la != lb) {
+                return (la < lb) ? -1 : 1;
+            }
+            int d = memcmp(a, b, la);
+            if (d != 0) {
+                return d;
+            }
+            a += la;
+            b += lb;
+            continue;
+        }
+        int ca = tolower((unsigned char)*a);
+        int cb = tolower((unsigned char)*b);
+        if (ca != cb) {
+            return ca - cb;
+        }
+        a++;
+        b++;
+    }
+    if (*a || *b) {
+        return *a ? 1 : -1;
+    }
+    if (zeros != 0) {
+        return zeros;
+    }
+    return strcmp(a0, b0);
+}
+
+static uint32_t *sort_offsets(track_sort_t *s)
+{
+    return (uint32_t *)(s->mem + s->mem_size) - s->items;
+}
+
+static int sort_cmp_at(const track_sort_t *s, uint32_t x, uint32_t y)
+{
+    return track_sort_natural_cmp((const char *)s->mem + x, (const char *)s->mem + y);
+}
+
+static void sort_sift(const track_sort_t *s, uint32_t *v, uint32_t root, uint32_t n)
+{
+    for (;;) {
+        uint32_t child = 2 * root + 1;
+        if (child >= n) {
+            return;
+        }
+        if (child + 1 < n && sort_cmp_at(s, v[child], v[child + 1]) < 0) {
+            child++;
+        }
+        if (sort_cmp_at(s, v[root], v[child]) >= 0) {
+            return;
+        }
+        uint32_t t = v[root];
+        v[root] = v[child];
+        v[child] = t;
+        root = child;
+    }
+}
+
+// Heapsort: in place and without recursion, for the scanner's small stack.
+static void sort_items(track_sort_t *s)
+{
+    uint32_t *v = sort_offsets(s);
+    uint32_t n = s->items;
+    for (uint32_t i = n / 2; i-- > 0; ) {
+        sort_sift(s, v, i, n);
+    }
+    for (uint32_t i = n; i-- > 1; ) {
+        uint32_t t = v[0];
+        v[0] = v[i];
+        v[i] = t;
+        sort_sift(s, v, 0, i);
+    }
+}
+
+static bool sort_write_at_end(track_sort_t *s, const void *src, size_t len)
+{
+    return fseek(s->runs, 0, SEEK_END) == 0 && fwrite(src, 1, len, s->runs) == len;
+}
+
+// Each run on the card: a 32-bit byte length, then the items in order.
+static bool sort_flush_run(track_sort_t *s)
+{
+    if (s->items == 0) {
+        return true;
+    }
+    if (!s->runs) {
+        s->runs = fopen(s->run_path, "w+b");
+        if (!s->runs) {
+            return false;
+        }
+    }
+    sort_items(s);
+    uint32_t *v = sort_offsets(s);
+    uint32_t len = (uint32_t)s->used;
+    bool ok = sort_write_at_end(s, &len, sizeof(len));
+    for (uint32_t i = 0; ok && i < s->items; ++i) {
+        const char *item = (const char *)s->mem + v[i];
+        ok = fwrite(item, 1, strlen(item) + 1, s->runs) == strlen(item) + 1;
+    }
+    s->used = 0;
+    s->items = 0;
+    s->run_count++;
+    return ok;
+}
+
+bool track_sort_begin(track_sort_t *s, size_t ram_budget, const char *run_path)
+{
+    memset(s, 0, sizeof(*s));
+    if (ram_budget < TRACK_SORT_MIN_RAM) {
+        ram_budget = TRACK_SORT_MIN_RAM;
+    }
+    s->mem_size = ram_budget & ~(size_t)3;
+    s->mem = malloc(s->mem_size);
+    if (!s->mem) {
+        return false;
+    }
+    s->run_path = run_path;
+    // One chunk per reader plus one for the output of intermediate merges.
+    size_t chunks = s->mem_size / TRACK_SORT_MIN_CHUNK;
+    s->fanin = (uint16_t)((chunks - 1 > TRACK_SORT_MAX_FANIN) ? TRACK_SORT_MAX_FANIN : chunks - 1);
+    size_t chunk = s->mem_size / (s->fanin + 1U);
+    s->chunk = (uint16_t)((chunk > 32768) ? 32768 : chunk);
+    return true;
+}
+
+bool track_sort_add(track_sort_t *s, const char *item)
+{
+    size_t len = strlen(item) + 1;
+    if (s->failed || len + sizeof(uint32_t) > TRACK_SORT_MIN_CHUNK) {
+        s->failed = true;
+        return false;
+    }
+    if (s->used + len + (s->items + 1U) * sizeof(uint32_t) > s->mem_size && !sort_flush_run(s)) {
+        s->failed = true;
+        return false;
+    }
+    memcpy(s->mem + s->used, item, len);
+    s->items++;
+    sort_offsets(s)[0] = (uint32_t)s->used;
+    s->used += len;
+    s->total++;
+    return true;
+}
+
+// Makes sure the reader's current item is complete in its buffer.
+static bool reader_fill(track_sort_t *s, track_sort_reader_t *r)
+{
+    if (memchr(r->buf + r->head, '\0', r->fill - r->head)) {
+        return true;
+    }
+    memmove(r->buf, r->buf + r->head, r->fill - r->head);
+    r->fill = (uint16_t)(r->fill - r->head);
+    r->head = 0;
+    uint32_t n = r->end - r->pos;
+    if (n > (uint32_t)(s->chunk - r->fill)) {
+        n = s->chunk - r->fill;
+    }
+    if (n > 0) {
+        if (fseek(s->runs, (long)r->pos, SEEK_SET) != 0 || fread(r->buf + r->fill, 1, n, s->runs) != n) {
+            return false;
+        }
+        r->pos += n;
+        r->fill = (uint16_t)(r->fill + n);
+    }
+    // Either a whole item is buffered now or the run is used up.
+    return r->fill == 0 || memchr(r->buf, '\0', r->fill) != NULL;
+}
+
+static const char *reader_item(const track_sort_reader_t *r)
+{
+    return (r->head < r->fill) ? (const char *)r->buf + r->head : NULL;
+}
+
+static bool reader_advance(track_sort_t *s, track_sort_reader_t *r)
+{
+    r->head = (uint16_t)(r->head + strlen((const char *)r->buf + r->head) + 1);
+    return reader_fill(s, r);
+}
+
+// Readers over the `n` runs starting at run_head.
+static bool sort_open_readers(track_sort_t *s, uint32_t n)
+{
+    uint32_t pos = s->run_head;
+    for (uint32_t i = 0; i < n; ++i) {
+        track_sort_reader_t *r = &s->readers[i];
+        uint32_t len;
+        if (fseek(s->runs, (long)pos, SEEK_SET) != 0 || fread(&len, sizeof(len), 1, s->runs) != 1) {
+            return false;
+        }
+        r->pos = pos + (uint32_t)sizeof(len);
+        r->end = r->pos + len;
+        r->head = 0;
+        r->fill = 0;
+        r->buf = s->mem + (size_t)i * s->chunk;
+        if (!reader_fill(s, r)) {
+            return false;
+        }
+        pos = r->end;
+    }
+    s->run_head = pos;
+    s->nreaders = (uint8_t)n;
+    return true;
+}
+
+static int sort_pick(const track_sort_t *s)
+{
+    int best = -1;
+    for (int i = 0; i < s->nreaders; ++i) {
+        const char *item = reader_item(&s->readers[i]);
+        if (item && (best < 0 || track_sort_natural_cmp(item, reader_item(&s->readers[best])) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Merges the first fan-in runs into one run appended at the end of the file.
+static bool sort_merge_pass(track_sort_t *s)
+{
+    uint32_t n = s->fanin;
+    if (!sort_open_readers(s, n) || fseek(s->runs, 0, SEEK_END) != 0) {
+        return false;
+    }
+    long out_start = ftell(s->runs);
+    uint32_t len = 0;
+    if (out_start < 0 || fwrite(&len, sizeof(len), 1, s->runs) != 1) {
+        return false;
+    }
+    uint8_t *out = s->mem + (size_t)n * s->chunk;
+    size_t out_fill = 0;
+    bool ok = true;
+    int best;
+    while (ok && (best = sort_pick(s)) >= 0) {
+        track_sort_reader_t *r = &s->readers[best];
+        const char *item = reader_item(r);
+        size_t item_len = strlen(item) + 1;
+        if (out_fill + item_len > s->chunk) {
+            ok = sort_write_at_end(s, out, out_fill);
+            len += (uint32_t)out_fill;
+            out_fill = 0;
+        }
+        memcpy(out + out_fill, item, item_len);
+        out_fill += item_len;
+        ok = ok && reader_advance(s, r);
+    }
+    ok = ok && sort_write_at_end(s, out, out_fill);
+    len += (uint32_t)out_fill;
+    ok = ok && fseek(s->runs, out_start, SEEK_SET) == 0 && fwrite(&len, sizeof(len), 1, s->runs) == 1;
+    s->nreaders = 0;
+    s->run_count -= n - 1;
+    return ok;
+}
+
+bool track_sort_finish(track_sort_t *s)
+{
+    if (s->failed) {
+        return false;
+    }
+    if (s->run_count == 0) {
+        sort_items(s);
+        return true;
+    }
+    bool ok = sort_flush_run(s);
+    while (ok && s->run_count > s->fanin) {
+        ok = sort_merge_pass(s);
+    }
+    ok = ok && sort_open_readers(s, s->run_count);
+    s->failed = !ok;
+    return ok;
+}
+
+const char *track_sort_next(track_sort_t *s)
+{
+    if (s->failed || s->emitted >= s->total) {
+        return NULL;
+    }
+    if (!s->runs) {
+        // Everything fit in RAM: the offsets are in order already.
+        const uint32_t *v = sort_offsets(s);
+        return (const char *)s->mem + v[s->emitted++];
+    }
+    // The previous item stays put until now, so its pointer stayed valid.
+    if (s->emitted > 0) {
+        track_sort_reader_t *r = &s->readers[s->last];
+        if (!reader_advance(s, r)) {
+            s->failed = true;
+            return NULL;
+        }
+    }
+    int best = sort_pick(s);
+    if (best < 0) {
+        s->failed = true;
+        return NULL;
+    }
+    s->last = (uint8_t)best;
+    s->emitted++;
+    return reader_item(&s->readers[best]);
+}
+
+void track_sort_end(track_sort_t *s)
+{
+    if (s->runs) {
+        fclose(s->runs);
+        s->runs = NULL;
+        remove(s->run_path);
+    }
+    free(s->mem);
+    s->mem = NULL;
+}
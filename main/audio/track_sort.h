@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACK_SORT_MAX_FANIN 16
+#define TRACK_SORT_MIN_RAM 1024
+
+typedef struct {
+    uint32_t pos;           // next unread byte of the run in the run file
+    uint32_t end;
+    uint16_t head;          // current item in buf
+    uint16_t fill;
+    uint8_t *buf;
+} track_sort_reader_t;
+
+// External merge sort of NUL-terminated strings in natural order under a
+// fixed RAM budget. Items collect in RAM; once the budget is full they are
+// sorted and written out as a run, and runs are merged (several passes if
+// there are more than the fan-in) when the sorted order is read back. Small
+// sets never touch the card.
+typedef struct {
+    uint8_t *mem;
+    size_t mem_size;
+    size_t used;            // item bytes packed from the front
+    uint32_t items;         // offsets packed from the back
+    const char *run_path;
+    FILE *runs;
+    uint32_t run_head;      // file offset of the first run not merged yet
+    uint32_t run_count;
+    uint32_t total;
+    uint32_t emitted;
+    uint16_t fanin;
+    uint16_t chunk;         // reader buffer size during merges
+    track_sort_reader_t readers[TRACK_SORT_MAX_FANIN];
+    uint8_t nreaders;
+    uint8_t last;           // reader of the item handed out last
+    bool failed;
+} track_sort_t;
+
+// Compares digit runs by value ("T2" < "T10") and letters case-insensitively.
+int track_sort_natural_cmp(const char *a, const char *b);
+
+// `run_path` is only created if the items outgrow `ram_budget` bytes.
+bool track_sort_begin(track_sort_t *s, size_t ram_budget, const char *run_path);
+bool track_sort_add(track_sort_t *s, const char *item);
+// Ends input; items then come back in order from track_sort_next().
+bool track_sort_finish(track_sort_t *s);
+// NULL when done or on a read error (check s->failed). The string stays
+// valid until the next call.
+const char *track_sort_next(track_sort_t *s);
+void track_sort_end(track_sort_t *s);
+
+#ifdef __cplusplus
+}
+#endif
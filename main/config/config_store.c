@@ -48,8 +48,9 @@ void config_set_defaults(app_config_t *cfg)
     strncpy(cfg->tz, "UTC0", sizeof(cfg->tz) - 1);
     strncpy(cfg->bt_name, "ClockAudio", sizeof(cfg->bt_name) - 1);
     cfg->volume = 15;
-    cfg->eq_low = 15;
-    cfg->eq_high = 15;
+    cfg->eq_low = APP_EQ_STEP_CENTER;
+    cfg->eq_high = APP_EQ_STEP_CENTER;
+    memset(cfg->eq_mid, APP_EQ_STEP_CENTER, sizeof(cfg->eq_mid));
     cfg->display_brightness = 255;
     cfg->alarm_hour = 7;
     cfg->alarm_min = 0;
@@ -61,6 +62,8 @@ void config_set_defaults(app_config_t *cfg)
     cfg->power_save_enabled = false;
     cfg->ui_mode = 0;
     cfg->web_enabled = false;
+    cfg->loudness_enabled = false;
+    cfg->crossfade_ms = 0;
 }
 
 esp_err_t config_store_init(void)
@@ -79,11 +82,16 @@ esp_err_t config_store_init(void)
     if (s_cfg.volume > APP_VOLUME_MAX) {
         s_cfg.volume = app_volume_steps_from_byte(s_cfg.volume);
     }
-    if (s_cfg.eq_low > 30) {
-        s_cfg.eq_low = 15;
+    if (s_cfg.eq_low > APP_EQ_STEP_MAX) {
+        s_cfg.eq_low = APP_EQ_STEP_CENTER;
     }
-    if (s_cfg.eq_high > 30) {
-        s_cfg.eq_high = 15;
+    if (s_cfg.eq_high > APP_EQ_STEP_MAX) {
+        s_cfg.eq_high = APP_EQ_STEP_CENTER;
+    }
+    for (size_t i = 0; i < sizeof(s_cfg.eq_mid); ++i) {
+        if (s_cfg.eq_mid[i] > APP_EQ_STEP_MAX) {
+            s_cfg.eq_mid[i] = APP_EQ_STEP_CENTER;
+        }
     }
     if (s_cfg.alarm_mode > 2) {
         s_cfg.alarm_mode = 2;
@@ -103,6 +111,12 @@ esp_err_t config_store_init(void)
     if (s_cfg.web_enabled != true && s_cfg.web_enabled != false) {
         s_cfg.web_enabled = false;
     }
+    if (s_cfg.loudness_enabled != true && s_cfg.loudness_enabled != false) {
+        s_cfg.loudness_enabled = false;
+    }
+    if (s_cfg.crossfade_ms > APP_CROSSFADE_MAX_MS) {
+        s_cfg.crossfade_ms = 0;
+    }
     return ESP_OK;
 }
 
@@ -114,6 +128,20 @@ void config_store_get(app_config_t *out)
     *out = s_cfg;
 }
 
+uint8_t *config_eq_step(app_config_t *cfg, uint8_t band, uint8_t band_count)
+{
+    if (!cfg || band >= band_count || band_count > APP_EQ_BANDS_MAX) {
+        return NULL;
+    }
+    if (band == 0) {
+        return &cfg->eq_low;
+    }
+    if (band == band_count - 1) {
+        return &cfg->eq_high;
+    }
+    return &cfg->eq_mid[band - 1];
+}
+
 esp_err_t config_store_update(const app_config_t *in)
 {
     if (!in) {
@@ -8,6 +8,12 @@
 extern "C" {
 #endif
 
+#define APP_EQ_BANDS_MAX 5
+#define APP_EQ_STEP_MAX 30
+#define APP_EQ_STEP_CENTER 15
+#define APP_CROSSFADE_STEP_MS 2000
+#define APP_CROSSFADE_MAX_MS 10000
+
 typedef struct {
     char wifi_ssid[32];
     char wifi_pass[64];
@@ -27,12 +33,20 @@ typedef struct {
     uint8_t ui_mode;
     uint8_t alarm_repeat;
     bool web_enabled;
+    // Appended so blobs saved before it still load; bands between eq_low and
+    // eq_high when the EQ has more than two.
+    uint8_t eq_mid[APP_EQ_BANDS_MAX - 2];
+    bool loudness_enabled;          // output compressor for small speakers
+    uint16_t crossfade_ms;          // overlap of consecutive MP3 tracks, 0 = gapless
 } app_config_t;
 
 esp_err_t config_store_init(void);
 void config_set_defaults(app_config_t *cfg);
 void config_store_get(app_config_t *out);
 esp_err_t config_store_update(const app_config_t *in);
+// Step of EQ band `band` out of `band_count`: the first is eq_low, the last
+// eq_high, the rest eq_mid. NULL when out of range.
+uint8_t *config_eq_step(app_config_t *cfg, uint8_t band, uint8_t band_count);
 
 #ifdef __cplusplus
 }
@@ -16,7 +16,7 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 
-#include "audio_owner.h"
+#include "audio_mixer.h"
 #include "audio_pcm5102.h"
 #include "audio_spectrum.h"
 #include "bt_app_core.h"
@@ -385,7 +385,7 @@ static void bt_i2s_task_handler(void *arg)
             if (s_bt_i2s_stop_requested) {
                 break;
             }
-            if (audio_owner_get() != AUDIO_OWNER_BT) {
+            if (!audio_mixer_is_open(AUDIO_SOURCE_BT)) {
                 vTaskDelay(pdMS_TO_TICKS(10));
                 continue;
             }
@@ -429,7 +429,8 @@ static void bt_i2s_task_handler(void *arg)
                         bt_app_core_set_mute(true);
                     }
                     size_t silence_written = 0;
-                    audio_i2s_write(s_silence_chunk, sizeof(s_silence_chunk), &silence_written, BT_I2S_WRITE_TIMEOUT_MS);
+                    audio_mixer_write(AUDIO_SOURCE_BT, s_silence_chunk, sizeof(s_silence_chunk), &silence_written,
+                                      BT_I2S_WRITE_TIMEOUT_MS);
                     vTaskDelay(pdMS_TO_TICKS(2));
                     continue;
                 }
@@ -445,20 +446,12 @@ static void bt_i2s_task_handler(void *arg)
 #endif
                 }
 
-                uint8_t vol = audio_get_volume();
-                if (vol < 255 && item_size >= sizeof(int16_t)) {
-                    int16_t *samples = (int16_t *)data;
-                    size_t count = item_size / sizeof(int16_t);
-                    for (size_t i = 0; i < count; ++i) {
-                        samples[i] = (int16_t)(((int32_t)samples[i] * vol) / 255);
-                    }
-                }
-
                 bytes_written = 0;
-                esp_err_t err = audio_i2s_write(data, item_size, &bytes_written, BT_I2S_WRITE_TIMEOUT_MS);
+                esp_err_t err = audio_mixer_write(AUDIO_SOURCE_BT, data, item_size, &bytes_written,
+                                                  BT_I2S_WRITE_TIMEOUT_MS);
                 if (err != ESP_OK || bytes_written == 0) {
                     bt_app_core_inc_error();
-                    audio_i2s_reset();
+                    audio_mixer_flush(AUDIO_SOURCE_BT);
                     ESP_LOGE(BT_APP_CORE_TAG, "i2s write failed: %s (%d), bytes=%u",
                              esp_err_to_name(err), err, (unsigned)bytes_written);
                     if (s_ringbuf_mutex && xSemaphoreTake(s_ringbuf_mutex, portMAX_DELAY) == pdTRUE) {
@@ -577,24 +570,24 @@ bool bt_i2s_task_is_running(void)
 
 void bt_i2s_task_start_up(void)
 {
-    if (!audio_owner_acquire(AUDIO_OWNER_BT, false)) {
-        ESP_LOGW(BT_APP_CORE_TAG, "BtI2STask start skipped (audio owner busy)");
+    if (!audio_mixer_open(AUDIO_SOURCE_BT)) {
+        ESP_LOGW(BT_APP_CORE_TAG, "BtI2STask start skipped (mixer not running)");
         return;
     }
     audio_spectrum_reset();
     s_bt_i2s_stop_requested = false;
     if (!bt_ringbuf_ensure_init()) {
         ESP_LOGW(BT_APP_CORE_TAG, "BtI2STask start skipped (ringbuffer init failed)");
-        audio_owner_release(AUDIO_OWNER_BT);
+        audio_mixer_close(AUDIO_SOURCE_BT);
         return;
     }
-    audio_i2s_reset();
+    audio_mixer_flush(AUDIO_SOURCE_BT);
     if (!s_i2s_write_semaphore) {
         s_i2s_write_semaphore = xSemaphoreCreateBinary();
     }
     if (!s_i2s_write_semaphore) {
         ESP_LOGE(BT_APP_CORE_TAG, "%s, semaphore create failed", __func__);
-        audio_owner_release(AUDIO_OWNER_BT);
+        audio_mixer_close(AUDIO_SOURCE_BT);
         return;
     }
     if (xSemaphoreTake(s_ringbuf_mutex, portMAX_DELAY) == pdTRUE) {
@@ -615,7 +608,7 @@ void bt_i2s_task_start_up(void)
         if (created != pdPASS) {
             ESP_LOGE(BT_APP_CORE_TAG, "BtI2STask create failed");
             s_bt_i2s_task_handle = NULL;
-            audio_owner_release(AUDIO_OWNER_BT);
+            audio_mixer_close(AUDIO_SOURCE_BT);
             return;
         }
     }
@@ -640,12 +633,11 @@ void bt_i2s_task_shut_down(void)
             ESP_LOGW(BT_APP_CORE_TAG, "BtI2STask stop timeout, leaving task running");
         }
     }
-    audio_i2s_write_silence(50);
     if (!s_bt_i2s_task_handle && s_i2s_write_semaphore) {
         vSemaphoreDelete(s_i2s_write_semaphore);
         s_i2s_write_semaphore = NULL;
     }
-    audio_owner_release(AUDIO_OWNER_BT);
+    audio_mixer_close(AUDIO_SOURCE_BT);
 }
 
 size_t write_ringbuf(const uint8_t *data, size_t size)
@@ -7,6 +7,8 @@
 #include "esp_vfs_fat.h"
 #include "ff.h"
 #include "sdmmc_cmd.h"
+#include <errno.h>
+#include <sys/stat.h>
 
 static const char *TAG = "storage_sd";
 static const char *MOUNT_POINT = "/sdcard";
@@ -48,7 +50,7 @@ esp_err_t storage_sd_init(void)
 
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
         .format_if_mount_failed = false,
-        .max_files = 4,
+        .max_files = 6,     // playing + pre-opened track, index sidecar, track catalog, config
         .allocation_unit_size = 16 * 1024
     };
 
@@ -114,3 +116,18 @@ esp_err_t storage_sd_get_space_mb(uint32_t *free_mb, uint32_t *total_mb)
     return ESP_OK;
 }
 
+esp_err_t storage_sd_ensure_dir(const char *path)
+{
+    if (!s_card || !path) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return S_ISDIR(st.st_mode) ? ESP_OK : ESP_FAIL;
+    }
+    if (mkdir(path, 0775) != 0 && errno != EEXIST) {
+        ESP_LOGW(TAG, "mkdir %s failed: errno=%d", path, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -8,10 +8,14 @@
 extern "C" {
 #endif
 
+// Directory for player caches (8.3 names only: FATFS is built without LFN).
+#define STORAGE_SD_CACHE_DIR "/sdcard/cache"
+
 esp_err_t storage_sd_init(void);
 void storage_sd_unmount(void);
 bool storage_sd_is_mounted(void);
 esp_err_t storage_sd_get_space_mb(uint32_t *free_mb, uint32_t *total_mb);
+esp_err_t storage_sd_ensure_dir(const char *path);
 
 #ifdef __cplusplus
 }
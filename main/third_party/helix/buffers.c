@@ -141,6 +141,70 @@ MP3DecInfo *AllocateBuffers(void)
 	return mp3DecInfo;
 }
 
+/**************************************************************************************
+ * Function:    ResetBuffers
+ *
+ * Description: return all decoder state to its freshly allocated (zeroed) form
+ *                without releasing any memory, so one instance can be reused
+ *                across streams
+ *
+ * Inputs:      pointer to MP3DecInfo structure from AllocateBuffers
+ *
+ * Outputs:     cleared buffers, sub-structure pointers preserved
+ *
+ * Return:      none
+ **************************************************************************************/
+void ResetBuffers(MP3DecInfo *mp3DecInfo)
+{
+	MP3DecInfo saved;
+
+	if (!mp3DecInfo)
+		return;
+
+	saved = *mp3DecInfo;
+	ClearBuffer(mp3DecInfo, sizeof(MP3DecInfo));
+	mp3DecInfo->FrameHeaderPS =     saved.FrameHeaderPS;
+	mp3DecInfo->SideInfoPS =        saved.SideInfoPS;
+	mp3DecInfo->ScaleFactorInfoPS = saved.ScaleFactorInfoPS;
+	mp3DecInfo->HuffmanInfoPS =     saved.HuffmanInfoPS;
+	mp3DecInfo->DequantInfoPS =     saved.DequantInfoPS;
+	mp3DecInfo->IMDCTInfoPS =       saved.IMDCTInfoPS;
+	mp3DecInfo->SubbandInfoPS =     saved.SubbandInfoPS;
+
+	ClearBuffer(mp3DecInfo->FrameHeaderPS,     sizeof(FrameHeader));
+	ClearBuffer(mp3DecInfo->SideInfoPS,        sizeof(SideInfo));
+	ClearBuffer(mp3DecInfo->ScaleFactorInfoPS, sizeof(ScaleFactorInfo));
+	ClearBuffer(mp3DecInfo->HuffmanInfoPS,     sizeof(HuffmanInfo));
+	ClearBuffer(mp3DecInfo->DequantInfoPS,     sizeof(DequantInfo));
+	ClearBuffer(mp3DecInfo->IMDCTInfoPS,       sizeof(IMDCTInfo));
+	ClearBuffer(mp3DecInfo->SubbandInfoPS,     sizeof(SubbandInfo));
+}
+
+/**************************************************************************************
+ * Function:    BuffersSize
+ *
+ * Description: bytes AllocateBuffers requests, each allocation rounded up to align
+ *
+ * Inputs:      allocation alignment in bytes (power of 2)
+ *
+ * Outputs:     none
+ *
+ * Return:      total size in bytes
+ **************************************************************************************/
+int BuffersSize(int align)
+{
+	int sizes[8] = {
+		sizeof(MP3DecInfo), sizeof(FrameHeader), sizeof(SideInfo), sizeof(ScaleFactorInfo),
+		sizeof(HuffmanInfo), sizeof(DequantInfo), sizeof(IMDCTInfo), sizeof(SubbandInfo)
+	};
+	int i, total = 0;
+
+	for (i = 0; i < 8; i++)
+		total += (sizes[i] + align - 1) & ~(align - 1);
+
+	return total;
+}
+
 #define SAFE_FREE(x)	{if (x)	helix_free(x);	(x) = 0;}	/* helper macro */
 
 /**************************************************************************************
@@ -116,6 +116,9 @@
 #define	quadTable			STATNAME(quadTable)
 #define	quadTabOffset		STATNAME(quadTabOffset)
 #define	quadTabMaxBits		STATNAME(quadTabMaxBits)
+#define	huffFastTable		STATNAME(huffFastTable)
+#define	huffFastOffset		STATNAME(huffFastOffset)
+#define	quadFastTable		STATNAME(quadFastTable)
 
 /* map these to the corresponding 2-bit values in the frame header */
 typedef enum {
@@ -281,6 +284,21 @@ extern const unsigned char quadTable[64+16];
 extern const int quadTabOffset[2];
 extern const int quadTabMaxBits[2];
 
+/* hufftabs_fast.c - generated at build time by gen_hufftabs_fast.py:
+ *   one 8-bit lookup resolves a whole codeword plus its sign bits, entries
+ *   without the valid bit fall back to the tables above
+ */
+#ifndef HELIX_HUFF_FAST
+#define HELIX_HUFF_FAST 0
+#endif
+#if HELIX_HUFF_FAST
+#define HUFF_FAST_BITS		8
+#define HUFF_FAST_VALID		0x8000
+extern const unsigned short huffFastTable[];
+extern const short huffFastOffset[HUFF_PAIRTABS];
+extern const unsigned short quadFastTable[2 << HUFF_FAST_BITS];
+#endif
+
 /* polyphase.c (or asmpoly.s)
  * some platforms require a C++ compile of all source files,
  * so if we're compiling C as C++ and using native assembly
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Generate 8-bit first-level Huffman lookup tables for huffman.c.
+
+Reads the packed Helix tables in hufftabs.c and, for every 8-bit prefix,
+simulates the reference decoder (see DecodeHuffmanPairs/DecodeHuffmanQuads).
+When the codeword and its sign bits fit in those 8 bits the whole result is
+stored in one entry; anything longer, and any linbits escape, is marked
+invalid so huffman.c falls back to the original table walk.
+
+Usage: gen_hufftabs_fast.py <hufftabs.c> <output.c>
+"""
+
+import re
+import sys
+
+FAST_BITS = 8
+VALID = 0x8000
+
+# Pair entry: [15] valid, [13:10] bits used, [9] y sign, [8] x sign, [7:4] y, [3:0] x
+# Quad entry: [15] valid, [11:8] bits used, [7:4] v/w/x/y signs, [3:0] v/w/x/y
+
+
+def parse(path):
+    src = open(path).read()
+
+    body = re.search(r"huffTable\[\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    subtabs = {}
+    for m in re.finditer(r"/\*\s*huffTable(\d+)\[(\d+)\]\s*\*/([^/]*)", body):
+        vals = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", m.group(3))]
+        if len(vals) != int(m.group(2)):
+            sys.exit("huffTable%s: expected %s entries, got %d" % (m.group(1), m.group(2), len(vals)))
+        subtabs[int(m.group(1))] = vals
+
+    offs = re.search(r"huffTabOffset\[HUFF_PAIRTABS\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    tab_of_idx = []
+    for tok in [t.strip() for t in offs.split(",") if t.strip()]:
+        m = re.match(r"HUFF_OFFSET_(\d+)", tok)
+        tab_of_idx.append(int(m.group(1)) if m else None)
+
+    look = re.search(r"huffTabLookup\[HUFF_PAIRTABS\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    lookup = [(int(a), b) for a, b in re.findall(r"\{\s*(\d+)\s*,\s*(\w+)\s*\}", look)]
+
+    quad = re.search(r"quadTable\[64\+16\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    quad_vals = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", quad)]
+
+    if len(tab_of_idx) != 32 or len(lookup) != 32 or len(quad_vals) != 80:
+        sys.exit("unexpected hufftabs.c layout")
+    return subtabs, tab_of_idx, lookup, quad_vals
+
+
+def top_bits(cache, n):
+    return (cache >> (32 - n)) & ((1 << n) - 1)
+
+
+def pair_entry(tab, tab_type, escape15, prefix):
+    cache = prefix << (32 - FAST_BITS)
+    used = 0
+    if tab_type == "oneShot":
+        max_bits = tab[0] & 0xF
+        cw = tab[1 + top_bits(cache, max_bits)]
+    else:
+        curr = 0
+        while True:
+            max_bits = tab[curr] & 0xF
+            cw = tab[curr + top_bits(cache, max_bits) + 1]
+            if (cw >> 12) & 0xF:
+                break
+            used += max_bits
+            if used > FAST_BITS:
+                return 0
+            cache = (cache << max_bits) & 0xFFFFFFFF
+            curr += cw
+    length = (cw >> 12) & 0xF
+    used += length
+    cache = (cache << length) & 0xFFFFFFFF
+    x = (cw >> 4) & 0xF
+    y = (cw >> 8) & 0xF
+    if escape15 and (x == 15 or y == 15):
+        return 0
+    sx = sy = 0
+    if x:
+        sx = cache >> 31
+        cache = (cache << 1) & 0xFFFFFFFF
+        used += 1
+    if y:
+        sy = cache >> 31
+        used += 1
+    if used > FAST_BITS:
+        return 0
+    return VALID | (used << 10) | (sy << 9) | (sx << 8) | (y << 4) | x
+
+
+def quad_entry(tab, max_bits, prefix):
+    cache = prefix << (32 - FAST_BITS)
+    cw = tab[top_bits(cache, max_bits)]
+    length = (cw >> 4) & 0xF
+    used = length
+    cache = (cache << length) & 0xFFFFFFFF
+    vals = [(cw >> 3) & 1, (cw >> 2) & 1, (cw >> 1) & 1, cw & 1]   # v, w, x, y
+    mags = 0
+    signs = 0
+    for i, v in enumerate(vals):
+        if v:
+            mags |= 1 << i
+            signs |= (cache >> 31) << i
+            cache = (cache << 1) & 0xFFFFFFFF
+            used += 1
+    if used > FAST_BITS:
+        return 0
+    return VALID | (used << 8) | (signs << 4) | mags
+
+
+def emit_array(out, ctype, name, vals, fmt, per_line=8):
+    out.append("const %s %s[%d] = {" % (ctype, name, len(vals)))
+    for i in range(0, len(vals), per_line):
+        out.append("\t" + " ".join((fmt % v) + "," for v in vals[i:i + per_line]))
+    out.append("};")
+    out.append("")
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    subtabs, tab_of_idx, lookup, quad_vals = parse(sys.argv[1])
+
+    fast = []
+    fast_offset = []
+    built = {}
+    for idx in range(32):
+        tab_type = lookup[idx][1]
+        tab_no = tab_of_idx[idx]
+        if tab_type not in ("oneShot", "loopNoLinbits", "loopLinbits") or tab_no is None:
+            fast_offset.append(-1)
+            continue
+        key = (tab_no, tab_type == "loopLinbits")
+        if key not in built:
+            built[key] = len(fast)
+            tab = subtabs[tab_no]
+            fast.extend(pair_entry(tab, tab_type, key[1], p) for p in range(1 << FAST_BITS))
+        fast_offset.append(built[key])
+
+    quad = []
+    for base, max_bits in ((0, 6), (64, 4)):
+        quad.extend(quad_entry(quad_vals[base:], max_bits, p) for p in range(1 << FAST_BITS))
+
+    hits = sum(1 for v in fast if v & VALID)
+    out = [
+        "/* Generated by gen_hufftabs_fast.py from hufftabs.c - do not edit. */",
+        "/* %d of %d pair entries and %d of %d quad entries resolve in one lookup. */"
+        % (hits, len(fast), sum(1 for v in quad if v & VALID), len(quad)),
+        "",
+        '#include "coder.h"',
+        "",
+        "#if HELIX_HUFF_FAST",
+        "",
+    ]
+    emit_array(out, "unsigned short", "huffFastTable", fast, "0x%04x")
+    out.append("const short huffFastOffset[HUFF_PAIRTABS] = {")
+    for i in range(0, 32, 8):
+        out.append("\t" + " ".join("%d," % v for v in fast_offset[i:i + 8]))
+    out.append("};")
+    out.append("")
+    emit_array(out, "unsigned short", "quadFastTable", quad, "0x%04x")
+    out.append("#endif /* HELIX_HUFF_FAST */")
+
+    with open(sys.argv[2], "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -59,6 +59,16 @@
 /* apply sign of s to the positive number x (save in MSB, will do two's complement in dequant) */
 #define ApplySign(x, s)	{ (x) |= ((s) & 0x80000000); }
 
+#if HELIX_HUFF_FAST
+/* fast pair entry: [13:10] bits used, [9] y sign, [8] x sign, [7:4] y, [3:0] x */
+#define GetFastLen(e)	((int)(((e) >> 10) & 0x0f))
+#define GetFastX(e)		((int)((e) & 0x0f) | (int)(((unsigned int)(e) & 0x0100) << 23))
+#define GetFastY(e)		((int)(((e) >> 4) & 0x0f) | (int)(((unsigned int)(e) & 0x0200) << 22))
+/* fast quad entry: [11:8] bits used, [7:4] signs, [3:0] nonzero flags (bit 0 = v ... bit 3 = y) */
+#define GetFastLenQ(e)	((int)(((e) >> 8) & 0x0f))
+#define GetFastQ(e, i)	((int)(((e) >> (i)) & 0x01) | (int)((((unsigned int)(e) >> (4 + (i))) & 0x01) << 31))
+#endif
+
 /**************************************************************************************
  * Function:    DecodeHuffmanPairs
  *
@@ -87,6 +97,10 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 	HuffTabType tabType;
 	unsigned short cw, *tBase, *tCurr;
 	unsigned int cache;
+#if HELIX_HUFF_FAST
+	const unsigned short *fBase;
+	unsigned short fe;
+#endif
 
 	if(nVals <= 0) 
 		return 0;
@@ -98,6 +112,9 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 	tBase = (unsigned short *)(huffTable + huffTabOffset[tabIdx]);
 	linBits = huffTabLookup[tabIdx].linBits;
 	tabType = huffTabLookup[tabIdx].tabType;
+#if HELIX_HUFF_FAST
+	fBase = huffFastTable + (huffFastOffset[tabIdx] < 0 ? 0 : huffFastOffset[tabIdx]);
+#endif
 
 	ASSERT(!(nVals & 0x01));
 	ASSERT(tabIdx < HUFF_PAIRTABS);
@@ -146,6 +163,20 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 
 			/* largest maxBits = 9, plus 2 for sign bits, so make sure cache has at least 11 bits */
 			while (nVals > 0 && cachedBits >= 11 ) {
+#if HELIX_HUFF_FAST
+				fe = fBase[cache >> (32 - HUFF_FAST_BITS)];
+				if (fe & HUFF_FAST_VALID) {
+					len = GetFastLen(fe);
+					cachedBits -= len;
+					cache <<= len;
+					if (cachedBits < padBits)
+						return -1;
+					*xy++ = GetFastX(fe);
+					*xy++ = GetFastY(fe);
+					nVals -= 2;
+					continue;
+				}
+#endif
 				cw = tBase[cache >> (32 - maxBits)];
 				len = GetHLen(cw);
 				cachedBits -= len;
@@ -191,6 +222,22 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 
 			/* largest maxBits = 9, plus 2 for sign bits, so make sure cache has at least 11 bits */
 			while (nVals > 0 && cachedBits >= 11 ) {
+#if HELIX_HUFF_FAST
+				if (tCurr == tBase) {
+					fe = fBase[cache >> (32 - HUFF_FAST_BITS)];
+					if (fe & HUFF_FAST_VALID) {
+						len = GetFastLen(fe);
+						cachedBits -= len;
+						cache <<= len;
+						if (cachedBits < padBits)
+							return -1;
+						*xy++ = GetFastX(fe);
+						*xy++ = GetFastY(fe);
+						nVals -= 2;
+						continue;
+					}
+				}
+#endif
 				maxBits = GetMaxbits(tCurr[0]);
 				cw = tCurr[(cache >> (32 - maxBits)) + 1];
 				len = GetHLen(cw);
@@ -290,6 +337,10 @@ static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, un
 	int len, maxBits, cachedBits, padBits;
 	unsigned int cache;
 	unsigned char cw, *tBase;
+#if HELIX_HUFF_FAST
+	const unsigned short *fBase = quadFastTable + (tabIdx << HUFF_FAST_BITS);
+	unsigned short fe;
+#endif
 
 	if (bitsLeft <= 0)
 		return 0;
@@ -328,6 +379,22 @@ static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, un
 
 		/* largest maxBits = 6, plus 4 for sign bits, so make sure cache has at least 10 bits */
 		while (i < (nVals - 3) && cachedBits >= 10 ) {
+#if HELIX_HUFF_FAST
+			fe = fBase[cache >> (32 - HUFF_FAST_BITS)];
+			if (fe & HUFF_FAST_VALID) {
+				len = GetFastLenQ(fe);
+				cachedBits -= len;
+				cache <<= len;
+				if (cachedBits < padBits)
+					return i;
+				*vwxy++ = GetFastQ(fe, 0);
+				*vwxy++ = GetFastQ(fe, 1);
+				*vwxy++ = GetFastQ(fe, 2);
+				*vwxy++ = GetFastQ(fe, 3);
+				i += 4;
+				continue;
+			}
+#endif
 			cw = tBase[cache >> (32 - maxBits)];
 			len = GetHLenQ(cw);
 			cachedBits -= len;
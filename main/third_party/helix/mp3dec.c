@@ -44,6 +44,7 @@
 #include "string.h"
 //#include "hlxclib/string.h"		/* for memmove, memcpy (can replace with different implementations if desired) */
 #include "mp3common.h"	/* includes mp3dec.h (public API) and internal, platform-independent API */
+#include "helix_shim.h"	/* optional per-stage cycle counters (HELIX_MP3_PROFILE) */
 
 
 //#define PROFILE
@@ -94,6 +95,38 @@ void MP3FreeDecoder(HMP3Decoder hMP3Decoder)
 	FreeBuffers(mp3DecInfo);
 }
 
+/**************************************************************************************
+ * Function:    MP3ResetDecoder
+ *
+ * Description: reset a decoder instance for a new stream without reallocating
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *
+ * Outputs:     none
+ *
+ * Return:      none
+ **************************************************************************************/
+void MP3ResetDecoder(HMP3Decoder hMP3Decoder)
+{
+	ResetBuffers((MP3DecInfo *)hMP3Decoder);
+}
+
+/**************************************************************************************
+ * Function:    MP3DecoderBytes
+ *
+ * Description: memory one MP3InitDecoder call takes from helix_malloc
+ *
+ * Inputs:      allocation alignment in bytes (power of 2)
+ *
+ * Outputs:     none
+ *
+ * Return:      total size in bytes
+ **************************************************************************************/
+int MP3DecoderBytes(int align)
+{
+	return BuffersSize(align);
+}
+
 /**************************************************************************************
  * Function:    MP3FindSyncWord
  *
@@ -293,6 +326,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 	#ifdef PROFILE
 	long time;
 	#endif
+	HELIX_PROFILE_VAR(stageTime);
 
 	if (!mp3DecInfo)
 		return ERR_MP3_NULL_POINTER;
@@ -423,7 +457,9 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			#endif
 			/* decode Huffman code words */
 			prevBitOffset = bitOffset;
+			HELIX_PROFILE_BEGIN(stageTime);
 			offset = DecodeHuffman(mp3DecInfo, mainPtr, &bitOffset, huffBlockBits, gr, ch);
+			HELIX_PROFILE_END(stageTime, HELIX_STAGE_HUFFMAN);
 			if (offset < 0) {
 				MP3ClearBadFrame(mp3DecInfo, outbuf);
 				return ERR_MP3_INVALID_HUFFCODES;
@@ -441,10 +477,12 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			time = systime_get();
 		#endif
 		/* dequantize coefficients, decode stereo, reorder short blocks */
+		HELIX_PROFILE_BEGIN(stageTime);
 		if (Dequantize(mp3DecInfo, gr) < 0) {
 			MP3ClearBadFrame(mp3DecInfo, outbuf);
 			return ERR_MP3_INVALID_DEQUANTIZE;			
 		}
+		HELIX_PROFILE_END(stageTime, HELIX_STAGE_DEQUANT);
 		#ifdef PROFILE
 			time = systime_get() - time;
 			printf("Dequantize: %i ms\n", time);
@@ -456,10 +494,12 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 		#ifdef PROFILE
 			time = systime_get();
 		#endif
+			HELIX_PROFILE_BEGIN(stageTime);
 			if (IMDCT(mp3DecInfo, gr, ch) < 0) {
 				MP3ClearBadFrame(mp3DecInfo, outbuf);
 				return ERR_MP3_INVALID_IMDCT;			
 			}
+			HELIX_PROFILE_END(stageTime, HELIX_STAGE_IMDCT);
 		#ifdef PROFILE
 			time = systime_get() - time;
 			printf("IMDCT: %i ms\n", time);
@@ -470,10 +510,12 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			time = systime_get();
 		#endif
 		/* subband transform - if stereo, interleaves pcm LRLRLR */
+		HELIX_PROFILE_BEGIN(stageTime);
 		if (Subband(mp3DecInfo, outbuf + gr*mp3DecInfo->nGranSamps*mp3DecInfo->nChans) < 0) {
 			MP3ClearBadFrame(mp3DecInfo, outbuf);
 			return ERR_MP3_INVALID_SUBBAND;			
 		}
+		HELIX_PROFILE_END(stageTime, HELIX_STAGE_SUBBAND);
 		#ifdef PROFILE
 			time = systime_get() - time;
 			printf("Subband: %i ms\n", time);
@@ -65,6 +65,8 @@
 #define	UnpackSideInfo		STATNAME(UnpackSideInfo)
 #define	AllocateBuffers		STATNAME(AllocateBuffers)
 #define	FreeBuffers			STATNAME(FreeBuffers)
+#define	ResetBuffers		STATNAME(ResetBuffers)
+#define	BuffersSize			STATNAME(BuffersSize)
 #define	DecodeHuffman		STATNAME(DecodeHuffman)
 #define	Dequantize			STATNAME(Dequantize)
 #define	IMDCT				STATNAME(IMDCT)
@@ -0,0 +1,125 @@
+// Decoder contexts across track changes without PSRAM. Player mode opens the
+// next track while the current one plays, so two contexts are in use at each
+// change; both must come from the arena, not from the heap. Runs the real
+// wrapper over a first-fit model of internal RAM (esp_heap_caps.h) with the
+// rest of the firmware allocating and freeing small blocks in between, and
+// over 100 changes the largest free block must not drop below its low point
+// over the first ten.
+//
+//   arena_check [-v] [-n changes]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "helix_mp3_wrapper.h"
+#include "helix_shim.h"
+#include "host_corpus.h"
+
+#define CHECK_HEAP_BYTES (160 * 1024)   // internal RAM left for player mode, roughly
+#define CHECK_WARMUP 10                 // changes the reference low point is taken over
+#define CHECK_OTHER_LIVE 6              // small blocks the rest of the firmware holds
+#define CHECK_MAX_HELIX_HEAP 1024       // per-track state besides the context
+
+static const char *s_tracks[] = {
+    "cbr128_44k_js.mp3", "vbr_48k_st.mp3", "cbr320_44k_st.mp3", "cbr96_32k_js.mp3", "vbr_44k_js.mp3",
+};
+
+static bool s_verbose = false;
+static void *s_other[CHECK_OTHER_LIVE];
+// Another task drops its oldest block and takes a new one the same size, so
+// whatever the wrapper leaves behind is all that can fragment the heap.
+static void other_churn(int step)
+{
+    int slot = step % CHECK_OTHER_LIVE;
+    heap_caps_free(s_other[slot]);
+    s_other[slot] = heap_caps_malloc(48 + 80 * (size_t)slot, MALLOC_CAP_DEFAULT);
+}
+
+int main(int argc, char **argv)
+{
+    int changes = 100;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            changes = atoi(argv[++i]);
+        }
+    }
+    if (changes <= CHECK_WARMUP) {
+        changes = CHECK_WARMUP + 1;
+    }
+    host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int nfiles = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    size_t ntracks = sizeof(s_tracks) / sizeof(s_tracks[0]);
+    char paths[sizeof(s_tracks) / sizeof(s_tracks[0])][256];
+    for (size_t t = 0; t < ntracks; ++t) {
+        const host_corpus_file_t *cf = host_corpus_find(files, nfiles, s_tracks[t]);
+        if (!cf) {
+            printf("arena_check: %s missing from the corpus\n", s_tracks[t]);
+            return 1;
+        }
+        host_corpus_path(cf, paths[t], sizeof(paths[t]));
+    }
+
+    host_heap_model(CHECK_HEAP_BYTES);
+    size_t before = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (helix_mp3_arena_init() != ESP_OK) {
+        printf("arena_check: FAILED (no arena in %u bytes)\n", (unsigned)CHECK_HEAP_BYTES);
+        return 1;
+    }
+    size_t arena = helix_shim_arena_used();
+    size_t helix_base = helix_shim_heap_in_use();
+    helix_shim_reset_stats();
+
+    bool ok = true;
+    size_t reference = 0;
+    size_t lowest = SIZE_MAX;
+    uint32_t allocs_from = 0;
+    helix_mp3_source_t *playing = helix_mp3_open(paths[0], 0.0f);
+    ok &= playing != NULL;
+    for (int c = 0; c < changes && ok; ++c) {
+        // Pre-open the next track while this one plays, then switch over.
+        helix_mp3_source_t *next = helix_mp3_open(paths[(c + 1) % ntracks], 0.0f);
+        ok &= next != NULL;
+        other_churn(c);
+        helix_mp3_close(playing);
+        playing = next;
+        other_churn(c + CHECK_OTHER_LIVE / 2);
+        size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (c < CHECK_WARMUP) {
+            reference = (c == 0 || largest < reference) ? largest : reference;
+            allocs_from = host_heap_model_allocs();
+        } else if (largest < lowest) {
+            lowest = largest;
+        }
+        if (s_verbose) {
+            printf("  change %3d: largest free %6u, helix heap %5u\n", c + 1, (unsigned)largest,
+                   (unsigned)(helix_shim_heap_in_use() - helix_base));
+        }
+    }
+    helix_mp3_close(playing);
+    // Both churn calls and the source struct of the opened track, per change.
+    uint32_t allocs = host_heap_model_allocs() - allocs_from;
+    double per_change = (double)allocs / (double)(changes - CHECK_WARMUP) - 2.0;
+    size_t helix_peak = helix_shim_heap_peak() - helix_base;
+    printf("arena: %u bytes for both contexts, largest free block %u before init\n", (unsigned)arena,
+           (unsigned)before);
+    printf("arena: %d track changes: largest free block %u over the first %d, lowest %u after; "
+           "helix heap peak %u, %.1f allocations per change\n",
+           changes, (unsigned)reference, CHECK_WARMUP, (unsigned)lowest, (unsigned)helix_peak, per_change);
+    if (lowest < reference) {
+        printf("  largest free block shrank by %u bytes\n", (unsigned)(reference - lowest));
+        ok = false;
+    }
+    if (helix_peak > CHECK_MAX_HELIX_HEAP) {
+        printf("  %u bytes of decoder state on the heap: a context was built there\n", (unsigned)helix_peak);
+        ok = false;
+    }
+    helix_mp3_arena_deinit();
+    printf(ok ? "arena_check: OK\n" : "arena_check: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+// Track-start latency against library size. For plain folders of 64 to 50k
+// files the catalog is built by the real scanner task, then the track at the
+// start, middle and end and a spread of random ones are resolved and opened
+// the way the player starts a track, next to the folder walk the player did
+// before the catalog (readdir up to the index). Reported per start: time,
+// directory entries read and catalog reads and bytes. The catalog must
+// resolve every probed index to the right file without reading the folder,
+// in as many reads at 50k tracks as at 64 and no more bytes than a record
+// and its path.
+//
+// On the largest folder a track is then added ahead of all others and the
+// folder rescanned while a duration is set: the replacement catalog must
+// find the old track by path at its shifted index and keep that duration.
+//
+// Directory entries and reads are counted by wrapping readdir/fread at link
+// time; on the card each directory entry is 32 bytes of FAT directory and
+// every catalog read a seek plus a sector.
+//
+//   catalog_bench [-v] [-n reps]
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "storage_sd_spi.h"
+#include "track_catalog.h"
+
+#define BENCH_PROBES 16
+#define BENCH_SCAN_TIMEOUT_MS 120000
+
+static bool s_verbose = false;
+static volatile uint32_t s_scan_done = 0;
+static uint64_t s_dirents = 0;
+static uint64_t s_read_bytes = 0;
+static uint64_t s_reads = 0;
+
+struct dirent *__real_readdir(DIR *dir);
+size_t __real_fread(void *ptr, size_t size, size_t n, FILE *f);
+
+struct dirent *__wrap_readdir(DIR *dir)
+{
+    struct dirent *e = __real_readdir(dir);
+    s_dirents += e != NULL;
+    return e;
+}
+
+size_t __wrap_fread(void *ptr, size_t size, size_t n, FILE *f)
+{
+    size_t got = __real_fread(ptr, size, n, f);
+    s_reads++;
+    s_read_bytes += got * size;
+    return got;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t lcg_next(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+static void on_scan(uint32_t count, bool done, void *user)
+{
+    (void)count;
+    (void)user;
+    if (done) {
+        s_scan_done++;
+    }
+}
+
+// Names sort the same naturally and by number, so track i is "Track i.mp3".
+static bool make_library(const char *dir, uint32_t count)
+{
+    mkdir(dir, 0755);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/Track %u.mp3", dir, (unsigned)(count - 1));
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        return true;    // left by an earlier run
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        snprintf(path, sizeof(path), "%s/Track %u.mp3", dir, (unsigned)i);
+        FILE *f = fopen(path, "wb");
+        if (!f) {
+            printf("  cannot create %s\n", path);
+            return false;
+        }
+        fclose(f);
+    }
+    return true;
+}
+
+static bool wait_scan(uint32_t before)
+{
+    for (int waited = 0; waited < BENCH_SCAN_TIMEOUT_MS; waited += 5) {
+        if (s_scan_done != before) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return false;
+}
+
+// What player_current_path() did per start before the catalog.
+static bool walk_path(const char *folder, uint32_t idx, char *out, size_t len)
+{
+    DIR *dir = opendir(folder);
+    if (!dir) {
+        return false;
+    }
+    struct dirent *e;
+    uint32_t n = 0;
+    bool found = false;
+    while ((e = readdir(dir)) != NULL) {
+        if (e->d_name[0] == '.' || track_catalog_detect_format(e->d_name) == TRACK_FMT_UNKNOWN) {
+            continue;
+        }
+        if (n++ == idx) {
+            found = snprintf(out, len, "%s/%s", folder, e->d_name) < (int)len;
+            break;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+typedef struct {
+    double us;
+    double dirents;
+    double reads;
+    double bytes;
+} start_cost_t;
+
+// Resolve and open tracks `idx`, averaged over the probes, best of `reps`.
+static bool bench_starts(const char *folder, bool catalog, const uint32_t *idx, int probes, int reps,
+                         start_cost_t *cost)
+{
+    char path[TRACK_CATALOG_MAX_PATH];
+    char want[64];
+    bool ok = true;
+    cost->us = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        uint64_t d0 = s_dirents;
+        uint64_t r0 = s_reads;
+        uint64_t b0 = s_read_bytes;
+        double t0 = now_us();
+        for (int p = 0; p < probes; ++p) {
+            bool found = catalog ? track_catalog_path(idx[p], path, sizeof(path))
+                                 : walk_path(folder, idx[p], path, sizeof(path));
+            FILE *f = found ? fopen(path, "rb") : NULL;
+            if (f) {
+                fclose(f);
+            }
+            snprintf(want, sizeof(want), "/Track %u.mp3", (unsigned)idx[p]);
+            size_t plen = strlen(path);
+            size_t wlen = strlen(want);
+            // readdir order is the file system's, so only the catalog is checked by name.
+            if (!f || (catalog && (plen < wlen || strcmp(path + plen - wlen, want) != 0))) {
+                printf("  track %u resolved to \"%s\"\n", (unsigned)idx[p], found ? path : "(nothing)");
+                ok = false;
+            }
+        }
+        double us = (now_us() - t0) / probes;
+        if (us < cost->us) {
+            cost->us = us;
+        }
+        cost->dirents = (double)(s_dirents - d0) / probes;
+        cost->reads = (double)(s_reads - r0) / probes;
+        cost->bytes = (double)(s_read_bytes - b0) / probes;
+    }
+    return ok;
+}
+
+// Rescan after a track was added in front of `idx`.
+static bool check_swap(const char *folder, uint32_t idx)
+{
+    char path[TRACK_CATALOG_MAX_PATH];
+    char added[96];
+    const uint32_t duration_ms = 123456;
+    snprintf(added, sizeof(added), "%s/A.mp3", folder);
+    if (!track_catalog_path(idx, path, sizeof(path))) {
+        return false;
+    }
+    FILE *f = fopen(added, "wb");
+    if (!f) {
+        return false;
+    }
+    fclose(f);
+    uint32_t before = s_scan_done;
+    track_catalog_rescan();
+    // Still the old catalog: the scan has the whole folder to sort again.
+    track_catalog_set_duration(idx, duration_ms);
+    bool scanned = wait_scan(before);
+    uint32_t found = UINT32_MAX;
+    track_catalog_entry_t e = {0};
+    bool ok = scanned && track_catalog_find(path, &found) && found == idx + 1 && track_catalog_entry(found, &e) &&
+              e.duration_ms == duration_ms;
+    printf("swap: %s at %u -> %u, duration %u ms%s\n", strrchr(path, '/') + 1, (unsigned)idx, (unsigned)found,
+           (unsigned)e.duration_ms, scanned ? "" : ", scan timed out");
+    remove(added);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 3;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    static const uint32_t counts[] = {64, 1000, 10000, 50000};
+    const char *cache = STORAGE_SD_CACHE_DIR;
+    storage_sd_ensure_dir(cache);
+    track_catalog_set_listener(on_scan, NULL);
+
+    printf("%6s  %9s %9s  %10s %8s %6s %6s  %10s %9s\n", "tracks", "scan ms", "rescan ms", "catalog us",
+           "dirents", "reads", "bytes", "walk us", "dirents");
+    bool ok = true;
+    double first_reads = 0.0;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        uint32_t count = counts[c];
+        char folder[64];
+        snprintf(folder, sizeof(folder), "%s/lib%u", cache, (unsigned)count);
+        if (!make_library(folder, count)) {
+            ok = false;
+            break;
+        }
+        // A fresh scan, then one over the unchanged folder.
+        remove(STORAGE_SD_CACHE_DIR "/TRACKS.CAT");
+        uint32_t before = s_scan_done;
+        double t0 = now_us();
+        track_catalog_open(folder);
+        bool scanned = wait_scan(before);
+        double scan_ms = (now_us() - t0) / 1e3;
+        before = s_scan_done;
+        t0 = now_us();
+        track_catalog_rescan();
+        scanned = scanned && wait_scan(before);
+        double rescan_ms = (now_us() - t0) / 1e3;
+        if (!scanned || track_catalog_count() != count) {
+            printf("  %u files: catalog holds %u tracks%s\n", (unsigned)count, (unsigned)track_catalog_count(),
+                   scanned ? "" : ", scan timed out");
+            ok = false;
+            track_catalog_close();
+            continue;
+        }
+
+        uint32_t idx[BENCH_PROBES];
+        uint32_t rng = 0xCA7A0000U + (uint32_t)c;
+        idx[0] = 0;
+        idx[1] = count / 2;
+        idx[2] = count - 1;
+        for (int p = 3; p < BENCH_PROBES; ++p) {
+            idx[p] = lcg_next(&rng) % count;
+        }
+        start_cost_t cat;
+        start_cost_t walk;
+        ok &= bench_starts(folder, true, idx, BENCH_PROBES, reps, &cat);
+        ok &= bench_starts(folder, false, idx, BENCH_PROBES, reps, &walk);
+        printf("%6u  %9.1f %9.1f  %10.1f %8.1f %6.1f %6.1f  %10.1f %9.1f\n", (unsigned)count, scan_ms,
+               rescan_ms, cat.us, cat.dirents, cat.reads, cat.bytes, walk.us, walk.dirents);
+        if (s_verbose) {
+            track_catalog_progress_t pr;
+            track_catalog_get_progress(&pr);
+            printf("  rescan: %u folders, %u unchanged\n", (unsigned)pr.dirs, (unsigned)pr.dirs_reused);
+        }
+        if (c == 0) {
+            first_reads = cat.reads;
+        } else if (cat.reads > first_reads) {
+            printf("  catalog: %.1f reads per start at %u tracks, %.1f at %u\n", cat.reads, (unsigned)count,
+                   first_reads, (unsigned)counts[0]);
+            ok = false;
+        }
+        if (cat.bytes > sizeof(track_catalog_entry_t) + TRACK_CATALOG_MAX_PATH) {
+            printf("  catalog: %.1f bytes per start\n", cat.bytes);
+            ok = false;
+        }
+        if (cat.dirents > 0.0) {
+            printf("  catalog lookups read the folder\n");
+            ok = false;
+        }
+        if (c + 1 == sizeof(counts) / sizeof(counts[0])) {
+            ok &= check_swap(folder, count / 2);
+        }
+        track_catalog_close();
+    }
+    printf(ok ? "catalog_bench: OK\n" : "catalog_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "host_corpus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int host_corpus_load(host_corpus_file_t *files, int max)
+{
+    FILE *f = fopen(CORPUS_DIR "/corpus.txt", "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", CORPUS_DIR "/corpus.txt");
+        return 0;
+    }
+    int count = 0;
+    char line[256];
+    while (count < max && fgets(line, sizeof(line), f)) {
+        host_corpus_file_t *c = &files[count];
+        char mode[16], kbps[16], tag[16];
+        unsigned rate, channels, frames, delay, padding, samples;
+        if (line[0] == '#' ||
+            sscanf(line, "%63s %u %u %15s %15s %u %u %u %u %15s", c->name, &rate, &channels, mode, kbps,
+                   &frames, &delay, &padding, &samples, tag) != 10) {
+            continue;
+        }
+        c->rate = rate;
+        c->channels = channels;
+        c->kbps = (uint32_t)strtoul(kbps, NULL, 10);
+        c->frames = frames;
+        c->enc_delay = delay;
+        c->padding = padding;
+        c->samples = samples;
+        c->tagged = strcmp(tag, "none") != 0;
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+const host_corpus_file_t *host_corpus_find(const host_corpus_file_t *files, int count, const char *name)
+{
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(files[i].name, name) == 0) {
+            return &files[i];
+        }
+    }
+    return NULL;
+}
+
+void host_corpus_path(const host_corpus_file_t *file, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s/%s", CORPUS_DIR, file->name);
+}
+
+uint32_t host_corpus_output_frames(const host_corpus_file_t *file)
+{
+    return file->tagged ? file->samples : file->frames * 1152U;
+}
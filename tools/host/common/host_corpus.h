@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One line of corpus/corpus.txt: what gen_corpus.py encoded.
+typedef struct {
+    char name[64];
+    uint32_t rate;
+    uint32_t channels;
+    uint32_t kbps;          // 0 = VBR
+    uint32_t frames;        // audio frames, tag frame excluded
+    uint32_t enc_delay;
+    uint32_t padding;
+    uint32_t samples;       // source samples per channel
+    bool tagged;            // Xing/Info + LAME tag: the player trims to `samples`
+} host_corpus_file_t;
+
+#define HOST_CORPUS_MAX_FILES 32
+
+// Reads CORPUS_DIR/corpus.txt; returns the number of files (0 on error).
+int host_corpus_load(host_corpus_file_t *files, int max);
+const host_corpus_file_t *host_corpus_find(const host_corpus_file_t *files, int count, const char *name);
+void host_corpus_path(const host_corpus_file_t *file, char *buf, size_t len);
+// Frames the wrapper should output when playing the file from the start.
+uint32_t host_corpus_output_frames(const host_corpus_file_t *file);
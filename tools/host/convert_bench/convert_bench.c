@@ -0,0 +1,181 @@
+// pcm_convert_block throughput per WAV format. For 8/16/24/32-bit integer
+// and 32-bit float, mono and stereo, a second of 48 kHz noise is
+// converted in the player's 256-frame blocks at unity and half gain, and
+// timed against a per-sample converter that picks the format for every
+// sample, the way the player converted before the block kernels. Reported:
+// ns per output frame, input MB/s and the speedup. Both must produce the
+// same samples, float specials (NaN, infinities, out of range) included.
+//
+//   convert_bench [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_cpu.h"
+#include "pcm_convert.h"
+
+#define BENCH_BLOCK 256                  // PLAYER_WAV_BLOCK_FRAMES
+#define BENCH_FRAMES (BENCH_BLOCK * 188) // just over a second at 48 kHz
+
+static bool s_verbose = false;
+static uint32_t s_rng = 1;
+
+static uint32_t bench_rand(void)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return s_rng;
+}
+
+// One sample at a time, format decided per sample.
+static int16_t ref_sample(pcm_format_t fmt, const uint8_t *p, int32_t gain)
+{
+    switch (fmt) {
+        case PCM_FMT_U8:
+            return (int16_t)((((int32_t)p[0] - 128) * 256 * gain) >> 15);
+        case PCM_FMT_S16:
+            return (int16_t)(((int32_t)(int16_t)(p[0] | (p[1] << 8)) * gain) >> 15);
+        case PCM_FMT_S24: {
+            int32_t v = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+            return (int16_t)(((int64_t)v * gain) >> 31);
+        }
+        case PCM_FMT_S32: {
+            int32_t v = (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                                  ((uint32_t)p[3] << 24));
+            return (int16_t)(((int64_t)v * gain) >> 31);
+        }
+        case PCM_FMT_F32: {
+            float v;
+            memcpy(&v, p, sizeof(v));
+            v *= (float)gain * (32768.0f / PCM_GAIN_UNITY);
+            if (!(v > -32768.0f)) {
+                return INT16_MIN;
+            }
+            if (v >= 32767.0f) {
+                return INT16_MAX;
+            }
+            return (int16_t)v;
+        }
+    }
+    return 0;
+}
+
+static void ref_convert(pcm_format_t fmt, uint8_t channels, const uint8_t *in, int16_t *out, size_t frames,
+                        int32_t gain)
+{
+    size_t bytes = pcm_sample_bytes(fmt);
+    for (size_t i = 0; i < frames; ++i) {
+        for (uint8_t c = 0; c < 2; ++c) {
+            const uint8_t *p = in + (i * channels + (channels == 2 ? c : 0)) * bytes;
+            out[i * 2 + c] = ref_sample(fmt, p, gain);
+        }
+    }
+}
+
+static void fill_input(pcm_format_t fmt, uint8_t *in, size_t samples)
+{
+    if (fmt != PCM_FMT_F32) {
+        for (size_t i = 0; i < samples * pcm_sample_bytes(fmt); ++i) {
+            in[i] = (uint8_t)(bench_rand() >> 24);
+        }
+        return;
+    }
+    static const float specials[] = {NAN, INFINITY, -INFINITY, 1.0f, -1.0f, 1.5f, -1.5f, 0.99999f, -0.0f};
+    for (size_t i = 0; i < samples; ++i) {
+        float v = (i < sizeof(specials) / sizeof(specials[0]))
+                      ? specials[i]
+                      : ((float)(bench_rand() >> 8) / 8388608.0f - 1.0f) * 1.2f;
+        memcpy(in + i * 4, &v, sizeof(v));
+    }
+}
+
+static double time_blocks(bool kernel, pcm_format_t fmt, uint8_t channels, const uint8_t *in, int16_t *out,
+                          int32_t gain, int reps)
+{
+    size_t frame_bytes = pcm_sample_bytes(fmt) * channels;
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (size_t at = 0; at < BENCH_FRAMES; at += BENCH_BLOCK) {
+            if (kernel) {
+                pcm_convert_block(fmt, channels, in + at * frame_bytes, out + at * 2, BENCH_BLOCK, gain);
+            } else {
+                ref_convert(fmt, channels, in + at * frame_bytes, out + at * 2, BENCH_BLOCK, gain);
+            }
+        }
+        double ns = (double)(uint32_t)(esp_cpu_get_cycle_count() - t0);
+        if (ns < best) {
+            best = ns;
+        }
+    }
+    return best / BENCH_FRAMES;
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    static const struct {
+        pcm_format_t fmt;
+        const char *name;
+    } formats[] = {
+        {PCM_FMT_U8, "u8"}, {PCM_FMT_S16, "s16"}, {PCM_FMT_S24, "s24"}, {PCM_FMT_S32, "s32"}, {PCM_FMT_F32, "f32"},
+    };
+    static const int32_t gains[] = {PCM_GAIN_UNITY, PCM_GAIN_UNITY / 2};
+    // Rows are 4-byte aligned, as pcm_convert_block() requires.
+    uint32_t *in = malloc(BENCH_FRAMES * 2 * 4);
+    int16_t *out = malloc(BENCH_FRAMES * 2 * sizeof(int16_t));
+    int16_t *ref = malloc(BENCH_FRAMES * 2 * sizeof(int16_t));
+    if (!in || !out || !ref) {
+        printf("convert_bench: FAILED (out of memory)\n");
+        return 1;
+    }
+
+    printf("%-6s %2s %6s  %9s %9s  %9s %8s\n", "format", "ch", "gain", "block ns", "ref ns", "block MB/s",
+           "speedup");
+    bool ok = true;
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f) {
+        for (uint8_t channels = 1; channels <= 2; ++channels) {
+            fill_input(formats[f].fmt, (uint8_t *)in, (size_t)BENCH_FRAMES * channels);
+            for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); ++g) {
+                int32_t gain = gains[g];
+                const uint8_t *src = (const uint8_t *)in;
+                double ns = time_blocks(true, formats[f].fmt, channels, src, out, gain, reps);
+                double ref_ns = time_blocks(false, formats[f].fmt, channels, src, ref, gain, reps);
+                double mb = pcm_sample_bytes(formats[f].fmt) * channels * 1e3 / ns;
+                printf("%-6s %2u %6.2f  %9.2f %9.2f  %9.1f %7.1fx\n", formats[f].name, (unsigned)channels,
+                       (double)gain / PCM_GAIN_UNITY, ns, ref_ns, mb, ref_ns / ns);
+                size_t bad = 0;
+                for (size_t i = 0; i < BENCH_FRAMES * 2; ++i) {
+                    if (out[i] != ref[i]) {
+                        if (bad++ < 3 && s_verbose) {
+                            printf("  sample %zu: %d, per-sample %d\n", i, out[i], ref[i]);
+                        }
+                    }
+                }
+                if (bad > 0) {
+                    printf("  %s %u ch: %zu samples differ from the per-sample converter\n", formats[f].name,
+                           (unsigned)channels, bad);
+                    ok = false;
+                }
+            }
+        }
+    }
+    free(in);
+    free(out);
+    free(ref);
+    printf(ok ? "convert_bench: OK\n" : "convert_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+// Bytes copied per second of audio on the local player's MP3 path. Corpus
+// files are decoded with the player's wrapper into the real mixer, which
+// feeds the host DAC sped up. Every memcpy/memmove on the way is counted by
+// wrapping them (and their fortified forms) at link time, split by where it
+// happens: the decoder's input buffer, the write into the mixer's ring, and
+// the mixer task's read of it. The I2S driver's copy into its DMA
+// descriptors is counted as the bytes audio_i2s_write() accepts.
+//
+// Next to it is the chain before the decoder wrote into the output slot
+// (pcm -> outbuf -> s_mp3_buf -> s_eq_buf -> DMA), modeled as the same input
+// copies plus four PCM copies. The current chain must copy less PCM than
+// that, the decoder may copy no PCM (its input buffer stays under twice the
+// bitstream), and every decoded frame must reach the DAC.
+//
+//   copy_bench [-v] [-n reps]
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_mixer.h"
+#include "audio_output_host.h"
+#include "audio_pcm5102.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "helix_mp3_wrapper.h"
+#include "host_corpus.h"
+
+#define BENCH_SPEED 64.0                // DAC runs this much faster than real time
+#define BENCH_WRITE_TIMEOUT_MS 1000
+#define BENCH_OLD_PCM_COPIES 4
+
+static const char *const s_files[] = {"cbr128_44k_js.mp3", "cbr320_44k_st.mp3", "cbr64_44k_mono.mp3"};
+
+static bool s_verbose = false;
+static pthread_t s_main;
+static uint64_t s_main_bytes = 0;       // copies on the decoding thread
+static uint64_t s_task_bytes = 0;       // copies on any other (the mixer task)
+static uint64_t s_ring_bytes = 0;       // of s_main_bytes, inside audio_mixer_write()
+static uint64_t s_pcm_frames = 0;       // handed to the writer
+static bool s_write_failed = false;
+
+void *__real_memcpy(void *dst, const void *src, size_t n);
+void *__real_memmove(void *dst, const void *src, size_t n);
+void *__real___memcpy_chk(void *dst, const void *src, size_t n, size_t dst_len);
+void *__real___memmove_chk(void *dst, const void *src, size_t n, size_t dst_len);
+
+static void count_copy(size_t n)
+{
+    if (pthread_equal(pthread_self(), s_main)) {
+        s_main_bytes += n;
+    } else {
+        __atomic_fetch_add(&s_task_bytes, n, __ATOMIC_RELAXED);
+    }
+}
+
+void *__wrap_memcpy(void *dst, const void *src, size_t n)
+{
+    count_copy(n);
+    return __real_memcpy(dst, src, n);
+}
+
+void *__wrap_memmove(void *dst, const void *src, size_t n)
+{
+    count_copy(n);
+    return __real_memmove(dst, src, n);
+}
+
+// Fortified builds call these where the destination size is known.
+void *__wrap___memcpy_chk(void *dst, const void *src, size_t n, size_t dst_len)
+{
+    count_copy(n);
+    return __real___memcpy_chk(dst, src, n, dst_len);
+}
+
+void *__wrap___memmove_chk(void *dst, const void *src, size_t n, size_t dst_len)
+{
+    count_copy(n);
+    return __real___memmove_chk(dst, src, n, dst_len);
+}
+
+static size_t mixer_sink(uint8_t *data, size_t len, void *user)
+{
+    (void)user;
+    size_t done = 0;
+    uint64_t before = s_main_bytes;
+    while (done < len) {
+        size_t wrote = 0;
+        if (audio_mixer_write(AUDIO_SOURCE_PLAYER, data + done, len - done, &wrote, BENCH_WRITE_TIMEOUT_MS) !=
+                ESP_OK && wrote == 0) {
+            s_write_failed = true;
+            break;
+        }
+        done += wrote;
+    }
+    s_ring_bytes += s_main_bytes - before;
+    s_pcm_frames += done / (2 * sizeof(int16_t));
+    return done;
+}
+
+static uint32_t mixer_rate(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    return audio_mixer_claim_rate(AUDIO_SOURCE_PLAYER, sample_rate);
+}
+
+typedef struct {
+    double seconds;
+    uint64_t input;
+    uint64_t ring;
+    uint64_t fetch;
+    uint64_t driver;
+    uint64_t pcm;
+} copy_counts_t;
+
+static bool play_file(const char *path, copy_counts_t *c)
+{
+    helix_mp3_source_t *src = helix_mp3_open(path, 0.0f);
+    if (!src || !audio_mixer_open(AUDIO_SOURCE_PLAYER)) {
+        helix_mp3_close(src);
+        return false;
+    }
+    uint64_t dac0 = audio_i2s_get_written_frames();
+    s_main_bytes = 0;
+    s_ring_bytes = 0;
+    s_pcm_frames = 0;
+    __atomic_store_n(&s_task_bytes, 0, __ATOMIC_RELAXED);
+    s_write_failed = false;
+    bool ok = helix_mp3_decode_source(src, mixer_sink, mixer_rate, NULL, NULL, NULL) && !s_write_failed;
+    audio_mixer_close(AUDIO_SOURCE_PLAYER);
+    // Let the ring and the DAC queue play out.
+    for (int i = 0; i < 500; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(2));
+        if (audio_i2s_get_written_frames() - dac0 >= s_pcm_frames &&
+            audio_i2s_get_played_frames() == audio_i2s_get_written_frames()) {
+            break;
+        }
+    }
+    uint64_t dac = audio_i2s_get_written_frames() - dac0;
+    c->seconds = (double)s_pcm_frames / audio_i2s_get_sample_rate();
+    c->input = s_main_bytes - s_ring_bytes;
+    c->ring = s_ring_bytes;
+    c->fetch = __atomic_load_n(&s_task_bytes, __ATOMIC_RELAXED);
+    c->driver = dac * 2 * sizeof(int16_t);
+    c->pcm = s_pcm_frames * 2 * sizeof(int16_t);
+    if (dac != s_pcm_frames) {
+        printf("  %llu frames decoded, %llu reached the DAC\n", (unsigned long long)s_pcm_frames,
+               (unsigned long long)dac);
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    s_main = pthread_self();
+    host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int nfiles = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    host_i2s_start(44100, BENCH_SPEED, NULL, NULL);
+    if (nfiles == 0 || helix_mp3_arena_init() != ESP_OK || audio_mixer_init() != ESP_OK) {
+        printf("copy_bench: FAILED (setup)\n");
+        return 1;
+    }
+
+    printf("KB copied per second of audio\n");
+    printf("%-18s %7s %7s %7s %7s %7s  %7s %7s\n", "file", "input", "ring", "fetch", "driver", "total", "PCM",
+           "before");
+    bool ok = true;
+    for (size_t f = 0; f < sizeof(s_files) / sizeof(s_files[0]); ++f) {
+        const host_corpus_file_t *file = host_corpus_find(files, nfiles, s_files[f]);
+        char path[256];
+        copy_counts_t c = {0};
+        if (!file) {
+            printf("  %s not in the corpus\n", s_files[f]);
+            ok = false;
+            continue;
+        }
+        host_corpus_path(file, path, sizeof(path));
+        for (int r = 0; r < reps; ++r) {
+            if (!play_file(path, &c)) {
+                printf("  %s: playback failed\n", file->name);
+                ok = false;
+            }
+        }
+        if (c.seconds <= 0.0) {
+            ok = false;
+            continue;
+        }
+        double k = 1.0 / (1024.0 * c.seconds);
+        double pcm_now = (double)(c.ring + c.fetch + c.driver);
+        double pcm_before = (double)BENCH_OLD_PCM_COPIES * c.pcm;
+        printf("%-18s %7.1f %7.1f %7.1f %7.1f %7.1f  %7.1f %7.1f\n", file->name, c.input * k, c.ring * k,
+               c.fetch * k, c.driver * k, (c.input + pcm_now) * k, c.pcm * k, (c.input + pcm_before) * k);
+        if (s_verbose) {
+            printf("  %.2f s of audio, %.2f PCM copies now, %d before\n", c.seconds, pcm_now / c.pcm,
+                   BENCH_OLD_PCM_COPIES);
+        }
+        if (pcm_now >= pcm_before) {
+            printf("  %s: %.2f PCM copies, no fewer than before\n", file->name, pcm_now / c.pcm);
+            ok = false;
+        }
+        double stream = file->kbps * 1000.0 / 8.0 * c.seconds;
+        if (c.input > 2.0 * stream) {
+            printf("  %s: decoder copied %.1f KB/s for a %.1f KB/s stream\n", file->name, c.input * k,
+                   stream * k);
+            ok = false;
+        }
+    }
+    host_i2s_stop();
+    printf(ok ? "copy_bench: OK\n" : "copy_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,656 @@
+#!/usr/bin/env python3
+"""Generate the MP3 test corpus used by the host tools.
+
+No encoder is assumed on the build machine, so this is a small MPEG-1
+Layer III encoder: ISO analysis filterbank, long-block MDCT, one global
+gain per granule (no scalefactors, no bit reservoir) and Huffman coding
+with the codebooks recovered from the vendored Helix hufftabs.c. Quality
+is modest but the streams are valid, cover CBR/VBR, 32/44.1/48 kHz, mono,
+stereo and joint (M/S) stereo, and carry Xing/Info + LAME tags where a
+real encoder would.
+
+The signals come from fixed formulas and a fixed-seed generator, so
+re-running the script regenerates the corpus. corpus.txt records the
+ground truth the host tests check against: frame count, LAME delay and
+padding, and the exact number of source samples per file.
+
+Usage: gen_corpus.py [output_dir]
+"""
+
+import math
+import operator
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HELIX_DIR = os.path.join(HERE, "..", "..", "..", "main", "third_party", "helix")
+
+BITRATES = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320]
+RATE_INDEX = {44100: 0, 48000: 1, 32000: 2}
+SFB_LONG = {
+    44100: [0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62, 74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576],
+    48000: [0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60, 72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576],
+    32000: [0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66, 82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576],
+}
+MODE_STEREO, MODE_JOINT, MODE_MONO = 0, 1, 3
+GRANULE = 576
+FRAME = 1152
+DECODER_DELAY = 529     # LAME convention, matches the wrapper's HELIX_DECODER_DELAY
+ENC_DELAY = 528         # filterbank + MDCT latency of this encoder, measured against Helix
+XR_SCALE = 1.0 / 9.0    # MDCT lines to Helix dequantizer units (unity gain through Helix)
+
+
+# --- Tables recovered from the vendored decoder ---------------------------
+
+def helix_source(name):
+    with open(os.path.join(HELIX_DIR, name)) as f:
+        return f.read()
+
+
+def load_codebooks():
+    """Per table index: (dict (x, y) -> (code, len), max value, linbits)."""
+    src = helix_source("hufftabs.c")
+    body = re.search(r"huffTable\[\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    subtabs = {}
+    for m in re.finditer(r"/\*\s*huffTable(\d+)\[(\d+)\]\s*\*/([^/]*)", body):
+        subtabs[int(m.group(1))] = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", m.group(3))]
+    offs = re.search(r"huffTabOffset\[HUFF_PAIRTABS\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    tab_of_idx = []
+    for tok in [t.strip() for t in offs.split(",") if t.strip()]:
+        m = re.match(r"HUFF_OFFSET_(\d+)", tok)
+        tab_of_idx.append(int(m.group(1)) if m else None)
+    look = re.search(r"huffTabLookup\[HUFF_PAIRTABS\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    lookup = [(int(a), b) for a, b in re.findall(r"\{\s*(\d+)\s*,\s*(\w+)\s*\}", look)]
+    quad = re.search(r"quadTable\[64\+16\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    quad_vals = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", quad)]
+
+    def walk(tab, curr, prefix, plen, out):
+        max_bits = tab[curr] & 0xF
+        for v in range(1 << max_bits):
+            cw = tab[curr + 1 + v]
+            length = cw >> 12
+            if length:
+                key = ((cw >> 4) & 0xF, (cw >> 8) & 0xF)
+                code = (prefix << length) | (v >> (max_bits - length))
+                assert out.setdefault(key, (code, plen + length)) == (code, plen + length)
+            else:
+                walk(tab, curr + cw, (prefix << max_bits) | v, plen + max_bits, out)
+
+    books = {}
+    for idx in range(1, 32):
+        linbits, kind = lookup[idx]
+        if kind not in ("oneShot", "loopNoLinbits", "loopLinbits"):
+            continue
+        codes = {}
+        walk(subtabs[tab_of_idx[idx]], 0, 0, 0, codes)
+        top = max(max(k) for k in codes)
+        books[idx] = (codes, top + ((1 << linbits) - 1 if linbits else 0), linbits)
+
+    quads = []
+    for base, max_bits in ((0, 6), (64, 4)):
+        codes = {}
+        for v in range(1 << max_bits):
+            cw = quad_vals[base + v]
+            length = (cw >> 4) & 0xF
+            codes.setdefault(cw & 0xF, (v >> (max_bits - length), length))
+        quads.append(codes)
+    return books, quads
+
+
+def load_window():
+    """ISO 11172-3 synthesis window D[512], rebuilt from Helix polyCoef[]."""
+    src = helix_source("trigtabs.c")
+    body = re.search(r"polyCoef\[264\]\s*=\s*\{(.*?)\};", src, re.S).group(1)
+    v = [int(x, 16) for x in re.findall(r"0x[0-9a-fA-F]+", body)]
+    v = [x - (1 << 32) if x >= 1 << 31 else x for x in v]
+    shuf = [0, 15, 2, 13, 4, 11, 6, 9, 8, 7, 10, 5, 12, 3, 14, 1]
+    d = [0.0] * 512
+    for j in range(16):
+        for p in range(16):
+            d[j + 32 * shuf[p]] = v[16 * j + p] / 2.0 ** 18
+    for k, c in zip((14, 12, 10, 8, 6, 4, 2, 0), v[256:264]):
+        d[16 + 32 * k] = c / 2.0 ** 18
+    for k in (1, 3, 5, 7):
+        d[16 + 32 * k] = -d[16 + 32 * (15 - k)]
+    for j in range(17, 32):
+        for k in range(16):
+            d[j + 32 * k] = -d[512 - (j + 32 * k)]
+    return d
+
+
+# --- Analysis ---------------------------------------------------------------
+
+class Analysis:
+    """Polyphase filterbank + MDCT + alias reduction for one channel."""
+
+    C = None
+    M = None
+    MDCT = None
+    CS = CA = None
+
+    def __init__(self):
+        if Analysis.C is None:
+            Analysis.C = [c / 32.0 for c in load_window()]
+            Analysis.M = [[math.cos((2 * k + 1) * (i - 16) * math.pi / 64) for i in range(64)] for k in range(32)]
+            win = [math.sin(math.pi / 36 * (i + 0.5)) for i in range(36)]
+            Analysis.MDCT = [[win[i] * math.cos(math.pi / 72 * (2 * i + 19) * (2 * m + 1)) for i in range(36)]
+                             for m in range(18)]
+            ci = [-0.6, -0.535, -0.33, -0.185, -0.095, -0.041, -0.0142, -0.0037]
+            Analysis.CS = [1.0 / math.sqrt(1.0 + c * c) for c in ci]
+            Analysis.CA = [c / math.sqrt(1.0 + c * c) for c in ci]
+        self.hist = [0.0] * 512         # newest sample first
+        self.prev = [[0.0] * 18 for _ in range(32)]
+
+    def granule(self, pcm):
+        """576 input samples (floats, +-1.0) -> 576 MDCT lines."""
+        C, M, mul = Analysis.C, Analysis.M, operator.mul
+        sub = [[0.0] * 18 for _ in range(32)]
+        hist = self.hist
+        for t in range(18):
+            hist = pcm[t * 32:t * 32 + 32][::-1] + hist[:480]
+            z = list(map(mul, C, hist))
+            y = [sum(z[i::64]) for i in range(64)]
+            for k in range(32):
+                s = sum(map(mul, M[k], y))
+                sub[k][t] = -s if (k & 1 and t & 1) else s
+        self.hist = hist
+        xr = []
+        for k in range(32):
+            block = self.prev[k] + sub[k]
+            xr.extend(sum(map(mul, row, block)) for row in Analysis.MDCT)
+        self.prev = sub
+        for sb in range(1, 32):
+            for i in range(8):
+                bu = xr[18 * sb - 1 - i]
+                bd = xr[18 * sb + i]
+                xr[18 * sb - 1 - i] = bu * Analysis.CS[i] + bd * Analysis.CA[i]
+                xr[18 * sb + i] = bd * Analysis.CS[i] - bu * Analysis.CA[i]
+        return [x * XR_SCALE for x in xr]
+
+
+# --- Quantization and Huffman coding ----------------------------------------
+
+class Bits:
+    def __init__(self):
+        self.acc = 0
+        self.n = 0
+
+    def put(self, value, nbits):
+        if nbits:
+            self.acc = (self.acc << nbits) | (value & ((1 << nbits) - 1))
+            self.n += nbits
+
+    def extend(self, other):
+        self.put(other.acc, other.n)
+
+    def tobytes(self, size):
+        pad = size * 8 - self.n
+        assert pad >= 0, "frame overflow"
+        return (self.acc << pad).to_bytes(size, "big")
+
+
+class Coder:
+    def __init__(self):
+        self.books, self.quads = load_codebooks()
+        self.tables = sorted(self.books)
+
+    def cost(self, t, x, y):
+        codes, top, linbits = self.books[t]
+        if x > top or y > top:
+            return None
+        xx, yy = (min(x, 15), min(y, 15)) if linbits else (x, y)
+        length = codes[(xx, yy)][1]
+        if linbits:
+            length += linbits * ((x >= 15) + (y >= 15))
+        return length + (x != 0) + (y != 0)
+
+    def region_costs(self, ix, end):
+        """Per table, prefix sums of pair costs over ix[0:end] (None = not codable)."""
+        out = {}
+        pairs = [(abs(ix[i]), abs(ix[i + 1])) for i in range(0, end, 2)]
+        for t in self.tables:
+            acc = [0]
+            s = 0
+            for x, y in pairs:
+                c = self.cost(t, x, y)
+                if c is None:
+                    s = None
+                    break
+                s += c
+                acc.append(s)
+            out[t] = acc if s is not None else acc + [None] * (len(pairs) + 1 - len(acc))
+        return out
+
+    @staticmethod
+    def best_table(prefix, a, b):
+        if a == b:
+            return 0, 0
+        best = None
+        for t, acc in prefix.items():
+            hi, lo = acc[b // 2], acc[a // 2]
+            if hi is None or lo is None:
+                continue
+            if best is None or hi - lo < best[1]:
+                best = (t, hi - lo)
+        return best
+
+    def layout(self, ix, sfb, full):
+        """Regions, tables and bit count for one granule/channel."""
+        last = 575
+        while last >= 0 and ix[last] == 0:
+            last -= 1
+        big = last
+        while big >= 0 and abs(ix[big]) <= 1:
+            big -= 1
+        bv_end = (big + 2) & ~1
+        c1_end = bv_end + ((last + 1 - bv_end + 3) & ~3) if last + 1 > bv_end else bv_end
+        if c1_end > 576:
+            bv_end += 2
+            c1_end = bv_end + ((last + 1 - bv_end + 3) & ~3) if last + 1 > bv_end else bv_end
+        quad_bits = []
+        for codes in self.quads:
+            bits = 0
+            for i in range(bv_end, c1_end, 4):
+                q = [abs(v) for v in ix[i:i + 4]]
+                bits += codes[(q[0] << 3) | (q[1] << 2) | (q[2] << 1) | q[3]][1] + sum(q)
+            quad_bits.append(bits)
+        c1_table = 0 if quad_bits[0] <= quad_bits[1] else 1
+
+        prefix = self.region_costs(ix, bv_end)
+        candidates = [(r0, r1) for r0 in range(16) for r1 in range(8) if r0 + r1 + 2 <= 22] if full else [(7, 7)]
+        best = None
+        for r0, r1 in candidates:
+            a = min(sfb[r0 + 1], bv_end)
+            b = min(sfb[r0 + r1 + 2], bv_end)
+            regions = [self.best_table(prefix, 0, a), self.best_table(prefix, a, b),
+                       self.best_table(prefix, b, bv_end)]
+            if None in regions:
+                continue
+            bits = sum(r[1] for r in regions)
+            if best is None or bits < best[0]:
+                best = (bits, r0, r1, [r[0] for r in regions])
+        if best is None:
+            return None
+        return {
+            "bits": best[0] + quad_bits[c1_table],
+            "big_values": bv_end // 2,
+            "c1_end": c1_end,
+            "region0": best[1],
+            "region1": best[2],
+            "tables": best[3],
+            "c1_table": c1_table,
+            "ix": ix,
+        }
+
+    def write(self, bits, gc, sfb):
+        ix = gc["ix"]
+        bv_end = gc["big_values"] * 2
+        a = min(sfb[gc["region0"] + 1], bv_end)
+        b = min(sfb[gc["region0"] + gc["region1"] + 2], bv_end)
+        for lo, hi, t in ((0, a, gc["tables"][0]), (a, b, gc["tables"][1]), (b, bv_end, gc["tables"][2])):
+            if t == 0:
+                continue
+            codes, _, linbits = self.books[t]
+            for i in range(lo, hi, 2):
+                x, y = ix[i], ix[i + 1]
+                ax, ay = abs(x), abs(y)
+                key = (min(ax, 15), min(ay, 15)) if linbits else (ax, ay)
+                bits.put(*codes[key])
+                if linbits and ax >= 15:
+                    bits.put(ax - 15, linbits)
+                if ax:
+                    bits.put(1 if x < 0 else 0, 1)
+                if linbits and ay >= 15:
+                    bits.put(ay - 15, linbits)
+                if ay:
+                    bits.put(1 if y < 0 else 0, 1)
+        codes = self.quads[gc["c1_table"]]
+        for i in range(bv_end, gc["c1_end"], 4):
+            q = ix[i:i + 4]
+            bits.put(*codes[(abs(q[0]) << 3) | (abs(q[1]) << 2) | (abs(q[2]) << 1) | abs(q[3])])
+            for v in q:
+                if v:
+                    bits.put(1 if v < 0 else 0, 1)
+
+
+def quantize(xr, gain, cutoff):
+    step = 2.0 ** ((gain - 210) / 4.0)
+    inv = 1.0 / step
+    out = [0] * 576
+    for i in range(cutoff):
+        x = xr[i]
+        if x:
+            q = int((abs(x) * inv) ** 0.75 + 0.4054)
+            if q > 8191:
+                return None
+            out[i] = -q if x < 0 else q
+    return out
+
+
+# --- Frame assembly ----------------------------------------------------------
+
+def frame_bytes(kbps, rate, padding):
+    return 144000 * kbps // rate + padding
+
+
+def header(kbps, rate, padding, mode, mode_ext):
+    b = Bits()
+    b.put(0x7FF, 11)
+    b.put(3, 2)     # MPEG-1
+    b.put(1, 2)     # layer III
+    b.put(1, 1)     # no CRC
+    b.put(BITRATES.index(kbps), 4)
+    b.put(RATE_INDEX[rate], 2)
+    b.put(padding, 1)
+    b.put(0, 1)
+    b.put(mode, 2)
+    b.put(mode_ext, 2)
+    b.put(0, 1)
+    b.put(1, 1)     # original
+    b.put(0, 2)
+    return b
+
+
+class Encoder:
+    def __init__(self, rate, mode, coder, lowpass_hz=16000):
+        self.rate = rate
+        self.mode = mode
+        self.channels = 1 if mode == MODE_MONO else 2
+        self.coder = coder
+        self.sfb = SFB_LONG[rate]
+        self.cutoff = min(576, int(lowpass_hz * 576 * 2 / rate))
+        self.analysis = [Analysis() for _ in range(self.channels)]
+        self.pad_acc = 0
+
+    def _spectra(self, chans, gr):
+        return [self.analysis[ch].granule(chans[ch][gr * GRANULE:(gr + 1) * GRANULE])
+                for ch in range(self.channels)]
+
+    def _code(self, spectra, gain, full):
+        out = []
+        for xr in spectra:
+            ix = quantize(xr, gain, self.cutoff)
+            if ix is None:
+                return None
+            gc = self.coder.layout(ix, self.sfb, full)
+            if gc is None or gc["bits"] > 4095:
+                return None
+            gc["gain"] = gain
+            out.append(gc)
+        return out
+
+    def _fit(self, spectra, budget, floor):
+        """Lowest global gain (finest step) whose granules fit `budget` bits."""
+        lo, hi = floor, 255
+        if self._code(spectra, hi, False) is None:
+            raise RuntimeError("signal too loud to code")
+        while lo < hi:
+            mid = (lo + hi) // 2
+            coded = self._code(spectra, mid, False)
+            if coded is not None and sum(g["bits"] for g in coded) <= budget:
+                hi = mid
+            else:
+                lo = mid + 1
+        return self._code(spectra, lo, True)
+
+    def _ms(self, spectra):
+        """M/S-code the frame's granules when the channels are well correlated."""
+        if self.mode != MODE_JOINT:
+            return spectra, 0
+        side = mid = 0.0
+        for l, r in spectra:
+            side += sum((a - b) * (a - b) for a, b in zip(l, r))
+            mid += sum((a + b) * (a + b) for a, b in zip(l, r))
+        if side >= 0.3 * mid:
+            return spectra, 0
+        s = 1.0 / math.sqrt(2.0)
+        return [[[(a + b) * s for a, b in zip(l, r)], [(a - b) * s for a, b in zip(l, r)]]
+                for l, r in spectra], 2
+
+    def frame(self, chans, kbps=None, quality_gain=None):
+        """Encode 1152 samples per channel. CBR if kbps, else VBR at quality_gain."""
+        spectra, ms = self._ms([self._spectra(chans, gr) for gr in range(2)])
+        side_bytes = 17 if self.channels == 1 else 32
+        flat = spectra[0] + spectra[1]
+
+        if kbps is not None:
+            padding = self._padding(kbps)
+            budget = (frame_bytes(kbps, self.rate, padding) - 4 - side_bytes) * 8
+            coded = self._fit(flat, budget, 0)
+        else:
+            coded = self._code(flat, quality_gain, True)
+            if coded is not None:
+                need = sum(g["bits"] for g in coded)
+                for k in BITRATES[1:]:
+                    if (frame_bytes(k, self.rate, 0) - 4 - side_bytes) * 8 >= need:
+                        kbps = k
+                        break
+            if kbps is None:
+                kbps = 320
+                budget = (frame_bytes(kbps, self.rate, 0) - 4 - side_bytes) * 8
+                coded = self._fit(flat, budget, quality_gain)
+            padding = 0
+
+        size = frame_bytes(kbps, self.rate, padding)
+        out = header(kbps, self.rate, padding, self.mode, ms)
+        out.put(0, 9)                               # main_data_begin: no reservoir
+        out.put(0, 5 if self.channels == 1 else 3)  # private bits
+        out.put(0, 4 * self.channels)               # scfsi
+        for gc in coded:
+            out.put(gc["bits"], 12)                 # part2_3_length (no scalefactors)
+            out.put(gc["big_values"], 9)
+            out.put(gc["gain"], 8)
+            out.put(0, 4)                           # scalefac_compress
+            out.put(0, 1)                           # long blocks only
+            for t in gc["tables"]:
+                out.put(t, 5)
+            out.put(gc["region0"], 4)
+            out.put(gc["region1"], 3)
+            out.put(0, 1)                           # preflag
+            out.put(0, 1)                           # scalefac_scale
+            out.put(gc["c1_table"], 1)
+        for gc in coded:
+            body = Bits()
+            self.coder.write(body, gc, self.sfb)
+            assert body.n == gc["bits"]
+            out.extend(body)
+        return out.tobytes(size)
+
+    def _padding(self, kbps):
+        rem = (144000 * kbps) % self.rate
+        if rem == 0:
+            return 0
+        self.pad_acc += rem
+        if self.pad_acc >= self.rate:
+            self.pad_acc -= self.rate
+            return 1
+        return 0
+
+
+def crc16_arc(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def tag_frame(rate, mode, kbps, frames, sizes, enc_delay, enc_padding):
+    """Xing (VBR, kbps None) or Info (CBR) frame with a TOC and a LAME extension."""
+    channels = 1 if mode == MODE_MONO else 2
+    side = 17 if channels == 1 else 32
+    vbr = kbps is None
+    need = 4 + side + 120 + 36
+    if vbr or frame_bytes(kbps, rate, 0) < need:
+        kbps = next(k for k in BITRATES[1:] if frame_bytes(k, rate, 0) >= need)
+    size = frame_bytes(kbps, rate, 0)
+    total = size + sum(sizes)
+    toc = bytearray(100)
+    offsets = [size]
+    for s in sizes:
+        offsets.append(offsets[-1] + s)
+    for pct in range(100):
+        pos = offsets[min(len(sizes) - 1, pct * len(sizes) // 100)]
+        toc[pct] = min(255, pos * 256 // total)
+    body = bytearray(header(kbps, rate, 0, mode, 0).tobytes(4))
+    body += bytes(side)
+    body += b"Xing" if vbr else b"Info"
+    body += struct.pack(">III", 0x0F, frames, total)
+    body += toc
+    body += struct.pack(">I", 100 if vbr else 0)
+    lame = bytearray(34)
+    lame[0:9] = b"LAME3.100"
+    lame[9] = 0x04 if vbr else 0x01     # tag revision 0, VBR method
+    lame[10] = 160                      # lowpass, 100 Hz units
+    lame[21] = enc_delay >> 4
+    lame[22] = ((enc_delay & 0xF) << 4) | (enc_padding >> 8)
+    lame[23] = enc_padding & 0xFF
+    lame[28:32] = struct.pack(">I", total)
+    body += lame
+    body += struct.pack(">H", crc16_arc(bytes(body)))
+    return bytes(body) + bytes(size - len(body))
+
+
+# --- Test signals -------------------------------------------------------------
+
+class Noise:
+    """32-bit LCG, uniform in [-1, 1)."""
+
+    def __init__(self, seed):
+        self.state = seed
+
+    def next(self):
+        self.state = (self.state * 1664525 + 1013904223) & 0xFFFFFFFF
+        return self.state / 2.0 ** 31 - 1.0
+
+
+def music(rate, samples, channels, dynamic, seed):
+    """Short melody over bass and hi-hat noise; `dynamic` adds quiet and near-silent passages."""
+    noise = Noise(seed)
+    melody = [64, 67, 71, 72, 69, 65, 62, 60, 67, 74, 72, 71]
+    note_len = rate // 4
+    out = [[0.0] * samples for _ in range(channels)]
+    hp = 0.0
+    for n in range(samples):
+        t = n / rate
+        note = melody[(n // note_len) % len(melody)]
+        f = 440.0 * 2.0 ** ((note - 69) / 12.0)
+        age = (n % note_len) / rate
+        env = math.exp(-3.0 * age)
+        tone = env * (0.30 * math.sin(2 * math.pi * f * t) + 0.12 * math.sin(4 * math.pi * f * t)
+                      + 0.05 * math.sin(6 * math.pi * f * t))
+        bass = 0.18 * math.sin(2 * math.pi * 55.0 * 2.0 ** ((n // (2 * note_len)) % 3 / 12.0) * t)
+        w = noise.next()
+        hat = (w - hp) * math.exp(-40.0 * ((n % (rate // 8)) / rate)) * 0.06
+        hp = w
+        level = 1.0
+        if dynamic:
+            pos = n / samples
+            if 0.35 <= pos < 0.55:
+                level = 0.03
+            elif 0.55 <= pos < 0.70:
+                level = 0.001
+            elif pos >= 0.70:
+                hat *= 2.0
+        left = level * (tone + bass + hat)
+        right = level * (0.6 * tone + bass - 0.8 * hat)
+        if channels == 1:
+            out[0][n] = 0.5 * (left + right)
+        else:
+            out[0][n] = left
+            out[1][n] = right
+    return out
+
+
+# Swept sine shared by gapless_a/gapless_b; gapless_test.c regenerates it.
+CHIRP_F0 = 100.0
+CHIRP_F1 = 5000.0
+CHIRP_AMP = 0.5
+
+
+def chirp(rate, start, samples, total):
+    length = total / rate
+    out = [[0.0] * samples, [0.0] * samples]
+    for i in range(samples):
+        t = (start + i) / rate
+        v = CHIRP_AMP * math.sin(2 * math.pi * (CHIRP_F0 * t + (CHIRP_F1 - CHIRP_F0) * t * t / (2 * length)))
+        out[0][i] = v
+        out[1][i] = -0.5 * v
+    return out
+
+
+# --- Corpus -----------------------------------------------------------------------
+
+GAPLESS_RATE = 44100
+GAPLESS_A = 50000       # samples; neither length nor split is frame aligned
+GAPLESS_B = 41111
+
+# name, rate, mode, kbps (None = VBR at the given quality gain), source samples, tag, signal
+CORPUS = [
+    ("cbr128_44k_js.mp3", 44100, MODE_JOINT, 128, 88517, "info", "music"),
+    ("cbr192_44k_js.mp3", 44100, MODE_JOINT, 192, 88517, "none", "music"),
+    ("cbr320_44k_st.mp3", 44100, MODE_STEREO, 320, 88517, "none", "music"),
+    ("cbr128_48k_st.mp3", 48000, MODE_STEREO, 128, 96333, "info", "music"),
+    ("cbr96_32k_js.mp3", 32000, MODE_JOINT, 96, 64201, "none", "music"),
+    ("cbr64_44k_mono.mp3", 44100, MODE_MONO, 64, 88517, "info", "music"),
+    ("vbr_44k_js.mp3", 44100, MODE_JOINT, None, 132301, "xing", "dynamic"),
+    ("vbr_48k_st.mp3", 48000, MODE_STEREO, None, 144007, "xing", "dynamic"),
+    ("vbr_32k_mono.mp3", 32000, MODE_MONO, None, 96119, "xing", "dynamic"),
+    ("gapless_a.mp3", GAPLESS_RATE, MODE_JOINT, 128, GAPLESS_A, "info", "chirp"),
+    ("gapless_b.mp3", GAPLESS_RATE, MODE_JOINT, 128, GAPLESS_B, "info", "chirp"),
+]
+VBR_QUALITY_GAIN = 162
+
+
+def encode(name, rate, mode, kbps, samples, tag, signal, coder):
+    channels = 1 if mode == MODE_MONO else 2
+    if signal == "chirp":
+        total = GAPLESS_A + GAPLESS_B
+        pcm = chirp(rate, 0, GAPLESS_A, total) if name == "gapless_a.mp3" else chirp(rate, GAPLESS_A, GAPLESS_B, total)
+    else:
+        pcm = music(rate, samples, channels, signal == "dynamic", seed=samples)
+    # Enough frames that the decoder delay still leaves every source sample in the output.
+    frames = (ENC_DELAY + samples + DECODER_DELAY + FRAME - 1) // FRAME
+    padding = frames * FRAME - samples - ENC_DELAY
+    for ch in pcm:
+        ch.extend([0.0] * (frames * FRAME - samples))
+    enc = Encoder(rate, mode, coder)
+    body = []
+    for f in range(frames):
+        block = [ch[f * FRAME:(f + 1) * FRAME] for ch in pcm]
+        body.append(enc.frame(block, kbps=kbps, quality_gain=VBR_QUALITY_GAIN))
+    data = b"".join(body)
+    if tag != "none":
+        data = tag_frame(rate, mode, kbps, frames, [len(b) for b in body], ENC_DELAY, padding) + data
+    kbps_avg = len(b"".join(body)) * 8 * rate // (frames * FRAME * 1000)
+    return data, "%-20s %6d %d %-6s %4s %5d %5d %5d %7d %-5s %d" % (
+        name, rate, channels, {MODE_STEREO: "stereo", MODE_JOINT: "joint", MODE_MONO: "mono"}[mode],
+        kbps if kbps else "vbr", frames, ENC_DELAY, padding, samples, tag, kbps_avg)
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else HERE
+    only = sys.argv[2:]
+    coder = Coder()
+    lines = [
+        "# Generated by gen_corpus.py - do not edit.",
+        "# name rate channels mode kbps frames enc_delay padding samples tag avg_kbps",
+    ]
+    for spec in CORPUS:
+        if only and spec[0] not in only:
+            continue
+        data, line = encode(*spec, coder=coder)
+        with open(os.path.join(out_dir, spec[0]), "wb") as f:
+            f.write(data)
+        lines.append(line)
+        print(line)
+    if not only:
+        with open(os.path.join(out_dir, "corpus.txt"), "w") as f:
+            f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
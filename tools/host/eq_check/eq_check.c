@@ -0,0 +1,259 @@
+// EQ accuracy and cost on the two-band plan (150 Hz low shelf, 5 kHz high
+// shelf). For all 31 x 31 low/high steps, a log sweep (left) and white noise
+// (right) go through audio_eq the way audio_output_render() feeds it, and
+// the output is compared with the same RBJ shelves designed and run in
+// double precision. The fixed-point build must also decay to exact zero
+// after a burst (no limit cycles). Then cycles per stereo frame with both
+// bands active; on the host the cycle counter runs in ns (esp_cpu.h).
+//
+// Built twice: eq_check (Q2.29, as shipped) and eq_check_float
+// (AUDIO_EQ_FIXED=0).
+//
+//   eq_check [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_eq.h"
+#include "audio_eq_tables.h"
+#include "esp_cpu.h"
+
+#define CHECK_RATE 44100
+#define CHECK_FRAMES CHECK_RATE                 // one second per step pair
+#define CHECK_ONE (1 << AUDIO_EQ_FRAC_BITS)     // int16 LSB in EQ samples
+#define CHECK_DB_PER_STEP (12.0 / (AUDIO_EQ_STEPS - 1))
+#define CHECK_IDLE_FRAMES 8192
+
+// Per step pair, in int16 LSB. Single-precision direct form I loses bits on
+// the 150 Hz shelf, whose poles sit close to z = 1.
+#if AUDIO_EQ_FIXED
+#define CHECK_VARIANT "fixed"
+#define CHECK_MAX_RMS_LSB 0.1
+#define CHECK_MAX_ERR_LSB 0.5
+#else
+#define CHECK_VARIANT "float"
+#define CHECK_MAX_RMS_LSB 4.0
+#define CHECK_MAX_ERR_LSB 16.0
+#endif
+
+typedef struct {
+    double b0, b1, b2, a1, a2;
+    double x1[2], x2[2], y1[2], y2[2];
+} ref_biquad_t;
+
+static bool s_verbose = false;
+static int16_t s_src[CHECK_FRAMES * 2];
+static int32_t s_out[2][CHECK_FRAMES];
+
+// RBJ cookbook shelf, slope 1, as gen_eq_tables.py designs it.
+static void ref_design(ref_biquad_t *q, bool high, double freq, double gain_db)
+{
+    memset(q, 0, sizeof(*q));
+    if (gain_db == 0.0) {
+        q->b0 = 1.0;
+        return;
+    }
+    double a = pow(10.0, gain_db / 40.0);
+    double w0 = 2.0 * M_PI * freq / CHECK_RATE;
+    double cw = cos(w0);
+    double sa = 2.0 * sqrt(a) * sin(w0) / 2.0 * sqrt(2.0);
+    double b0, b1, b2, a0, a1, a2;
+    if (!high) {
+        b0 = a * ((a + 1) - (a - 1) * cw + sa);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cw);
+        b2 = a * ((a + 1) - (a - 1) * cw - sa);
+        a0 = (a + 1) + (a - 1) * cw + sa;
+        a1 = -2 * ((a - 1) + (a + 1) * cw);
+        a2 = (a + 1) + (a - 1) * cw - sa;
+    } else {
+        b0 = a * ((a + 1) + (a - 1) * cw + sa);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cw);
+        b2 = a * ((a + 1) + (a - 1) * cw - sa);
+        a0 = (a + 1) - (a - 1) * cw + sa;
+        a1 = 2 * ((a - 1) - (a + 1) * cw);
+        a2 = (a + 1) - (a - 1) * cw - sa;
+    }
+    q->b0 = b0 / a0;
+    q->b1 = b1 / a0;
+    q->b2 = b2 / a0;
+    q->a1 = a1 / a0;
+    q->a2 = a2 / a0;
+}
+
+static double ref_run(ref_biquad_t *q, int ch, double x)
+{
+    double y = q->b0 * x + q->b1 * q->x1[ch] + q->b2 * q->x2[ch] - q->a1 * q->y1[ch] - q->a2 * q->y2[ch];
+    q->x2[ch] = q->x1[ch];
+    q->x1[ch] = x;
+    q->y2[ch] = q->y1[ch];
+    q->y1[ch] = y;
+    return y;
+}
+
+// Sets both bands with no ramp: a rate change jumps to the new coefficients
+// and clears the filter state.
+static void eq_set_steps(uint8_t lo, uint8_t hi)
+{
+    audio_eq_set_sample_rate(8000);
+    audio_eq_begin();
+    audio_eq_set_band_step(0, lo);
+    audio_eq_set_band_step(1, hi);
+    audio_eq_set_sample_rate(CHECK_RATE);
+}
+
+// Runs `frames` of s_src through the EQ into s_out in render-sized blocks.
+static void eq_process(const int16_t *src, size_t frames)
+{
+    bool eq = audio_eq_begin();
+    for (size_t done = 0; done < frames; done += AUDIO_EQ_BLOCK_FRAMES) {
+        size_t n = frames - done;
+        if (n > AUDIO_EQ_BLOCK_FRAMES) {
+            n = AUDIO_EQ_BLOCK_FRAMES;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            s_out[0][done + i] = (int32_t)src[(done + i) * 2] * CHECK_ONE;
+            s_out[1][done + i] = (int32_t)src[(done + i) * 2 + 1] * CHECK_ONE;
+        }
+        if (eq) {
+            audio_eq_run(0, s_out[0] + done, n);
+            audio_eq_run(1, s_out[1] + done, n);
+            eq = audio_eq_next_block();
+        }
+    }
+}
+
+static void make_signal(void)
+{
+    uint32_t rng = 1;
+    double phase = 0.0;
+    for (size_t i = 0; i < CHECK_FRAMES; ++i) {
+        double f = 20.0 * pow(1000.0, (double)i / CHECK_FRAMES);
+        phase += 2.0 * M_PI * f / CHECK_RATE;
+        s_src[i * 2] = (int16_t)lrint(16384.0 * sin(phase));                   // -6 dBFS
+        rng = rng * 1664525U + 1013904223U;
+        s_src[i * 2 + 1] = (int16_t)((int32_t)(rng >> 16) % 8192);              // -12 dBFS
+    }
+}
+
+static bool check_accuracy(void)
+{
+    double worst_rms = 0.0;
+    double worst_err = 0.0;
+    double sum_rms = 0.0;
+    int worst_lo = 0;
+    int worst_hi = 0;
+    bool ok = true;
+    for (int lo = 0; lo < AUDIO_EQ_STEPS; ++lo) {
+        for (int hi = 0; hi < AUDIO_EQ_STEPS; ++hi) {
+            eq_set_steps((uint8_t)lo, (uint8_t)hi);
+            eq_process(s_src, CHECK_FRAMES);
+            ref_biquad_t low;
+            ref_biquad_t high;
+            ref_design(&low, false, 150.0, (lo - AUDIO_EQ_CENTER_STEP) * CHECK_DB_PER_STEP);
+            ref_design(&high, true, 5000.0, (hi - AUDIO_EQ_CENTER_STEP) * CHECK_DB_PER_STEP);
+            double err2 = 0.0;
+            double max_err = 0.0;
+            for (size_t i = 0; i < CHECK_FRAMES; ++i) {
+                for (int ch = 0; ch < 2; ++ch) {
+                    double ref = ref_run(&high, ch, ref_run(&low, ch, s_src[i * 2 + ch]));
+                    double d = fabs((double)s_out[ch][i] / CHECK_ONE - ref);
+                    err2 += d * d;
+                    if (d > max_err) {
+                        max_err = d;
+                    }
+                }
+            }
+            double rms = sqrt(err2 / (2.0 * CHECK_FRAMES));
+            sum_rms += rms;
+            if (rms > worst_rms) {
+                worst_rms = rms;
+                worst_lo = lo;
+                worst_hi = hi;
+            }
+            if (max_err > worst_err) {
+                worst_err = max_err;
+            }
+            bool pair_ok = rms <= CHECK_MAX_RMS_LSB && max_err <= CHECK_MAX_ERR_LSB;
+            if (!pair_ok) {
+                printf("  lo %2d hi %2d: rms %.4f LSB, max %.4f LSB  <-- OUT OF TOLERANCE\n", lo, hi, rms, max_err);
+            }
+            ok &= pair_ok;
+        }
+    }
+    printf("eq %s: %d x %d steps vs double reference: rms error mean %.4f worst %.4f LSB (lo %d hi %d), "
+           "max %.4f LSB\n",
+           CHECK_VARIANT, AUDIO_EQ_STEPS, AUDIO_EQ_STEPS, sum_rms / (AUDIO_EQ_STEPS * AUDIO_EQ_STEPS), worst_rms,
+           worst_lo, worst_hi, worst_err);
+    return ok;
+}
+
+// After a burst into full boost, silence must come out as exact zeros.
+static bool check_idle(void)
+{
+    static int16_t burst[CHECK_IDLE_FRAMES * 2];
+    memcpy(burst, s_src, 1024 * 2 * sizeof(int16_t));
+    eq_set_steps(AUDIO_EQ_STEPS - 1, AUDIO_EQ_STEPS - 1);
+    eq_process(burst, CHECK_IDLE_FRAMES);
+    size_t nonzero = 0;
+    for (size_t i = CHECK_IDLE_FRAMES / 2; i < CHECK_IDLE_FRAMES; ++i) {
+        nonzero += (s_out[0][i] != 0) + (s_out[1][i] != 0);
+    }
+#if AUDIO_EQ_FIXED
+    bool ok = nonzero == 0;
+#else
+    bool ok = true;     // float decays into denormals, not to zero
+#endif
+    if (s_verbose || !ok) {
+        printf("eq %s: %zu nonzero samples in the second half of the idle tail%s\n", CHECK_VARIANT, nonzero,
+               ok ? "" : "  <-- LIMIT CYCLE");
+    }
+    return ok;
+}
+
+static void bench(int reps)
+{
+    eq_set_steps(24, 6);
+    eq_process(s_src, CHECK_FRAMES);
+    uint64_t cycles = 0;
+    for (int r = 0; r < reps; ++r) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (size_t done = 0; done < CHECK_FRAMES; done += AUDIO_EQ_BLOCK_FRAMES) {
+            size_t n = CHECK_FRAMES - done;
+            if (n > AUDIO_EQ_BLOCK_FRAMES) {
+                n = AUDIO_EQ_BLOCK_FRAMES;
+            }
+            audio_eq_run(0, s_out[0] + done, n);
+            audio_eq_run(1, s_out[1] + done, n);
+        }
+        cycles += (uint32_t)(esp_cpu_get_cycle_count() - t0);
+        eq_process(s_src, CHECK_FRAMES);
+    }
+    printf("eq %s: %.2f cycles per stereo frame, 2 bands (%d x %d frames)\n", CHECK_VARIANT,
+           (double)cycles / ((double)reps * CHECK_FRAMES), reps, CHECK_FRAMES);
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 20;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    audio_eq_init(CHECK_RATE);
+    make_signal();
+    bool ok = check_accuracy();
+    ok &= check_idle();
+    bench(reps);
+    printf(ok ? "eq_check: OK\n" : "eq_check: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// Gapless joins: gapless_a.mp3 and gapless_b.mp3 are one chirp split at a
+// point that is not frame aligned, each with a LAME tag. Played back to back
+// the way the player does it (the second file opened while the first
+// decodes), the trimmed output must be exactly as long as the source and
+// line up with the chirp everywhere, with no gap or overlap at the join.
+// The second file is also played with its head pulled through
+// helix_mp3_source_read(), as a crossfade does, which must not change a
+// single sample.
+//
+//   gapless_check [-v]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "helix_mp3_wrapper.h"
+#include "host_corpus.h"
+
+// Must match gen_corpus.py.
+#define CHIRP_F0 100.0
+#define CHIRP_F1 5000.0
+#define CHIRP_AMP 0.5
+
+#define CHECK_WINDOW 1024
+#define CHECK_MAX_LAG 64
+#define CHECK_MIN_SNR_DB 30.0
+#define CHECK_PULL_FRAMES 3000
+
+typedef struct {
+    int16_t *pcm;           // interleaved stereo
+    size_t frames;
+    size_t cap;
+} pcm_buf_t;
+
+static bool s_verbose = false;
+
+static bool pcm_append(pcm_buf_t *b, const int16_t *data, size_t frames)
+{
+    if (b->frames + frames > b->cap) {
+        size_t cap = (b->cap ? b->cap * 2 : 65536) + frames;
+        int16_t *p = realloc(b->pcm, cap * 4);
+        if (!p) {
+            return false;
+        }
+        b->pcm = p;
+        b->cap = cap;
+    }
+    memcpy(b->pcm + b->frames * 2, data, frames * 4);
+    b->frames += frames;
+    return true;
+}
+
+static size_t append_sink(uint8_t *data, size_t len, void *user)
+{
+    return pcm_append(user, (const int16_t *)data, len / 4) ? len : 0;
+}
+
+static uint32_t native_rate(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    return sample_rate;
+}
+
+// Left channel of the source, int16 full scale.
+static double chirp_at(size_t i, uint32_t rate, size_t total)
+{
+    double length = (double)total / rate;
+    double t = (double)i / rate;
+    return 32768.0 * CHIRP_AMP *
+           sin(2.0 * M_PI * (CHIRP_F0 * t + (CHIRP_F1 - CHIRP_F0) * t * t / (2.0 * length)));
+}
+
+// SNR of out[at..] against the chirp shifted by `lag` samples.
+static double window_snr(const pcm_buf_t *out, size_t at, long lag, uint32_t rate, size_t total)
+{
+    double sig = 0.0;
+    double err = 0.0;
+    for (size_t i = at; i < at + CHECK_WINDOW; ++i) {
+        double ref = chirp_at((size_t)((long)i + lag), rate, total);
+        double d = out->pcm[i * 2] - ref;
+        sig += ref * ref;
+        err += d * d;
+    }
+    return 10.0 * log10(sig / (err > 0.0 ? err : 1e-9));
+}
+
+static bool check_window(const char *what, const pcm_buf_t *out, size_t at, uint32_t rate, size_t total)
+{
+    long best_lag = 0;
+    double best_snr = -1e9;
+    for (long lag = -CHECK_MAX_LAG; lag <= CHECK_MAX_LAG; ++lag) {
+        if ((long)at + lag < 0 || at + CHECK_WINDOW + (size_t)(lag > 0 ? lag : 0) > total) {
+            continue;
+        }
+        double snr = window_snr(out, at, lag, rate, total);
+        if (snr > best_snr) {
+            best_snr = snr;
+            best_lag = lag;
+        }
+    }
+    bool ok = best_lag == 0 && best_snr >= CHECK_MIN_SNR_DB;
+    if (s_verbose || !ok) {
+        printf("  %-16s at %6zu: lag %+ld, SNR %5.1f dB%s\n", what, at, best_lag, best_snr,
+               ok ? "" : "  <-- GAP/OVERLAP");
+    }
+    return ok;
+}
+
+// Both files back to back; `pull` frames of the second one go through
+// helix_mp3_source_read() first.
+static bool play_pair(const char *path_a, const char *path_b, size_t pull, pcm_buf_t *out)
+{
+    helix_mp3_source_t *a = helix_mp3_open(path_a, 0.0f);
+    helix_mp3_source_t *b = helix_mp3_open(path_b, 0.0f);
+    bool ok = a && b;
+    if (ok) {
+        ok = helix_mp3_decode_source(a, append_sink, native_rate, out, NULL, NULL);
+        a = NULL;
+    }
+    if (ok && pull > 0) {
+        int16_t *head = malloc(pull * 4);
+        size_t got = head ? helix_mp3_source_read(b, head, pull, NULL) : 0;
+        ok = got == pull && pcm_append(out, head, got);
+        free(head);
+    }
+    if (ok) {
+        ok = helix_mp3_decode_source(b, append_sink, native_rate, out, NULL, NULL);
+        b = NULL;
+    }
+    helix_mp3_close(a);
+    helix_mp3_close(b);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    static host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int count = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    const host_corpus_file_t *fa = host_corpus_find(files, count, "gapless_a.mp3");
+    const host_corpus_file_t *fb = host_corpus_find(files, count, "gapless_b.mp3");
+    if (!fa || !fb) {
+        printf("gapless_a/b.mp3 missing from corpus.txt\n");
+        return 1;
+    }
+    char path_a[4096];
+    char path_b[4096];
+    host_corpus_path(fa, path_a, sizeof(path_a));
+    host_corpus_path(fb, path_b, sizeof(path_b));
+    size_t join = fa->samples;
+    size_t total = fa->samples + fb->samples;
+    uint32_t rate = fa->rate;
+
+    // Player mode: without PSRAM the second file gets a heap context.
+    helix_mp3_arena_init();
+    bool ok = true;
+    pcm_buf_t out = {0};
+    if (!play_pair(path_a, path_b, 0, &out)) {
+        printf("gapless: decode failed\n");
+        ok = false;
+    } else if (out.frames != total) {
+        printf("gapless: %zu frames, source has %zu (%+ld)\n", out.frames, total, (long)out.frames - (long)total);
+        ok = false;
+    } else {
+        ok &= check_window("start", &out, CHECK_MAX_LAG, rate, total);
+        ok &= check_window("end of a", &out, join - CHECK_WINDOW, rate, total);
+        ok &= check_window("across the join", &out, join - CHECK_WINDOW / 2, rate, total);
+        ok &= check_window("start of b", &out, join, rate, total);
+        ok &= check_window("end", &out, total - CHECK_WINDOW, rate, total);
+    }
+    printf("gapless: %zu + %zu frames, %s\n", (size_t)fa->samples, (size_t)fb->samples, ok ? "joined" : "NOT JOINED");
+
+    pcm_buf_t pulled = {0};
+    bool same = play_pair(path_a, path_b, CHECK_PULL_FRAMES, &pulled) && pulled.frames == out.frames &&
+                memcmp(pulled.pcm, out.pcm, out.frames * 4) == 0;
+    printf("gapless: %u frames pulled ahead of the second file, output %s\n", (unsigned)CHECK_PULL_FRAMES,
+           same ? "identical" : "DIFFERS");
+    ok &= same;
+
+    helix_mp3_arena_deinit();
+    free(out.pcm);
+    free(pulled.pcm);
+    printf(ok ? "gapless_check: OK\n" : "gapless_check: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,380 @@
+// System tones over Bluetooth music: handover latency and dropped samples,
+// the mixer against the exclusive owner model it replaced. An A2DP thread
+// delivers BT audio in real time into the 64 KB BT ring, and the BT I2S task
+// moves it on in 360-frame chunks, as bt_app_core.c does. Every 600 ms a
+// 150 ms system tone (plus its 30 ms silence tail) is played over it.
+//
+// Owner model (audio_owner.c before the mixer): the tone takes the output by
+// force, the BT task stops writing while it does not own it, the tone is
+// written straight to I2S behind what BT had queued, then its tail, and
+// audio_i2s_reset() drops the DMA queue before BT may write again.
+//
+// Mixer: BT stays open and writes into its source ring; the tone opens its
+// own source, writes and closes, and the mixer ducks BT under it.
+//
+// BT frames carry audio on the left channel only and the tone on the right,
+// so at the host DAC's tap either can be told apart through ducking.
+// Reported per model, in ms of audio: tone latency from request to first
+// audible frame (average and worst), the longest stretch with no BT audio
+// once BT started, and BT audio dropped (delivered but never heard). The
+// mixer must drop nothing, never silence BT for longer than one DMA buffer,
+// and start tones no later than the owner model did.
+//
+// Times are counted in DAC frames including the buffers that went out empty,
+// so they hold to one DMA buffer at any speed.
+//
+//   handover_bench [-v] [-n tones]
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "audio_mixer.h"
+#include "audio_output_host.h"
+#include "audio_pcm5102.h"
+
+#define BENCH_RATE 44100
+#define BENCH_SPEED 8.0                 // DAC runs this much faster than real time
+#define BENCH_BT_RING_FRAMES (64 * 1024 / 4)        // RINGBUF_HIGHEST_WATER_LEVEL
+#define BENCH_BT_PREFETCH_FRAMES (40 * 1024 / 4)    // RINGBUF_PREFETCH_START_BYTES
+#define BENCH_BT_CHUNK_FRAMES (240 * 6 / 4)         // BT_I2S_CHUNK_BYTES
+#define BENCH_BT_PACKET_FRAMES 512      // A2DP delivery
+#define BENCH_TONE_CHUNK_FRAMES 256     // AUDIO_CHUNK_FRAMES
+#define BENCH_TONE_MS 150
+#define BENCH_TONE_TAIL_MS 30
+#define BENCH_TONE_PERIOD_MS 600
+#define BENCH_SETTLE_MS 500
+#define BENCH_BT_LEVEL 4096
+#define BENCH_TONE_LEVEL 8192
+
+typedef enum {
+    MODEL_OWNER = 0,
+    MODEL_MIXER,
+} bench_model_t;
+
+typedef struct {
+    double latency_avg_ms;
+    double latency_max_ms;
+    double gap_ms;
+    double dropped_ms;
+    uint32_t missed;            // tones never heard
+} handover_result_t;
+
+static bool s_verbose = false;
+static bench_model_t s_model = MODEL_OWNER;
+
+// BT ring between the A2DP thread and the BT I2S task.
+static pthread_mutex_t s_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static int16_t s_ring[BENCH_BT_RING_FRAMES * 2];
+static size_t s_ring_head = 0;
+static size_t s_ring_len = 0;
+static bool s_prefetching = true;
+static uint64_t s_bt_delivered = 0;
+static uint64_t s_bt_overflow = 0;
+static volatile bool s_bt_running = false;
+static volatile bool s_bt_owner = true;     // owner model: BT holds the output
+
+// DAC tap, in frames since start including empty buffers.
+static pthread_mutex_t s_tap_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t s_tapped = 0;
+static uint64_t s_bt_heard = 0;
+static uint64_t s_last_bt = 0;
+static bool s_bt_started = false;
+static uint64_t s_max_gap = 0;
+static uint64_t s_tone_req = 0;
+static bool s_tone_waiting = false;
+static uint64_t s_tone_latency = 0;
+
+static void sleep_audio_ms(double ms)
+{
+    usleep((useconds_t)(ms * 1000.0 / BENCH_SPEED));
+}
+
+static uint64_t dac_clock(void)
+{
+    return (uint64_t)host_i2s_underruns() * HOST_I2S_DMA_FRAMES + audio_i2s_get_played_frames();
+}
+
+static void dac_tap(const int16_t *pcm, size_t frames, void *user)
+{
+    (void)user;
+    uint64_t empty = (uint64_t)host_i2s_underruns() * HOST_I2S_DMA_FRAMES;
+    pthread_mutex_lock(&s_tap_lock);
+    for (size_t i = 0; i < frames; ++i) {
+        uint64_t at = empty + s_tapped + i;
+        if (pcm[i * 2] != 0) {
+            if (s_bt_started && at - s_last_bt > s_max_gap) {
+                s_max_gap = at - s_last_bt;
+            }
+            s_bt_started = true;
+            s_last_bt = at;
+            s_bt_heard++;
+        }
+        if (pcm[i * 2 + 1] != 0 && s_tone_waiting) {
+            s_tone_waiting = false;
+            s_tone_latency = (at > s_tone_req) ? at - s_tone_req : 0;
+        }
+    }
+    s_tapped += frames;
+    pthread_mutex_unlock(&s_tap_lock);
+}
+
+static void *a2dp_thread(void *arg)
+{
+    (void)arg;
+    while (s_bt_running) {
+        pthread_mutex_lock(&s_ring_lock);
+        size_t space = BENCH_BT_RING_FRAMES - s_ring_len;
+        size_t n = (space < BENCH_BT_PACKET_FRAMES) ? space : BENCH_BT_PACKET_FRAMES;
+        for (size_t i = 0; i < n; ++i) {
+            size_t at = (s_ring_head + s_ring_len + i) % BENCH_BT_RING_FRAMES;
+            s_ring[at * 2] = BENCH_BT_LEVEL;
+            s_ring[at * 2 + 1] = 0;
+        }
+        s_ring_len += n;
+        s_bt_delivered += BENCH_BT_PACKET_FRAMES;
+        s_bt_overflow += BENCH_BT_PACKET_FRAMES - n;
+        if (s_ring_len >= BENCH_BT_PREFETCH_FRAMES) {
+            s_prefetching = false;
+        }
+        pthread_mutex_unlock(&s_ring_lock);
+        sleep_audio_ms(1000.0 * BENCH_BT_PACKET_FRAMES / BENCH_RATE);
+    }
+    return NULL;
+}
+
+static size_t ring_pop(int16_t *out, size_t max)
+{
+    pthread_mutex_lock(&s_ring_lock);
+    size_t n = s_prefetching ? 0 : ((s_ring_len < max) ? s_ring_len : max);
+    for (size_t i = 0; i < n; ++i) {
+        size_t at = (s_ring_head + i) % BENCH_BT_RING_FRAMES;
+        out[i * 2] = s_ring[at * 2];
+        out[i * 2 + 1] = s_ring[at * 2 + 1];
+    }
+    s_ring_head = (s_ring_head + n) % BENCH_BT_RING_FRAMES;
+    s_ring_len -= n;
+    pthread_mutex_unlock(&s_ring_lock);
+    return n;
+}
+
+static size_t ring_level(void)
+{
+    pthread_mutex_lock(&s_ring_lock);
+    size_t n = s_ring_len;
+    pthread_mutex_unlock(&s_ring_lock);
+    return n;
+}
+
+// bt_i2s_task_handler(): poll ownership every 10 ms under the owner model,
+// write into the BT source under the mixer.
+static void *bt_i2s_thread(void *arg)
+{
+    (void)arg;
+    static int16_t chunk[BENCH_BT_CHUNK_FRAMES * 2];
+    while (s_bt_running || ring_level() > 0) {
+        if (s_model == MODEL_OWNER && !s_bt_owner) {
+            sleep_audio_ms(10);
+            continue;
+        }
+        size_t n = ring_pop(chunk, BENCH_BT_CHUNK_FRAMES);
+        if (n == 0) {
+            sleep_audio_ms(2);
+            continue;
+        }
+        size_t wrote = 0;
+        if (s_model == MODEL_OWNER) {
+            audio_i2s_write(chunk, n * 4, &wrote, 1000);
+        } else {
+            audio_mixer_write(AUDIO_SOURCE_BT, chunk, n * 4, &wrote, 1000);
+        }
+    }
+    return NULL;
+}
+
+static void tone_write(const int16_t *frames, size_t count)
+{
+    size_t wrote = 0;
+    if (s_model == MODEL_OWNER) {
+        audio_i2s_write(frames, count * 4, &wrote, 5000);
+    } else {
+        audio_mixer_write(AUDIO_SOURCE_TONE, frames, count * 4, &wrote, 5000);
+    }
+}
+
+// audio_play_system_tone() and the audio task writing it out.
+static void play_tone(void)
+{
+    static int16_t chunk[BENCH_TONE_CHUNK_FRAMES * 2];
+    if (s_model == MODEL_OWNER) {
+        s_bt_owner = false;
+    } else {
+        audio_mixer_open(AUDIO_SOURCE_TONE);
+    }
+    uint64_t req = dac_clock();
+    pthread_mutex_lock(&s_tap_lock);
+    s_tone_req = req;
+    s_tone_waiting = true;
+    pthread_mutex_unlock(&s_tap_lock);
+
+    uint32_t tone = BENCH_RATE * BENCH_TONE_MS / 1000;
+    uint32_t tail = BENCH_RATE * BENCH_TONE_TAIL_MS / 1000;
+    for (uint32_t at = 0; at < tone + tail; at += BENCH_TONE_CHUNK_FRAMES) {
+        uint32_t n = (tone + tail - at < BENCH_TONE_CHUNK_FRAMES) ? tone + tail - at : BENCH_TONE_CHUNK_FRAMES;
+        for (uint32_t i = 0; i < n; ++i) {
+            chunk[i * 2] = 0;
+            chunk[i * 2 + 1] = (at + i < tone) ? BENCH_TONE_LEVEL : 0;
+        }
+        tone_write(chunk, n);
+    }
+    if (s_model == MODEL_OWNER) {
+        // audio_i2s_reset(): the channel restarts with its DMA queue dropped.
+        audio_i2s_set_sample_rate(BENCH_RATE);
+        s_bt_owner = true;
+    } else {
+        audio_mixer_close(AUDIO_SOURCE_TONE);
+    }
+}
+
+static bool run_model(bench_model_t model, int tones, handover_result_t *res)
+{
+    s_model = model;
+    s_ring_head = 0;
+    s_ring_len = 0;
+    s_prefetching = true;
+    s_bt_delivered = 0;
+    s_bt_overflow = 0;
+    s_bt_owner = true;
+    s_bt_running = true;
+    pthread_mutex_lock(&s_tap_lock);
+    s_bt_heard = 0;
+    s_bt_started = false;
+    s_max_gap = 0;
+    s_tone_waiting = false;
+    pthread_mutex_unlock(&s_tap_lock);
+    if (model == MODEL_MIXER && !audio_mixer_open(AUDIO_SOURCE_BT)) {
+        return false;
+    }
+
+    pthread_t a2dp;
+    pthread_t bt;
+    pthread_create(&a2dp, NULL, a2dp_thread, NULL);
+    pthread_create(&bt, NULL, bt_i2s_thread, NULL);
+    sleep_audio_ms(BENCH_SETTLE_MS + 1000.0 * BENCH_BT_PREFETCH_FRAMES / BENCH_RATE);
+
+    double sum = 0.0;
+    int heard = 0;
+    res->latency_max_ms = 0.0;
+    res->missed = 0;
+    for (int t = 0; t < tones; ++t) {
+        play_tone();
+        sleep_audio_ms(BENCH_TONE_PERIOD_MS - BENCH_TONE_MS - BENCH_TONE_TAIL_MS);
+        pthread_mutex_lock(&s_tap_lock);
+        bool waiting = s_tone_waiting;
+        double ms = s_tone_latency * 1000.0 / BENCH_RATE;
+        s_tone_waiting = false;
+        pthread_mutex_unlock(&s_tap_lock);
+        if (waiting) {
+            res->missed++;
+            continue;
+        }
+        if (s_verbose) {
+            printf("  tone %d: heard after %.1f ms\n", t, ms);
+        }
+        sum += ms;
+        heard++;
+        if (ms > res->latency_max_ms) {
+            res->latency_max_ms = ms;
+        }
+    }
+    sleep_audio_ms(BENCH_SETTLE_MS);
+
+    // Stop delivering and let everything queued play out.
+    s_bt_running = false;
+    pthread_join(a2dp, NULL);
+    pthread_join(bt, NULL);
+    if (model == MODEL_MIXER) {
+        audio_mixer_close(AUDIO_SOURCE_BT);
+    }
+    for (int i = 0; i < 500; ++i) {
+        sleep_audio_ms(10);
+        if (audio_i2s_get_played_frames() == audio_i2s_get_written_frames() &&
+            (model == MODEL_OWNER || audio_mixer_get_played_frames(AUDIO_SOURCE_BT) ==
+                                         audio_mixer_get_written_frames(AUDIO_SOURCE_BT))) {
+            break;
+        }
+    }
+    sleep_audio_ms(10);
+
+    pthread_mutex_lock(&s_tap_lock);
+    uint64_t bt_heard = s_bt_heard;
+    uint64_t gap = s_max_gap;
+    pthread_mutex_unlock(&s_tap_lock);
+    res->latency_avg_ms = heard ? sum / heard : 0.0;
+    res->gap_ms = gap * 1000.0 / BENCH_RATE;
+    res->dropped_ms = (s_bt_delivered > bt_heard) ? (s_bt_delivered - bt_heard) * 1000.0 / BENCH_RATE : 0.0;
+    if (s_verbose) {
+        printf("  BT: %llu frames delivered, %llu overflowed the ring, %llu heard\n",
+               (unsigned long long)s_bt_delivered, (unsigned long long)s_bt_overflow,
+               (unsigned long long)bt_heard);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int tones = 4;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            tones = atoi(argv[++i]);
+        }
+    }
+    if (tones < 1) {
+        tones = 1;
+    }
+    host_i2s_start(BENCH_RATE, BENCH_SPEED, dac_tap, NULL);
+
+    static const char *const names[] = {"owner", "mixer"};
+    handover_result_t res[2] = {0};
+    bool ok = run_model(MODEL_OWNER, tones, &res[MODEL_OWNER]);
+    // The mixer task owns the I2S write from here on.
+    ok = ok && audio_mixer_init() == ESP_OK && run_model(MODEL_MIXER, tones, &res[MODEL_MIXER]);
+    host_i2s_stop();
+    if (!ok) {
+        printf("handover_bench: FAILED (setup)\n");
+        return 1;
+    }
+
+    printf("%d tones of %d ms over BT, ms of audio:\n", tones, BENCH_TONE_MS);
+    printf("%-6s %12s %12s %10s %11s\n", "model", "latency avg", "latency max", "BT gap", "BT dropped");
+    for (int m = MODEL_OWNER; m <= MODEL_MIXER; ++m) {
+        printf("%-6s %12.1f %12.1f %10.1f %11.1f\n", names[m], res[m].latency_avg_ms, res[m].latency_max_ms,
+               res[m].gap_ms, res[m].dropped_ms);
+        if (res[m].missed > 0) {
+            printf("  %s: %u tones never heard\n", names[m], (unsigned)res[m].missed);
+            ok = false;
+        }
+    }
+    const handover_result_t *mix = &res[MODEL_MIXER];
+    double dma_ms = HOST_I2S_DMA_FRAMES * 1000.0 / BENCH_RATE;
+    if (mix->dropped_ms > 0.0) {
+        printf("  mixer dropped %.1f ms of BT audio\n", mix->dropped_ms);
+        ok = false;
+    }
+    if (mix->gap_ms > dma_ms) {
+        printf("  mixer left BT silent for %.1f ms\n", mix->gap_ms);
+        ok = false;
+    }
+    if (mix->latency_max_ms > res[MODEL_OWNER].latency_max_ms + dma_ms) {
+        printf("  mixer starts tones later than the owner model\n");
+        ok = false;
+    }
+    printf(ok ? "handover_bench: OK\n" : "handover_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
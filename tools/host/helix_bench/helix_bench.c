@@ -0,0 +1,152 @@
+// Host benchmark for the decode path the player uses: helix_mp3_decode_file()
+// into a byte-counting sink, reporting frames/s, per-stage ns/frame and the
+// PCM CRC32 for every file of the corpus (or the files given).
+//
+//   helix_bench [-n runs] [--check] [file.mp3 ...]
+//
+// Timings are the best of `runs` passes. --check compares the output length
+// with corpus.txt and the CRC with helix_crc.txt, so the reference and the
+// HELIX_HUFF_FAST builds must decode bit-identically.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "helix_mp3_wrapper.h"
+#include "host_corpus.h"
+
+static host_corpus_file_t s_files[HOST_CORPUS_MAX_FILES];
+static int s_file_count = 0;
+static uint32_t s_crc[HOST_CORPUS_MAX_FILES];
+static bool s_have_crc[HOST_CORPUS_MAX_FILES];
+
+static size_t count_sink(uint8_t *data, size_t len, void *user)
+{
+    (void)data;
+    *(uint64_t *)user += len;
+    return len;
+}
+
+// Keep the stream rate: the benchmark measures decoding, not resampling.
+static uint32_t native_rate(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    return sample_rate;
+}
+
+static void load_crcs(void)
+{
+    FILE *f = fopen(CORPUS_DIR "/helix_crc.txt", "r");
+    if (!f) {
+        return;
+    }
+    char line[256];
+    char name[64];
+    unsigned crc;
+    while (fgets(line, sizeof(line), f)) {
+        const host_corpus_file_t *c;
+        if (line[0] != '#' && sscanf(line, "%63s %x", name, &crc) == 2 &&
+            (c = host_corpus_find(s_files, s_file_count, name)) != NULL) {
+            s_crc[c - s_files] = crc;
+            s_have_crc[c - s_files] = true;
+        }
+    }
+    fclose(f);
+}
+
+static bool bench_one(const char *path, const char *name, int runs, bool check)
+{
+    helix_mp3_stats_t best = {0};
+    uint64_t bytes = 0;
+    for (int r = 0; r < runs; ++r) {
+        bytes = 0;
+        if (!helix_mp3_decode_file(path, count_sink, native_rate, &bytes, NULL, NULL, 0.0f)) {
+            printf("%-20s decode failed\n", name);
+            return false;
+        }
+        helix_mp3_stats_t st;
+        helix_mp3_get_last_stats(&st);
+        if (r == 0 || st.decode_us < best.decode_us) {
+            best = st;
+        }
+    }
+    uint32_t ns_frame = best.frames ? (uint32_t)((uint64_t)best.decode_us * 1000ULL / best.frames) : 0;
+    printf("%-20s %5u %7u %7u %8u %8u %8u %8u %7u  %08x\n", name, (unsigned)best.frames,
+           (unsigned)best.frames_per_sec, (unsigned)ns_frame,
+           (unsigned)best.stage_ns_per_frame[0], (unsigned)best.stage_ns_per_frame[1],
+           (unsigned)best.stage_ns_per_frame[2], (unsigned)best.stage_ns_per_frame[3],
+           (unsigned)best.heap_peak, (unsigned)best.pcm_crc32);
+
+    if (!check) {
+        return true;
+    }
+    const host_corpus_file_t *ref = host_corpus_find(s_files, s_file_count, name);
+    if (!ref) {
+        printf("  %s: not in corpus.txt\n", name);
+        return false;
+    }
+    bool ok = true;
+    // The sink always receives 16-bit stereo.
+    uint64_t want = (uint64_t)host_corpus_output_frames(ref) * 4U;
+    if (bytes != want) {
+        printf("  %s: %llu output bytes, expected %llu\n", name, (unsigned long long)bytes,
+               (unsigned long long)want);
+        ok = false;
+    }
+    size_t idx = (size_t)(ref - s_files);
+    if (!s_have_crc[idx]) {
+        printf("  %s: no reference CRC in helix_crc.txt\n", name);
+        ok = false;
+    } else if (s_crc[idx] != best.pcm_crc32) {
+        printf("  %s: CRC %08x, expected %08x\n", name, (unsigned)best.pcm_crc32, (unsigned)s_crc[idx]);
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 5;
+    bool check = false;
+    int first_file = argc;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+    s_file_count = host_corpus_load(s_files, HOST_CORPUS_MAX_FILES);
+    if (s_file_count == 0 && (check || first_file == argc)) {
+        return 1;
+    }
+    load_crcs();
+
+    // Player mode: decoder contexts come from the arena, as on the device.
+    helix_mp3_arena_init();
+    printf("%-20s %5s %7s %7s %8s %8s %8s %8s %7s  %s\n", "file", "frms", "fps", "ns/frm",
+           "huffman", "dequant", "imdct", "polyph", "heap", "pcm_crc32");
+    bool ok = true;
+    char path[4096];
+    if (first_file < argc) {
+        for (int i = first_file; i < argc; ++i) {
+            const char *name = strrchr(argv[i], '/');
+            ok &= bench_one(argv[i], name ? name + 1 : argv[i], runs, check);
+        }
+    } else {
+        for (int i = 0; i < s_file_count; ++i) {
+            host_corpus_path(&s_files[i], path, sizeof(path));
+            ok &= bench_one(path, s_files[i].name, runs, check);
+        }
+    }
+    helix_mp3_arena_deinit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+// Limiter overshoot and cost. Below the ceiling the output must be the input,
+// bit-exact, delayed by the look-ahead. Hot material (sines, clicks, noise,
+// square, sweep bursts, 6-18 dB over) is run at the default attack, at the
+// longest look-ahead and with a one-frame window: no output sample may
+// exceed the ceiling, and limited peaks must still come within 3 dB of it.
+// Then cycles per stereo frame, idle, limiting and with the compressor; on
+// the host the cycle counter runs in ns (esp_cpu.h).
+//
+//   limiter_check [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_limiter.h"
+#include "esp_cpu.h"
+
+#define CHECK_RATE 44100
+#define CHECK_FRAMES CHECK_RATE
+#define CHECK_ONE (1 << AUDIO_EQ_FRAC_BITS)     // int16 LSB in limiter samples
+#define CHECK_FULL_SCALE (32768.0 * CHECK_ONE)
+#define CHECK_MIN_PEAK_DB -3.0                  // limited peaks below the ceiling
+#define CHECK_BENCH_FRAMES 4096
+
+typedef enum {
+    SIG_SINE_1K,
+    SIG_SINE_60,
+    SIG_CLICKS,
+    SIG_NOISE,
+    SIG_SQUARE,
+    SIG_SWEEP_BURST,
+} check_signal_t;
+
+static const struct {
+    const char *name;
+    check_signal_t kind;
+    double over_db;
+} s_cases[] = {
+    {"sine 1 kHz", SIG_SINE_1K, 6.0},
+    {"sine 60 Hz", SIG_SINE_60, 12.0},
+    {"clicks", SIG_CLICKS, 18.0},
+    {"noise", SIG_NOISE, 12.0},
+    {"square 200 Hz", SIG_SQUARE, 9.0},
+    {"sweep bursts", SIG_SWEEP_BURST, 15.0},
+};
+
+static const struct {
+    const char *name;
+    uint16_t attack_us;
+} s_attacks[] = {
+    {"default", 1500},
+    {"longest", 3000},
+    {"1 frame", 0},
+};
+
+static bool s_verbose = false;
+static int32_t s_in[2][CHECK_FRAMES];
+static int32_t s_out[2][CHECK_FRAMES];
+static uint32_t s_rng = 1;
+
+static double check_rand(void)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return (double)(s_rng >> 8) / (double)(1U << 24) * 2.0 - 1.0;
+}
+
+static void limiter_setup(uint16_t attack_us, bool comp)
+{
+    audio_limiter_init(CHECK_RATE);
+    audio_limiter_config_t cfg;
+    audio_limiter_get_config(&cfg);
+    cfg.attack_us = attack_us;
+    cfg.comp_enabled = comp;
+    audio_limiter_set_config(&cfg);
+}
+
+static double ceiling_level(void)
+{
+    audio_limiter_config_t cfg;
+    audio_limiter_get_config(&cfg);
+    return CHECK_FULL_SCALE * pow(10.0, cfg.ceiling_db / 20.0);
+}
+
+// s_in through the limiter into s_out, in output-stage sub-blocks.
+static void limiter_run(size_t frames)
+{
+    memcpy(s_out, s_in, sizeof(s_out));
+    for (size_t done = 0; done < frames; done += AUDIO_LIMITER_BLOCK_FRAMES) {
+        size_t n = frames - done;
+        if (n > AUDIO_LIMITER_BLOCK_FRAMES) {
+            n = AUDIO_LIMITER_BLOCK_FRAMES;
+        }
+        audio_limiter_process(s_out[0] + done, s_out[1] + done, n);
+    }
+}
+
+static void make_signal(check_signal_t kind, double amp)
+{
+    for (size_t i = 0; i < CHECK_FRAMES; ++i) {
+        double t = (double)i / CHECK_RATE;
+        double v;
+        double right = 0.9;
+        switch (kind) {
+        case SIG_SINE_1K:
+            v = sin(2.0 * M_PI * 1000.0 * t);
+            break;
+        case SIG_SINE_60:
+            v = sin(2.0 * M_PI * 60.0 * t);
+            break;
+        case SIG_CLICKS:
+            // Three-frame clicks of alternating sign every 100 ms over a quiet tone.
+            v = (i % 4410 < 3) ? (((i / 4410) & 1) ? 1.0 : -1.0) : 0.05 * sin(2.0 * M_PI * 440.0 * t);
+            break;
+        case SIG_NOISE:
+            v = check_rand();
+            right = -0.8;
+            break;
+        case SIG_SQUARE:
+            v = (sin(2.0 * M_PI * 200.0 * t) > 0.0) ? 1.0 : -1.0;
+            break;
+        default:
+            v = ((i / 8820) & 1) ? sin(2.0 * M_PI * (50.0 + 8000.0 * t) * t) : 0.1 * sin(2.0 * M_PI * 300.0 * t);
+            break;
+        }
+        s_in[0][i] = (int32_t)(amp * v);
+        s_in[1][i] = (int32_t)(amp * v * right);
+    }
+}
+
+static bool check_transparent(void)
+{
+    limiter_setup(1500, false);
+    size_t lat = audio_limiter_latency_frames();
+    double amp = ceiling_level() * 0.7;
+    for (size_t i = 0; i < CHECK_FRAMES; ++i) {
+        s_in[0][i] = (int32_t)(amp * check_rand());
+        s_in[1][i] = -s_in[0][i] / 3;
+    }
+    limiter_run(CHECK_FRAMES);
+    size_t bad = 0;
+    for (size_t i = lat; i < CHECK_FRAMES; ++i) {
+        bad += s_out[0][i] != s_in[0][i - lat] || s_out[1][i] != s_in[1][i - lat];
+    }
+    printf("limiter: below the ceiling %zu of %zu frames differ (latency %zu frames)\n", bad,
+           (size_t)CHECK_FRAMES - lat, lat);
+    return bad == 0;
+}
+
+static bool check_overshoot(const char *attack_name, uint16_t attack_us)
+{
+    bool ok = true;
+    double worst_db = -INFINITY;
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); ++c) {
+        limiter_setup(attack_us, false);
+        double ceiling = ceiling_level();
+        make_signal(s_cases[c].kind, ceiling * pow(10.0, s_cases[c].over_db / 20.0));
+        limiter_run(CHECK_FRAMES);
+        double peak = 0.0;
+        size_t over = 0;
+        for (size_t i = 0; i < CHECK_FRAMES; ++i) {
+            for (int ch = 0; ch < 2; ++ch) {
+                double a = fabs((double)s_out[ch][i]);
+                over += a > ceiling;
+                if (a > peak) {
+                    peak = a;
+                }
+            }
+        }
+        double peak_db = 20.0 * log10(peak / ceiling);
+        if (peak_db > worst_db) {
+            worst_db = peak_db;
+        }
+        bool case_ok = over == 0 && peak_db >= CHECK_MIN_PEAK_DB;
+        if (s_verbose || !case_ok) {
+            printf("  %-8s %-14s %+5.1f dB in -> peak %+8.4f dB re ceiling, %zu samples over%s\n", attack_name,
+                   s_cases[c].name, s_cases[c].over_db, peak_db, over,
+                   case_ok ? "" : (over ? "  <-- OVERSHOOT" : "  <-- OVER-ATTENUATED"));
+        }
+        ok &= case_ok;
+    }
+    printf("limiter: %s attack (%u us, latency %zu frames): highest peak %+.4f dB re ceiling\n", attack_name,
+           (unsigned)attack_us, audio_limiter_latency_frames(), worst_db);
+    return ok;
+}
+
+static void bench(int reps)
+{
+    static const struct {
+        const char *name;
+        bool comp;
+        double level_db;
+    } runs[] = {
+        {"idle (-10 dB)", false, -10.0},
+        {"limiting (+12 dB)", false, 12.0},
+        {"compressor + limiter", true, -6.0},
+    };
+    for (size_t k = 0; k < sizeof(runs) / sizeof(runs[0]); ++k) {
+        limiter_setup(1500, runs[k].comp);
+        double amp = ceiling_level() * pow(10.0, runs[k].level_db / 20.0);
+        for (size_t i = 0; i < CHECK_BENCH_FRAMES; ++i) {
+            s_in[0][i] = (int32_t)(amp * sin(2.0 * M_PI * 300.0 * i / CHECK_RATE) + 64000.0 * check_rand());
+            s_in[1][i] = s_in[0][i] / 2;
+        }
+        uint32_t best = UINT32_MAX;
+        for (int r = 0; r < reps; ++r) {
+            memcpy(s_out, s_in, sizeof(s_out));
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            for (size_t done = 0; done < CHECK_BENCH_FRAMES; done += AUDIO_LIMITER_BLOCK_FRAMES) {
+                audio_limiter_process(s_out[0] + done, s_out[1] + done, AUDIO_LIMITER_BLOCK_FRAMES);
+            }
+            uint32_t t = esp_cpu_get_cycle_count() - t0;
+            if (t < best) {
+                best = t;
+            }
+        }
+        printf("limiter: %-20s %6.2f cycles per stereo frame\n", runs[k].name, (double)best / CHECK_BENCH_FRAMES);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 50;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    bool ok = check_transparent();
+    for (size_t a = 0; a < sizeof(s_attacks) / sizeof(s_attacks[0]); ++a) {
+        ok &= check_overshoot(s_attacks[a].name, s_attacks[a].attack_us);
+    }
+    bench(reps);
+    printf(ok ? "limiter_check: OK\n" : "limiter_check: FAILED\n");
+    return ok ? 0 : 1;
+}
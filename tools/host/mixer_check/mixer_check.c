@@ -0,0 +1,158 @@
+// audio_mixer under a flushing writer. The real mixer task runs against the
+// host DAC (audio_output_host.h) sped up, while the player source is written
+// in odd-sized pieces without blocking and flushed at random moments, the way
+// seeks and skips do. Every frame carries its generation (flushes so far) and its index in
+// it, so what reaches the DAC must be, per generation, a gap-free prefix in
+// order, with no generation coming back after a newer one started. The
+// source's played count must never pass its written count and must equal it
+// once everything has played out.
+//
+//   mixer_check [-v] [-n seconds]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_mixer.h"
+#include "audio_output_host.h"
+#include "audio_pcm5102.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CHECK_RATE 44100
+#define CHECK_SPEED 64.0                // DAC runs this much faster than real time
+#define CHECK_MAX_PIECE 700             // frames per write, at most
+#define CHECK_FLUSH_US 20             // between flushes, at most
+
+static bool s_verbose = false;
+static uint32_t s_rng = 1;
+static portMUX_TYPE s_tap_mux = portMUX_INITIALIZER_UNLOCKED;
+static int32_t s_tap_gen = -1;
+static int32_t s_tap_next = 0;          // index expected next in s_tap_gen
+static uint64_t s_tap_frames = 0;
+static uint32_t s_tap_errors = 0;
+
+static uint32_t check_rand(uint32_t n)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return (s_rng >> 8) % n;
+}
+
+// Left: index within the generation, right: generation, both mod 2^15.
+static void dac_tap(const int16_t *pcm, size_t frames, void *user)
+{
+    (void)user;
+    portENTER_CRITICAL(&s_tap_mux);
+    for (size_t i = 0; i < frames; ++i) {
+        int32_t idx = pcm[i * 2];
+        int32_t gen = pcm[i * 2 + 1];
+        bool ok;
+        if (gen == s_tap_gen) {
+            ok = idx == s_tap_next;
+        } else {
+            // A newer generation starts at its first frame; any older one is late.
+            ok = ((gen - s_tap_gen) & 0x7FFF) < 0x4000 && idx == 0;
+            s_tap_gen = gen;
+        }
+        if (!ok && s_tap_errors++ < 5 && s_verbose) {
+            printf("  frame %llu: generation %d index %d, expected %d\n", (unsigned long long)(s_tap_frames + i),
+                   (int)gen, (int)idx, (int)s_tap_next);
+        }
+        s_tap_next = (idx + 1) & 0x7FFF;
+    }
+    s_tap_frames += frames;
+    portEXIT_CRITICAL(&s_tap_mux);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = 2;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        }
+    }
+    if (seconds < 1) {
+        seconds = 1;
+    }
+    host_i2s_start(CHECK_RATE, CHECK_SPEED, dac_tap, NULL);
+    if (audio_mixer_init() != ESP_OK || !audio_mixer_open(AUDIO_SOURCE_PLAYER)) {
+        printf("mixer_check: FAILED (mixer init)\n");
+        return 1;
+    }
+    static int16_t piece[CHECK_MAX_PIECE * 2];
+    int32_t gen = 0;
+    int32_t idx = 0;
+    uint32_t flushes = 0;
+    uint32_t writes = 0;
+    uint32_t overcount = 0;
+    size_t pending = 0;
+    size_t sent = 0;
+    // Writes never block, so flushes land at any point of the mixer's block
+    // rather than just after it frees ring space.
+    int64_t next_flush = esp_timer_get_time() + check_rand(CHECK_FLUSH_US);
+    int64_t end = esp_timer_get_time() + 1000000LL * seconds;
+    while (esp_timer_get_time() < end) {
+        if (esp_timer_get_time() >= next_flush) {
+            audio_mixer_flush(AUDIO_SOURCE_PLAYER);
+            gen = (gen + 1) & 0x7FFF;
+            idx = 0;
+            pending = 0;
+            sent = 0;
+            flushes++;
+            next_flush = esp_timer_get_time() + check_rand(CHECK_FLUSH_US);
+        }
+        if (sent == pending) {
+            pending = 1 + check_rand(CHECK_MAX_PIECE);
+            sent = 0;
+            for (size_t i = 0; i < pending; ++i) {
+                piece[i * 2] = (int16_t)idx;
+                piece[i * 2 + 1] = (int16_t)gen;
+                idx = (idx + 1) & 0x7FFF;
+            }
+        }
+        size_t wrote = 0;
+        audio_mixer_write(AUDIO_SOURCE_PLAYER, piece + sent * 2, (pending - sent) * 4, &wrote, 0);
+        sent += wrote / 4;
+        writes += wrote > 0;
+        overcount += audio_mixer_get_played_frames(AUDIO_SOURCE_PLAYER) >
+                     audio_mixer_get_written_frames(AUDIO_SOURCE_PLAYER);
+    }
+    audio_mixer_close(AUDIO_SOURCE_PLAYER);
+    // Let the queue play out.
+    uint64_t written = audio_mixer_get_written_frames(AUDIO_SOURCE_PLAYER);
+    uint64_t played = 0;
+    for (int i = 0; i < 200; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        played = audio_mixer_get_played_frames(AUDIO_SOURCE_PLAYER);
+        if (played >= written && audio_i2s_get_played_frames() == audio_i2s_get_written_frames()) {
+            break;
+        }
+    }
+    host_i2s_stop();
+
+    portENTER_CRITICAL(&s_tap_mux);
+    uint64_t heard = s_tap_frames;
+    uint32_t errors = s_tap_errors;
+    portEXIT_CRITICAL(&s_tap_mux);
+    printf("mixer: %u writes, %u flushes: %llu frames written, %llu counted played, %llu reached the DAC\n",
+           (unsigned)writes, (unsigned)flushes, (unsigned long long)written, (unsigned long long)played,
+           (unsigned long long)heard);
+    bool ok = true;
+    if (errors > 0) {
+        printf("  %u frames out of order: flushed audio played\n", (unsigned)errors);
+        ok = false;
+    }
+    if (overcount > 0 || played != written) {
+        printf("  played count %s the written count (%u times during the run)\n",
+               played > written ? "passed" : "did not reach", (unsigned)overcount);
+        ok = false;
+    }
+    printf(ok ? "mixer_check: OK\n" : "mixer_check: FAILED\n");
+    return ok ? 0 : 1;
+}
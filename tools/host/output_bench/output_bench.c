@@ -0,0 +1,288 @@
+// Output stage cost per 256-frame mixer block, fused against separate passes.
+// Before the fused stage every source scaled its own PCM for volume (x/255),
+// the mixer summed into int32 and saturated back to int16, and the EQ read
+// that int16 block channel by channel and wrote it back. Now the volume is
+// the mixer's gain while summing and audio_output_render() runs the EQ, the
+// limiter and the soft clip from the int32 accumulator straight into the
+// I2S block. Both chains are run here on one or two sources at volume 200
+// (-12 dBFS noise and a sine sweep), EQ flat and with all five bands off
+// centre; the EQ filters are the real audio_eq in both.
+//
+// Reported per block: ns (the host cycle counter), of which the limiter the
+// old chain did not have, and bytes of block buffers read and written (the
+// EQ's and limiter's 64-frame stack buffers stay in cache and are not
+// counted). The speedup leaves the limiter out. The fused chain must touch
+// fewer bytes and, below the limiter's ceiling, produce the old chain's
+// samples delayed by the limiter's look-ahead, to within 3 LSB: the old
+// chain truncated every source to int16 for volume, which the EQ's boost
+// then amplifies.
+//
+//   output_bench [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_eq.h"
+#include "audio_eq_tables.h"
+#include "audio_limiter.h"
+#include "audio_pcm5102.h"
+#include "esp_cpu.h"
+#include "pcm_convert.h"
+
+#define BENCH_RATE 44100
+#define BENCH_BLOCK 256                 // AUDIO_MIXER_BLOCK_FRAMES
+#define BENCH_BLOCKS 172                // about a second
+#define BENCH_FRAMES (BENCH_BLOCK * BENCH_BLOCKS)
+#define BENCH_VOLUME 200
+#define BENCH_MAX_DIFF 3                // LSB
+#define BENCH_SRC_MAX 2
+
+typedef struct {
+    const char *name;
+    int sources;
+    bool eq;
+} bench_case_t;
+
+static bool s_verbose = false;
+static uint32_t s_rng = 1;
+static int16_t s_src[BENCH_SRC_MAX][BENCH_FRAMES * 2];
+static int16_t s_in[BENCH_SRC_MAX][BENCH_BLOCK * 2];
+static int32_t s_acc[BENCH_BLOCK * 2];
+static int16_t s_old[BENCH_FRAMES * 2];
+static int16_t s_new[BENCH_FRAMES * 2];
+static int16_t s_scratch[AUDIO_EQ_BLOCK_FRAMES * 2];
+static const uint8_t s_eq_steps[] = {20, 12, 17, 10, 22};
+
+static uint32_t bench_rand(void)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return s_rng;
+}
+
+static void fill_sources(void)
+{
+    const double amp = 32767.0 * 0.25;      // -12 dBFS
+    double phase = 0.0;
+    for (size_t i = 0; i < BENCH_FRAMES; ++i) {
+        s_src[0][i * 2] = (int16_t)(((int32_t)(bench_rand() >> 16) - 32768) / 4);
+        s_src[0][i * 2 + 1] = (int16_t)(((int32_t)(bench_rand() >> 16) - 32768) / 4);
+        double f = 50.0 * pow(16000.0 / 50.0, (double)i / BENCH_FRAMES);
+        phase += 2.0 * M_PI * f / BENCH_RATE;
+        s_src[1][i * 2] = (int16_t)lrint(amp * sin(phase));
+        s_src[1][i * 2 + 1] = (int16_t)lrint(amp * cos(phase));
+    }
+}
+
+// A rate change resets the EQ and limiter state, so every run starts alike.
+static void output_reset(const bench_case_t *c)
+{
+    for (uint8_t b = 0; b < audio_eq_get_band_count(); ++b) {
+        audio_eq_set_band_step(b, c->eq ? s_eq_steps[b % sizeof(s_eq_steps)] : AUDIO_EQ_CENTER_STEP);
+    }
+    memset(s_acc, 0, sizeof(s_acc));
+    audio_eq_set_sample_rate(48000);
+    audio_limiter_set_sample_rate(48000);
+    audio_output_render(s_acc, s_scratch, AUDIO_EQ_BLOCK_FRAMES);
+    audio_eq_set_sample_rate(BENCH_RATE);
+    audio_limiter_set_sample_rate(BENCH_RATE);
+}
+
+// The mixer's fetch from a source ring, the same in both chains.
+static void fetch(const bench_case_t *c, size_t block)
+{
+    for (int s = 0; s < c->sources; ++s) {
+        memcpy(s_in[s], &s_src[s][block * BENCH_BLOCK * 2], sizeof(s_in[s]));
+    }
+}
+
+static void old_eq(int16_t *out)
+{
+    const int32_t half = 1 << (AUDIO_EQ_FRAC_BITS - 1);
+    int32_t buf[AUDIO_EQ_BLOCK_FRAMES];
+    if (!audio_eq_begin()) {
+        return;
+    }
+    for (size_t off = 0; off < BENCH_BLOCK; off += AUDIO_EQ_BLOCK_FRAMES) {
+        for (int ch = 0; ch < 2; ++ch) {
+            int16_t *p = &out[off * 2 + ch];
+            for (size_t i = 0; i < AUDIO_EQ_BLOCK_FRAMES; ++i) {
+                buf[i] = (int32_t)p[i * 2] * (1 << AUDIO_EQ_FRAC_BITS);
+            }
+            audio_eq_run(ch, buf, AUDIO_EQ_BLOCK_FRAMES);
+            for (size_t i = 0; i < AUDIO_EQ_BLOCK_FRAMES; ++i) {
+                int32_t v = (buf[i] + half) >> AUDIO_EQ_FRAC_BITS;
+                p[i * 2] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+            }
+        }
+        if (!audio_eq_next_block()) {
+            break;
+        }
+    }
+}
+
+// Volume in each source, int16 sum, saturate, then the EQ over the block.
+static void old_block(const bench_case_t *c, int16_t *out)
+{
+    for (int s = 0; s < c->sources; ++s) {
+        for (size_t i = 0; i < BENCH_BLOCK * 2; ++i) {
+            s_in[s][i] = (int16_t)(((int32_t)s_in[s][i] * BENCH_VOLUME) / 255);
+        }
+    }
+    memset(s_acc, 0, sizeof(s_acc));
+    for (int s = 0; s < c->sources; ++s) {
+        for (size_t i = 0; i < BENCH_BLOCK * 2; ++i) {
+            s_acc[i] += ((int32_t)s_in[s][i] * 32768) >> 15;
+        }
+    }
+    for (size_t i = 0; i < BENCH_BLOCK * 2; ++i) {
+        int32_t v = s_acc[i];
+        out[i] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+    }
+    old_eq(out);
+}
+
+// mixer_accumulate() at a steady gain, then the output stage.
+static void new_block(const bench_case_t *c, int16_t *out)
+{
+    const int shift = 15 - AUDIO_OUTPUT_FRAC_BITS;
+    const int32_t gain = pcm_gain_from_volume(BENCH_VOLUME);
+    memset(s_acc, 0, sizeof(s_acc));
+    for (int s = 0; s < c->sources; ++s) {
+        for (size_t i = 0; i < BENCH_BLOCK * 2; ++i) {
+            s_acc[i] += ((int32_t)s_in[s][i] * gain) >> shift;
+        }
+    }
+    audio_output_render(s_acc, out, BENCH_BLOCK);
+}
+
+static double time_chain(const bench_case_t *c, bool fused, int16_t *out, int reps)
+{
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        output_reset(c);
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (size_t b = 0; b < BENCH_BLOCKS; ++b) {
+            fetch(c, b);
+            if (fused) {
+                new_block(c, &out[b * BENCH_BLOCK * 2]);
+            } else {
+                old_block(c, &out[b * BENCH_BLOCK * 2]);
+            }
+        }
+        double ns = (double)(uint32_t)(esp_cpu_get_cycle_count() - t0);
+        if (ns < best) {
+            best = ns;
+        }
+    }
+    return best / BENCH_BLOCKS;
+}
+
+// The limiter alone on the new chain's block contents, per block.
+static double time_limiter(const bench_case_t *c, int reps)
+{
+    int32_t left[AUDIO_LIMITER_BLOCK_FRAMES];
+    int32_t right[AUDIO_LIMITER_BLOCK_FRAMES];
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        output_reset(c);
+        uint32_t spent = 0;
+        for (size_t b = 0; b < BENCH_BLOCKS; ++b) {
+            for (size_t off = 0; off < BENCH_BLOCK; off += AUDIO_LIMITER_BLOCK_FRAMES) {
+                const int16_t *p = &s_new[(b * BENCH_BLOCK + off) * 2];
+                for (size_t i = 0; i < AUDIO_LIMITER_BLOCK_FRAMES; ++i) {
+                    left[i] = (int32_t)p[i * 2] * (1 << AUDIO_EQ_FRAC_BITS);
+                    right[i] = (int32_t)p[i * 2 + 1] * (1 << AUDIO_EQ_FRAC_BITS);
+                }
+                uint32_t t0 = esp_cpu_get_cycle_count();
+                audio_limiter_process(left, right, AUDIO_LIMITER_BLOCK_FRAMES);
+                spent += esp_cpu_get_cycle_count() - t0;
+            }
+        }
+        if (spent < best) {
+            best = spent;
+        }
+    }
+    return best / BENCH_BLOCKS;
+}
+
+// Bytes of block buffers read and written per block.
+static size_t chain_bytes(const bench_case_t *c, bool fused)
+{
+    const size_t pcm = BENCH_BLOCK * 2 * sizeof(int16_t);
+    const size_t acc = BENCH_BLOCK * 2 * sizeof(int32_t);
+    size_t bytes = c->sources * 2 * pcm;                // fetch
+    bytes += acc;                                       // clear
+    bytes += c->sources * (pcm + 2 * acc);              // accumulate
+    if (fused) {
+        return bytes + acc + pcm;                       // render
+    }
+    bytes += c->sources * 2 * pcm;                      // volume, in place
+    bytes += acc + pcm;                                 // saturate
+    return bytes + (c->eq ? 2 * pcm : 0);               // EQ, in place
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    static const bench_case_t cases[] = {
+        {"flat", 1, false},
+        {"flat", 2, false},
+        {"5 bands", 1, true},
+        {"5 bands", 2, true},
+    };
+    fill_sources();
+    audio_eq_init(BENCH_RATE);
+    audio_limiter_init(BENCH_RATE);
+    size_t delay = audio_output_latency_frames();
+
+    printf("per %d-frame block: ns on this host (speedup without the limiter), bytes of block buffers\n",
+           BENCH_BLOCK);
+    printf("%-8s %3s  %8s %8s %9s %7s  %7s %7s\n", "EQ", "src", "old ns", "new ns", "limiter", "speedup",
+           "old B", "new B");
+    bool ok = true;
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        const bench_case_t *c = &cases[k];
+        double old_ns = time_chain(c, false, s_old, reps);
+        double new_ns = time_chain(c, true, s_new, reps);
+        double lim_ns = time_limiter(c, reps);
+        size_t old_b = chain_bytes(c, false);
+        size_t new_b = chain_bytes(c, true);
+        printf("%-8s %3d  %8.0f %8.0f %9.0f %6.2fx  %7zu %7zu\n", c->name, c->sources, old_ns, new_ns, lim_ns,
+               old_ns / (new_ns - lim_ns), old_b, new_b);
+
+        int max_diff = 0;
+        for (size_t i = 0; i + delay * 2 < BENCH_FRAMES * 2; ++i) {
+            int d = abs((int)s_new[i + delay * 2] - (int)s_old[i]);
+            if (d > max_diff) {
+                max_diff = d;
+            }
+        }
+        if (s_verbose) {
+            printf("  fused output within %d LSB of the old chain, %zu frames later\n", max_diff, delay);
+        }
+        if (max_diff > BENCH_MAX_DIFF) {
+            printf("  %s, %d sources: fused output %d LSB off the old chain\n", c->name, c->sources, max_diff);
+            ok = false;
+        }
+        if (new_b >= old_b) {
+            printf("  %s, %d sources: fused chain touches no fewer bytes\n", c->name, c->sources);
+            ok = false;
+        }
+    }
+    printf(ok ? "output_bench: OK\n" : "output_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
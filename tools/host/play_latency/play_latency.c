@@ -0,0 +1,296 @@
+// Latency from audio_player_play() to the first audible sample, on the real
+// player task (audio_player.c over the host mixer and a real-time host DAC).
+// Two cases, each repeated:
+//   - cold start: from stopped, with the output drained; the task opens the
+//     track and decodes its first frames;
+//   - resume: from pause, once everything queued before it has played out.
+// A sample counts as audible when the DAC thread takes the buffer holding it
+// off the queue. Each latency is split into the wake (the decode task
+// returning from xTaskNotifyWait(), wrapped at link time), the first write
+// into the DAC queue and the buffer going out; the last step waits for the
+// DAC's next buffer boundary, so it alone may take up to a DMA period.
+//
+// Before the notifications, a paused task woke every 20 ms to poll the
+// queue (an idle one already blocked on it). For each resume the old wake
+// is modelled as the next 20 ms poll counted from when the task went to
+// sleep, in place of the measured one. Resume wakes must stay under one
+// DMA period, and resumes must be faster on average than the poll model.
+//
+//   play_latency [-v] [-n trials]
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "audio_mixer.h"
+#include "audio_output_host.h"
+#include "audio_pcm5102.h"
+#include "audio_player.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_corpus.h"
+
+#define LATENCY_FILE "cbr128_44k_js.mp3"
+#define LATENCY_RATE 44100
+#define LATENCY_POLL_US 20000           // the old paused loop's vTaskDelay(20)
+#define LATENCY_PLAY_MS 150             // played before each pause or stop
+#define LATENCY_QUIET_BUFFERS 4         // DMA buffers with nothing played: drained
+#define LATENCY_TIMEOUT_US 2000000
+#define LATENCY_MUSIC_DIR STORAGE_SD_CACHE_DIR "/music"
+#define LATENCY_DMA_US (HOST_I2S_DMA_FRAMES * 1000000LL / LATENCY_RATE)
+
+typedef struct {
+    int64_t wake_us;
+    int64_t queued_us;
+    int64_t audible_us;
+    int64_t slept_us;           // from the task going to sleep to the request
+} latency_t;
+
+typedef struct {
+    double sum_ms;
+    double max_ms;
+    int count;
+} latency_sum_t;
+
+static bool s_verbose = false;
+static int64_t s_request_us = 0;        // audio_player_play() time of the trial, 0 between trials
+static int64_t s_sleep_us = 0;          // the decode task last entered xTaskNotifyWait()
+static int64_t s_wake_us = 0;           // and returned from it after the request
+static int64_t s_queued_us = 0;
+static int64_t s_audible_us = 0;
+
+BaseType_t __real_xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                                  TickType_t ticks);
+esp_err_t __real_audio_i2s_write(const int16_t *samples, size_t len, size_t *bytes_written, uint32_t timeout_ms);
+
+static bool is_decode_task(void)
+{
+    return strcmp(pcTaskGetName(xTaskGetCurrentTaskHandle()), "audio_player") == 0;
+}
+
+BaseType_t __wrap_xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                                  TickType_t ticks)
+{
+    bool decode = is_decode_task();
+    if (decode) {
+        __atomic_store_n(&s_sleep_us, esp_timer_get_time(), __ATOMIC_RELEASE);
+    }
+    BaseType_t got = __real_xTaskNotifyWait(clear_on_entry, clear_on_exit, value, ticks);
+    if (decode && __atomic_load_n(&s_request_us, __ATOMIC_ACQUIRE) != 0) {
+        int64_t zero = 0;
+        int64_t now = esp_timer_get_time();
+        __atomic_compare_exchange_n(&s_wake_us, &zero, now, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+esp_err_t __wrap_audio_i2s_write(const int16_t *samples, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+{
+    esp_err_t err = __real_audio_i2s_write(samples, len, bytes_written, timeout_ms);
+    if (__atomic_load_n(&s_request_us, __ATOMIC_ACQUIRE) != 0) {
+        int64_t zero = 0;
+        int64_t now = esp_timer_get_time();
+        __atomic_compare_exchange_n(&s_queued_us, &zero, now, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+    return err;
+}
+
+static void dac_tap(const int16_t *pcm, size_t frames, void *user)
+{
+    (void)pcm;
+    (void)frames;
+    (void)user;
+    if (__atomic_load_n(&s_request_us, __ATOMIC_ACQUIRE) != 0) {
+        int64_t zero = 0;
+        int64_t now = esp_timer_get_time();
+        __atomic_compare_exchange_n(&s_audible_us, &zero, now, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+// Waits until the DAC has played nothing for a few buffers in a row.
+static bool wait_drained(void)
+{
+    int64_t end = esp_timer_get_time() + LATENCY_TIMEOUT_US;
+    uint64_t played = audio_i2s_get_played_frames();
+    int quiet = 0;
+    while (quiet < LATENCY_QUIET_BUFFERS) {
+        if (esp_timer_get_time() > end) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LATENCY_DMA_US / 1000 + 1));
+        uint64_t now = audio_i2s_get_played_frames();
+        quiet = (now == played) ? quiet + 1 : 0;
+        played = now;
+    }
+    return true;
+}
+
+static bool measure_play(latency_t *out)
+{
+    __atomic_store_n(&s_wake_us, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_queued_us, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_audible_us, 0, __ATOMIC_RELAXED);
+    int64_t t0 = esp_timer_get_time();
+    out->slept_us = t0 - __atomic_load_n(&s_sleep_us, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&s_request_us, t0, __ATOMIC_RELEASE);
+    audio_player_play();
+    while (__atomic_load_n(&s_audible_us, __ATOMIC_ACQUIRE) == 0) {
+        if (esp_timer_get_time() - t0 > LATENCY_TIMEOUT_US) {
+            __atomic_store_n(&s_request_us, 0, __ATOMIC_RELEASE);
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    __atomic_store_n(&s_request_us, 0, __ATOMIC_RELEASE);
+    int64_t wake = __atomic_load_n(&s_wake_us, __ATOMIC_ACQUIRE);
+    int64_t queued = __atomic_load_n(&s_queued_us, __ATOMIC_ACQUIRE);
+    out->wake_us = wake ? wake - t0 : -1;
+    out->queued_us = queued ? queued - t0 : -1;
+    out->audible_us = __atomic_load_n(&s_audible_us, __ATOMIC_ACQUIRE) - t0;
+    return out->wake_us >= 0 && out->queued_us >= 0;
+}
+
+// One trial: play a while, pause or stop, let the output drain, then play.
+static bool run_trial(bool resume, latency_t *out)
+{
+    vTaskDelay(pdMS_TO_TICKS(LATENCY_PLAY_MS));
+    if (resume) {
+        audio_player_pause();
+    } else {
+        audio_player_stop();
+    }
+    if (!wait_drained()) {
+        printf("  output never drained\n");
+        return false;
+    }
+    audio_player_state_t want = resume ? PLAYER_STATE_PAUSED : PLAYER_STATE_STOPPED;
+    if (audio_player_get_state() != want) {
+        printf("  player not %s\n", resume ? "paused" : "stopped");
+        return false;
+    }
+    if (!measure_play(out)) {
+        printf("  nothing audible within %d ms\n", LATENCY_TIMEOUT_US / 1000);
+        return false;
+    }
+    return true;
+}
+
+static void sum_add(latency_sum_t *s, double ms)
+{
+    s->sum_ms += ms;
+    s->max_ms = (ms > s->max_ms) ? ms : s->max_ms;
+    s->count++;
+}
+
+static void print_row(const char *label, const latency_sum_t *s)
+{
+    printf("  %-24s %7.2f %7.2f\n", label, s->count ? s->sum_ms / s->count : 0.0, s->max_ms);
+}
+
+static bool run_case(bool resume, int trials)
+{
+    latency_sum_t wake = {0};
+    latency_sum_t queued = {0};
+    latency_sum_t audible = {0};
+    latency_sum_t poll = {0};
+    bool ok = true;
+    for (int i = 0; i < trials && ok; ++i) {
+        latency_t l;
+        ok = run_trial(resume, &l);
+        if (!ok) {
+            break;
+        }
+        sum_add(&wake, l.wake_us / 1000.0);
+        sum_add(&queued, l.queued_us / 1000.0);
+        sum_add(&audible, l.audible_us / 1000.0);
+        // The old loop polled at whole 20 ms steps after it went to sleep.
+        int64_t poll_wake = LATENCY_POLL_US - (l.slept_us % LATENCY_POLL_US);
+        sum_add(&poll, (l.audible_us - l.wake_us + poll_wake) / 1000.0);
+        if (s_verbose) {
+            printf("    trial %d: wake %.2f, queued %.2f, audible %.2f ms (asleep %.1f ms)\n", i,
+                   l.wake_us / 1000.0, l.queued_us / 1000.0, l.audible_us / 1000.0, l.slept_us / 1000.0);
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+    printf("%s, %d trials\n", resume ? "resume from pause" : "cold start", trials);
+    printf("  %-24s %7s %7s\n", "ms", "avg", "max");
+    print_row("task woken", &wake);
+    print_row("first sample queued", &queued);
+    print_row("first sample audible", &audible);
+    if (resume) {
+        print_row("audible, 20 ms poll", &poll);
+        if (wake.max_ms * 1000.0 >= LATENCY_DMA_US) {
+            printf("  resume wake %.2f ms, over one DMA period (%.2f ms)\n", wake.max_ms, LATENCY_DMA_US / 1000.0);
+            ok = false;
+        }
+        if (audible.sum_ms >= poll.sum_ms) {
+            printf("  resume no faster than the 20 ms poll\n");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// One track in a folder of its own.
+static bool make_library(void)
+{
+    host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int nfiles = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    const host_corpus_file_t *file = host_corpus_find(files, nfiles, LATENCY_FILE);
+    char src[256];
+    char dst[256];
+    if (!file) {
+        return false;
+    }
+    host_corpus_path(file, src, sizeof(src));
+    mkdir(STORAGE_SD_CACHE_DIR, 0755);
+    mkdir(LATENCY_MUSIC_DIR, 0755);
+    snprintf(dst, sizeof(dst), "%s/%s", LATENCY_MUSIC_DIR, LATENCY_FILE);
+    unlink(dst);
+    return symlink(src, dst) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int trials = 8;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            trials = atoi(argv[++i]);
+        }
+    }
+    if (trials < 1) {
+        trials = 1;
+    }
+    host_i2s_start(LATENCY_RATE, 1.0, dac_tap, NULL);
+    if (!make_library() || audio_mixer_init() != ESP_OK || audio_player_init(LATENCY_MUSIC_DIR) != ESP_OK) {
+        printf("play_latency: FAILED (setup)\n");
+        return 1;
+    }
+    audio_player_set_volume(128);
+    audio_player_set_repeat_mode(PLAYER_REPEAT_ONE);
+    // The catalog scan runs in the background: wait for the track.
+    for (int i = 0; i < 200 && audio_player_get_track_count() == 0; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    audio_player_play();
+
+    bool ok = audio_player_get_track_count() == 1;
+    ok = ok && run_case(false, trials);
+    ok = ok && run_case(true, trials);
+    audio_player_stop();
+    wait_drained();
+    audio_player_shutdown();
+    host_i2s_stop();
+    printf("play_latency: %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
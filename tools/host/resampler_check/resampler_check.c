@@ -0,0 +1,257 @@
+// audio_resampler quality and cost over the rate pairs the player and the
+// mixer use. For each pair, -6 dBFS tones across the passband are resampled
+// and a sine of the same frequency is fitted to the output: what the fit
+// leaves over (aliases, images, interpolation error) gives the SNR. When
+// downsampling, a tone well above the output Nyquist must come out
+// attenuated. Pushing the same input in odd-sized pieces and pulling in
+// odd-sized blocks must give bit-identical output to whole MP3 frames. Then
+// cycles per output stereo frame; on the host the cycle counter runs in ns
+// (esp_cpu.h).
+//
+//   resampler_check [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_resampler.h"
+#include "esp_cpu.h"
+
+#define CHECK_IN_FRAMES 48000
+#define CHECK_OUT_MAX (CHECK_IN_FRAMES * 6 + 64)
+#define CHECK_SKIP 64                   // filter start-up, in output frames
+#define CHECK_AMP 16384.0               // -6 dBFS
+#define CHECK_MIN_SNR_DB 60.0
+#define CHECK_MAX_ALIAS_DB -40.0
+#define CHECK_PASSBAND 0.40             // highest tone, fraction of the lower rate
+
+static const struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+} s_pairs[] = {
+    {48000, 44100}, {32000, 44100}, {22050, 44100}, {24000, 44100}, {16000, 44100}, {11025, 44100},
+    {8000, 44100},  {44100, 48000}, {32000, 48000}, {44100, 22050}, {48000, 22050}, {48000, 16000},
+};
+
+static bool s_verbose = false;
+static int16_t s_in[CHECK_IN_FRAMES * 2];
+static int16_t s_out[CHECK_OUT_MAX * 2];
+static int16_t s_ref[CHECK_OUT_MAX * 2];
+static audio_resampler_t s_rs;
+static uint32_t s_rng = 1;
+
+static uint32_t check_rand(uint32_t n)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return (s_rng >> 8) % n;
+}
+
+static void make_tone(double freq, uint32_t rate)
+{
+    for (size_t i = 0; i < CHECK_IN_FRAMES; ++i) {
+        double v = CHECK_AMP * sin(2.0 * M_PI * freq * (double)i / rate);
+        s_in[i * 2] = (int16_t)lrint(v);
+        s_in[i * 2 + 1] = (int16_t)lrint(-v);
+    }
+}
+
+// The way the wrapper drives it: one MP3 frame in, everything out.
+static size_t resample_frames(int16_t *out)
+{
+    size_t got = 0;
+    for (size_t done = 0; done < CHECK_IN_FRAMES; done += AUDIO_RESAMPLER_MAX_IN_FRAMES) {
+        size_t n = CHECK_IN_FRAMES - done;
+        if (n > AUDIO_RESAMPLER_MAX_IN_FRAMES) {
+            n = AUDIO_RESAMPLER_MAX_IN_FRAMES;
+        }
+        audio_resampler_push(&s_rs, s_in + done * 2, n, 2);
+        got += audio_resampler_pull(&s_rs, out + got * 2, CHECK_OUT_MAX - got);
+    }
+    return got;
+}
+
+// Residual power over signal power of the left channel after a least-squares
+// fit of a sin + b cos + c at `freq`, in dB.
+static double fit_snr(const int16_t *pcm, size_t frames, double freq, uint32_t rate)
+{
+    double ss = 0, cc = 0, sc = 0, s1 = 0, c1 = 0, n = 0, ys = 0, yc = 0, y1 = 0;
+    for (size_t i = CHECK_SKIP; i < frames; ++i) {
+        double w = 2.0 * M_PI * freq * (double)i / rate;
+        double s = sin(w);
+        double c = cos(w);
+        double y = pcm[i * 2];
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        s1 += s;
+        c1 += c;
+        n += 1.0;
+        ys += y * s;
+        yc += y * c;
+        y1 += y;
+    }
+    // 3 x 3 normal equations by Cramer's rule.
+    double m[3][3] = {{ss, sc, s1}, {sc, cc, c1}, {s1, c1, n}};
+    double r[3] = {ys, yc, y1};
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    double x[3];
+    for (int k = 0; k < 3; ++k) {
+        double t[3][3];
+        memcpy(t, m, sizeof(t));
+        for (int j = 0; j < 3; ++j) {
+            t[j][k] = r[j];
+        }
+        x[k] = (t[0][0] * (t[1][1] * t[2][2] - t[1][2] * t[2][1]) - t[0][1] * (t[1][0] * t[2][2] - t[1][2] * t[2][0]) +
+                t[0][2] * (t[1][0] * t[2][1] - t[1][1] * t[2][0])) /
+               det;
+    }
+    double sig = 0.0;
+    double err = 0.0;
+    for (size_t i = CHECK_SKIP; i < frames; ++i) {
+        double w = 2.0 * M_PI * freq * (double)i / rate;
+        double fit = x[0] * sin(w) + x[1] * cos(w) + x[2];
+        double d = pcm[i * 2] - fit;
+        sig += fit * fit;
+        err += d * d;
+    }
+    return 10.0 * log10(sig / (err > 0.0 ? err : 1e-9));
+}
+
+static bool check_pair(uint32_t in_rate, uint32_t out_rate, double *worst_snr)
+{
+    if (!audio_resampler_init(&s_rs, in_rate, out_rate)) {
+        printf("  %5u -> %5u: init failed\n", (unsigned)in_rate, (unsigned)out_rate);
+        return false;
+    }
+    bool ok = true;
+    double low = (in_rate < out_rate ? in_rate : out_rate);
+    static const double tones[] = {0.005, 0.02, 0.1, 0.2, 0.3, CHECK_PASSBAND};
+    for (size_t t = 0; t < sizeof(tones) / sizeof(tones[0]); ++t) {
+        double freq = tones[t] * low;
+        make_tone(freq, in_rate);
+        audio_resampler_reset(&s_rs);
+        size_t got = resample_frames(s_out);
+        double snr = fit_snr(s_out, got, freq, out_rate);
+        bool tone_ok = snr >= CHECK_MIN_SNR_DB;
+        if (snr < *worst_snr) {
+            *worst_snr = snr;
+        }
+        if (s_verbose || !tone_ok) {
+            printf("  %5u -> %5u: %7.1f Hz  SNR %5.1f dB%s\n", (unsigned)in_rate, (unsigned)out_rate, freq, snr,
+                   tone_ok ? "" : "  <-- NOISY");
+        }
+        ok &= tone_ok;
+    }
+    // Between the end of the transition band and the input Nyquist, where
+    // there is room for a tone (not for 48 -> 44.1 kHz).
+    double stop_lo = 0.55 * out_rate;
+    double stop_hi = 0.475 * in_rate;
+    if (stop_lo < stop_hi) {
+        double freq = 0.5 * (stop_lo + stop_hi);
+        make_tone(freq, in_rate);
+        audio_resampler_reset(&s_rs);
+        size_t got = resample_frames(s_out);
+        double p = 0.0;
+        for (size_t i = CHECK_SKIP; i < got; ++i) {
+            p += (double)s_out[i * 2] * s_out[i * 2];
+        }
+        double db = 10.0 * log10((p / (double)(got - CHECK_SKIP) + 1e-9) / (CHECK_AMP * CHECK_AMP / 2.0));
+        bool alias_ok = db <= CHECK_MAX_ALIAS_DB;
+        if (s_verbose || !alias_ok) {
+            printf("  %5u -> %5u: %7.1f Hz  alias %6.1f dB%s\n", (unsigned)in_rate, (unsigned)out_rate, freq, db,
+                   alias_ok ? "" : "  <-- ALIASING");
+        }
+        ok &= alias_ok;
+    }
+    return ok;
+}
+
+// Whole frames vs. odd-sized pushes and pulls.
+static bool check_chunking(uint32_t in_rate, uint32_t out_rate)
+{
+    for (size_t i = 0; i < CHECK_IN_FRAMES * 2; ++i) {
+        s_in[i] = (int16_t)(check_rand(40000) - 20000);
+    }
+    audio_resampler_init(&s_rs, in_rate, out_rate);
+    size_t ref = resample_frames(s_ref);
+
+    audio_resampler_reset(&s_rs);
+    size_t got = 0;
+    size_t done = 0;
+    while (done < CHECK_IN_FRAMES) {
+        size_t n = 1 + check_rand(AUDIO_RESAMPLER_MAX_IN_FRAMES);
+        if (n > CHECK_IN_FRAMES - done) {
+            n = CHECK_IN_FRAMES - done;
+        }
+        done += audio_resampler_push(&s_rs, s_in + done * 2, n, 2);
+        size_t m;
+        do {
+            m = audio_resampler_pull(&s_rs, s_out + got * 2, 1 + check_rand(300));
+            got += m;
+        } while (m > 0);
+    }
+    bool ok = got == ref && memcmp(s_out, s_ref, got * 4) == 0;
+    if (s_verbose || !ok) {
+        printf("  %5u -> %5u: %zu frames in odd pieces vs %zu in whole frames, %s\n", (unsigned)in_rate,
+               (unsigned)out_rate, got, ref, ok ? "identical" : "DIFFERENT");
+    }
+    return ok;
+}
+
+static void bench(uint32_t in_rate, uint32_t out_rate, int reps)
+{
+    make_tone(1000.0, in_rate);
+    audio_resampler_init(&s_rs, in_rate, out_rate);
+    uint32_t best = UINT32_MAX;
+    size_t got = 0;
+    for (int r = 0; r < reps; ++r) {
+        audio_resampler_reset(&s_rs);
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        got = resample_frames(s_out);
+        uint32_t t = esp_cpu_get_cycle_count() - t0;
+        if (t < best) {
+            best = t;
+        }
+    }
+    printf("resampler: %5u -> %5u  %6.2f cycles per output stereo frame\n", (unsigned)in_rate, (unsigned)out_rate,
+           (double)best / (double)got);
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 20;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    bool ok = true;
+    double worst_snr = INFINITY;
+    size_t npairs = sizeof(s_pairs) / sizeof(s_pairs[0]);
+    for (size_t p = 0; p < npairs; ++p) {
+        ok &= check_pair(s_pairs[p].in_rate, s_pairs[p].out_rate, &worst_snr);
+    }
+    printf("resampler: %zu rate pairs, tones up to %.2f x the lower rate: worst SNR %.1f dB\n", npairs,
+           CHECK_PASSBAND, worst_snr);
+    bool same = true;
+    for (size_t p = 0; p < npairs; ++p) {
+        same &= check_chunking(s_pairs[p].in_rate, s_pairs[p].out_rate);
+    }
+    printf("resampler: odd-sized push/pull %s\n", same ? "identical to whole frames" : "DIFFERS");
+    ok &= same;
+    bench(48000, 44100, reps);
+    bench(32000, 44100, reps);
+    bench(44100, 48000, reps);
+    bench(48000, 22050, reps);
+    printf(ok ? "resampler_check: OK\n" : "resampler_check: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// track_shuffle checks: every (count, seed) gives a true permutation whose
+// inverse is track_shuffle_pos(), the seed step round-trips, and over the
+// seeds the player walks through (track_shuffle_next_seed() per pass) each
+// track is equally likely at each position - chi-square over the
+// position x track table, for small libraries where bias would be audible.
+//
+//   shuffle_check [-v]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "track_shuffle.h"
+
+#define CHECK_SEEDS 16
+#define CHECK_UNIFORM_PASSES 200     // expected hits per table cell
+#define CHECK_CHI2_SIGMAS 5.0
+
+static bool s_verbose = false;
+
+static bool check_permutation(uint32_t count, uint32_t seed)
+{
+    track_shuffle_t s;
+    track_shuffle_init(&s, count, seed);
+    uint8_t *seen = calloc(count ? count : 1, 1);
+    if (!seen) {
+        return false;
+    }
+    bool ok = true;
+    for (uint32_t p = 0; p < count && ok; ++p) {
+        uint32_t t = track_shuffle_at(&s, p);
+        if (t >= count || seen[t]) {
+            printf("  count %u seed %08x: position %u -> track %u %s\n", (unsigned)count, (unsigned)seed,
+                   (unsigned)p, (unsigned)t, t >= count ? "out of range" : "repeated");
+            ok = false;
+        } else if (track_shuffle_pos(&s, t) != p) {
+            printf("  count %u seed %08x: pos(at(%u)) = %u\n", (unsigned)count, (unsigned)seed, (unsigned)p,
+                   (unsigned)track_shuffle_pos(&s, t));
+            ok = false;
+        }
+        if (t < count) {
+            seen[t] = 1;
+        }
+    }
+    // Out-of-range positions pass through unchanged.
+    if (ok && (track_shuffle_at(&s, count) != count || track_shuffle_pos(&s, count) != count)) {
+        printf("  count %u seed %08x: out-of-range position not passed through\n", (unsigned)count,
+               (unsigned)seed);
+        ok = false;
+    }
+    free(seen);
+    return ok;
+}
+
+static bool check_uniform(uint32_t count, uint32_t seed)
+{
+    uint32_t passes = CHECK_UNIFORM_PASSES * count;
+    uint32_t *hits = calloc((size_t)count * count, sizeof(uint32_t));
+    if (!hits) {
+        return false;
+    }
+    track_shuffle_t s;
+    for (uint32_t i = 0; i < passes; ++i) {
+        track_shuffle_init(&s, count, seed);
+        for (uint32_t p = 0; p < count; ++p) {
+            hits[(size_t)p * count + track_shuffle_at(&s, p)]++;
+        }
+        seed = track_shuffle_next_seed(seed);
+    }
+    double expected = (double)passes / count;
+    double chi2 = 0.0;
+    for (size_t i = 0; i < (size_t)count * count; ++i) {
+        double d = hits[i] - expected;
+        chi2 += d * d / expected;
+    }
+    free(hits);
+    // Each row and column sums to `passes`, leaving (n-1)^2 degrees of freedom.
+    double df = (double)(count - 1) * (count - 1);
+    double limit = df + CHECK_CHI2_SIGMAS * sqrt(2.0 * df);
+    bool ok = chi2 <= limit;
+    if (s_verbose || !ok) {
+        printf("  %4u tracks, %7u passes: chi2 %8.1f, df %6.0f, limit %8.1f%s\n", (unsigned)count,
+               (unsigned)passes, chi2, df, limit, ok ? "" : "  <-- BIASED");
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    static const uint32_t counts[] = {0, 1, 2, 3, 4, 5, 7, 12, 16, 17, 100, 255, 256, 257, 1000, 4097, 65537, 200000};
+    static const uint32_t uniform_counts[] = {2, 3, 5, 12, 30, 100};
+    bool ok = true;
+
+    uint32_t seed = 0x12345678U;
+    int perms = 0;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        for (int i = 0; i < CHECK_SEEDS; ++i) {
+            ok &= check_permutation(counts[c], seed);
+            seed = track_shuffle_next_seed(seed);
+            perms++;
+        }
+    }
+    // Seeds at the ends of the range too.
+    ok &= check_permutation(1000, 0);
+    ok &= check_permutation(1000, UINT32_MAX);
+    printf("shuffle: %d permutations checked\n", perms + 2);
+
+    bool seeds_ok = true;
+    for (uint32_t i = 0, s = 0xDEADBEEFU; i < 100000; ++i, s = track_shuffle_next_seed(s)) {
+        seeds_ok &= track_shuffle_prev_seed(track_shuffle_next_seed(s)) == s;
+    }
+    printf("shuffle: seed step %s\n", seeds_ok ? "round-trips" : "DOES NOT ROUND-TRIP");
+    ok &= seeds_ok;
+
+    bool uniform = true;
+    for (size_t c = 0; c < sizeof(uniform_counts) / sizeof(uniform_counts[0]); ++c) {
+        uniform &= check_uniform(uniform_counts[c], 0xC0FFEE00U + (uint32_t)c);
+    }
+    printf("shuffle: position x track distribution %s\n", uniform ? "uniform" : "BIASED");
+    ok &= uniform;
+
+    printf(ok ? "shuffle_check: OK\n" : "shuffle_check: FAILED\n");
+    return ok ? 0 : 1;
+}
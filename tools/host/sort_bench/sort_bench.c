@@ -0,0 +1,254 @@
+// track_sort over synthetic folders of 1k, 10k and 50k file names under the
+// catalog's RAM budget (TRACK_CATALOG_SORT_RAM, runs spilled to the cache
+// dir): sort time, peak heap, runs written and run file size, next to an
+// in-RAM qsort of the same names. Every sorted output is checked for count,
+// order and content.
+//
+// Peak heap counts malloc/free calls made while sorting (the link wraps
+// them); stdio's own buffers are not included.
+//
+//   sort_bench [-v] [-n reps]
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "storage_sd_spi.h"
+#include "track_catalog.h"
+#include "track_sort.h"
+
+#define BENCH_NAME_MAX 64
+
+static bool s_verbose = false;
+static size_t s_heap_live = 0;
+static size_t s_heap_peak = 0;
+static size_t s_heap_base = 0;
+
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    void *p = __real_malloc(size);
+    if (p) {
+        s_heap_live += malloc_usable_size(p);
+        if (s_heap_live > s_heap_peak) {
+            s_heap_peak = s_heap_live;
+        }
+    }
+    return p;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        s_heap_live -= malloc_usable_size(ptr);
+    }
+    __real_free(ptr);
+}
+
+// Peak above what is live now.
+static void heap_reset_peak(void)
+{
+    s_heap_base = s_heap_live;
+    s_heap_peak = s_heap_live;
+}
+
+static size_t heap_peak(void)
+{
+    return s_heap_peak - s_heap_base;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint32_t lcg_next(uint32_t *state)
+{
+    *state = *state * 1664525U + 1013904223U;
+    return *state >> 8;
+}
+
+// A mix of what folders hold: numbered album tracks, camera-style 8.3
+// names, and free-form titles with numbers in the middle.
+static void make_name(char *out, uint32_t i, uint32_t *rng)
+{
+    static const char *const words[] = {"Alpha", "bravo", "Charlie", "delta", "Echo", "foxtrot",
+                                        "Golf",  "hotel", "India",   "juliet", "Kilo", "lima"};
+    uint32_t r = lcg_next(rng);
+    const char *w1 = words[r % 12];
+    const char *w2 = words[(r / 12) % 12];
+    switch ((r / 144) % 4) {
+    case 0:
+        snprintf(out, BENCH_NAME_MAX, "%02u - %s %s.mp3", (unsigned)(r % 40 + 1), w1, w2);
+        break;
+    case 1:
+        snprintf(out, BENCH_NAME_MAX, "TRACK%03u.MP3", (unsigned)(r % 1000));
+        break;
+    case 2:
+        snprintf(out, BENCH_NAME_MAX, "%s %u %s part %u.mp3", w1, (unsigned)(r % 200), w2, (unsigned)(r % 7));
+        break;
+    default:
+        snprintf(out, BENCH_NAME_MAX, "%s-%s (%u).wav", w2, w1, (unsigned)(r % 100));
+        break;
+    }
+    // Keep every name distinct so the content check is exact.
+    size_t len = strlen(out);
+    snprintf(out + len, BENCH_NAME_MAX - len, "#%u", (unsigned)i);
+}
+
+// Order-independent digest of a set of names.
+static uint64_t names_digest(uint64_t acc, const char *name)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (const char *p = name; *p; ++p) {
+        h = (h ^ (uint8_t)*p) * 1099511628211ULL;
+    }
+    return acc + h;
+}
+
+static int qsort_cmp(const void *a, const void *b)
+{
+    return track_sort_natural_cmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+typedef struct {
+    double ms;
+    size_t peak;
+    uint32_t runs;
+    long run_bytes;
+} bench_result_t;
+
+static bool bench_track_sort(char **names, uint32_t count, uint64_t digest, const char *run_path,
+                             bench_result_t *res)
+{
+    track_sort_t s;
+    heap_reset_peak();
+    double t0 = now_ms();
+    bool ok = track_sort_begin(&s, TRACK_CATALOG_SORT_RAM, run_path);
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        ok = track_sort_add(&s, names[i]);
+    }
+    res->runs = s.run_count + (s.items > 0 && s.run_count > 0 ? 1 : 0);
+    ok = ok && track_sort_finish(&s);
+    struct stat st;
+    res->run_bytes = (ok && s.runs && stat(run_path, &st) == 0) ? (long)st.st_size : 0;
+
+    const char *prev = NULL;
+    char prev_buf[BENCH_NAME_MAX];
+    uint32_t got = 0;
+    uint64_t sum = 0;
+    const char *item;
+    while (ok && (item = track_sort_next(&s)) != NULL) {
+        if (prev && track_sort_natural_cmp(prev, item) > 0) {
+            printf("  %u names: \"%s\" after \"%s\"\n", (unsigned)count, item, prev);
+            ok = false;
+        }
+        sum = names_digest(sum, item);
+        snprintf(prev_buf, sizeof(prev_buf), "%s", item);
+        prev = prev_buf;
+        got++;
+    }
+    ok = ok && !s.failed;
+    track_sort_end(&s);
+    res->ms = now_ms() - t0;
+    res->peak = heap_peak();
+    if (ok && (got != count || sum != digest)) {
+        printf("  %u names: %u came back, %s\n", (unsigned)count, (unsigned)got,
+               sum != digest ? "contents differ" : "contents match");
+        ok = false;
+    }
+    return ok;
+}
+
+// The whole folder in RAM: copies of the names plus a pointer array.
+static void bench_qsort(char **names, uint32_t count, bench_result_t *res)
+{
+    heap_reset_peak();
+    double t0 = now_ms();
+    char **v = malloc(count * sizeof(char *));
+    for (uint32_t i = 0; v && i < count; ++i) {
+        size_t len = strlen(names[i]) + 1;
+        v[i] = malloc(len);
+        memcpy(v[i], names[i], len);
+    }
+    if (v) {
+        qsort(v, count, sizeof(char *), qsort_cmp);
+        for (uint32_t i = 0; i < count; ++i) {
+            free(v[i]);
+        }
+    }
+    free(v);
+    res->ms = now_ms() - t0;
+    res->peak = heap_peak();
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 3;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    static const uint32_t counts[] = {1000, 10000, 50000};
+    char run_path[256];
+    storage_sd_ensure_dir(storage_sd_host_cache_dir());
+    snprintf(run_path, sizeof(run_path), "%s/TRACKS.RUN", storage_sd_host_cache_dir());
+
+    printf("sort budget %u bytes\n", (unsigned)TRACK_CATALOG_SORT_RAM);
+    printf("%6s  %10s %10s %5s %10s   %10s %10s\n", "names", "sort ms", "peak B", "runs", "run file B",
+           "qsort ms", "peak B");
+    bool ok = true;
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        uint32_t count = counts[c];
+        char **names = malloc(count * sizeof(char *));
+        uint64_t digest = 0;
+        uint32_t rng = 0x5EED0000U + (uint32_t)c;
+        for (uint32_t i = 0; i < count; ++i) {
+            names[i] = malloc(BENCH_NAME_MAX);
+            make_name(names[i], i, &rng);
+            digest = names_digest(digest, names[i]);
+        }
+
+        bench_result_t best = {0};
+        bench_result_t ref = {0};
+        for (int r = 0; r < reps; ++r) {
+            bench_result_t res;
+            bench_result_t q;
+            ok &= bench_track_sort(names, count, digest, run_path, &res);
+            bench_qsort(names, count, &q);
+            if (r == 0 || res.ms < best.ms) {
+                best = res;
+            }
+            if (r == 0 || q.ms < ref.ms) {
+                ref = q;
+            }
+            if (s_verbose) {
+                printf("  rep %d: %.2f ms, qsort %.2f ms\n", r, res.ms, q.ms);
+            }
+        }
+        printf("%6u  %10.2f %10zu %5u %10ld   %10.2f %10zu\n", (unsigned)count, best.ms, best.peak,
+               (unsigned)best.runs, best.run_bytes, ref.ms, ref.peak);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            free(names[i]);
+        }
+        free(names);
+    }
+    printf(ok ? "sort_bench: OK\n" : "sort_bench: FAILED\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+// Player state readers against the decode task, on the real player task
+// (audio_player.c over the host mixer and DAC). Three reader tasks poll the
+// state once a millisecond the way the display loop does, while a control
+// task pauses, resumes and skips every 40 ms. Lock traffic is counted by
+// wrapping the FreeRTOS primitives at link time: every mutex take (a
+// semaphore created full with a count of one) and every critical section
+// entered, by whom, whether it was held at the time and for how long the
+// taker then waited. When the decode task ("audio_player") finds a lock
+// held, the holder is recorded: a reader or the control task holding a lock
+// the decode task needs is a priority inversion on the board.
+//
+// The same load runs twice:
+//   - before: each display pass makes the five getter calls the old loop
+//     made at most (state twice, track index twice, count), and every
+//     control call posts, each under one API mutex, as when all of them took
+//     s_api_mutex;
+//   - now: one audio_player_get_status() and the scan progress per pass,
+//     commands posted as they are.
+// Now, readers and control calls may take no lock at all, and the decode
+// task may never wait for a lock either of them holds.
+//
+// Snapshots must be states the player published. Under playback each one is
+// checked for consistency (index within count, elapsed within total); before
+// the task starts, the API publishes itself and the check is exact: a
+// writer alternately sets seed k and repeat mode k % 3, so a snapshot's seed
+// fixes the two repeat modes it may carry, and seeds may never go backwards.
+//
+//   status_check [-v] [-n ms]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "audio_mixer.h"
+#include "audio_output_host.h"
+#include "audio_player.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_corpus.h"
+
+#define CHECK_SPEED 4.0                 // DAC runs this much faster than real time
+#define CHECK_READERS 3
+#define CHECK_READ_BATCH 64             // snapshots a stress reader takes between yields
+#define CHECK_CONTROL_MS 40
+#define CHECK_OLD_GETTERS 5
+#define CHECK_MAX_MUTEXES 16
+#define CHECK_MAX_THREADS 32
+#define CHECK_MUSIC_DIR STORAGE_SD_CACHE_DIR "/music"
+
+static const char *const s_files[] = {"cbr128_44k_js.mp3", "cbr192_44k_js.mp3", "cbr320_44k_st.mp3",
+                                      "vbr_44k_js.mp3"};
+
+typedef enum {
+    ROLE_OTHER = 0,
+    ROLE_DECODE,
+    ROLE_READER,
+    ROLE_CONTROL,
+    ROLE_COUNT
+} check_role_t;
+
+static const char *const s_role_names[ROLE_COUNT] = {"other", "decode", "readers", "control"};
+
+typedef enum {
+    MODE_STRESS = 0,
+    MODE_BEFORE,
+    MODE_NOW,
+} check_mode_t;
+
+typedef struct {
+    uint64_t takes;
+    uint64_t held;          // found the lock taken by another task
+    int64_t wait_us;        // spent waiting on those
+    int64_t max_us;
+} lock_stats_t;
+
+typedef struct {
+    uint64_t passes;
+    uint64_t reads;
+    uint64_t bad;
+} reader_result_t;
+
+static bool s_verbose = false;
+static volatile check_mode_t s_mode = MODE_STRESS;
+static volatile bool s_running = false;
+static int s_tasks_done = 0;
+static SemaphoreHandle_t s_old_api = NULL;     // s_api_mutex as the old getters took it
+static reader_result_t s_readers[CHECK_READERS];
+static uint64_t s_commands = 0;
+
+static lock_stats_t s_stats[ROLE_COUNT];
+static lock_stats_t s_decode_on[ROLE_COUNT];    // decode task waits, by the holder's role
+
+static QueueHandle_t s_mutexes[CHECK_MAX_MUTEXES];
+static int s_mutex_holder[CHECK_MAX_MUTEXES];
+static int s_mutex_count = 0;
+
+static pthread_t s_threads[CHECK_MAX_THREADS];
+static int s_thread_roles[CHECK_MAX_THREADS];
+static int s_thread_count = 0;
+static __thread int s_role = -1;
+
+SemaphoreHandle_t __real_xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+BaseType_t __real_xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks);
+BaseType_t __real_xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks);
+void __real_host_mux_enter(portMUX_TYPE *mux);
+
+static int check_role(void)
+{
+    if (s_role >= 0) {
+        return s_role;
+    }
+    const char *name = pcTaskGetName(xTaskGetCurrentTaskHandle());
+    s_role = (strcmp(name, "audio_player") == 0) ? ROLE_DECODE
+             : (strcmp(name, "ui_reader") == 0)  ? ROLE_READER
+             : (strcmp(name, "ui_control") == 0) ? ROLE_CONTROL
+                                                 : ROLE_OTHER;
+    int slot = __atomic_fetch_add(&s_thread_count, 1, __ATOMIC_RELAXED);
+    if (slot < CHECK_MAX_THREADS) {
+        s_thread_roles[slot] = s_role;
+        __atomic_store_n(&s_threads[slot], pthread_self(), __ATOMIC_RELEASE);
+    }
+    return s_role;
+}
+
+static int thread_role(pthread_t thread)
+{
+    int n = __atomic_load_n(&s_thread_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n && i < CHECK_MAX_THREADS; ++i) {
+        if (pthread_equal(__atomic_load_n(&s_threads[i], __ATOMIC_ACQUIRE), thread)) {
+            return s_thread_roles[i];
+        }
+    }
+    return ROLE_OTHER;
+}
+
+static void stats_add(lock_stats_t *s, bool held, int64_t wait_us)
+{
+    __atomic_fetch_add(&s->takes, 1, __ATOMIC_RELAXED);
+    if (!held) {
+        return;
+    }
+    __atomic_fetch_add(&s->held, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->wait_us, wait_us, __ATOMIC_RELAXED);
+    int64_t max = __atomic_load_n(&s->max_us, __ATOMIC_RELAXED);
+    while (wait_us > max &&
+           !__atomic_compare_exchange_n(&s->max_us, &max, wait_us, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void note_take(int role, int holder, int64_t wait_us)
+{
+    stats_add(&s_stats[role], holder >= 0, wait_us);
+    if (role == ROLE_DECODE && holder >= 0) {
+        stats_add(&s_decode_on[holder], true, wait_us);
+    }
+}
+
+static int find_mutex(QueueHandle_t q)
+{
+    int n = __atomic_load_n(&s_mutex_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; ++i) {
+        if (s_mutexes[i] == q) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SemaphoreHandle_t __wrap_xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t q = __real_xSemaphoreCreateCounting(max, initial);
+    if (q && max == 1 && initial == 1) {
+        int slot = __atomic_load_n(&s_mutex_count, __ATOMIC_RELAXED);
+        if (slot < CHECK_MAX_MUTEXES) {
+            s_mutexes[slot] = q;
+            s_mutex_holder[slot] = -1;
+            __atomic_store_n(&s_mutex_count, slot + 1, __ATOMIC_RELEASE);
+        }
+    }
+    return q;
+}
+
+BaseType_t __wrap_xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    int m = find_mutex(q);
+    if (m < 0) {
+        return __real_xQueueReceive(q, item, ticks);
+    }
+    int role = check_role();
+    int holder = (uxQueueMessagesWaiting(q) == 0) ? __atomic_load_n(&s_mutex_holder[m], __ATOMIC_RELAXED) : -1;
+    int64_t t0 = esp_timer_get_time();
+    BaseType_t ok = __real_xQueueReceive(q, item, ticks);
+    int64_t waited = esp_timer_get_time() - t0;
+    if (ok) {
+        __atomic_store_n(&s_mutex_holder[m], role, __ATOMIC_RELAXED);
+        note_take(role, holder, waited);
+    }
+    return ok;
+}
+
+BaseType_t __wrap_xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    int m = find_mutex(q);
+    if (m >= 0) {
+        __atomic_store_n(&s_mutex_holder[m], -1, __ATOMIC_RELAXED);
+    }
+    return __real_xQueueSend(q, item, ticks);
+}
+
+void __wrap_host_mux_enter(portMUX_TYPE *mux)
+{
+    pthread_t me = pthread_self();
+    int depth = __atomic_load_n(&mux->depth, __ATOMIC_RELAXED);
+    if (depth > 0 && pthread_equal(mux->owner, me)) {
+        __real_host_mux_enter(mux);     // nested: not a take
+        return;
+    }
+    int role = check_role();
+    int holder = (depth > 0) ? thread_role(mux->owner) : -1;
+    int64_t t0 = esp_timer_get_time();
+    __real_host_mux_enter(mux);
+    note_take(role, holder, esp_timer_get_time() - t0);
+}
+
+// Seqlock stress: the writer's seeds count up from 1, repeat mode k % 3
+// follows seed k.
+static bool stress_valid(const audio_player_status_t *st, uint32_t *last_seed)
+{
+    uint32_t s = st->shuffle_seed;
+    bool ok = s >= *last_seed && st->state == PLAYER_STATE_STOPPED && st->track_index == 0 &&
+              st->track_count == 0 && st->elapsed_ms == 0 && st->total_ms == 0;
+    if (s == 0) {
+        ok = ok && st->repeat_mode == PLAYER_REPEAT_ALL;
+    } else {
+        ok = ok && (st->repeat_mode == (audio_repeat_mode_t)((s - 1) % 3) ||
+                    st->repeat_mode == (audio_repeat_mode_t)(s % 3));
+    }
+    *last_seed = s;
+    return ok;
+}
+
+static bool playing_valid(const audio_player_status_t *st)
+{
+    return st->state <= PLAYER_STATE_PAUSED && st->repeat_mode <= PLAYER_REPEAT_SHUFFLE &&
+           st->track_index <= st->track_count && (st->total_ms == 0 || st->elapsed_ms <= st->total_ms);
+}
+
+static void old_lock(void)
+{
+    xSemaphoreTake(s_old_api, portMAX_DELAY);
+}
+
+static void old_unlock(void)
+{
+    xSemaphoreGive(s_old_api);
+}
+
+// One display pass, as the loop reads the player before and after the snapshot.
+static bool display_pass(check_mode_t mode)
+{
+    audio_player_status_t st;
+    if (mode == MODE_NOW) {
+        uint32_t found = 0;
+        audio_player_get_status(&st);
+        audio_player_get_scan_progress(&found);
+        return playing_valid(&st);
+    }
+    // Index and count come from separate calls here, so only the state is checked.
+    bool ok = true;
+    for (int i = 0; i < CHECK_OLD_GETTERS; ++i) {
+        old_lock();
+        if (i < 2) {
+            ok = ok && audio_player_get_state() <= PLAYER_STATE_PAUSED;
+        } else if (i < 4) {
+            (void)audio_player_get_track_index();
+        } else {
+            (void)audio_player_get_track_count();
+        }
+        old_unlock();
+    }
+    return ok;
+}
+
+static void reader_task(void *arg)
+{
+    reader_result_t *r = arg;
+    uint32_t last_seed = 0;
+    while (s_running) {
+        if (s_mode == MODE_STRESS) {
+            for (int i = 0; i < CHECK_READ_BATCH; ++i) {
+                audio_player_status_t st;
+                audio_player_get_status(&st);
+                if (!stress_valid(&st, &last_seed)) {
+                    r->bad++;
+                }
+            }
+            r->reads += CHECK_READ_BATCH;
+            sched_yield();
+            continue;
+        }
+        if (!display_pass(s_mode)) {
+            r->bad++;
+        }
+        r->passes++;
+        vTaskDelay(1);
+    }
+    __atomic_fetch_add(&s_tasks_done, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+static void control_task(void *arg)
+{
+    (void)arg;
+    static void (*const ops[])(void) = {audio_player_pause, audio_player_play, audio_player_next,
+                                        audio_player_prev};
+    uint32_t n = 0;
+    while (s_running) {
+        vTaskDelay(pdMS_TO_TICKS(CHECK_CONTROL_MS));
+        bool old = (s_mode == MODE_BEFORE);
+        if (old) {
+            old_lock();
+        }
+        ops[n++ % (sizeof(ops) / sizeof(ops[0]))]();
+        if (old) {
+            old_unlock();
+        }
+        s_commands++;
+    }
+    __atomic_fetch_add(&s_tasks_done, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+static bool start_tasks(bool control)
+{
+    __atomic_store_n(&s_tasks_done, 0, __ATOMIC_RELAXED);
+    memset(s_readers, 0, sizeof(s_readers));
+    s_commands = 0;
+    s_running = true;
+    bool ok = true;
+    for (int i = 0; i < CHECK_READERS; ++i) {
+        ok = ok && xTaskCreate(reader_task, "ui_reader", 4096, &s_readers[i], 3, NULL) == pdPASS;
+    }
+    if (control) {
+        ok = ok && xTaskCreate(control_task, "ui_control", 4096, NULL, 5, NULL) == pdPASS;
+    }
+    return ok;
+}
+
+static void stop_tasks(int count)
+{
+    s_running = false;
+    while (__atomic_load_n(&s_tasks_done, __ATOMIC_ACQUIRE) < count) {
+        vTaskDelay(1);
+    }
+}
+
+static reader_result_t reader_totals(void)
+{
+    reader_result_t t = {0};
+    for (int i = 0; i < CHECK_READERS; ++i) {
+        t.passes += s_readers[i].passes;
+        t.reads += s_readers[i].reads;
+        t.bad += s_readers[i].bad;
+    }
+    return t;
+}
+
+static bool run_stress(int ms)
+{
+    if (!start_tasks(false)) {
+        return false;
+    }
+    uint32_t k = 0;
+    int64_t end = esp_timer_get_time() + (int64_t)ms * 1000;
+    while (esp_timer_get_time() < end) {
+        ++k;
+        audio_player_set_shuffle_seed(k);
+        audio_player_set_repeat_mode((audio_repeat_mode_t)(k % 3));
+    }
+    stop_tasks(CHECK_READERS);
+    reader_result_t t = reader_totals();
+    printf("seqlock, %d readers: %llu snapshots over %u publishes, %llu not published\n", CHECK_READERS,
+           (unsigned long long)t.reads, (unsigned)k * 2, (unsigned long long)t.bad);
+    return t.bad == 0 && t.reads > 0;
+}
+
+static void print_stats(const char *label, const lock_stats_t *s)
+{
+    printf("  %-22s %9llu takes, %6llu found held, longest wait %lld us\n", label, (unsigned long long)s->takes,
+           (unsigned long long)s->held, (long long)s->max_us);
+}
+
+static bool run_load(check_mode_t mode, int ms)
+{
+    memset(s_stats, 0, sizeof(s_stats));
+    memset(s_decode_on, 0, sizeof(s_decode_on));
+    s_mode = mode;
+    if (!start_tasks(true)) {
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    stop_tasks(CHECK_READERS + 1);
+    audio_player_play();    // the control task may have left it paused
+
+    reader_result_t t = reader_totals();
+    lock_stats_t inversion = s_decode_on[ROLE_READER];
+    inversion.held += s_decode_on[ROLE_CONTROL].held;
+    if (s_decode_on[ROLE_CONTROL].max_us > inversion.max_us) {
+        inversion.max_us = s_decode_on[ROLE_CONTROL].max_us;
+    }
+    printf("%s: %llu display passes, %llu commands, %llu inconsistent snapshots\n",
+           mode == MODE_BEFORE ? "before" : "now", (unsigned long long)t.passes, (unsigned long long)s_commands,
+           (unsigned long long)t.bad);
+    print_stats("readers", &s_stats[ROLE_READER]);
+    print_stats("control", &s_stats[ROLE_CONTROL]);
+    print_stats("decode, any lock", &s_stats[ROLE_DECODE]);
+    printf("  %-22s %9llu waits, longest %lld us\n", "decode, held by UI", (unsigned long long)inversion.held,
+           (long long)inversion.max_us);
+    if (s_verbose) {
+        for (int r = 0; r < ROLE_COUNT; ++r) {
+            if (s_decode_on[r].held > 0) {
+                printf("    decode waited on %s: %llu, %lld us in all\n", s_role_names[r],
+                       (unsigned long long)s_decode_on[r].held, (long long)s_decode_on[r].wait_us);
+            }
+        }
+    }
+
+    bool ok = t.bad == 0 && t.passes > 0 && s_commands > 0 && inversion.held == 0;
+    if (mode == MODE_BEFORE) {
+        ok = ok && s_stats[ROLE_READER].takes == t.passes * CHECK_OLD_GETTERS;
+    } else {
+        ok = ok && s_stats[ROLE_READER].takes == 0 && s_stats[ROLE_CONTROL].takes == 0;
+    }
+    return ok;
+}
+
+// The corpus tracks at 44.1 kHz, linked into a folder of their own.
+static bool make_library(void)
+{
+    host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int nfiles = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    mkdir(STORAGE_SD_CACHE_DIR, 0755);
+    mkdir(CHECK_MUSIC_DIR, 0755);
+    for (size_t i = 0; i < sizeof(s_files) / sizeof(s_files[0]); ++i) {
+        const host_corpus_file_t *file = host_corpus_find(files, nfiles, s_files[i]);
+        char src[256];
+        char dst[256];
+        if (!file) {
+            return false;
+        }
+        host_corpus_path(file, src, sizeof(src));
+        snprintf(dst, sizeof(dst), "%s/%s", CHECK_MUSIC_DIR, s_files[i]);
+        unlink(dst);
+        if (symlink(src, dst) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int ms = 1500;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ms = atoi(argv[++i]);
+        }
+    }
+    if (ms < 100) {
+        ms = 100;
+    }
+    s_old_api = xSemaphoreCreateMutex();
+    if (!s_old_api || !make_library()) {
+        printf("status_check: FAILED (setup)\n");
+        return 1;
+    }
+
+    bool ok = run_stress(ms);
+    host_i2s_start(44100, CHECK_SPEED, NULL, NULL);
+    if (audio_mixer_init() != ESP_OK || audio_player_init(CHECK_MUSIC_DIR) != ESP_OK) {
+        printf("status_check: FAILED (player)\n");
+        return 1;
+    }
+    audio_player_set_volume(128);
+    audio_player_play();
+    ok = run_load(MODE_BEFORE, ms) && ok;
+    ok = run_load(MODE_NOW, ms) && ok;
+    if (audio_player_get_track_count() != sizeof(s_files) / sizeof(s_files[0])) {
+        printf("  %u tracks found, expected %u\n", (unsigned)audio_player_get_track_count(),
+               (unsigned)(sizeof(s_files) / sizeof(s_files[0])));
+        ok = false;
+    }
+    audio_player_shutdown();
+    host_i2s_stop();
+    printf("status_check: %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#include "audio_output_host.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_pcm5102.h"
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t s_dac;
+static bool s_running = false;
+static int16_t s_queue[HOST_I2S_QUEUE_FRAMES * 2];
+static size_t s_queue_head = 0;     // next frame the DAC plays
+static size_t s_queue_len = 0;
+static uint64_t s_written = 0;
+static uint64_t s_played = 0;
+static uint32_t s_rate = 44100;
+static uint32_t s_underruns = 0;
+static double s_speed = 1.0;
+static host_i2s_tap_t s_tap = NULL;
+static void *s_tap_user = NULL;
+
+static void *host_dac_thread(void *arg)
+{
+    (void)arg;
+    static int16_t buf[HOST_I2S_DMA_FRAMES * 2];
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    pthread_mutex_lock(&s_lock);
+    while (s_running) {
+        long period_ns = (long)(1e9 * HOST_I2S_DMA_FRAMES / s_rate / s_speed);
+        pthread_mutex_unlock(&s_lock);
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        // A hardware DAC never stalls: if the host held this thread for more
+        // than a period, the clock pauses instead of playing the missed
+        // buffers back to back and draining the queue behind everyone's back.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec - next.tv_sec) * 1000000000L + (now.tv_nsec - next.tv_nsec) > period_ns) {
+            next = now;
+        }
+        pthread_mutex_lock(&s_lock);
+        size_t n = s_queue_len < HOST_I2S_DMA_FRAMES ? s_queue_len : HOST_I2S_DMA_FRAMES;
+        for (size_t i = 0; i < n; ++i) {
+            size_t at = (s_queue_head + i) % HOST_I2S_QUEUE_FRAMES;
+            buf[i * 2] = s_queue[at * 2];
+            buf[i * 2 + 1] = s_queue[at * 2 + 1];
+        }
+        s_queue_head = (s_queue_head + n) % HOST_I2S_QUEUE_FRAMES;
+        s_queue_len -= n;
+        s_played += n;
+        if (n == 0) {
+            s_underruns++;
+        }
+        pthread_cond_broadcast(&s_cond);
+        host_i2s_tap_t tap = s_tap;
+        void *user = s_tap_user;
+        pthread_mutex_unlock(&s_lock);
+        if (tap && n > 0) {
+            tap(buf, n, user);
+        }
+        pthread_mutex_lock(&s_lock);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return NULL;
+}
+
+void host_i2s_start(uint32_t rate, double speed, host_i2s_tap_t tap, void *user)
+{
+    pthread_mutex_lock(&s_lock);
+    s_rate = rate;
+    s_speed = speed;
+    s_tap = tap;
+    s_tap_user = user;
+    s_underruns = 0;
+    s_running = true;
+    pthread_mutex_unlock(&s_lock);
+    pthread_create(&s_dac, NULL, host_dac_thread, NULL);
+}
+
+void host_i2s_stop(void)
+{
+    pthread_mutex_lock(&s_lock);
+    bool was = s_running;
+    s_running = false;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    if (was) {
+        pthread_join(s_dac, NULL);
+    }
+}
+
+uint32_t host_i2s_underruns(void)
+{
+    pthread_mutex_lock(&s_lock);
+    uint32_t n = s_underruns;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+void audio_output_render(const int32_t *mix, int16_t *out, size_t frames)
+{
+    for (size_t i = 0; i < frames * 2; ++i) {
+        int32_t v = mix[i] >> AUDIO_OUTPUT_FRAC_BITS;
+        out[i] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+    }
+}
+
+size_t audio_output_latency_frames(void)
+{
+    return 0;
+}
+
+esp_err_t audio_i2s_write(const int16_t *samples, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+{
+    size_t frames = len / (2 * sizeof(int16_t));
+    size_t done = 0;
+    // s_cond runs on the realtime clock.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    while (done < frames) {
+        if (s_queue_len == HOST_I2S_QUEUE_FRAMES) {
+            if (!s_running) {
+                err = ESP_ERR_INVALID_STATE;
+                break;
+            }
+            if (pthread_cond_timedwait(&s_cond, &s_lock, &deadline) == ETIMEDOUT) {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            continue;
+        }
+        size_t at = (s_queue_head + s_queue_len) % HOST_I2S_QUEUE_FRAMES;
+        s_queue[at * 2] = samples[done * 2];
+        s_queue[at * 2 + 1] = samples[done * 2 + 1];
+        s_queue_len++;
+        s_written++;
+        done++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    if (bytes_written) {
+        *bytes_written = done * 2 * sizeof(int16_t);
+    }
+    return err;
+}
+
+uint64_t audio_i2s_get_written_frames(void)
+{
+    pthread_mutex_lock(&s_lock);
+    uint64_t n = s_written;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+uint64_t audio_i2s_get_played_frames(void)
+{
+    pthread_mutex_lock(&s_lock);
+    uint64_t n = s_played;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+uint32_t audio_i2s_get_sample_rate(void)
+{
+    pthread_mutex_lock(&s_lock);
+    uint32_t r = s_rate;
+    pthread_mutex_unlock(&s_lock);
+    return r;
+}
+
+// Reclocking stops the channel on the board, dropping what it had queued.
+esp_err_t audio_i2s_set_sample_rate(uint32_t sample_rate)
+{
+    pthread_mutex_lock(&s_lock);
+    s_rate = sample_rate;
+    s_queue_len = 0;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
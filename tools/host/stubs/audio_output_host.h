@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host build: the output side of audio_pcm5102.c (audio_output_host.c).
+// audio_output_render() drops the fraction bits and clamps; audio_i2s_write()
+// queues into HOST_I2S_QUEUE_FRAMES, like the DMA descriptors, and a DAC
+// thread plays one HOST_I2S_DMA_FRAMES buffer per buffer period, scaled by
+// `speed`, handing what it plays to `tap`. An empty queue plays silence
+// that is not counted as played, as the sent callback does on the board.
+#define HOST_I2S_DMA_FRAMES 384
+#define HOST_I2S_QUEUE_FRAMES (8 * HOST_I2S_DMA_FRAMES)
+
+typedef void (*host_i2s_tap_t)(const int16_t *pcm, size_t frames, void *user);
+
+void host_i2s_start(uint32_t rate, double speed, host_i2s_tap_t tap, void *user);
+void host_i2s_stop(void);
+// DMA buffers that went out with no audio queued since start.
+uint32_t host_i2s_underruns(void);
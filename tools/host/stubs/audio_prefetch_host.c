@@ -0,0 +1,64 @@
+#include "audio_prefetch.h"
+
+#include <stdlib.h>
+#include "esp_heap_caps.h"
+
+#define PREFETCH_MIN_BLOCKS 3
+#define PREFETCH_MAX_BLOCKS_INTERNAL 8
+
+// Host build: no reader task, every read goes straight to the FILE. A ring
+// is still taken from the heap when the caller brings none, as the firmware
+// does, so heap figures match; it is never filled.
+struct audio_prefetch {
+    FILE *f;
+    uint32_t reads;
+    uint8_t *own_ring;
+};
+
+audio_prefetch_t *audio_prefetch_open(FILE *f, uint32_t bytes_per_sec, uint32_t lead_ms,
+                                      uint8_t *ring, size_t ring_bytes)
+{
+    if (lead_ms == 0) {
+        lead_ms = AUDIO_PREFETCH_LEAD_MS_DEFAULT;
+    }
+    audio_prefetch_t *pf = calloc(1, sizeof(*pf));
+    if (!pf) {
+        return NULL;
+    }
+    pf->f = f;
+    if (!ring || ring_bytes < (size_t)PREFETCH_MIN_BLOCKS * AUDIO_PREFETCH_BLOCK_BYTES) {
+        uint64_t lead_bytes = ((uint64_t)bytes_per_sec * lead_ms) / 1000ULL;
+        uint32_t n = (uint32_t)((lead_bytes + AUDIO_PREFETCH_BLOCK_BYTES - 1) / AUDIO_PREFETCH_BLOCK_BYTES);
+        if (n < PREFETCH_MIN_BLOCKS) {
+            n = PREFETCH_MIN_BLOCKS;
+        }
+        if (n > PREFETCH_MAX_BLOCKS_INTERNAL) {
+            n = PREFETCH_MAX_BLOCKS_INTERNAL;
+        }
+        pf->own_ring = heap_caps_malloc((size_t)n * AUDIO_PREFETCH_BLOCK_BYTES, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    }
+    return pf;
+}
+
+size_t audio_prefetch_read(audio_prefetch_t *pf, void *dst, size_t len)
+{
+    pf->reads++;
+    return fread(dst, 1, len, pf->f);
+}
+
+long audio_prefetch_tell(const audio_prefetch_t *pf)
+{
+    return ftell(pf->f);
+}
+
+void audio_prefetch_close(audio_prefetch_t *pf, audio_prefetch_stats_t *stats)
+{
+    if (stats) {
+        *stats = (audio_prefetch_stats_t){0};
+        stats->reads = pf ? pf->reads : 0;
+    }
+    if (pf) {
+        heap_caps_free(pf->own_ring);
+    }
+    free(pf);
+}
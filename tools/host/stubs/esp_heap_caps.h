@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host build: every capability maps to the C heap. SPIRAM requests fail, as
+// on the board (sdkconfig has CONFIG_SPIRAM unset).
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+size_t heap_caps_get_allocated_size(void *ptr);
+// 0 unless host_heap_model() is on.
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+
+// Host only: from here on heap_caps_* allocate first-fit from a fixed block
+// of `bytes`, so largest-free-block and fragmentation mean what they do on
+// the board. Allocations made before keep going to the C heap.
+void host_heap_model(size_t bytes);
+// heap_caps_malloc/calloc calls served by the model so far.
+uint32_t host_heap_model_allocs(void);
@@ -0,0 +1,150 @@
+#include "esp_heap_caps.h"
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_HEAP_ALIGN 8
+#define HOST_HEAP_MAX_BLOCKS 1024
+
+// Model heap: live blocks sorted by offset, free space is the gaps between them.
+typedef struct {
+    size_t off;
+    size_t size;
+} host_block_t;
+
+static uint8_t *s_heap = NULL;
+static size_t s_heap_size = 0;
+static host_block_t s_blocks[HOST_HEAP_MAX_BLOCKS];
+static int s_block_count = 0;
+static uint32_t s_allocs = 0;
+
+void host_heap_model(size_t bytes)
+{
+    free(s_heap);
+    s_heap = malloc(bytes);
+    s_heap_size = s_heap ? bytes : 0;
+    s_block_count = 0;
+    s_allocs = 0;
+}
+
+uint32_t host_heap_model_allocs(void)
+{
+    return s_allocs;
+}
+
+static bool host_heap_owns(const void *ptr)
+{
+    return s_heap && (const uint8_t *)ptr >= s_heap && (const uint8_t *)ptr < s_heap + s_heap_size;
+}
+
+static int host_heap_find(const void *ptr)
+{
+    size_t off = (size_t)((const uint8_t *)ptr - s_heap);
+    for (int i = 0; i < s_block_count; ++i) {
+        if (s_blocks[i].off == off) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *host_heap_take(size_t size)
+{
+    size_t need = (size + HOST_HEAP_ALIGN - 1) & ~(size_t)(HOST_HEAP_ALIGN - 1);
+    if (need == 0 || s_block_count == HOST_HEAP_MAX_BLOCKS) {
+        return NULL;
+    }
+    size_t at = 0;
+    int i = 0;
+    for (; i <= s_block_count; ++i) {
+        size_t end = (i < s_block_count) ? s_blocks[i].off : s_heap_size;
+        if (end - at >= need) {
+            break;
+        }
+        if (i < s_block_count) {
+            at = s_blocks[i].off + s_blocks[i].size;
+        }
+    }
+    if (i > s_block_count) {
+        return NULL;
+    }
+    memmove(&s_blocks[i + 1], &s_blocks[i], (size_t)(s_block_count - i) * sizeof(s_blocks[0]));
+    s_blocks[i] = (host_block_t){at, need};
+    s_block_count++;
+    s_allocs++;
+    return s_heap + at;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    if (caps & MALLOC_CAP_SPIRAM) {
+        return NULL;
+    }
+    return s_heap ? host_heap_take(size) : malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    void *p = heap_caps_malloc(n * size, caps);
+    if (p) {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+void heap_caps_free(void *ptr)
+{
+    if (!host_heap_owns(ptr)) {
+        free(ptr);
+        return;
+    }
+    int i = host_heap_find(ptr);
+    if (i >= 0) {
+        memmove(&s_blocks[i], &s_blocks[i + 1], (size_t)(s_block_count - i - 1) * sizeof(s_blocks[0]));
+        s_block_count--;
+    }
+}
+
+size_t heap_caps_get_allocated_size(void *ptr)
+{
+    if (!host_heap_owns(ptr)) {
+        return malloc_usable_size(ptr);
+    }
+    int i = host_heap_find(ptr);
+    return (i >= 0) ? s_blocks[i].size : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    if (!s_heap) {
+        return 0;
+    }
+    size_t largest = 0;
+    size_t at = 0;
+    for (int i = 0; i <= s_block_count; ++i) {
+        size_t end = (i < s_block_count) ? s_blocks[i].off : s_heap_size;
+        if (end - at > largest) {
+            largest = end - at;
+        }
+        if (i < s_block_count) {
+            at = s_blocks[i].off + s_blocks[i].size;
+        }
+    }
+    return largest;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    if (!s_heap) {
+        return 0;
+    }
+    size_t used = 0;
+    for (int i = 0; i < s_block_count; ++i) {
+        used += s_blocks[i].size;
+    }
+    return s_heap_size - used;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host build: a fixed pseudo-random sequence, so runs repeat.
+uint32_t esp_random(void);
@@ -0,0 +1,14 @@
+#include "esp_random.h"
+
+static uint32_t s_state = 0x2545F491U;
+
+// xorshift32, not thread-safe: the callers only need a seed.
+uint32_t esp_random(void)
+{
+    uint32_t x = s_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s_state = x;
+    return x;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host build: included by the player, which uses nothing from it here.
@@ -0,0 +1,363 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    const char *name;
+    UBaseType_t prio;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *items;
+};
+
+static __thread struct host_task *s_self = NULL;
+static volatile int s_tasks_started = 0;
+static pthread_once_t s_start_once = PTHREAD_ONCE_INIT;
+static struct timespec s_start;
+
+static void host_start_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_start);
+}
+
+// Absolute CLOCK_MONOTONIC deadline `ticks` from now.
+static struct timespec host_deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Waits on `cond` until woken, or for `ticks` (0: not at all). False on timeout.
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                           const struct timespec *deadline)
+{
+    if (ticks == 0) {
+        return false;
+    }
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+void host_mux_enter(portMUX_TYPE *mux)
+{
+    pthread_t me = pthread_self();
+    if (mux->depth > 0 && pthread_equal(mux->owner, me)) {
+        mux->depth++;
+        return;
+    }
+    // Once there are tasks, let another one run first: on a single-core
+    // host that is the only way code between two critical sections can see
+    // what the other core would have done meanwhile.
+    if (s_tasks_started) {
+        sched_yield();
+    }
+    pthread_mutex_lock(&mux->lock);
+    mux->owner = me;
+    mux->depth = 1;
+}
+
+void host_mux_exit(portMUX_TYPE *mux)
+{
+    if (--mux->depth == 0) {
+        pthread_mutex_unlock(&mux->lock);
+    }
+}
+
+static struct host_task *host_task_new(const char *name, UBaseType_t prio)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) {
+        abort();
+    }
+    t->name = name;
+    t->prio = prio;
+    pthread_mutex_init(&t->lock, NULL);
+    host_cond_init(&t->cond);
+    return t;
+}
+
+// The main thread, or any other not started by xTaskCreate, gets a handle on first use.
+static struct host_task *host_self(void)
+{
+    if (!s_self) {
+        s_self = host_task_new("main", 1);
+        s_self->thread = pthread_self();
+    }
+    return s_self;
+}
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *t = arg;
+    s_self = t;
+    t->fn(t->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)stack;
+    (void)core;
+    pthread_once(&s_start_once, host_start_init);
+    struct host_task *t = host_task_new(name, prio);
+    t->fn = fn;
+    t->arg = arg;
+    // The handle is stored before the task runs, as FreeRTOS does.
+    if (handle) {
+        *handle = t;
+    }
+    s_tasks_started = 1;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&t->thread, &attr, host_task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        if (handle) {
+            *handle = NULL;
+        }
+        free(t);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == s_self) {
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {(time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    pthread_once(&s_start_once, host_start_init);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ms = (int64_t)(ts.tv_sec - s_start.tv_sec) * 1000 + (ts.tv_nsec - s_start.tv_nsec) / 1000000L;
+    return (TickType_t)ms;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_self();
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : host_self())->name;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task ? task : host_self())->prio;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    if (!task) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+        case eSetBits:
+            task->notify_value |= value;
+            break;
+        case eIncrement:
+            task->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notify_value = value;
+            break;
+        default:
+            break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct host_task *t = host_self();
+    struct timespec deadline = host_deadline(ticks);
+    pthread_mutex_lock(&t->lock);
+    if (!t->notify_pending) {
+        t->notify_value &= ~clear_on_entry;
+    }
+    while (!t->notify_pending && host_cond_wait(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    BaseType_t got = t->notify_pending ? pdTRUE : pdFALSE;
+    if (value) {
+        *value = t->notify_value;
+    }
+    if (got) {
+        t->notify_value &= ~clear_on_exit;
+        t->notify_pending = false;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return got;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct host_task *t = host_self();
+    struct timespec deadline = host_deadline(ticks);
+    pthread_mutex_lock(&t->lock);
+    while (t->notify_value == 0 && host_cond_wait(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    uint32_t v = t->notify_value;
+    if (v > 0) {
+        t->notify_value = clear ? 0 : v - 1;
+    }
+    t->notify_pending = false;
+    pthread_mutex_unlock(&t->lock);
+    return v;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    if (item_size > 0) {
+        q->items = calloc(length, item_size);
+        if (!q->items) {
+            free(q);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    host_cond_init(&q->cond);
+    return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    struct host_queue *q = xQueueCreate(max, 0);
+    if (q) {
+        q->count = initial;
+    }
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) {
+        return;
+    }
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    free(q->items);
+    free(q);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    struct timespec deadline = host_deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->length && host_cond_wait(&q->cond, &q->lock, ticks, &deadline)) {
+    }
+    BaseType_t ok = pdFALSE;
+    if (q->count < q->length) {
+        if (q->item_size > 0) {
+            UBaseType_t slot = (q->head + q->count) % q->length;
+            memcpy(q->items + (size_t)slot * q->item_size, item, q->item_size);
+        }
+        q->count++;
+        ok = pdTRUE;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    struct timespec deadline = host_deadline(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && host_cond_wait(&q->cond, &q->lock, ticks, &deadline)) {
+    }
+    BaseType_t ok = pdFALSE;
+    if (q->count > 0) {
+        if (q->item_size > 0) {
+            memcpy(item, q->items + (size_t)q->head * q->item_size, q->item_size);
+            q->head = (q->head + 1) % q->length;
+        }
+        q->count--;
+        ok = pdTRUE;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->count = 0;
+    q->head = 0;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
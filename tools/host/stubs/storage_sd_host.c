@@ -0,0 +1,41 @@
+#include "storage_sd_spi.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char *storage_sd_host_cache_dir(void)
+{
+    const char *dir = getenv("HELIX_HOST_CACHE");
+    return (dir && dir[0]) ? dir : "/tmp/helix_host";
+}
+
+esp_err_t storage_sd_ensure_dir(const char *path)
+{
+    if (mkdir(path, 0755) == 0 || errno == EEXIST) {
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+void storage_sd_host_clear_cache(void)
+{
+    const char *dir = storage_sd_host_cache_dir();
+    DIR *d = opendir(dir);
+    if (!d) {
+        return;
+    }
+    struct dirent *e;
+    char path[512];
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host build: caches go to $HELIX_HOST_CACHE (default /tmp/helix_host)
+// instead of the card. Keep it short, mp3_frame_index.c builds 40-byte
+// sidecar paths. A tool may define it as a literal for sources that paste
+// file names onto it (track_catalog.c).
+#ifndef STORAGE_SD_CACHE_DIR
+#define STORAGE_SD_CACHE_DIR storage_sd_host_cache_dir()
+#endif
+
+const char *storage_sd_host_cache_dir(void);
+esp_err_t storage_sd_ensure_dir(const char *path);
+// Removes every file in the cache directory.
+void storage_sd_host_clear_cache(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,267 @@
+// Durations and seek landing points of the player's decode path, checked
+// against a reference: the full linear decode of each corpus file, whose
+// length is pinned to the encoder's ground truth in corpus.txt.
+//
+// Per file: the elapsed time at the end of a full play, then twice - with
+// the frame index that play left behind and, after clearing it, from the
+// Xing/LAME tag or the CBR bitrate estimate - the duration a source reports
+// and, for seeks to 10..90 %, where the decoded audio really starts (located
+// by matching the output against the reference PCM) and where the progress
+// callback claims it starts. The sample rate a source reports must be right
+// before anything is decoded; the crossfade compares it up front.
+//
+//   vbr_check [-v] [file.mp3 ...]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "helix_mp3_wrapper.h"
+#include "host_corpus.h"
+#include "storage_sd_spi.h"
+
+#define CHECK_SPF 1152
+#define CHECK_CAPTURE_FRAMES (8 * CHECK_SPF)
+#define CHECK_SETTLE_FRAMES (2 * CHECK_SPF)     // decoder history after a cold start
+#define CHECK_MATCH_FRAMES CHECK_SPF
+
+typedef struct {
+    int16_t *pcm;           // interleaved stereo
+    size_t frames;
+    size_t cap;
+    int32_t reported_ms;    // first (seeks) or last (reference) elapsed time reported
+    size_t reported_at;     // frames written before that callback
+} capture_t;
+
+static bool s_verbose = false;
+
+static size_t capture_sink(uint8_t *data, size_t len, void *user)
+{
+    capture_t *c = user;
+    size_t frames = len / 4;
+    if (frames > c->cap - c->frames) {
+        frames = c->cap - c->frames;
+    }
+    memcpy(c->pcm + c->frames * 2, data, frames * 4);
+    c->frames += frames;
+    // Stop the decode once there is enough audio to locate.
+    return (c->frames < c->cap) ? len : 0;
+}
+
+static size_t grow_sink(uint8_t *data, size_t len, void *user)
+{
+    capture_t *c = user;
+    size_t frames = len / 4;
+    if (c->frames + frames > c->cap) {
+        size_t cap = (c->cap ? c->cap * 2 : 65536) + frames;
+        int16_t *p = realloc(c->pcm, cap * 4);
+        if (!p) {
+            return 0;
+        }
+        c->pcm = p;
+        c->cap = cap;
+    }
+    memcpy(c->pcm + c->frames * 2, data, len);
+    c->frames += frames;
+    return len;
+}
+
+static void capture_progress(size_t bytes_read, size_t total_bytes, uint32_t elapsed_ms, uint32_t est_total_ms,
+                             void *user)
+{
+    (void)bytes_read;
+    (void)total_bytes;
+    (void)est_total_ms;
+    capture_t *c = user;
+    if (c->reported_ms < 0 && elapsed_ms > 0) {
+        c->reported_ms = (int32_t)elapsed_ms;
+        c->reported_at = c->frames;
+    }
+}
+
+static void last_progress(size_t bytes_read, size_t total_bytes, uint32_t elapsed_ms, uint32_t est_total_ms,
+                          void *user)
+{
+    (void)bytes_read;
+    (void)total_bytes;
+    (void)est_total_ms;
+    ((capture_t *)user)->reported_ms = (int32_t)elapsed_ms;
+}
+
+static uint32_t native_rate(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    return sample_rate;
+}
+
+// Position in `ref` where the settled part of `out` appears, or -1. The
+// corpus music repeats bar-aligned patterns, so take the match nearest `near`.
+static long locate(const capture_t *ref, const capture_t *out, long near)
+{
+    if (out->frames < CHECK_SETTLE_FRAMES + CHECK_MATCH_FRAMES) {
+        return -1;
+    }
+    const int16_t *needle = out->pcm + CHECK_SETTLE_FRAMES * 2;
+    long best = -1;
+    for (size_t p = 0; p + CHECK_MATCH_FRAMES <= ref->frames; ++p) {
+        if (memcmp(ref->pcm + p * 2, needle, CHECK_MATCH_FRAMES * 4) == 0) {
+            long pos = (long)p - CHECK_SETTLE_FRAMES;
+            if (best < 0 || labs(pos - near) < labs(best - near)) {
+                best = pos;
+            }
+        }
+    }
+    return best;
+}
+
+static long ms_of(long frames, uint32_t rate)
+{
+    return (long)((frames * 1000LL) / (long long)rate);
+}
+
+// Duration a source reports before it is played. A tagless stream only
+// knows it after the first frame.
+static long shown_duration_ms(const char *path)
+{
+    helix_mp3_source_t *src = helix_mp3_open(path, 0.0f);
+    int16_t head[CHECK_SPF * 2];
+    long dur_ms = 0;
+    if (src && helix_mp3_source_read(src, head, CHECK_SPF, NULL) > 0) {
+        dur_ms = (long)helix_mp3_source_duration_ms(src);
+    }
+    helix_mp3_close(src);
+    return dur_ms;
+}
+
+static bool check_open_rate(const host_corpus_file_t *file, const char *path)
+{
+    helix_mp3_source_t *src = helix_mp3_open(path, 0.0f);
+    uint32_t rate = helix_mp3_source_sample_rate(src);
+    helix_mp3_close(src);
+    bool ok = rate == file->rate;
+    if (s_verbose || !ok) {
+        printf("%-20s rate   %5u Hz at open, reference %5u Hz%s\n", file->name, (unsigned)rate,
+               (unsigned)file->rate, ok ? "" : "  <-- MISMATCH");
+    }
+    return ok;
+}
+
+static bool check_seeks(const host_corpus_file_t *file, const char *path, const capture_t *ref, long tol_ms)
+{
+    bool ok = true;
+    long worst_land = 0;
+    long worst_report = 0;
+    for (int pct = 10; pct <= 90; pct += 10) {
+        capture_t out = {.pcm = malloc(CHECK_CAPTURE_FRAMES * 4), .cap = CHECK_CAPTURE_FRAMES, .reported_ms = -1};
+        helix_mp3_decode_file(path, capture_sink, native_rate, &out, capture_progress, &out, pct / 100.0f);
+        long target = (long)((double)ref->frames * pct / 100.0);
+        long landed = locate(ref, &out, target);
+        if (landed < 0) {
+            printf("  %3d%%: output not found in the reference\n", pct);
+            ok = false;
+            free(out.pcm);
+            continue;
+        }
+        long land_err = ms_of(landed - target, file->rate);
+        long shown_ms = out.reported_ms - ms_of((long)out.reported_at, file->rate);
+        long report_err = shown_ms - ms_of(landed, file->rate);
+        if (labs(land_err) > labs(worst_land)) {
+            worst_land = land_err;
+        }
+        if (labs(report_err) > labs(worst_report)) {
+            worst_report = report_err;
+        }
+        bool seek_ok = labs(land_err) <= tol_ms && labs(report_err) <= tol_ms;
+        if (s_verbose || !seek_ok) {
+            printf("  %3d%%: target %6ld ms, landed %6ld ms (%+ld), shown %6ld ms (%+ld)%s\n", pct,
+                   ms_of(target, file->rate), ms_of(landed, file->rate), land_err, shown_ms, report_err,
+                   seek_ok ? "" : "  <-- OUT OF TOLERANCE");
+        }
+        ok &= seek_ok;
+        free(out.pcm);
+    }
+    printf("%-20s seeks: worst landing %+ld ms, worst shown position %+ld ms (tolerance %ld ms)\n", "",
+           worst_land, worst_report, tol_ms);
+    return ok;
+}
+
+static bool check_duration(const host_corpus_file_t *file, const char *what, long dur_ms, long true_ms, long tol_ms)
+{
+    bool ok = labs(dur_ms - true_ms) <= tol_ms;
+    printf("%-20s %-6s %5ld ms, reference %5ld ms%s\n", file->name, what, dur_ms, true_ms,
+           ok ? "" : "  <-- MISMATCH");
+    return ok;
+}
+
+static bool check_file(const host_corpus_file_t *file)
+{
+    char path[4096];
+    host_corpus_path(file, path, sizeof(path));
+    bool ok = true;
+
+    // Reference: one uninterrupted decode from the start, which also leaves
+    // the frame index behind.
+    capture_t ref = {.reported_ms = -1};
+    storage_sd_host_clear_cache();
+    if (!helix_mp3_decode_file(path, grow_sink, native_rate, &ref, last_progress, &ref, 0.0f)) {
+        printf("%-20s reference decode failed\n", file->name);
+        free(ref.pcm);
+        return false;
+    }
+    long want_frames = (long)host_corpus_output_frames(file);
+    long true_ms = ms_of(want_frames, file->rate);
+    if ((long)ref.frames != want_frames) {
+        printf("%-20s reference has %zu frames, encoder wrote %ld\n", file->name, ref.frames, want_frames);
+        ok = false;
+    }
+    ok &= check_duration(file, "played", ref.reported_ms, true_ms, 1);
+    ok &= check_open_rate(file, path);
+
+    // Second play: the index gives the duration and sample-exact seeks.
+    ok &= check_duration(file, "index", shown_duration_ms(path), true_ms, 1);
+    ok &= check_seeks(file, path, &ref, 1);
+
+    // First play: Xing/LAME tag, TOC or byte ratio. Tagless CBR durations
+    // are a bitrate estimate.
+    storage_sd_host_clear_cache();
+    ok &= check_duration(file, file->tagged ? "tag" : "cbr", shown_duration_ms(path), true_ms,
+                         file->tagged ? 1 : ms_of(CHECK_SPF, file->rate));
+    ok &= check_seeks(file, path, &ref, ms_of(want_frames, file->rate) / 100 + ms_of(2 * CHECK_SPF, file->rate));
+    free(ref.pcm);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    static host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int count = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    if (count == 0) {
+        return 1;
+    }
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        s_verbose = true;
+        first = 2;
+    }
+    bool ok = true;
+    if (first < argc) {
+        for (int i = first; i < argc; ++i) {
+            const host_corpus_file_t *f = host_corpus_find(files, count, argv[i]);
+            if (!f) {
+                printf("%s: not in corpus.txt\n", argv[i]);
+                ok = false;
+                continue;
+            }
+            ok &= check_file(f);
+        }
+    } else {
+        for (int i = 0; i < count; ++i) {
+            ok &= check_file(&files[i]);
+        }
+    }
+    storage_sd_host_clear_cache();
+    printf(ok ? "vbr_check: OK\n" : "vbr_check: FAILED\n");
+    return ok ? 0 : 1;
+}
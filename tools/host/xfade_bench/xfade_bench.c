@@ -0,0 +1,213 @@
+// Crossfade CPU headroom at 320 kbps. The player's crossfade decodes the
+// current track through helix_mp3_decode_source() while its writer pulls
+// the next one with helix_mp3_source_read() and mixes the two with an
+// equal-power curve, all on the decode task. Here both are
+// cbr320_44k_st.mp3 overlapped for their whole length, as in the player
+// (576-frame pulls, gains interpolated between chunk ends).
+//
+// Reported in per mille of real time on this host:
+//   - the decode load of one track alone;
+//   - the two loads the player adds up against PLAYER_XFADE_MAX_LOAD
+//     (decode only);
+//   - everything the decode task does during the overlap (decode, reads,
+//     mixing).
+// From these it prints how many times slower than this host a core may be
+// before the player falls back to a gapless cut, and before the overlap no
+// longer fits at all.
+//
+// The incoming track, pulled in chunks, must match the same file decoded
+// alone, and the outgoing track must play to its full length. The player's
+// sum may not exceed what the task really spent, since it would then refuse
+// fades that fit.
+//
+//   xfade_bench [-v] [-n reps]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "helix_mp3_wrapper.h"
+#include "host_corpus.h"
+
+#define BENCH_FILE "cbr320_44k_st.mp3"
+#define BENCH_CHUNK 576                 // PLAYER_XFADE_CHUNK
+#define BENCH_MAX_LOAD 700              // PLAYER_XFADE_MAX_LOAD
+
+typedef struct {
+    int16_t *pcm;
+    size_t frames;
+    size_t cap;
+} pcm_buf_t;
+
+typedef struct {
+    helix_mp3_source_t *cur;
+    helix_mp3_source_t *next;   // NULL: the track plays alone
+    pcm_buf_t *incoming;        // what was pulled from `next`, for the check
+    uint64_t pos;
+    uint64_t len;
+    uint64_t frames;            // written by the current track
+    uint32_t cur_load;          // as the player reads them while `cur` is open
+    uint32_t next_load;
+} xfade_t;
+
+static bool s_verbose = false;
+static int16_t s_pull[BENCH_CHUNK * 2];
+
+static bool pcm_append(pcm_buf_t *b, const int16_t *data, size_t frames)
+{
+    if (b->frames + frames > b->cap) {
+        size_t cap = (b->cap ? b->cap * 2 : 65536) + frames;
+        int16_t *p = realloc(b->pcm, cap * 4);
+        if (!p) {
+            return false;
+        }
+        b->pcm = p;
+        b->cap = cap;
+    }
+    memcpy(b->pcm + b->frames * 2, data, frames * 4);
+    b->frames += frames;
+    return true;
+}
+
+static size_t append_sink(uint8_t *data, size_t len, void *user)
+{
+    return pcm_append(user, (const int16_t *)data, len / 4) ? len : 0;
+}
+
+static uint32_t native_rate(uint32_t sample_rate, void *user)
+{
+    (void)user;
+    return sample_rate;
+}
+
+static int32_t xfade_gain(const xfade_t *x, uint64_t pos, bool incoming)
+{
+    float a = (float)pos * ((float)M_PI_2 / (float)x->len);
+    return (int32_t)((incoming ? sinf(a) : cosf(a)) * 32767.0f + 0.5f);
+}
+
+// player_xfade_mix(): the next track is pulled a chunk at a time and mixed
+// into the decoder's slot in place.
+static size_t xfade_sink(uint8_t *data, size_t len, void *user)
+{
+    xfade_t *x = user;
+    int16_t *pcm = (int16_t *)data;
+    size_t frames = len / 4;
+    x->frames += frames;
+    x->cur_load = helix_mp3_source_load(x->cur);
+    while (x->next && frames > 0) {
+        size_t n = (frames < BENCH_CHUNK) ? frames : BENCH_CHUNK;
+        size_t got = helix_mp3_source_read(x->next, s_pull, n, NULL);
+        pcm_append(x->incoming, s_pull, got);
+        memset(s_pull + got * 2, 0, (n - got) * 2 * sizeof(int16_t));
+        int32_t out0 = xfade_gain(x, x->pos, false);
+        int32_t in0 = xfade_gain(x, x->pos, true);
+        int32_t out_step = ((xfade_gain(x, x->pos + n, false) - out0) * 65536) / (int32_t)n;
+        int32_t in_step = ((xfade_gain(x, x->pos + n, true) - in0) * 65536) / (int32_t)n;
+        int32_t g_out = out0 * 65536;
+        int32_t g_in = in0 * 65536;
+        for (size_t i = 0; i < n * 2; i += 2) {
+            int32_t go = g_out >> 16;
+            int32_t gi = g_in >> 16;
+            for (size_t c = 0; c < 2; ++c) {
+                int32_t v = ((int32_t)pcm[i + c] * go + (int32_t)s_pull[i + c] * gi) >> 15;
+                pcm[i + c] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+            }
+            g_out += out_step;
+            g_in += in_step;
+        }
+        x->pos += n;
+        pcm += n * 2;
+        frames -= n;
+        x->next_load = helix_mp3_source_load(x->next);
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 3;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+    host_corpus_file_t files[HOST_CORPUS_MAX_FILES];
+    int nfiles = host_corpus_load(files, HOST_CORPUS_MAX_FILES);
+    const host_corpus_file_t *file = host_corpus_find(files, nfiles, BENCH_FILE);
+    if (!file || helix_mp3_arena_init() != ESP_OK) {
+        printf("xfade_bench: FAILED (setup)\n");
+        return 1;
+    }
+    char path[256];
+    host_corpus_path(file, path, sizeof(path));
+
+    // The incoming track as it sounds on its own.
+    pcm_buf_t alone = {0};
+    helix_mp3_source_t *src = helix_mp3_open(path, 0.0f);
+    bool ok = src && helix_mp3_decode_source(src, append_sink, native_rate, &alone, NULL, NULL);
+    if (!ok || alone.frames == 0) {
+        printf("xfade_bench: FAILED (decode)\n");
+        return 1;
+    }
+    double audio_us = alone.frames * 1e6 / file->rate;
+
+    // Best of `reps` for each figure.
+    uint32_t solo = UINT32_MAX;
+    uint32_t gate = UINT32_MAX;
+    double task = 1e30;
+    for (int r = 0; r < reps && ok; ++r) {
+        xfade_t one = {.cur = helix_mp3_open(path, 0.0f)};
+        ok = one.cur && helix_mp3_decode_source(one.cur, xfade_sink, native_rate, &one, NULL, NULL);
+        solo = (one.cur_load < solo) ? one.cur_load : solo;
+
+        pcm_buf_t incoming = {0};
+        xfade_t x = {.incoming = &incoming, .len = alone.frames};
+        x.cur = helix_mp3_open(path, 0.0f);
+        x.next = helix_mp3_open(path, 0.0f);
+        ok = ok && x.cur && x.next;
+        int64_t t0 = esp_timer_get_time();
+        ok = ok && helix_mp3_decode_source(x.cur, xfade_sink, native_rate, &x, NULL, NULL);
+        double t = (double)(esp_timer_get_time() - t0) * 1000.0 / audio_us;
+        helix_mp3_close(x.next);
+        task = (t < task) ? t : task;
+        uint32_t g = x.cur_load + x.next_load;
+        gate = (g < gate) ? g : gate;
+        if (s_verbose) {
+            printf("  run %d: alone %u, current %u + next %u, task %.1f per mille\n", r, (unsigned)one.cur_load,
+                   (unsigned)x.cur_load, (unsigned)x.next_load, t);
+        }
+
+        if (x.frames != alone.frames || incoming.frames != alone.frames ||
+            memcmp(incoming.pcm, alone.pcm, alone.frames * 4) != 0) {
+            printf("  current %llu frames, incoming %zu, alone %zu%s\n", (unsigned long long)x.frames,
+                   incoming.frames, alone.frames,
+                   incoming.frames == alone.frames ? ", incoming samples differ" : "");
+            ok = false;
+        }
+        free(incoming.pcm);
+    }
+    if (ok) {
+        printf("%s, %.2f s overlapped, per mille of real time on this host:\n", BENCH_FILE, audio_us / 1e6);
+        printf("  one decoder %u, both as the player sums them %u, decode task in the overlap %.1f\n",
+               (unsigned)solo, (unsigned)gate, task);
+        printf("  crossfades on a core up to %.0fx slower (gate %u); fits at all up to %.0fx\n",
+               gate ? (double)BENCH_MAX_LOAD / gate : 0.0, BENCH_MAX_LOAD, task > 0 ? 1000.0 / task : 0.0);
+        if (gate > task) {
+            printf("  the player's sum (%u) is above what the task spent (%.1f)\n", (unsigned)gate, task);
+            ok = false;
+        }
+    }
+    free(alone.pcm);
+    printf("xfade_bench: %s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}